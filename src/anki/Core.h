@@ -7,5 +7,6 @@
 
 #include <anki/core/App.h>
 #include <anki/core/Config.h>
+#include <anki/core/FrameSpikeDetector.h>
 #include <anki/core/NativeWindow.h>
 #include <anki/core/Trace.h>
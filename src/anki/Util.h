@@ -22,21 +22,27 @@
 #include <anki/util/List.h>
 #include <anki/util/Logger.h>
 #include <anki/util/Memory.h>
+#include <anki/util/MemoryTracker.h>
 #include <anki/util/NonCopyable.h>
 #include <anki/util/Hierarchy.h>
+#include <anki/util/IoService.h>
 #include <anki/util/Ptr.h>
 #include <anki/util/Singleton.h>
 #include <anki/util/StdTypes.h>
 #include <anki/util/String.h>
 #include <anki/util/StringList.h>
+#include <anki/util/StringTable.h>
 #include <anki/util/System.h>
 #include <anki/util/Thread.h>
 #include <anki/util/ThreadPool.h>
 #include <anki/util/Visitor.h>
 #include <anki/util/INotify.h>
 #include <anki/util/SparseArray.h>
+#include <anki/util/FlatHashMap.h>
+#include <anki/util/ConcurrentHashMap.h>
 #include <anki/util/ObjectAllocator.h>
 #include <anki/util/Tracer.h>
+#include <anki/util/CpuProfiler.h>
 
 /// @defgroup util Utilities (like STL)
 
@@ -11,7 +11,9 @@
 #include <anki/util/System.h>
 #include <anki/util/ThreadPool.h>
 #include <anki/util/ThreadHive.h>
+#include <anki/util/StringTable.h>
 #include <anki/core/Trace.h>
+#include <anki/core/FrameSpikeDetector.h>
 
 #include <anki/core/NativeWindow.h>
 #include <anki/input/Input.h>
@@ -26,6 +28,7 @@
 #include <anki/core/StagingGpuMemoryManager.h>
 #include <anki/ui/UiManager.h>
 #include <anki/ui/Canvas.h>
+#include <ctime>
 
 #if ANKI_OS == ANKI_OS_ANDROID
 #	include <android_native_app_glue.h>
@@ -39,6 +42,9 @@ namespace anki
 android_app* gAndroidApp = nullptr;
 #endif
 
+static const Array<const char*, U(AppSubsystem::COUNT)> SUBSYSTEM_NAMES = {
+	{"Core", "Gr", "Physics", "Resource", "UI", "Renderer", "Script", "Scene"}};
+
 class App::StatsUi : public UiImmediateModeBuilder
 {
 public:
@@ -80,6 +86,8 @@ public:
 	PtrSize m_allocatedCpuMem = 0;
 	U64 m_allocCount = 0;
 	U64 m_freeCount = 0;
+	Array<MemoryTrackerStats, U(AppSubsystem::COUNT)> m_subsystemMem;
+	Bool8 m_memoryTracking = false;
 
 	U64 m_vkCpuMem = 0;
 	U64 m_vkGpuMem = 0;
@@ -88,8 +96,13 @@ public:
 	static const U32 BUFFERED_FRAMES = 16;
 	U32 m_bufferedFrames = 0;
 
+	static const U32 MAX_ZONE_DEPTH = 2;
+	CpuProfilerFrame m_profilerFrame; ///< Refreshed together with the buffered values.
+	U32 m_zoneRowCount = 0;
+
 	StatsUi(UiManager* ui)
 		: UiImmediateModeBuilder(ui)
+		, m_profilerFrame(getAllocator())
 	{
 	}
 
@@ -102,6 +115,19 @@ public:
 		{
 			flush = true;
 			m_bufferedFrames = 0;
+
+#if ANKI_ENABLE_TRACE
+			if(CoreTracerSingleton::get().m_profilerEnabled)
+			{
+				CoreTracerSingleton::get().m_profiler.getLastFrame(m_profilerFrame);
+
+				m_zoneRowCount = 0;
+				for(const CpuProfilerZone& zone : m_profilerFrame.m_zones)
+				{
+					m_zoneRowCount += zone.m_thread == m_profilerFrame.m_mainThread && zone.m_depth <= MAX_ZONE_DEPTH;
+				}
+			}
+#endif
 		}
 
 		// Start drawing the UI
@@ -111,7 +137,9 @@ public:
 
 		nk_style_push_style_item(ctx, &ctx->style.window.fixed_background, nk_style_item_color(nk_rgba(0, 0, 0, 128)));
 
-		if(nk_begin(ctx, "Stats", nk_rect(5, 5, 230, 380), 0))
+		const F32 zonesHeight = (m_zoneRowCount) ? F32(m_zoneRowCount + 2) * 21.0f : 0.0f;
+		const F32 memHeight = (m_memoryTracking) ? F32(U(AppSubsystem::COUNT) + 1) * 21.0f : 0.0f;
+		if(nk_begin(ctx, "Stats", nk_rect(5, 5, 230, 380 + zonesHeight + memHeight), 0))
 		{
 			nk_layout_row_dynamic(ctx, 17, 1);
 
@@ -131,9 +159,40 @@ public:
 			labelBytes(ctx, m_vkCpuMem, "Vulkan CPU");
 			labelBytes(ctx, m_vkGpuMem, "Vulkan GPU");
 
+			if(m_memoryTracking)
+			{
+				nk_label(ctx, " ", NK_TEXT_ALIGN_LEFT);
+				nk_label(ctx, "Memory per subsystem:", NK_TEXT_ALIGN_LEFT);
+				for(AppSubsystem subsystem = AppSubsystem::FIRST; subsystem < AppSubsystem::COUNT; ++subsystem)
+				{
+					labelBytes(ctx, m_subsystemMem[subsystem].m_liveBytes, SUBSYSTEM_NAMES[subsystem]);
+				}
+			}
+
 			nk_label(ctx, " ", NK_TEXT_ALIGN_LEFT);
 			nk_label(ctx, "Vulkan:", NK_TEXT_ALIGN_LEFT);
 			labelUint(ctx, m_vkCmdbCount, "Cmd buffers");
+
+			if(m_zoneRowCount)
+			{
+				// The zones of the main thread, indented by depth
+				nk_label(ctx, " ", NK_TEXT_ALIGN_LEFT);
+				nk_label(ctx, "CPU zones (inclusive/exclusive):", NK_TEXT_ALIGN_LEFT);
+				for(const CpuProfilerZone& zone : m_profilerFrame.m_zones)
+				{
+					if(zone.m_thread == m_profilerFrame.m_mainThread && zone.m_depth <= MAX_ZONE_DEPTH)
+					{
+						StringAuto str(getAllocator());
+						str.sprintf("%*s%s: %.2f/%.2fms",
+							I(zone.m_depth * 2),
+							"",
+							zone.m_name,
+							zone.m_inclusiveTime * 1000.0,
+							zone.m_exclusiveTime * 1000.0);
+						nk_label(ctx, str.cstr(), NK_TEXT_ALIGN_LEFT);
+					}
+				}
+			}
 		}
 
 		nk_style_pop_style_item(ctx);
@@ -191,64 +250,6 @@ public:
 	}
 };
 
-void* App::MemStats::allocCallback(void* userData, void* ptr, PtrSize size, PtrSize alignment)
-{
-	ANKI_ASSERT(userData);
-
-	static const PtrSize MAX_ALIGNMENT = 64;
-
-	struct alignas(MAX_ALIGNMENT) Header
-	{
-		PtrSize m_allocatedSize;
-		Array<U8, MAX_ALIGNMENT - sizeof(PtrSize)> _m_padding;
-	};
-	static_assert(sizeof(Header) == MAX_ALIGNMENT, "See file");
-	static_assert(alignof(Header) == MAX_ALIGNMENT, "See file");
-
-	void* out = nullptr;
-
-	if(ptr == nullptr)
-	{
-		// Need to allocate
-		ANKI_ASSERT(size > 0);
-		ANKI_ASSERT(alignment > 0 && alignment <= MAX_ALIGNMENT);
-
-		const PtrSize newAlignment = MAX_ALIGNMENT;
-		const PtrSize newSize = sizeof(Header) + size;
-
-		// Allocate
-		MemStats* self = static_cast<MemStats*>(userData);
-		Header* allocation = static_cast<Header*>(
-			self->m_originalAllocCallback(self->m_originalUserData, nullptr, newSize, newAlignment));
-		allocation->m_allocatedSize = size;
-		++allocation;
-		out = static_cast<void*>(allocation);
-
-		// Update stats
-		self->m_allocatedMem.fetchAdd(size);
-		self->m_allocCount.fetchAdd(1);
-	}
-	else
-	{
-		// Need to free
-
-		MemStats* self = static_cast<MemStats*>(userData);
-
-		Header* allocation = static_cast<Header*>(ptr);
-		--allocation;
-		ANKI_ASSERT(allocation->m_allocatedSize > 0);
-
-		// Update stats
-		self->m_freeCount.fetchAdd(1);
-		self->m_allocatedMem.fetchSub(allocation->m_allocatedSize);
-
-		// Free
-		self->m_originalAllocCallback(self->m_originalUserData, allocation, 0, 0);
-	}
-
-	return out;
-}
-
 App::App()
 {
 }
@@ -260,6 +261,19 @@ App::~App()
 
 void App::cleanup()
 {
+	// Dump the sampled allocations that are still alive before the subsystems release them
+	if(m_memoryLogOnExit && !m_settingsDir.isEmpty())
+	{
+		StringAuto prefix(m_heapAlloc);
+		prefix.sprintf("%s/memory", m_settingsDir.cstr());
+		ANKI_CORE_LOGI("Will dump the memory allocation logs: %s_*.log", prefix.cstr());
+		if(dumpMemoryAllocationLogs(prefix.toCString()))
+		{
+			ANKI_CORE_LOGE("Ignoring error from the memory trackers");
+		}
+		m_memoryLogOnExit = false;
+	}
+
 	m_heapAlloc.deleteInstance(m_scene);
 	m_heapAlloc.deleteInstance(m_script);
 	m_heapAlloc.deleteInstance(m_renderer);
@@ -274,6 +288,7 @@ void App::cleanup()
 	GrManager::deleteInstance(m_gr);
 	m_heapAlloc.deleteInstance(m_input);
 	m_heapAlloc.deleteInstance(m_window);
+	m_heapAlloc.deleteInstance(m_spikeDetector);
 
 #if ANKI_ENABLE_TRACE
 	if(CoreTracerSingleton::get().isInitialized())
@@ -291,6 +306,9 @@ void App::cleanup()
 
 	m_settingsDir.destroy(m_heapAlloc);
 	m_cacheDir.destroy(m_heapAlloc);
+
+	// Write the last messages
+	LoggerSingleton::get().stopAsync();
 }
 
 Error App::init(const ConfigSet& config, AllocAlignedCallback allocCb, void* allocCbUserData)
@@ -310,8 +328,18 @@ Error App::initInternal(const ConfigSet& config_, AllocAlignedCallback allocCb,
 	ConfigSet config = config_;
 	m_displayStats = config.getNumber("core.displayStats");
 
-	initMemoryCallbacks(allocCb, allocCbUserData);
-	m_heapAlloc = HeapAllocator<U8>(m_allocCb, m_allocCbData);
+	initMemoryCallbacks(config, allocCb, allocCbUserData);
+	m_heapAlloc =
+		HeapAllocator<U8>(getAllocationCallback(AppSubsystem::CORE), getAllocationCallbackData(AppSubsystem::CORE));
+
+	// Create the string table before the threads that intern names
+	StringTableSingleton::get();
+
+	if(config.getNumber("core.asyncLogging"))
+	{
+		LoggerSingleton::get().startAsync(U32(config.getNumber("core.asyncLoggingRecordCount")),
+			U32(config.getNumber("core.logRateLimit")));
+	}
 
 #if ANKI_ENABLE_TRACE
 	CoreTracerSingleton::get().init(m_heapAlloc);
@@ -320,6 +348,30 @@ Error App::initInternal(const ConfigSet& config_, AllocAlignedCallback allocCb,
 
 	ANKI_CHECK(initDirs(config));
 
+#if ANKI_ENABLE_TRACE
+	if(config.getNumber("core.traceStream"))
+	{
+		StringAuto fname(m_heapAlloc);
+		fname.sprintf("%s/trace.ankitrace", m_settingsDir.cstr());
+		ANKI_CORE_LOGI("Will stream the trace to: %s", fname.cstr());
+		ANKI_CHECK(CoreTracerSingleton::get().beginStreaming(fname.toCString()));
+	}
+
+	if(config.getNumber("core.profiler"))
+	{
+		CoreTracerSingleton::get().m_profilerEnabled = true;
+	}
+
+	if(config.getNumber("core.spikeCapture"))
+	{
+		// The tracer keeps the last events in memory anyway, enable it and dump them when a frame is too slow
+		m_spikeCaptureFrameCount = max<U32>(1, config.getNumber("core.spikeCaptureFrameCount"));
+		m_spikeDetector = m_heapAlloc.newInstance<FrameSpikeDetector>(
+			m_heapAlloc, m_spikeCaptureFrameCount, max(1.1, config.getNumber("core.spikeCaptureFactor")));
+		CoreTracerSingleton::get().m_enabled = true;
+	}
+#endif
+
 	// Print a message
 	const char* buildType =
 #if ANKI_OPTIMIZE
@@ -393,8 +445,8 @@ Error App::initInternal(const ConfigSet& config_, AllocAlignedCallback allocCb,
 	// Graphics API
 	//
 	GrManagerInitInfo grInit;
-	grInit.m_allocCallback = m_allocCb;
-	grInit.m_allocCallbackUserData = m_allocCbData;
+	grInit.m_allocCallback = getAllocationCallback(AppSubsystem::GR);
+	grInit.m_allocCallbackUserData = getAllocationCallbackData(AppSubsystem::GR);
 	grInit.m_cacheDirectory = m_cacheDir.toCString();
 	grInit.m_config = &config;
 	grInit.m_window = m_window;
@@ -412,7 +464,8 @@ Error App::initInternal(const ConfigSet& config_, AllocAlignedCallback allocCb,
 	//
 	m_physics = m_heapAlloc.newInstance<PhysicsWorld>();
 
-	ANKI_CHECK(m_physics->create(m_allocCb, m_allocCbData));
+	ANKI_CHECK(m_physics->create(
+		getAllocationCallback(AppSubsystem::PHYSICS), getAllocationCallbackData(AppSubsystem::PHYSICS)));
 
 	//
 	// Resource FS
@@ -429,8 +482,8 @@ Error App::initInternal(const ConfigSet& config_, AllocAlignedCallback allocCb,
 	rinit.m_resourceFs = m_resourceFs;
 	rinit.m_config = &config;
 	rinit.m_cacheDir = m_cacheDir.toCString();
-	rinit.m_allocCallback = m_allocCb;
-	rinit.m_allocCallbackData = m_allocCbData;
+	rinit.m_allocCallback = getAllocationCallback(AppSubsystem::RESOURCE);
+	rinit.m_allocCallbackData = getAllocationCallbackData(AppSubsystem::RESOURCE);
 	m_resources = m_heapAlloc.newInstance<ResourceManager>();
 
 	ANKI_CHECK(m_resources->init(rinit));
@@ -439,7 +492,12 @@ Error App::initInternal(const ConfigSet& config_, AllocAlignedCallback allocCb,
 	// UI
 	//
 	m_ui = m_heapAlloc.newInstance<UiManager>();
-	ANKI_CHECK(m_ui->init(m_allocCb, m_allocCbData, m_resources, m_gr, m_stagingMem, m_input));
+	ANKI_CHECK(m_ui->init(getAllocationCallback(AppSubsystem::UI),
+		getAllocationCallbackData(AppSubsystem::UI),
+		m_resources,
+		m_gr,
+		m_stagingMem,
+		m_input));
 
 	ANKI_CHECK(m_ui->newInstance<StatsUi>(m_statsUi));
 
@@ -454,22 +512,30 @@ Error App::initInternal(const ConfigSet& config_, AllocAlignedCallback allocCb,
 
 	m_renderer = m_heapAlloc.newInstance<MainRenderer>();
 
-	ANKI_CHECK(m_renderer->init(
-		m_threadpool, m_resources, m_gr, m_stagingMem, m_ui, m_allocCb, m_allocCbData, config, &m_globalTimestamp));
+	ANKI_CHECK(m_renderer->init(m_threadpool,
+		m_resources,
+		m_gr,
+		m_stagingMem,
+		m_ui,
+		getAllocationCallback(AppSubsystem::RENDERER),
+		getAllocationCallbackData(AppSubsystem::RENDERER),
+		config,
+		&m_globalTimestamp));
 
 	//
 	// Script
 	//
 	m_script = m_heapAlloc.newInstance<ScriptManager>();
-	ANKI_CHECK(m_script->init(m_allocCb, m_allocCbData));
+	ANKI_CHECK(
+		m_script->init(getAllocationCallback(AppSubsystem::SCRIPT), getAllocationCallbackData(AppSubsystem::SCRIPT)));
 
 	//
 	// Scene
 	//
 	m_scene = m_heapAlloc.newInstance<SceneGraph>();
 
-	ANKI_CHECK(m_scene->init(m_allocCb,
-		m_allocCbData,
+	ANKI_CHECK(m_scene->init(getAllocationCallback(AppSubsystem::SCENE),
+		getAllocationCallbackData(AppSubsystem::SCENE),
 		m_threadpool,
 		m_threadHive,
 		m_resources,
@@ -547,6 +613,30 @@ Error App::initDirs(const ConfigSet& cfg)
 	return Error::NONE;
 }
 
+void App::captureSpike(Second frameTime)
+{
+#if ANKI_ENABLE_TRACE
+	// Name the files after the wall clock time so they're easy to match with the reports
+	const std::time_t now = std::time(nullptr);
+	Array<char, 32> timestamp;
+	if(std::strftime(&timestamp[0], sizeof(timestamp), "%Y%m%d_%H%M%S", std::localtime(&now)) == 0)
+	{
+		timestamp[0] = '\0';
+	}
+
+	StringAuto fname(m_heapAlloc);
+	fname.sprintf("%s/spike_%s_%u", m_cacheDir.cstr(), &timestamp[0], m_spikeCount++);
+
+	ANKI_CORE_LOGW("Frame took %fms (median %fms). Will capture the trace: %s",
+		frameTime * 1000.0,
+		m_spikeDetector->getMedianFrameTime() * 1000.0,
+		fname.cstr());
+
+	// The tracer writes the files in its thread so the spike doesn't get longer
+	CoreTracerSingleton::get().requestCaptureLastFrames(m_spikeCaptureFrameCount, fname.toCString());
+#endif
+}
+
 Error App::mainLoop()
 {
 	ANKI_CORE_LOGI("Entering main loop");
@@ -564,6 +654,9 @@ Error App::mainLoop()
 		ANKI_TRACE_START_EVENT(FRAME);
 		const Second startTime = HighRezTimer::getCurrentTime();
 
+		// Background work that doesn't start in time will be deferred to the next frame
+		m_threadHive->setFrameDeadline(startTime + m_timerTick);
+
 		prevUpdateTime = crntTime;
 		crntTime = HighRezTimer::getCurrentTime();
 
@@ -597,6 +690,22 @@ Error App::mainLoop()
 		ANKI_TRACE_INC_COUNTER(RESOURCE_ASYNC_TASKS, asyncTaskCount - m_resourceCompletedAsyncTaskCount);
 		m_resourceCompletedAsyncTaskCount = asyncTaskCount;
 
+#if ANKI_ENABLE_TRACE
+		// And some thread hive stats
+		const ThreadHiveStats criticalStats = m_threadHive->getStats(ThreadHiveTaskPriority::CRITICAL);
+		const ThreadHiveStats normalStats = m_threadHive->getStats(ThreadHiveTaskPriority::NORMAL);
+		const ThreadHiveStats backgroundStats = m_threadHive->getStats(ThreadHiveTaskPriority::BACKGROUND);
+		m_threadHive->resetStats();
+
+		ANKI_TRACE_INC_COUNTER(HIVE_CRITICAL_QUEUE_DEPTH, criticalStats.m_maxQueueDepth);
+		ANKI_TRACE_INC_COUNTER(HIVE_NORMAL_QUEUE_DEPTH, normalStats.m_maxQueueDepth);
+		ANKI_TRACE_INC_COUNTER(HIVE_BACKGROUND_QUEUE_DEPTH, backgroundStats.m_maxQueueDepth);
+		ANKI_TRACE_INC_COUNTER(HIVE_CRITICAL_WAIT_TIME_US, U64(criticalStats.m_waitTime * 1000000.0));
+		ANKI_TRACE_INC_COUNTER(HIVE_NORMAL_WAIT_TIME_US, U64(normalStats.m_waitTime * 1000000.0));
+		ANKI_TRACE_INC_COUNTER(HIVE_BACKGROUND_WAIT_TIME_US, U64(backgroundStats.m_waitTime * 1000000.0));
+		ANKI_TRACE_INC_COUNTER(HIVE_DEFERRED_TASKS, backgroundStats.m_deferredTaskCount);
+#endif
+
 		// Now resume the loader
 		m_resources->getAsyncLoader().resume();
 
@@ -611,7 +720,18 @@ Error App::mainLoop()
 			HighRezTimer::sleep(m_timerTick - frameTime);
 		}
 
+		// Capture the trace if the frame was too slow
+		if(m_spikeDetector && m_spikeDetector->newFrame(frameTime))
+		{
+			captureSpike(frameTime);
+		}
+
 		// Stats
+		if(m_memoryTracking)
+		{
+			updateMemoryStats();
+		}
+
 		if(m_displayStats)
 		{
 			StatsUi& statsUi = static_cast<StatsUi&>(*m_statsUi);
@@ -621,9 +741,6 @@ Error App::mainLoop()
 			statsUi.m_sceneUpdateTime.set(m_scene->getStats().m_updateTime);
 			statsUi.m_visTestsTime.set(m_scene->getStats().m_visibilityTestsTime);
 			statsUi.m_physicsTime.set(m_scene->getStats().m_physicsUpdate);
-			statsUi.m_allocatedCpuMem = m_memStats.m_allocatedMem.load();
-			statsUi.m_allocCount = m_memStats.m_allocCount.load();
-			statsUi.m_freeCount = m_memStats.m_freeCount.load();
 
 			GrManagerStats grStats = m_gr->getStats();
 			statsUi.m_vkCpuMem = grStats.m_cpuMemory;
@@ -658,21 +775,95 @@ void App::injectStatsUiElement(DynamicArrayAuto<UiQueueElement>& newUiElementArr
 	}
 }
 
-void App::initMemoryCallbacks(AllocAlignedCallback allocCb, void* allocCbUserData)
+void App::initMemoryCallbacks(const ConfigSet& config, AllocAlignedCallback allocCb, void* allocCbUserData)
 {
+	m_allocCb = allocCb;
+	m_allocCbData = allocCbUserData;
+
+	m_memoryTracking = m_displayStats || config.getNumber("core.memoryTracking");
+	if(m_memoryTracking)
+	{
+		const U32 sampleRate = config.getNumber("core.memoryLogSampleRate");
+		for(AppSubsystem subsystem = AppSubsystem::FIRST; subsystem < AppSubsystem::COUNT; ++subsystem)
+		{
+			m_memoryTrackers[subsystem].init(SUBSYSTEM_NAMES[subsystem], allocCb, allocCbUserData);
+			if(sampleRate)
+			{
+				m_memoryTrackers[subsystem].enableAllocationLog(sampleRate);
+				m_memoryLogOnExit = true;
+			}
+		}
+	}
+}
+
+void App::updateMemoryStats()
+{
+	Array<MemoryTrackerStats, U(AppSubsystem::COUNT)> stats;
+	for(AppSubsystem subsystem = AppSubsystem::FIRST; subsystem < AppSubsystem::COUNT; ++subsystem)
+	{
+		m_memoryTrackers[subsystem].newFrame();
+		stats[subsystem] = m_memoryTrackers[subsystem].getStats();
+	}
+
+#if ANKI_ENABLE_TRACE
+	static const Array<const char*, U(AppSubsystem::COUNT)> LIVE_COUNTER_NAMES = {{"MEM_CORE_LIVE_KB",
+		"MEM_GR_LIVE_KB",
+		"MEM_PHYSICS_LIVE_KB",
+		"MEM_RESOURCE_LIVE_KB",
+		"MEM_UI_LIVE_KB",
+		"MEM_RENDERER_LIVE_KB",
+		"MEM_SCRIPT_LIVE_KB",
+		"MEM_SCENE_LIVE_KB"}};
+	static const Array<const char*, U(AppSubsystem::COUNT)> ALLOC_COUNTER_NAMES = {{"MEM_CORE_FRAME_ALLOCS",
+		"MEM_GR_FRAME_ALLOCS",
+		"MEM_PHYSICS_FRAME_ALLOCS",
+		"MEM_RESOURCE_FRAME_ALLOCS",
+		"MEM_UI_FRAME_ALLOCS",
+		"MEM_RENDERER_FRAME_ALLOCS",
+		"MEM_SCRIPT_FRAME_ALLOCS",
+		"MEM_SCENE_FRAME_ALLOCS"}};
+
+	for(AppSubsystem subsystem = AppSubsystem::FIRST; subsystem < AppSubsystem::COUNT; ++subsystem)
+	{
+		CoreTracerSingleton::get().increaseCounter(LIVE_COUNTER_NAMES[subsystem], stats[subsystem].m_liveBytes / 1_KB);
+		CoreTracerSingleton::get().increaseCounter(
+			ALLOC_COUNTER_NAMES[subsystem], stats[subsystem].m_frameAllocationCount);
+	}
+#endif
+
 	if(m_displayStats)
 	{
-		m_memStats.m_originalAllocCallback = allocCb;
-		m_memStats.m_originalUserData = allocCbUserData;
+		StatsUi& statsUi = static_cast<StatsUi&>(*m_statsUi);
+		statsUi.m_memoryTracking = true;
+		statsUi.m_allocatedCpuMem = 0;
+		statsUi.m_allocCount = 0;
+		statsUi.m_freeCount = 0;
+		for(AppSubsystem subsystem = AppSubsystem::FIRST; subsystem < AppSubsystem::COUNT; ++subsystem)
+		{
+			statsUi.m_subsystemMem[subsystem] = stats[subsystem];
+			statsUi.m_allocatedCpuMem += stats[subsystem].m_liveBytes;
+			statsUi.m_allocCount += stats[subsystem].m_allocationCount;
+			statsUi.m_freeCount += stats[subsystem].m_freeCount;
+		}
+	}
+}
 
-		m_allocCb = MemStats::allocCallback;
-		m_allocCbData = &m_memStats;
+Error App::dumpMemoryAllocationLogs(CString filenamePrefix, U64 sinceFrame) const
+{
+	if(!m_memoryTracking)
+	{
+		ANKI_CORE_LOGE("Memory tracking is disabled");
+		return Error::USER_DATA;
 	}
-	else
+
+	for(AppSubsystem subsystem = AppSubsystem::FIRST; subsystem < AppSubsystem::COUNT; ++subsystem)
 	{
-		m_allocCb = allocCb;
-		m_allocCbData = allocCbUserData;
+		StringAuto fname(m_heapAlloc);
+		fname.sprintf("%s_%s.log", filenamePrefix.cstr(), SUBSYSTEM_NAMES[subsystem]);
+		ANKI_CHECK(m_memoryTrackers[subsystem].dumpAllocationLog(fname.toCString(), sinceFrame));
 	}
+
+	return Error::NONE;
 }
 
 } // end namespace anki
@@ -7,6 +7,8 @@
 
 #include <anki/core/Common.h>
 #include <anki/util/Allocator.h>
+#include <anki/util/MemoryTracker.h>
+#include <anki/util/Enum.h>
 #include <anki/util/String.h>
 #include <anki/util/Ptr.h>
 #include <anki/ui/UiImmediateModeBuilder.h>
@@ -25,6 +27,7 @@ extern android_app* gAndroidApp;
 class ConfigSet;
 class ThreadPool;
 class ThreadHive;
+class FrameSpikeDetector;
 class NativeWindow;
 class Input;
 class GrManager;
@@ -39,6 +42,23 @@ class UiManager;
 class UiQueueElement;
 class RenderQueue;
 
+/// The subsystems that have their own memory tracker. @memberof App
+enum class AppSubsystem : U8
+{
+	CORE,
+	GR,
+	PHYSICS,
+	RESOURCE,
+	UI,
+	RENDERER,
+	SCRIPT,
+	SCENE,
+
+	COUNT,
+	FIRST = 0
+};
+ANKI_ENUM_ALLOW_NUMERIC_OPERATIONS(AppSubsystem, inline)
+
 /// The core class of the engine.
 class App
 {
@@ -153,12 +173,32 @@ public:
 		return m_displayStats;
 	}
 
+	/// Memory tracking is enabled by the core.memoryTracking option or if the stats are displayed.
+	Bool getMemoryTrackingEnabled() const
+	{
+		return m_memoryTracking;
+	}
+
+	/// Get the memory tracker of a subsystem. Valid only if memory tracking is enabled.
+	const MemoryTracker& getMemoryTracker(AppSubsystem subsystem) const
+	{
+		ANKI_ASSERT(m_memoryTracking);
+		return m_memoryTrackers[subsystem];
+	}
+
+	/// Write the sampled live allocations of all subsystems to files named filenamePrefix_subsystem.log. See
+	/// MemoryTracker::dumpAllocationLog() and the core.memoryLogSampleRate option.
+	ANKI_USE_RESULT Error dumpMemoryAllocationLogs(CString filenamePrefix, U64 sinceFrame = 0) const;
+
 private:
 	class StatsUi;
 
 	// Allocation
 	AllocAlignedCallback m_allocCb;
 	void* m_allocCbData;
+	Array<MemoryTracker, U(AppSubsystem::COUNT)> m_memoryTrackers; ///< Should outlive all the allocators.
+	Bool8 m_memoryTracking = false;
+	Bool8 m_memoryLogOnExit = false;
 	HeapAllocator<U8> m_heapAlloc;
 
 	// Sybsystems
@@ -184,27 +224,35 @@ private:
 	String m_cacheDir; ///< This is used as a cache
 	Second m_timerTick;
 	U64 m_resourceCompletedAsyncTaskCount = 0;
+	FrameSpikeDetector* m_spikeDetector = nullptr;
+	U32 m_spikeCaptureFrameCount = 0;
+	U32 m_spikeCount = 0; ///< Used to name the trace files of the spikes.
 
-	class MemStats
-	{
-	public:
-		Atomic<PtrSize> m_allocatedMem = {0};
-		Atomic<U64> m_allocCount = {0};
-		Atomic<U64> m_freeCount = {0};
+	void initMemoryCallbacks(const ConfigSet& config, AllocAlignedCallback allocCb, void* allocCbUserData);
 
-		void* m_originalUserData = nullptr;
-		AllocAlignedCallback m_originalAllocCallback = nullptr;
+	/// Get the allocation callback of a subsystem.
+	AllocAlignedCallback getAllocationCallback(AppSubsystem subsystem) const
+	{
+		return (m_memoryTracking) ? m_memoryTrackers[subsystem].getAllocationCallback() : m_allocCb;
+	}
 
-		static void* allocCallback(void* userData, void* ptr, PtrSize size, PtrSize alignment);
-	} m_memStats;
+	/// Get the allocation callback user data of a subsystem.
+	void* getAllocationCallbackData(AppSubsystem subsystem)
+	{
+		return (m_memoryTracking) ? m_memoryTrackers[subsystem].getAllocationCallbackUserData() : m_allocCbData;
+	}
 
-	void initMemoryCallbacks(AllocAlignedCallback allocCb, void* allocCbUserData);
+	/// Publish the memory stats to the stats UI and the tracer.
+	void updateMemoryStats();
 
 	ANKI_USE_RESULT Error initInternal(const ConfigSet& config, AllocAlignedCallback allocCb, void* allocCbUserData);
 
 	ANKI_USE_RESULT Error initDirs(const ConfigSet& cfg);
 	void cleanup();
 
+	/// Write the trace of the last frames to the cache directory.
+	void captureSpike(Second frameTime);
+
 	/// Inject a new UI element in the render queue for displaying stats.
 	void injectStatsUiElement(DynamicArrayAuto<UiQueueElement>& elements, RenderQueue& rqueue);
 };
@@ -43,6 +43,7 @@ Config::Config()
 	// Scene
 	newOption("scene.imageReflectionMaxDistance", 30.0);
 	newOption("scene.earlyZDistance", 10.0, "Objects with distance lower than that will be used in early Z");
+	newOption("scene.bvh", false, "Use a BVH instead of an octree for the visibility tests");
 
 	// Globals
 	newOption("width", 1280);
@@ -53,6 +54,7 @@ Config::Config()
 	newOption("rsrc.textureAnisotropy", 8);
 	newOption("rsrc.dataPaths", ".", "The engine loads assets only in from these paths. Separate them with :");
 	newOption("rsrc.transferScratchMemorySize", 256_MB);
+	newOption("rsrc.indexCache", true, "Cache the file lists of the zip archives so they are not listed every time");
 
 	// Window
 	newOption("window.fullscreenDesktopResolution", false);
@@ -75,6 +77,16 @@ Config::Config()
 	newOption("core.mainThreadCount", max(2u, getCpuCoresCount() / 2u - 1u));
 	newOption("core.displayStats", false);
 	newOption("core.clearCaches", false);
+	newOption("core.memoryTracking", false, "Track the memory of every subsystem. On if the stats are displayed");
+	newOption("core.memoryLogSampleRate", 0, "Log the stack of one every N allocations. Dump the live ones at exit");
+	newOption("core.asyncLogging", true, "Write the log from a dedicated thread");
+	newOption("core.asyncLoggingRecordCount", 1024, "The messages the async logger can hold before dropping some");
+	newOption("core.logRateLimit", 100, "Max messages per second of a line of code in async logging. 0 is no limit");
+	newOption("core.traceStream", false, "Stream the trace to the settings directory. Convert it with trace2json");
+	newOption("core.profiler", false, "Aggregate the trace events of every frame. The stats show the last frame");
+	newOption("core.spikeCapture", false, "Capture a trace to the cache directory when a frame is too slow");
+	newOption("core.spikeCaptureFactor", 2.0, "A frame is too slow if it's that many times slower than the median. At least 1.1");
+	newOption("core.spikeCaptureFrameCount", 120, "The number of recent frames to compare against and capture");
 }
 
 Config::~Config()
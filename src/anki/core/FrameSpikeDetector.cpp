@@ -0,0 +1,61 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/core/FrameSpikeDetector.h>
+#include <algorithm>
+
+namespace anki
+{
+
+FrameSpikeDetector::FrameSpikeDetector(HeapAllocator<U8> alloc, U32 windowSize, F64 factor)
+	: m_alloc(alloc)
+	, m_factor(factor)
+{
+	ANKI_ASSERT(windowSize > 0);
+	ANKI_ASSERT(factor > 1.0);
+	m_frameTimes.create(m_alloc, windowSize, 0.0);
+	m_scratch.create(m_alloc, windowSize);
+}
+
+FrameSpikeDetector::~FrameSpikeDetector()
+{
+	m_frameTimes.destroy(m_alloc);
+	m_scratch.destroy(m_alloc);
+}
+
+Bool FrameSpikeDetector::newFrame(Second frameTime)
+{
+	const U32 windowSize = m_frameTimes.getSize();
+	Bool spike = false;
+
+	if(m_frameCount >= windowSize)
+	{
+		// The window is full, compute the median. Do it every frame, the window is small
+		memcpy(&m_scratch[0], &m_frameTimes[0], m_frameTimes.getSizeInBytes());
+		Second* middle = m_scratch.getBegin() + windowSize / 2;
+		std::nth_element(m_scratch.getBegin(), middle, m_scratch.getEnd());
+		m_median = *middle;
+
+		spike = m_cooldown == 0 && frameTime > m_median * m_factor;
+	}
+
+	if(m_cooldown > 0)
+	{
+		--m_cooldown;
+	}
+
+	if(spike)
+	{
+		// Don't report the frames that follow, they'll probably be slow as well
+		m_cooldown = windowSize;
+	}
+
+	m_frameTimes[m_frameCount % windowSize] = frameTime;
+	++m_frameCount;
+
+	return spike;
+}
+
+} // end namespace anki
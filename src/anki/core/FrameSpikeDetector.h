@@ -0,0 +1,52 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/core/Common.h>
+#include <anki/util/Allocator.h>
+#include <anki/util/DynamicArray.h>
+
+namespace anki
+{
+
+/// @addtogroup core
+/// @{
+
+/// Detects frames that are much slower than the recent ones. It keeps the times of the last frames and compares every
+/// new frame against their median.
+class FrameSpikeDetector : public NonCopyable
+{
+public:
+	/// @param alloc The allocator.
+	/// @param windowSize The number of the recent frames. No spikes are reported until that many frames were seen and
+	///                   for that many frames after a spike.
+	/// @param factor A frame is a spike if it's slower than factor times the median.
+	FrameSpikeDetector(HeapAllocator<U8> alloc, U32 windowSize, F64 factor);
+
+	~FrameSpikeDetector();
+
+	/// Feed the time of a new frame.
+	/// @return True if the frame is a spike.
+	Bool newFrame(Second frameTime);
+
+	/// Get the median of the recent frame times that the last frame was compared against.
+	Second getMedianFrameTime() const
+	{
+		return m_median;
+	}
+
+private:
+	HeapAllocator<U8> m_alloc;
+	DynamicArray<Second> m_frameTimes; ///< Ring buffer.
+	DynamicArray<Second> m_scratch; ///< Used to compute the median.
+	U64 m_frameCount = 0;
+	U32 m_cooldown = 0; ///< Frames left before a new spike can be reported.
+	F64 m_factor;
+	Second m_median = 0.0;
+};
+/// @}
+
+} // end namespace anki
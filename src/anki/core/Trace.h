@@ -7,6 +7,7 @@
 
 #include <anki/core/Common.h>
 #include <anki/util/Tracer.h>
+#include <anki/util/CpuProfiler.h>
 
 namespace anki
 {
@@ -14,17 +15,21 @@ namespace anki
 /// @addtogroup core
 /// @{
 
-/// Core tracer.
+/// Core tracer. The trace events feed the CPU profiler as well.
 class CoreTracer
 {
 public:
 	Tracer m_tracer;
 	Bool m_enabled = false;
 
+	CpuProfiler m_profiler;
+	Bool m_profilerEnabled = false; ///< Enable it before any event begins, the zones need to be balanced.
+
 	/// @copydoc Tracer::init
 	void init(GenericMemoryPoolAllocator<U8> alloc)
 	{
 		m_tracer.init(alloc);
+		m_profiler.init(alloc);
 	}
 
 	/// @copydoc Tracer::isInitialized
@@ -34,23 +39,33 @@ public:
 	}
 
 	/// @copydoc Tracer::beginEvent
-	ANKI_USE_RESULT TracerEventHandle beginEvent()
+	ANKI_USE_RESULT TracerEventHandle beginEvent(const char* eventName)
 	{
+		if(m_profilerEnabled)
+		{
+			m_profiler.beginZone(eventName);
+		}
+
 		if(m_enabled)
 		{
 			return m_tracer.beginEvent();
 		}
 
-		return nullptr;
+		return -1.0;
 	}
 
 	/// @copydoc Tracer::endEvent
 	void endEvent(const char* eventName, TracerEventHandle event)
 	{
-		if(event != nullptr)
+		if(event >= 0.0)
 		{
 			m_tracer.endEvent(eventName, event);
 		}
+
+		if(m_profilerEnabled)
+		{
+			m_profiler.endZone();
+		}
 	}
 
 	/// @copydoc Tracer::increaseCounter
@@ -69,6 +84,11 @@ public:
 		{
 			m_tracer.newFrame(frame);
 		}
+
+		if(m_profilerEnabled)
+		{
+			m_profiler.newFrame(frame);
+		}
 	}
 
 	/// @copydoc Tracer::flush
@@ -76,6 +96,30 @@ public:
 	{
 		return m_tracer.flush(filename);
 	}
+
+	/// @copydoc Tracer::captureLastFrames
+	ANKI_USE_RESULT Error captureLastFrames(U32 frameCount, CString filename)
+	{
+		return m_tracer.captureLastFrames(frameCount, filename);
+	}
+
+	/// @copydoc Tracer::requestCaptureLastFrames
+	void requestCaptureLastFrames(U32 frameCount, CString filename)
+	{
+		m_tracer.requestCaptureLastFrames(frameCount, filename);
+	}
+
+	/// @copydoc Tracer::beginStreaming
+	ANKI_USE_RESULT Error beginStreaming(CString filename)
+	{
+		return m_tracer.beginStreaming(filename);
+	}
+
+	/// @copydoc Tracer::endStreaming
+	ANKI_USE_RESULT Error endStreaming()
+	{
+		return m_tracer.endStreaming();
+	}
 };
 
 using CoreTracerSingleton = Singleton<CoreTracer>;
@@ -87,7 +131,7 @@ public:
 		: m_name(name)
 		, m_tracer(&CoreTracerSingleton::get())
 	{
-		m_handle = m_tracer->beginEvent();
+		m_handle = m_tracer->beginEvent(name);
 	}
 
 	~CoreTraceScopedEvent()
@@ -104,7 +148,8 @@ private:
 /// @name Trace macros.
 /// @{
 #if ANKI_ENABLE_TRACE
-#	define ANKI_TRACE_START_EVENT(name_) TracerEventHandle _teh##name_ = CoreTracerSingleton::get().beginEvent()
+#	define ANKI_TRACE_START_EVENT(name_) \
+		TracerEventHandle _teh##name_ = CoreTracerSingleton::get().beginEvent(#	name_)
 #	define ANKI_TRACE_STOP_EVENT(name_) CoreTracerSingleton::get().endEvent(#	name_, _teh##name_)
 #	define ANKI_TRACE_SCOPED_EVENT(name_) CoreTraceScopedEvent _tse##name_(#	name_)
 #	define ANKI_TRACE_INC_COUNTER(name_, val_) CoreTracerSingleton::get().increaseCounter(#	name_, val_)
@@ -455,23 +455,23 @@ Error ShaderCompilerCache::compileInternal(
 {
 	ANKI_ASSERT(!source.isEmpty() && source.getLength() > 0);
 
-	// Compute hash
-	U64 fhash;
+	// Compute hash. The cache is addressed by the content so use 128bits for the source to make collisions unlikely
+	Hash128 fhash;
 	if(hash)
 	{
-		fhash = *hash;
-		ANKI_ASSERT(fhash != 0);
+		fhash.m_low = *hash;
+		ANKI_ASSERT(fhash.m_low != 0);
 	}
 	else
 	{
-		fhash = computeHash(&source[0], source.getLength());
+		fhash = computeHash128(&source[0], source.getLength());
 	}
 
-	fhash = appendHash(&options, sizeof(options), fhash);
+	const U64 optionsHash = computeHash(&options, sizeof(options));
 
 	// Search the cache
 	StringAuto fname(m_alloc);
-	fname.sprintf("%s/%llu.shdrbin", m_cacheDir.cstr(), fhash);
+	fname.sprintf("%s/%016llx%016llx-%016llx.shdrbin", m_cacheDir.cstr(), fhash.m_high, fhash.m_low, optionsHash);
 	if(fileExists(fname.toCString()))
 	{
 		File file;
@@ -38,7 +38,7 @@ Error XmlElement::getText(CString& out) const
 
 Error XmlElement::getMat3(Mat3& out) const
 {
-	DynamicArrayAuto<F32> arr(m_alloc);
+	DynamicArrayInline<F32, 16> arr(m_alloc);
 	Error err = getNumbers(arr);
 
 	if(!err && arr.getSize() != 9)
@@ -65,7 +65,7 @@ Error XmlElement::getMat3(Mat3& out) const
 
 Error XmlElement::getMat4(Mat4& out) const
 {
-	DynamicArrayAuto<F32> arr(m_alloc);
+	DynamicArrayInline<F32, 16> arr(m_alloc);
 	Error err = getNumbers(arr);
 
 	if(!err && arr.getSize() != 16)
@@ -92,7 +92,7 @@ Error XmlElement::getMat4(Mat4& out) const
 
 Error XmlElement::getVec2(Vec2& out) const
 {
-	DynamicArrayAuto<F32> arr(m_alloc);
+	DynamicArrayInline<F32, 16> arr(m_alloc);
 	Error err = getNumbers(arr);
 
 	if(!err && arr.getSize() != 2)
@@ -119,7 +119,7 @@ Error XmlElement::getVec2(Vec2& out) const
 
 Error XmlElement::getVec3(Vec3& out) const
 {
-	DynamicArrayAuto<F32> arr(m_alloc);
+	DynamicArrayInline<F32, 16> arr(m_alloc);
 	Error err = getNumbers(arr);
 
 	if(!err && arr.getSize() != 3)
@@ -146,7 +146,7 @@ Error XmlElement::getVec3(Vec3& out) const
 
 Error XmlElement::getVec4(Vec4& out) const
 {
-	DynamicArrayAuto<F32> arr(m_alloc);
+	DynamicArrayInline<F32, 16> arr(m_alloc);
 	Error err = getNumbers(arr);
 
 	if(!err && arr.getSize() != 4)
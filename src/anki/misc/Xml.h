@@ -82,8 +82,9 @@ public:
 	}
 
 	/// Get a number of numbers.
-	template<typename T>
-	ANKI_USE_RESULT Error getNumbers(DynamicArrayAuto<T>& out) const
+	/// @param[out] out A DynamicArrayAuto or a DynamicArrayInline. It will be recreated.
+	template<typename TArray>
+	ANKI_USE_RESULT Error getNumbers(TArray& out) const
 	{
 		CString txt;
 		ANKI_CHECK(getText(txt));
@@ -94,7 +95,7 @@ public:
 		}
 		else
 		{
-			out = DynamicArrayAuto<T>(m_alloc);
+			out.destroy();
 			return Error::NONE;
 		}
 	}
@@ -138,11 +139,10 @@ public:
 
 	/// Get the attribute's value as a series of numbers.
 	/// @param name The name of the attribute.
-	/// @param out The value of the attribute.
+	/// @param out The value of the attribute. A DynamicArrayAuto or a DynamicArrayInline.
 	/// @param attribPresent True if the attribute exists. If it doesn't the @a out is undefined.
-	template<typename T>
-	ANKI_USE_RESULT Error getAttributeNumbersOptional(
-		const CString& name, DynamicArrayAuto<T>& out, Bool& attribPresent) const
+	template<typename TArray>
+	ANKI_USE_RESULT Error getAttributeNumbersOptional(const CString& name, TArray& out, Bool& attribPresent) const
 	{
 		CString txtVal;
 		ANKI_CHECK(getAttributeTextOptional(name, txtVal, attribPresent));
@@ -164,7 +164,7 @@ public:
 	template<typename T>
 	ANKI_USE_RESULT Error getAttributeNumberOptional(const CString& name, T& out, Bool& attribPresent) const
 	{
-		DynamicArrayAuto<T> arr(m_alloc);
+		DynamicArrayInline<T, 4> arr(m_alloc);
 		ANKI_CHECK(getAttributeNumbersOptional(name, arr, attribPresent));
 
 		if(attribPresent)
@@ -188,7 +188,7 @@ public:
 	template<typename T>
 	ANKI_USE_RESULT Error getAttributeVectorOptional(const CString& name, T& out, Bool& attribPresent) const
 	{
-		DynamicArrayAuto<F32> arr(m_alloc);
+		DynamicArrayInline<F32, 16> arr(m_alloc);
 		ANKI_CHECK(getAttributeNumbersOptional(name, arr, attribPresent));
 
 		if(attribPresent)
@@ -235,9 +235,9 @@ public:
 
 	/// Get the attribute's value as a series of numbers.
 	/// @param name The name of the attribute.
-	/// @param out The value of the attribute.
-	template<typename T>
-	ANKI_USE_RESULT Error getAttributeNumbers(const CString& name, DynamicArrayAuto<T>& out) const
+	/// @param out The value of the attribute. A DynamicArrayAuto or a DynamicArrayInline.
+	template<typename TArray>
+	ANKI_USE_RESULT Error getAttributeNumbers(const CString& name, TArray& out) const
 	{
 		Bool found;
 		ANKI_CHECK(getAttributeNumbersOptional(name, out, found));
@@ -282,26 +282,51 @@ private:
 
 	ANKI_USE_RESULT Error check() const;
 
-	template<typename T>
-	ANKI_USE_RESULT Error parseNumbers(CString txt, DynamicArrayAuto<T>& out) const
+	/// Parse a list of numbers that are separated by spaces. It doesn't allocate for short lists if @a out is a
+	/// DynamicArrayInline.
+	template<typename TArray>
+	ANKI_USE_RESULT Error parseNumbers(CString txt, TArray& out) const
 	{
 		ANKI_ASSERT(txt);
 		ANKI_ASSERT(m_el);
 
-		StringListAuto list(m_alloc);
-		list.splitString(txt, ' ');
+		const char* begin = txt.cstr();
+		const char* end = begin + txt.getLength();
 
-		out = DynamicArrayAuto<T>(m_alloc);
-		out.create(list.getSize());
+		// Count them first to create the array once
+		PtrSize count = 0;
+		for(const char* c = begin; c < end; ++c)
+		{
+			if(*c != ' ' && (c == begin || c[-1] == ' '))
+			{
+				++count;
+			}
+		}
+
+		out.destroy();
+		out.create(count);
 
+		// Parse them. The number is copied to a small string to have it null terminated
+		StringInline<64> token(m_alloc);
 		Error err = Error::NONE;
-		auto it = list.getBegin();
-		auto end = list.getEnd();
-		U i = 0;
-		while(it != end && !err)
+		PtrSize i = 0;
+		const char* c = begin;
+		while(i < count && !err)
 		{
-			err = it->toNumber(out[i++]);
-			++it;
+			while(*c == ' ')
+			{
+				++c;
+			}
+
+			const char* tokenBegin = c;
+			while(c < end && *c != ' ')
+			{
+				++c;
+			}
+
+			token.destroy();
+			token.create(tokenBegin, c);
+			err = token.toNumber(out[i++]);
 		}
 
 		if(err)
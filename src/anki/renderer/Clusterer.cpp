@@ -10,18 +10,8 @@
 namespace anki
 {
 
-class UpdatePlanesPerspectiveCameraTask : public ThreadPoolTask
-{
-public:
-	Clusterer* m_clusterer = nullptr;
-	Bool m_frustumChanged;
-
-	Error operator()(U32 threadId, PtrSize threadsCount)
-	{
-		m_clusterer->update(threadId, threadsCount, m_frustumChanged);
-		return Error::NONE;
-	}
-};
+/// The number of planes or boxes a thread updates at a time.
+const U UPDATE_GRAIN_SIZE = 32;
 
 static Vec4 unproject(const F32 depth, const Vec2& ndc, const Vec4& projParams)
 {
@@ -244,18 +234,25 @@ void Clusterer::prepare(ThreadPool& threadPool, const ClustererPrepareInfo& inf)
 	//
 	// Issue parallel jobs
 	//
-	UpdatePlanesPerspectiveCameraTask job;
-	job.m_clusterer = this;
-	job.m_frustumChanged = frustumChanged;
-
-	for(U i = 0; i < threadPool.getThreadCount(); i++)
+	PtrSize count = m_planesYW.getSize() + m_planesXW.getSize();
+	if(frustumChanged)
 	{
-		threadPool.assignNewTask(i, &job);
+		count += m_clusterBoxes.getSize();
 	}
 
-	// Sync threads
-	Error err = threadPool.waitForAllThreadsToFinish();
+	Error err =
+		threadPool.parallelFor(count, UPDATE_GRAIN_SIZE, [&](U32 threadId, PtrSize start, PtrSize end) -> Error {
+			update(start, end, frustumChanged);
+			return Error::NONE;
+		});
 	(void)err;
+
+	// Finaly tranform the near and far planes
+	*m_nearPlane = Plane(Vec4(0.0, 0.0, -1.0, 0.0), m_near);
+	m_nearPlane->transform(m_camTrf);
+
+	*m_farPlane = Plane(Vec4(0.0, 0.0, 1.0, 0.0), -m_far);
+	m_farPlane->transform(m_camTrf);
 }
 
 void Clusterer::computeSplitRange(const CollisionShape& cs, U& zBegin, U& zEnd) const
@@ -678,70 +675,41 @@ void Clusterer::binPerspectiveFrustum(const PerspectiveFrustum& fr, const Aabb&
 	});
 }
 
-void Clusterer::update(U32 threadId, PtrSize threadsCount, Bool frustumChanged)
+void Clusterer::update(PtrSize start, PtrSize end, Bool frustumChanged)
 {
-	PtrSize start, end;
-
 	const Transform& trf = m_camTrf;
 	const Vec4& projParams = m_unprojParams;
+	const PtrSize planeYCount = m_planesYW.getSize();
+	const PtrSize planeCount = planeYCount + m_planesXW.getSize();
 
-	if(frustumChanged)
+	// First the top looking planes
+	for(PtrSize i = start; i < min(end, planeYCount); ++i)
 	{
-		// Re-calculate the planes in local space
-
-		// First the top looking planes
-		ThreadPoolTask::choseStartEnd(threadId, threadsCount, m_planesYW.getSize(), start, end);
-
-		for(U i = start; i < end; i++)
+		if(frustumChanged)
 		{
 			calcPlaneY(i, projParams);
-
-			m_planesYW[i] = m_planesY[i].getTransformed(trf);
-		}
-
-		// Then the right looking planes
-		ThreadPoolTask::choseStartEnd(threadId, threadsCount, m_planesXW.getSize(), start, end);
-
-		for(U j = start; j < end; j++)
-		{
-			calcPlaneX(j, projParams);
-
-			m_planesXW[j] = m_planesX[j].getTransformed(trf);
 		}
 
-		// The boxes
-		ThreadPoolTask::choseStartEnd(threadId, threadsCount, m_clusterBoxes.getSize(), start, end);
-		setClusterBoxes(projParams, start, end);
+		m_planesYW[i] = m_planesY[i].getTransformed(trf);
 	}
-	else
-	{
-		// Only transform planes
-
-		// First the top looking planes
-		ThreadPoolTask::choseStartEnd(threadId, threadsCount, m_planesYW.getSize(), start, end);
 
-		for(U i = start; i < end; i++)
+	// Then the right looking planes
+	for(PtrSize i = max(start, planeYCount); i < min(end, planeCount); ++i)
+	{
+		const U j = i - planeYCount;
+		if(frustumChanged)
 		{
-			m_planesYW[i] = m_planesY[i].getTransformed(trf);
+			calcPlaneX(j, projParams);
 		}
 
-		// Then the right looking planes
-		ThreadPoolTask::choseStartEnd(threadId, threadsCount, m_planesXW.getSize(), start, end);
-
-		for(U j = start; j < end; j++)
-		{
-			m_planesXW[j] = m_planesX[j].getTransformed(trf);
-		}
+		m_planesXW[j] = m_planesX[j].getTransformed(trf);
 	}
 
-	// Finaly tranform the near and far planes
-	if(threadId == 0)
+	// The boxes. They are part of the range only if the frustum changed
+	if(end > planeCount)
 	{
-		*m_nearPlane = Plane(Vec4(0.0, 0.0, -1.0, 0.0), m_near);
-		m_nearPlane->transform(trf);
-
-		*m_farPlane = Plane(Vec4(0.0, 0.0, 1.0, 0.0), -m_far);
-		m_farPlane->transform(trf);
+		ANKI_ASSERT(frustumChanged);
+		setClusterBoxes(projParams, max(start, planeCount) - planeCount, end - planeCount);
 	}
 }
 
@@ -133,8 +133,6 @@ public:
 /// Collection of clusters for visibility tests.
 class Clusterer
 {
-	friend class UpdatePlanesPerspectiveCameraTask;
-
 public:
 	Clusterer()
 	{
@@ -236,7 +234,8 @@ private:
 
 	void computeSplitRange(const CollisionShape& cs, U& zBegin, U& zEnd) const;
 
-	void update(U32 threadId, PtrSize threadsCount, Bool frustumChanged);
+	/// Update the planes and the cluster boxes. The range indexes the Y planes, then the X planes and then the boxes.
+	void update(PtrSize start, PtrSize end, Bool frustumChanged);
 
 	/// Calculate and set a top looking plane.
 	void calcPlaneY(U i, const Vec4& projParams);
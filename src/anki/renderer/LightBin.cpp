@@ -17,6 +17,9 @@ namespace anki
 /// This should be the number of light types. For now it's spots & points & probes & decals.
 const U SIZE_IDX_COUNT = 4;
 
+/// The number of clusters a thread processes at a time.
+const U CLUSTER_GROUP = 16;
+
 // Shader structs and block representations. All positions and directions in viewspace
 // For documentation see the shaders
 
@@ -258,28 +261,10 @@ public:
 	WeakArray<const ReflectionProbeQueueElement> m_vProbes;
 	WeakArray<const DecalQueueElement> m_vDecals;
 
-	Atomic<U32> m_count = {0};
-	Atomic<U32> m_count2 = {0};
-
 	TextureViewPtr m_diffDecalTexAtlas;
 	SpinLock m_diffDecalTexAtlasMtx;
 	TextureViewPtr m_specularRoughnessDecalTexAtlas;
 	SpinLock m_specularRoughnessDecalTexAtlasMtx;
-
-	LightBin* m_bin = nullptr;
-};
-
-/// Write the lights to the GPU buffers.
-class LightBin::WriteLightsTask : public ThreadPoolTask
-{
-public:
-	BinContext* m_ctx = nullptr;
-
-	Error operator()(U32 threadId, PtrSize threadsCount)
-	{
-		m_ctx->m_bin->binLights(threadId, threadsCount, *m_ctx);
-		return Error::NONE;
-	}
 };
 
 LightBin::LightBin(const GenericMemoryPoolAllocator<U8>& alloc,
@@ -292,7 +277,6 @@ LightBin::LightBin(const GenericMemoryPoolAllocator<U8>& alloc,
 	, m_clusterCount(clusterCountX * clusterCountY * clusterCountZ)
 	, m_threadPool(threadPool)
 	, m_stagingMem(stagingMem)
-	, m_barrier(threadPool->getThreadCount())
 {
 	m_clusterer.init(alloc, clusterCountX, clusterCountY, clusterCountZ);
 }
@@ -336,7 +320,6 @@ Error LightBin::bin(const Mat4& viewMat,
 	//
 	// Write the lights and tiles UBOs
 	//
-	Array<WriteLightsTask, ThreadPool::MAX_THREADS> tasks;
 	BinContext ctx(frameAlloc);
 	ctx.m_viewMat = viewMat;
 	ctx.m_viewProjMat = viewProjMat;
@@ -404,8 +387,6 @@ Error LightBin::bin(const Mat4& viewMat,
 		out.m_decalsToken.markUnused();
 	}
 
-	ctx.m_bin = this;
-
 	// Get mem for clusters
 	ShaderCluster* data = static_cast<ShaderCluster*>(m_stagingMem->allocateFrame(
 		sizeof(ShaderCluster) * m_clusterCount, StagingGpuMemoryType::STORAGE, out.m_clustersToken));
@@ -425,16 +406,41 @@ Error LightBin::bin(const Mat4& viewMat,
 	}
 	ctx.m_lightIdsCount.set(SIZE_IDX_COUNT);
 
-	// Fire the async job
-	for(U i = 0; i < m_threadPool->getThreadCount(); i++)
-	{
-		tasks[i].m_ctx = &ctx;
+	// Initialize the temp clusters
+	ANKI_CHECK(m_threadPool->parallelFor(
+		m_clusterCount, CLUSTER_GROUP, [&](U32 threadId, PtrSize start, PtrSize end) -> Error {
+			ANKI_TRACE_SCOPED_EVENT(R_LIGHT_BINNING);
+			for(PtrSize i = start; i < end; ++i)
+			{
+				ctx.m_tempClusters[i].reset();
+			}
+
+			return Error::NONE;
+		}));
 
-		m_threadPool->assignNewTask(i, &tasks[i]);
+	// Iterate lights and probes and bin them. The cost of every object varies a lot so hand them out one by one
+	DynamicArrayAuto<ClustererTestResult> testResults(ctx.m_alloc);
+	testResults.create(m_threadPool->getThreadCount());
+	for(ClustererTestResult& testResult : testResults)
+	{
+		m_clusterer.initTestResults(ctx.m_alloc, testResult);
 	}
 
-	// Sync
-	ANKI_CHECK(m_threadPool->waitForAllThreadsToFinish());
+	const U totalCount = visiblePointLightsCount + visibleSpotLightsCount + visibleProbeCount + visibleDecalCount;
+	ANKI_CHECK(
+		m_threadPool->parallelFor(totalCount, 1, [&](U32 threadId, PtrSize start, PtrSize end) -> Error {
+			ANKI_TRACE_SCOPED_EVENT(R_LIGHT_BINNING);
+			binLights(start, end, ctx, testResults[threadId]);
+			return Error::NONE;
+		}));
+
+	// Last thing, update the real clusters
+	ANKI_CHECK(m_threadPool->parallelFor(
+		m_clusterCount, CLUSTER_GROUP, [&](U32 threadId, PtrSize start, PtrSize end) -> Error {
+			ANKI_TRACE_SCOPED_EVENT(R_LIGHT_BINNING);
+			writeClusters(start, end, ctx);
+			return Error::NONE;
+		}));
 
 	out.m_diffDecalTexView = ctx.m_diffDecalTexAtlas;
 	out.m_specularRoughnessDecalTexView = ctx.m_specularRoughnessDecalTexAtlas;
@@ -442,159 +448,111 @@ Error LightBin::bin(const Mat4& viewMat,
 	return Error::NONE;
 }
 
-void LightBin::binLights(U32 threadId, PtrSize threadsCount, BinContext& ctx)
+void LightBin::binLights(PtrSize start, PtrSize end, BinContext& ctx, ClustererTestResult& testResult)
 {
-	U clusterCount = m_clusterCount;
-	PtrSize start, end;
+	const U lightCount = ctx.m_vPointLights.getSize() + ctx.m_vSpotLights.getSize();
 
-	//
-	// Initialize the temp clusters
-	//
+	for(U j = start; j < end; ++j)
 	{
-		ANKI_TRACE_SCOPED_EVENT(R_LIGHT_BINNING);
-
-		ThreadPoolTask::choseStartEnd(threadId, threadsCount, clusterCount, start, end);
-
-		for(U i = start; i < end; ++i)
+		if(j >= lightCount + ctx.m_vDecals.getSize())
+		{
+			U i = j - (lightCount + ctx.m_vDecals.getSize());
+			writeAndBinProbe(ctx.m_vProbes[i], ctx, testResult);
+		}
+		else if(j >= ctx.m_vPointLights.getSize() + ctx.m_vDecals.getSize())
+		{
+			U i = j - (ctx.m_vPointLights.getSize() + ctx.m_vDecals.getSize());
+			writeAndBinSpotLight(ctx.m_vSpotLights[i], ctx, testResult);
+		}
+		else if(j >= ctx.m_vDecals.getSize())
+		{
+			U i = j - ctx.m_vDecals.getSize();
+			writeAndBinPointLight(ctx.m_vPointLights[i], ctx, testResult);
+		}
+		else
 		{
-			ctx.m_tempClusters[i].reset();
+			U i = j;
+			writeAndBinDecal(ctx.m_vDecals[i], ctx, testResult);
 		}
 	}
+}
 
-	m_barrier.wait();
-
-	//
-	// Iterate lights and probes and bin them
-	//
+void LightBin::writeClusters(PtrSize start, PtrSize end, BinContext& ctx)
+{
+	for(U i = start; i < end; ++i)
 	{
-		ANKI_TRACE_SCOPED_EVENT(R_LIGHT_BINNING);
+		auto& cluster = ctx.m_tempClusters[i];
+		cluster.normalizeCounts();
 
-		ClustererTestResult testResult;
-		m_clusterer.initTestResults(ctx.m_alloc, testResult);
-		U lightCount = ctx.m_vPointLights.getSize() + ctx.m_vSpotLights.getSize();
-		U totalCount = lightCount + ctx.m_vProbes.getSize() + ctx.m_vDecals.getSize();
+		const U countP = cluster.m_pointCount.get();
+		const U countS = cluster.m_spotCount.get();
+		const U countProbe = cluster.m_probeCount.get();
+		const U countDecal = cluster.m_decalCount.get();
+		const U count = countP + countS + countProbe + countDecal;
+
+		auto& c = ctx.m_clusters[i];
+		c.m_firstIdx = 0; // Point to the first empty indices
 
-		const U TO_BIN_COUNT = 1;
-		while((start = ctx.m_count2.fetchAdd(TO_BIN_COUNT)) < totalCount)
+		// Early exit
+		if(ANKI_UNLIKELY(count == 0))
 		{
-			end = min<U>(start + TO_BIN_COUNT, totalCount);
+			continue;
+		}
+
+		// Check if the previous cluster contains the same lights as this one and if yes then merge them. This will
+		// avoid allocating new IDs (and thrashing GPU caches). Only do that inside the range since the previous
+		// cluster might be written by another thread.
+		cluster.sortLightIds();
+		if(i != start)
+		{
+			const auto& clusterB = ctx.m_tempClusters[i - 1];
 
-			for(U j = start; j < end; ++j)
+			if(cluster == clusterB)
 			{
-				if(j >= lightCount + ctx.m_vDecals.getSize())
-				{
-					U i = j - (lightCount + ctx.m_vDecals.getSize());
-					writeAndBinProbe(ctx.m_vProbes[i], ctx, testResult);
-				}
-				else if(j >= ctx.m_vPointLights.getSize() + ctx.m_vDecals.getSize())
-				{
-					U i = j - (ctx.m_vPointLights.getSize() + ctx.m_vDecals.getSize());
-					writeAndBinSpotLight(ctx.m_vSpotLights[i], ctx, testResult);
-				}
-				else if(j >= ctx.m_vDecals.getSize())
-				{
-					U i = j - ctx.m_vDecals.getSize();
-					writeAndBinPointLight(ctx.m_vPointLights[i], ctx, testResult);
-				}
-				else
-				{
-					U i = j;
-					writeAndBinDecal(ctx.m_vDecals[i], ctx, testResult);
-				}
+				c.m_firstIdx = ctx.m_clusters[i - 1].m_firstIdx;
+				continue;
 			}
 		}
-	}
 
-	m_barrier.wait();
+		U offset = ctx.m_lightIdsCount.fetchAdd(count + SIZE_IDX_COUNT);
+		U initialOffset = offset;
+		(void)initialOffset;
 
-	//
-	// Last thing, update the real clusters
-	//
+		if(offset + count + SIZE_IDX_COUNT <= ctx.m_maxLightIndices)
+		{
+			c.m_firstIdx = offset;
 
-	{
-		ANKI_TRACE_SCOPED_EVENT(R_LIGHT_BINNING);
+			ctx.m_lightIds[offset++] = countDecal;
+			for(U i = 0; i < countDecal; ++i)
+			{
+				ctx.m_lightIds[offset++] = cluster.m_decalIds[i].getIndex();
+			}
 
-		// Run per cluster
-		const U CLUSTER_GROUP = 16;
-		while((start = ctx.m_count.fetchAdd(CLUSTER_GROUP)) < clusterCount)
-		{
-			end = min<U>(start + CLUSTER_GROUP, clusterCount);
+			ctx.m_lightIds[offset++] = countP;
+			for(U i = 0; i < countP; ++i)
+			{
+				ctx.m_lightIds[offset++] = cluster.m_pointIds[i].getIndex();
+			}
 
-			for(U i = start; i < end; ++i)
+			ctx.m_lightIds[offset++] = countS;
+			for(U i = 0; i < countS; ++i)
 			{
-				auto& cluster = ctx.m_tempClusters[i];
-				cluster.normalizeCounts();
-
-				const U countP = cluster.m_pointCount.get();
-				const U countS = cluster.m_spotCount.get();
-				const U countProbe = cluster.m_probeCount.get();
-				const U countDecal = cluster.m_decalCount.get();
-				const U count = countP + countS + countProbe + countDecal;
-
-				auto& c = ctx.m_clusters[i];
-				c.m_firstIdx = 0; // Point to the first empty indices
-
-				// Early exit
-				if(ANKI_UNLIKELY(count == 0))
-				{
-					continue;
-				}
-
-				// Check if the previous cluster contains the same lights as this one and if yes then merge them. This
-				// will avoid allocating new IDs (and thrashing GPU caches).
-				cluster.sortLightIds();
-				if(i != start)
-				{
-					const auto& clusterB = ctx.m_tempClusters[i - 1];
-
-					if(cluster == clusterB)
-					{
-						c.m_firstIdx = ctx.m_clusters[i - 1].m_firstIdx;
-						continue;
-					}
-				}
-
-				U offset = ctx.m_lightIdsCount.fetchAdd(count + SIZE_IDX_COUNT);
-				U initialOffset = offset;
-				(void)initialOffset;
-
-				if(offset + count + SIZE_IDX_COUNT <= ctx.m_maxLightIndices)
-				{
-					c.m_firstIdx = offset;
-
-					ctx.m_lightIds[offset++] = countDecal;
-					for(U i = 0; i < countDecal; ++i)
-					{
-						ctx.m_lightIds[offset++] = cluster.m_decalIds[i].getIndex();
-					}
-
-					ctx.m_lightIds[offset++] = countP;
-					for(U i = 0; i < countP; ++i)
-					{
-						ctx.m_lightIds[offset++] = cluster.m_pointIds[i].getIndex();
-					}
-
-					ctx.m_lightIds[offset++] = countS;
-					for(U i = 0; i < countS; ++i)
-					{
-						ctx.m_lightIds[offset++] = cluster.m_spotIds[i].getIndex();
-					}
-
-					ctx.m_lightIds[offset++] = countProbe;
-					for(U i = 0; i < countProbe; ++i)
-					{
-						ctx.m_lightIds[offset++] = cluster.m_probeIds[i].getIndex();
-					}
-
-					ANKI_ASSERT(offset - initialOffset == count + SIZE_IDX_COUNT);
-				}
-				else
-				{
-					ANKI_R_LOGW("Light IDs buffer too small");
-				}
-			} // end for
-		} // end while
-	} // scope
+				ctx.m_lightIds[offset++] = cluster.m_spotIds[i].getIndex();
+			}
+
+			ctx.m_lightIds[offset++] = countProbe;
+			for(U i = 0; i < countProbe; ++i)
+			{
+				ctx.m_lightIds[offset++] = cluster.m_probeIds[i].getIndex();
+			}
+
+			ANKI_ASSERT(offset - initialOffset == count + SIZE_IDX_COUNT);
+		}
+		else
+		{
+			ANKI_R_LOGW("Light IDs buffer too small");
+		}
+	}
 }
 
 void LightBin::writeAndBinPointLight(
@@ -31,8 +31,6 @@ public:
 /// Bins lights and probes to clusters.
 class LightBin
 {
-	friend class WriteLightsTask;
-
 public:
 	LightBin(const GenericMemoryPoolAllocator<U8>& alloc,
 		U clusterCountX,
@@ -64,16 +62,19 @@ private:
 	class ClusterLightIndex;
 	class ClusterProbeIndex;
 	class ClusterData;
-	class WriteLightsTask;
 
 	GenericMemoryPoolAllocator<U8> m_alloc;
 	Clusterer m_clusterer;
 	U32 m_clusterCount = 0;
 	ThreadPool* m_threadPool = nullptr;
 	StagingGpuMemoryManager* m_stagingMem = nullptr;
-	Barrier m_barrier;
 
-	void binLights(U32 threadId, PtrSize threadsCount, BinContext& ctx);
+	/// Bin the lights, probes and decals in the range [start, end). Decals come first, then point lights, then spot
+	/// lights and then probes.
+	void binLights(PtrSize start, PtrSize end, BinContext& ctx, ClustererTestResult& testResult);
+
+	/// Write the clusters in the range [start, end) to the GPU buffers.
+	void writeClusters(PtrSize start, PtrSize end, BinContext& ctx);
 
 	void writeAndBinPointLight(const PointLightQueueElement& lightEl, BinContext& ctx, ClustererTestResult& testResult);
 
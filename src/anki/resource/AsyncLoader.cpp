@@ -27,7 +27,7 @@ AsyncLoader::~AsyncLoader()
 		{
 			AsyncLoaderTask* task = &m_taskQueue.getFront();
 			m_taskQueue.popFront();
-			m_alloc.deleteInstance(task);
+			m_taskAlloc.deleteInstance(task);
 		}
 	}
 }
@@ -35,6 +35,8 @@ AsyncLoader::~AsyncLoader()
 void AsyncLoader::init(const HeapAllocator<U8>& alloc)
 {
 	m_alloc = alloc;
+	m_taskAlloc = ThreadCachingAllocator<U8>(
+		alloc.getMemoryPool().getAllocationCallback(), alloc.getMemoryPool().getAllocationCallbackUserData());
 	m_thread.start(this, threadCallback);
 }
 
@@ -147,7 +149,7 @@ Error AsyncLoader::threadWorker()
 			else
 			{
 				// Delete the task
-				m_alloc.deleteInstance(task);
+				m_taskAlloc.deleteInstance(task);
 			}
 
 			if(ctx.m_pause)
@@ -56,7 +56,7 @@ public:
 	template<typename TTask, typename... TArgs>
 	TTask* newTask(TArgs&&... args)
 	{
-		return m_alloc.template newInstance<TTask>(std::forward<TArgs>(args)...);
+		return m_taskAlloc.template newInstance<TTask>(std::forward<TArgs>(args)...);
 	}
 
 	/// Create and submit a new asynchronous loading task.
@@ -86,6 +86,7 @@ public:
 
 private:
 	HeapAllocator<U8> m_alloc;
+	ThreadCachingAllocator<U8> m_taskAlloc; ///< The tasks are created in many threads and deleted in the loader thread.
 	Thread m_thread;
 	Barrier m_barrier = {2};
 
@@ -306,6 +306,28 @@ static PtrSize calcSizeOfSegment(const AnkiTextureHeader& header, ImageLoader::D
 	return out;
 }
 
+/// Point to the data of a mapped file or read them.
+static ANKI_USE_RESULT Error loadAnkiTextureData(ResourceFilePtr& file,
+	PtrSize offset,
+	PtrSize size,
+	GenericMemoryPoolAllocator<U8>& alloc,
+	DynamicArray<U8>& data,
+	ConstWeakArray<U8>& mappedData)
+{
+	if(file->isMapped())
+	{
+		ANKI_CHECK(file->map(offset, size, mappedData));
+		ANKI_CHECK(file->seek(size, ResourceFile::SeekOrigin::CURRENT));
+	}
+	else
+	{
+		data.create(alloc, size);
+		ANKI_CHECK(file->read(&data[0], size));
+	}
+
+	return Error::NONE;
+}
+
 static ANKI_USE_RESULT Error loadAnkiTexture(ResourceFilePtr file,
 	U32 maxTextureSize,
 	ImageLoader::DataCompression& preferredCompression,
@@ -443,6 +465,7 @@ static ANKI_USE_RESULT Error loadAnkiTexture(ResourceFilePtr file,
 	// Move file pointer
 	//
 
+	PtrSize offset = sizeof(AnkiTextureHeader);
 	if(preferredCompression == ImageLoader::DataCompression::RAW)
 	{
 		// Do nothing
@@ -452,8 +475,9 @@ static ANKI_USE_RESULT Error loadAnkiTexture(ResourceFilePtr file,
 		if((header.m_compressionFormats & ImageLoader::DataCompression::RAW) != ImageLoader::DataCompression::NONE)
 		{
 			// If raw compression is present then skip it
-			ANKI_CHECK(file->seek(
-				calcSizeOfSegment(header, ImageLoader::DataCompression::RAW), ResourceFile::SeekOrigin::CURRENT));
+			const PtrSize skip = calcSizeOfSegment(header, ImageLoader::DataCompression::RAW);
+			ANKI_CHECK(file->seek(skip, ResourceFile::SeekOrigin::CURRENT));
+			offset += skip;
 		}
 	}
 	else if(preferredCompression == ImageLoader::DataCompression::ETC)
@@ -461,18 +485,23 @@ static ANKI_USE_RESULT Error loadAnkiTexture(ResourceFilePtr file,
 		if((header.m_compressionFormats & ImageLoader::DataCompression::RAW) != ImageLoader::DataCompression::NONE)
 		{
 			// If raw compression is present then skip it
-			ANKI_CHECK(file->seek(
-				calcSizeOfSegment(header, ImageLoader::DataCompression::RAW), ResourceFile::SeekOrigin::CURRENT));
+			const PtrSize skip = calcSizeOfSegment(header, ImageLoader::DataCompression::RAW);
+			ANKI_CHECK(file->seek(skip, ResourceFile::SeekOrigin::CURRENT));
+			offset += skip;
 		}
 
 		if((header.m_compressionFormats & ImageLoader::DataCompression::S3TC) != ImageLoader::DataCompression::NONE)
 		{
 			// If s3tc compression is present then skip it
-			ANKI_CHECK(file->seek(
-				calcSizeOfSegment(header, ImageLoader::DataCompression::S3TC), ResourceFile::SeekOrigin::CURRENT));
+			const PtrSize skip = calcSizeOfSegment(header, ImageLoader::DataCompression::S3TC);
+			ANKI_CHECK(file->seek(skip, ResourceFile::SeekOrigin::CURRENT));
+			offset += skip;
 		}
 	}
 
+	// The whole segment will be read soon
+	file->adviseAccess(offset, calcSizeOfSegment(header, preferredCompression), FileAccessHint::WILL_NEED);
+
 	//
 	// It's time to read
 	//
@@ -502,14 +531,14 @@ static ANKI_USE_RESULT Error loadAnkiTexture(ResourceFilePtr file,
 						surf.m_width = mipWidth;
 						surf.m_height = mipHeight;
 
-						surf.m_data.create(alloc, dataSize);
-
-						ANKI_CHECK(file->read(&surf.m_data[0], dataSize));
+						ANKI_CHECK(loadAnkiTextureData(file, offset, dataSize, alloc, surf.m_data, surf.m_mappedData));
 					}
 					else
 					{
 						ANKI_CHECK(file->seek(dataSize, ResourceFile::SeekOrigin::CURRENT));
 					}
+
+					offset += dataSize;
 				}
 			}
 
@@ -536,15 +565,15 @@ static ANKI_USE_RESULT Error loadAnkiTexture(ResourceFilePtr file,
 				vol.m_height = mipHeight;
 				vol.m_depth = mipDepth;
 
-				vol.m_data.create(alloc, dataSize);
-
-				ANKI_CHECK(file->read(&vol.m_data[0], dataSize));
+				ANKI_CHECK(loadAnkiTextureData(file, offset, dataSize, alloc, vol.m_data, vol.m_mappedData));
 			}
 			else
 			{
 				ANKI_CHECK(file->seek(dataSize, ResourceFile::SeekOrigin::CURRENT));
 			}
 
+			offset += dataSize;
+
 			mipWidth /= 2;
 			mipHeight /= 2;
 			mipDepth /= 2;
@@ -619,6 +648,12 @@ Error ImageLoader::load(ResourceFilePtr file, const CString& filename, U32 maxTe
 			m_mipLevels,
 			m_textureType,
 			m_colorFormat));
+
+		// The data might point to the file
+		if(file->isMapped())
+		{
+			m_file = file;
+		}
 	}
 	else
 	{
@@ -678,6 +713,8 @@ void ImageLoader::destroy()
 	}
 
 	m_volumes.destroy(m_alloc);
+
+	m_file.reset(nullptr);
 }
 
 } // end namespace anki
@@ -53,7 +53,14 @@ public:
 		U32 m_width;
 		U32 m_height;
 		U32 m_mipLevel;
-		DynamicArray<U8> m_data;
+		DynamicArray<U8> m_data; ///< The pixels if they are not mapped from the file.
+		ConstWeakArray<U8> m_mappedData; ///< The pixels if they are mapped from the file.
+
+		/// Get the pixels.
+		ConstWeakArray<U8> getData() const
+		{
+			return (m_mappedData.getSize()) ? m_mappedData : ConstWeakArray<U8>(m_data);
+		}
 	};
 
 	class Volume
@@ -63,7 +70,14 @@ public:
 		U32 m_height;
 		U32 m_depth;
 		U32 m_mipLevel;
-		DynamicArray<U8> m_data;
+		DynamicArray<U8> m_data; ///< The pixels if they are not mapped from the file.
+		ConstWeakArray<U8> m_mappedData; ///< The pixels if they are mapped from the file.
+
+		/// Get the pixels.
+		ConstWeakArray<U8> getData() const
+		{
+			return (m_mappedData.getSize()) ? m_mappedData : ConstWeakArray<U8>(m_data);
+		}
 	};
 
 	ImageLoader(GenericMemoryPoolAllocator<U8> alloc)
@@ -143,6 +157,9 @@ private:
 	GenericMemoryPoolAllocator<U8> m_alloc;
 	Atomic<I32> m_refcount = {0};
 
+	/// Kept if the surfaces or the volumes point to the mapped file.
+	ResourceFilePtr m_file;
+
 	/// [mip][depth or face or layer]. Loader doesn't support cube arrays ATM so face and layer won't be used at the
 	/// same time.
 	DynamicArray<Surface> m_surfaces;
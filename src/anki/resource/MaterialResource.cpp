@@ -48,6 +48,7 @@ MaterialResource::~MaterialResource()
 	m_vars.destroy(getAllocator());
 	m_constValues.destroy(getAllocator());
 	m_mutations.destroy(getAllocator());
+	m_variants.destroy(getAllocator());
 }
 
 Error MaterialResource::load(const ResourceFilename& filename, Bool async)
@@ -531,16 +532,19 @@ const MaterialVariant& MaterialResource::getOrCreateVariant(const RenderingKey&
 
 	key.m_instanceCount = 1 << getInstanceGroupIdx(key.m_instanceCount);
 
-	MaterialVariant& variant = m_variantMatrix[U(key.m_pass)][key.m_lod][getInstanceGroupIdx(key.m_instanceCount)]
-											  [key.m_skinned][key.m_velocity];
-	LockGuard<SpinLock> lock(m_variantMatrixMtx);
+	// Flatten the key
+	U32 variantKey = U32(key.m_pass);
+	variantKey = variantKey * MAX_LOD_COUNT + key.m_lod;
+	variantKey = variantKey * MAX_INSTANCE_GROUPS + getInstanceGroupIdx(key.m_instanceCount);
+	variantKey = variantKey * 2 + (key.m_skinned != 0);
+	variantKey = variantKey * 2 + (key.m_velocity != 0);
 
-	if(variant.m_variant == nullptr)
-	{
+	// The lookup doesn't lock, only the creation of a new variant does
+	return m_variants.getOrCreate(getAllocator(), variantKey, [&](MaterialVariant& variant) {
 		const U mutatorCount = m_mutations.getSize() + ((m_instanceMutator) ? 1 : 0) + ((m_passMutator) ? 1 : 0)
 							   + ((m_lodMutator) ? 1 : 0) + ((m_bonesMutator) ? 1 : 0) + ((m_velocityMutator) ? 1 : 0);
 
-		DynamicArrayAuto<ShaderProgramResourceMutation> mutations(getTempAllocator());
+		DynamicArrayInline<ShaderProgramResourceMutation, 16> mutations(getAllocator());
 		mutations.create(mutatorCount);
 		U count = m_mutations.getSize();
 		if(m_mutations.getSize())
@@ -588,9 +592,7 @@ const MaterialVariant& MaterialResource::getOrCreateVariant(const RenderingKey&
 			ConstWeakArray<ShaderProgramResourceConstantValue>(
 				(m_constValues.getSize()) ? &m_constValues[0] : nullptr, m_constValues.getSize()),
 			variant.m_variant);
-	}
-
-	return variant;
+	});
 }
 
 U MaterialResource::getInstanceGroupIdx(U instanceCount)
@@ -271,8 +271,9 @@ private:
 	DynamicArray<ShaderProgramResourceMutation> m_mutations;
 
 	/// Matrix of variants.
-	mutable Array5d<MaterialVariant, U(Pass::COUNT), MAX_LOD_COUNT, MAX_INSTANCE_GROUPS, 2, 2> m_variantMatrix;
-	mutable SpinLock m_variantMatrixMtx;
+	/// The variants that were requested so far. The key is the index in a [pass][lod][instanceGroup][skinned][velocity]
+	/// matrix.
+	mutable ConcurrentHashMap<U32, MaterialVariant> m_variants;
 
 	DynamicArray<MaterialVariable> m_vars; ///< Non-const vars.
 	DynamicArray<ShaderProgramResourceConstantValue> m_constValues;
@@ -112,6 +112,10 @@ Error MeshLoader::load(const ResourceFilename& filename)
 		}
 	}
 
+	// The buffers will be read next
+	const PtrSize buffersOffset = sizeof(m_header) + m_subMeshes.getSizeInBytes();
+	m_file->adviseAccess(buffersOffset, m_file->getSize() - buffersOffset, FileAccessHint::WILL_NEED);
+
 	return Error::NONE;
 }
 
@@ -0,0 +1,491 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/resource/PackArchive.h>
+#include <anki/util/Hash.h>
+#include <anki/util/Functions.h>
+#include <zlib.h>
+
+namespace anki
+{
+
+static U32 computeBlockCount(const PackArchiveFile::Entry& entry, U32 blockSize)
+{
+	return U32((entry.m_size + blockSize - 1) / blockSize);
+}
+
+PackArchive::~PackArchive()
+{
+	m_toc.destroy(m_alloc);
+}
+
+Error PackArchive::open(const CString& filename)
+{
+	ANKI_CHECK(m_file.open(filename, FileOpenFlag::READ | FileOpenFlag::BINARY | FileOpenFlag::MMAP));
+
+	// Header
+	if(m_file.getSize() < sizeof(m_header))
+	{
+		ANKI_RESOURCE_LOGE("Pack archive is too small: %s", &filename[0]);
+		return Error::USER_DATA;
+	}
+
+	ANKI_CHECK(m_file.readAt(0, &m_header, sizeof(m_header)));
+
+	if(memcmp(&m_header.m_magic[0], PackArchiveFile::MAGIC, sizeof(m_header.m_magic)) != 0)
+	{
+		ANKI_RESOURCE_LOGE("Wrong magic word in pack archive: %s", &filename[0]);
+		return Error::USER_DATA;
+	}
+
+	if(m_header.m_version != PackArchiveFile::VERSION || m_header.m_hashVersion != PackArchiveFile::HASH_VERSION)
+	{
+		ANKI_RESOURCE_LOGE("Pack archive has version %u and hash version %u, expected %u and %u. Re-pack it: %s",
+			m_header.m_version,
+			m_header.m_hashVersion,
+			U32(PackArchiveFile::VERSION),
+			U32(PackArchiveFile::HASH_VERSION),
+			&filename[0]);
+		return Error::USER_DATA;
+	}
+
+	const PtrSize bucketsSize = m_header.m_bucketCount * sizeof(U32);
+	const PtrSize entriesSize = m_header.m_entryCount * sizeof(PackArchiveFile::Entry);
+	const PtrSize blocksSize = m_header.m_blockCount * sizeof(PackArchiveFile::Block);
+	if(m_header.m_tocOffset > m_file.getSize() || m_header.m_tocSize != m_file.getSize() - m_header.m_tocOffset
+		|| (m_header.m_tocOffset % alignof(U64)) != 0 || m_header.m_bucketCount < 2
+		|| !isPowerOfTwo(m_header.m_bucketCount) || m_header.m_bucketCount < m_header.m_entryCount
+		|| m_header.m_blockSize == 0 || m_header.m_tocSize < bucketsSize + entriesSize + blocksSize)
+	{
+		ANKI_RESOURCE_LOGE("Wrong header in pack archive: %s", &filename[0]);
+		return Error::USER_DATA;
+	}
+
+	// Table of contents. Use it from the mapping if possible
+	const U8* toc;
+	if(m_file.isMapped())
+	{
+		ConstWeakArray<U8> view;
+		ANKI_CHECK(m_file.map(m_header.m_tocOffset, m_header.m_tocSize, view));
+		toc = &view[0];
+	}
+	else
+	{
+		m_toc.create(m_alloc, m_header.m_tocSize);
+		ANKI_CHECK(m_file.readAt(m_header.m_tocOffset, &m_toc[0], m_header.m_tocSize));
+		toc = &m_toc[0];
+	}
+
+	m_buckets = reinterpret_cast<const U32*>(toc);
+	m_entries = reinterpret_cast<const PackArchiveFile::Entry*>(toc + bucketsSize);
+	m_blocks = reinterpret_cast<const PackArchiveFile::Block*>(toc + bucketsSize + entriesSize);
+	m_names = reinterpret_cast<const char*>(toc + bucketsSize + entriesSize + blocksSize);
+
+	if(checkToc())
+	{
+		ANKI_RESOURCE_LOGE("Wrong table of contents in pack archive: %s", &filename[0]);
+		return Error::USER_DATA;
+	}
+
+	return Error::NONE;
+}
+
+Error PackArchive::checkToc() const
+{
+	const PtrSize namesSize = m_header.m_tocSize - m_header.m_bucketCount * sizeof(U32)
+							  - m_header.m_entryCount * sizeof(PackArchiveFile::Entry)
+							  - m_header.m_blockCount * sizeof(PackArchiveFile::Block);
+
+	for(U32 i = 0; i < m_header.m_bucketCount; ++i)
+	{
+		if(m_buckets[i] != PackArchiveFile::EMPTY_BUCKET && m_buckets[i] >= m_header.m_entryCount)
+		{
+			return Error::USER_DATA;
+		}
+	}
+
+	for(U32 i = 0; i < m_header.m_entryCount; ++i)
+	{
+		const PackArchiveFile::Entry& entry = m_entries[i];
+
+		if(PtrSize(entry.m_nameOffset) + entry.m_nameLength >= namesSize
+			|| m_names[entry.m_nameOffset + entry.m_nameLength] != '\0')
+		{
+			return Error::USER_DATA;
+		}
+
+		if(entry.m_compression == PackArchiveFile::Compression::NONE)
+		{
+			if(entry.m_offset > m_header.m_tocOffset || entry.m_size > m_header.m_tocOffset - entry.m_offset)
+			{
+				return Error::USER_DATA;
+			}
+		}
+		else if(entry.m_compression == PackArchiveFile::Compression::DEFLATE)
+		{
+			const U32 blockCount = computeBlockCount(entry, m_header.m_blockSize);
+			if(entry.m_firstBlock > m_header.m_blockCount || blockCount > m_header.m_blockCount - entry.m_firstBlock)
+			{
+				return Error::USER_DATA;
+			}
+
+			for(U32 b = entry.m_firstBlock; b < entry.m_firstBlock + blockCount; ++b)
+			{
+				const PackArchiveFile::Block& block = m_blocks[b];
+				if(block.m_compressedSize > m_header.m_blockSize || block.m_offset > m_header.m_tocOffset
+					|| block.m_compressedSize > m_header.m_tocOffset - block.m_offset)
+				{
+					return Error::USER_DATA;
+				}
+			}
+		}
+		else
+		{
+			return Error::USER_DATA;
+		}
+	}
+
+	return Error::NONE;
+}
+
+Bool PackArchive::find(const CString& filename, U32& entryIdx) const
+{
+	ANKI_ASSERT(m_entries);
+	const U32 length = U32(filename.getLength());
+	const U64 hash = computeHash(filename.cstr(), length);
+	const U32 mask = m_header.m_bucketCount - 1;
+
+	for(U32 i = 0; i < m_header.m_bucketCount; ++i)
+	{
+		const U32 idx = m_buckets[(hash + i) & mask];
+		if(idx == PackArchiveFile::EMPTY_BUCKET)
+		{
+			break;
+		}
+
+		const PackArchiveFile::Entry& entry = m_entries[idx];
+		if(entry.m_nameHash == hash && entry.m_nameLength == length
+			&& memcmp(m_names + entry.m_nameOffset, filename.cstr(), length) == 0)
+		{
+			entryIdx = idx;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+Error PackArchive::readRaw(PtrSize offset, void* buff, PtrSize size)
+{
+#if ANKI_POSIX
+	return m_file.readAt(offset, buff, size);
+#else
+	// File::readAt is not thread safe here
+	LockGuard<Mutex> lock(m_mtx);
+	return m_file.readAt(offset, buff, size);
+#endif
+}
+
+Error PackArchive::readUncompressed(U32 entryIdx, PtrSize offset, void* buff, PtrSize size)
+{
+	const PackArchiveFile::Entry& entry = getEntry(entryIdx);
+	ANKI_ASSERT(entry.m_compression == PackArchiveFile::Compression::NONE);
+
+	if(offset > entry.m_size || size > entry.m_size - offset)
+	{
+		ANKI_RESOURCE_LOGE("Reading out of the file: %s", getEntryName(entryIdx).cstr());
+		return Error::FILE_ACCESS;
+	}
+
+	return readRaw(entry.m_offset + offset, buff, size);
+}
+
+Error PackArchive::mapUncompressed(U32 entryIdx, PtrSize offset, PtrSize size, ConstWeakArray<U8>& data) const
+{
+	const PackArchiveFile::Entry& entry = getEntry(entryIdx);
+	ANKI_ASSERT(entry.m_compression == PackArchiveFile::Compression::NONE);
+
+	if(offset > entry.m_size || size > entry.m_size - offset)
+	{
+		ANKI_RESOURCE_LOGE("Mapping out of the file: %s", getEntryName(entryIdx).cstr());
+		return Error::FUNCTION_FAILED;
+	}
+
+	return m_file.map(entry.m_offset + offset, size, data);
+}
+
+Error PackArchive::readBlock(U32 entryIdx, U32 blockIdx, void* buff, DynamicArrayAuto<U8>& scratch, PtrSize& size)
+{
+	const PackArchiveFile::Entry& entry = getEntry(entryIdx);
+	ANKI_ASSERT(entry.m_compression == PackArchiveFile::Compression::DEFLATE);
+	ANKI_ASSERT(blockIdx < computeBlockCount(entry, m_header.m_blockSize));
+
+	size = min<PtrSize>(m_header.m_blockSize, entry.m_size - PtrSize(blockIdx) * m_header.m_blockSize);
+	const PackArchiveFile::Block& block = m_blocks[entry.m_firstBlock + blockIdx];
+
+	if(block.m_compressedSize == size)
+	{
+		// Stored uncompressed
+		return readRaw(block.m_offset, buff, size);
+	}
+
+	const U8* src;
+	if(m_file.isMapped())
+	{
+		ConstWeakArray<U8> view;
+		ANKI_CHECK(m_file.map(block.m_offset, block.m_compressedSize, view));
+		src = &view[0];
+	}
+	else
+	{
+		scratch.resize(block.m_compressedSize);
+		ANKI_CHECK(readRaw(block.m_offset, &scratch[0], block.m_compressedSize));
+		src = &scratch[0];
+	}
+
+	uLongf uncompressedSize = size;
+	const int ret = uncompress(static_cast<Bytef*>(buff), &uncompressedSize, src, block.m_compressedSize);
+	if(ret != Z_OK || uncompressedSize != size)
+	{
+		ANKI_RESOURCE_LOGE("Failed to decompress a block of: %s", getEntryName(entryIdx).cstr());
+		return Error::FILE_ACCESS;
+	}
+
+	return Error::NONE;
+}
+
+void PackArchive::adviseAccess(U32 entryIdx, PtrSize offset, PtrSize size, FileAccessHint hint)
+{
+	const PackArchiveFile::Entry& entry = getEntry(entryIdx);
+	if(offset >= entry.m_size || size == 0)
+	{
+		return;
+	}
+
+	size = min<PtrSize>(size, entry.m_size - offset);
+
+	if(entry.m_compression == PackArchiveFile::Compression::NONE)
+	{
+		m_file.adviseAccess(entry.m_offset + offset, size, hint);
+	}
+	else
+	{
+		// Advise the range of the compressed blocks
+		const PackArchiveFile::Block& first = m_blocks[entry.m_firstBlock + offset / m_header.m_blockSize];
+		const PackArchiveFile::Block& last = m_blocks[entry.m_firstBlock + (offset + size - 1) / m_header.m_blockSize];
+		m_file.adviseAccess(first.m_offset, last.m_offset + last.m_compressedSize - first.m_offset, hint);
+	}
+}
+
+PackArchiveWriter::~PackArchiveWriter()
+{
+	destroy();
+}
+
+void PackArchiveWriter::destroy()
+{
+	m_entries.destroy(m_alloc);
+	m_blocks.destroy(m_alloc);
+	m_names.destroy(m_alloc);
+}
+
+Error PackArchiveWriter::begin(const CString& filename, U32 blockSize)
+{
+	ANKI_ASSERT(!m_file.isOpen());
+	ANKI_ASSERT(blockSize > 0);
+
+	ANKI_CHECK(m_file.open(filename, FileOpenFlag::WRITE | FileOpenFlag::BINARY));
+	m_blockSize = blockSize;
+	m_offset = 0;
+
+	// The header is written at the end
+	PackArchiveFile::Header header;
+	memset(&header, 0, sizeof(header));
+	ANKI_CHECK(write(&header, sizeof(header)));
+
+	return Error::NONE;
+}
+
+Error PackArchiveWriter::write(const void* data, PtrSize size)
+{
+	ANKI_CHECK(m_file.write(data, size));
+	m_offset += size;
+	return Error::NONE;
+}
+
+Error PackArchiveWriter::pad(PtrSize alignment)
+{
+	static const Array<U8, 64> zeros = {};
+	PtrSize padding = getAlignedRoundUp(alignment, m_offset) - m_offset;
+	while(padding > 0)
+	{
+		const PtrSize size = min<PtrSize>(padding, zeros.getSize());
+		ANKI_CHECK(write(&zeros[0], size));
+		padding -= size;
+	}
+
+	return Error::NONE;
+}
+
+Error PackArchiveWriter::addFile(
+	const CString& filename, ConstWeakArray<U8> data, PackArchiveFile::Compression compression)
+{
+	ANKI_ASSERT(m_file.isOpen());
+
+	PackArchiveFile::Entry entry;
+	memset(&entry, 0, sizeof(entry));
+	entry.m_nameLength = U32(filename.getLength());
+	entry.m_nameHash = computeHash(filename.cstr(), entry.m_nameLength);
+	entry.m_size = data.getSize();
+
+	if(entry.m_nameLength == 0)
+	{
+		ANKI_RESOURCE_LOGE("Empty filename");
+		return Error::USER_DATA;
+	}
+
+	for(const PackArchiveFile::Entry& other : m_entries)
+	{
+		if(other.m_nameHash == entry.m_nameHash && other.m_nameLength == entry.m_nameLength
+			&& memcmp(&m_names[other.m_nameOffset], filename.cstr(), entry.m_nameLength) == 0)
+		{
+			ANKI_RESOURCE_LOGE("File added twice: %s", filename.cstr());
+			return Error::USER_DATA;
+		}
+	}
+
+	// Name
+	entry.m_nameOffset = U32(m_names.getSize());
+	m_names.resize(m_alloc, m_names.getSize() + entry.m_nameLength + 1);
+	memcpy(&m_names[entry.m_nameOffset], filename.cstr(), entry.m_nameLength + 1);
+
+	// Data
+	Bool compressed = false;
+	if(compression == PackArchiveFile::Compression::DEFLATE && data.getSize() > 0)
+	{
+		// Compress the blocks in memory first to know if it's worth it
+		const U32 blockCount = computeBlockCount(entry, m_blockSize);
+		const PtrSize maxCompressedBlockSize = compressBound(m_blockSize);
+		DynamicArrayAuto<U8> compressedData(m_alloc);
+		compressedData.create(blockCount * maxCompressedBlockSize);
+		DynamicArrayAuto<PackArchiveFile::Block> blocks(m_alloc);
+		blocks.create(blockCount);
+
+		PtrSize compressedDataSize = 0;
+		for(U32 i = 0; i < blockCount; ++i)
+		{
+			const PtrSize pos = PtrSize(i) * m_blockSize;
+			const PtrSize size = min<PtrSize>(m_blockSize, data.getSize() - pos);
+
+			uLongf compressedSize = maxCompressedBlockSize;
+			const int ret =
+				compress2(&compressedData[compressedDataSize], &compressedSize, &data[pos], size, Z_BEST_COMPRESSION);
+			if(ret != Z_OK || compressedSize >= size)
+			{
+				// Store it uncompressed
+				memcpy(&compressedData[compressedDataSize], &data[pos], size);
+				compressedSize = size;
+			}
+
+			blocks[i].m_offset = compressedDataSize;
+			blocks[i].m_compressedSize = U32(compressedSize);
+			blocks[i].m_padding = 0;
+			compressedDataSize += compressedSize;
+		}
+
+		if(compressedDataSize < data.getSize())
+		{
+			compressed = true;
+			entry.m_compression = PackArchiveFile::Compression::DEFLATE;
+			entry.m_offset = m_offset;
+			entry.m_firstBlock = U32(m_blocks.getSize());
+
+			for(PackArchiveFile::Block& block : blocks)
+			{
+				block.m_offset += m_offset;
+				m_blocks.emplaceBack(m_alloc, block);
+			}
+
+			ANKI_CHECK(write(&compressedData[0], compressedDataSize));
+		}
+	}
+
+	if(!compressed)
+	{
+		ANKI_CHECK(pad(PackArchiveFile::DATA_ALIGNMENT));
+		entry.m_compression = PackArchiveFile::Compression::NONE;
+		entry.m_offset = m_offset;
+
+		if(data.getSize() > 0)
+		{
+			ANKI_CHECK(write(&data[0], data.getSize()));
+		}
+	}
+
+	m_entries.emplaceBack(m_alloc, entry);
+	return Error::NONE;
+}
+
+Error PackArchiveWriter::end()
+{
+	ANKI_ASSERT(m_file.isOpen());
+
+	// The hash table
+	const U32 entryCount = U32(m_entries.getSize());
+	const U32 bucketCount = nextPowerOfTwo(max<U32>(entryCount * 2, 2));
+	DynamicArrayAuto<U32> buckets(m_alloc);
+	buckets.create(bucketCount, PackArchiveFile::EMPTY_BUCKET);
+	for(U32 i = 0; i < entryCount; ++i)
+	{
+		U64 bucket = m_entries[i].m_nameHash;
+		while(buckets[bucket & (bucketCount - 1)] != PackArchiveFile::EMPTY_BUCKET)
+		{
+			++bucket;
+		}
+
+		buckets[bucket & (bucketCount - 1)] = i;
+	}
+
+	// The table of contents
+	ANKI_CHECK(pad(alignof(U64)));
+	const PtrSize tocOffset = m_offset;
+	ANKI_CHECK(write(&buckets[0], buckets.getSizeInBytes()));
+	if(entryCount)
+	{
+		ANKI_CHECK(write(&m_entries[0], m_entries.getSizeInBytes()));
+	}
+
+	if(m_blocks.getSize())
+	{
+		ANKI_CHECK(write(&m_blocks[0], m_blocks.getSizeInBytes()));
+	}
+
+	if(entryCount)
+	{
+		ANKI_CHECK(write(&m_names[0], m_names.getSizeInBytes()));
+	}
+
+	// The header
+	PackArchiveFile::Header header;
+	memcpy(&header.m_magic[0], PackArchiveFile::MAGIC, sizeof(header.m_magic));
+	header.m_version = PackArchiveFile::VERSION;
+	header.m_hashVersion = PackArchiveFile::HASH_VERSION;
+	header.m_entryCount = entryCount;
+	header.m_bucketCount = bucketCount;
+	header.m_blockCount = U32(m_blocks.getSize());
+	header.m_blockSize = m_blockSize;
+	header.m_padding = 0;
+	header.m_tocOffset = tocOffset;
+	header.m_tocSize = m_offset - tocOffset;
+
+	ANKI_CHECK(m_file.seek(0, File::SeekOrigin::BEGINNING));
+	ANKI_CHECK(m_file.write(&header, sizeof(header)));
+	m_file.close();
+
+	destroy();
+	return Error::NONE;
+}
+
+} // end namespace anki
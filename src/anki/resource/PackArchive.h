@@ -0,0 +1,206 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/resource/Common.h>
+#include <anki/util/File.h>
+#include <anki/util/DynamicArray.h>
+#include <anki/util/WeakArray.h>
+#include <anki/util/Thread.h>
+
+namespace anki
+{
+
+/// @addtogroup resource
+/// @{
+
+/// The on-disk format of the pack archives (.ankipack). A pack starts with the Header, the data of the entries follow
+/// and the table of contents is at the end. The table of contents is the hash table, the entries, the blocks and the
+/// names, one after the other.
+///
+/// Compressed entries are split into blocks of Header::m_blockSize that are compressed independently so a seek only
+/// needs to decompress a single block. Uncompressed entries are aligned to DATA_ALIGNMENT so they can be mapped.
+class PackArchiveFile
+{
+public:
+	static constexpr const char* MAGIC = "ANKIPAK1";
+	static constexpr U32 VERSION = 1; ///< Bump it when the layout changes.
+	static constexpr U32 HASH_VERSION = 1; ///< Bump it when computeHash() changes. The entries are found by hash.
+	static constexpr U32 DEFAULT_BLOCK_SIZE = 64 * 1024;
+	static constexpr U32 DATA_ALIGNMENT = 4096;
+	static constexpr U32 EMPTY_BUCKET = MAX_U32;
+
+	enum class Compression : U32
+	{
+		NONE,
+		DEFLATE ///< zlib.
+	};
+
+	struct Header
+	{
+		char m_magic[8];
+		U32 m_version; ///< VERSION
+		U32 m_hashVersion; ///< HASH_VERSION
+		U32 m_entryCount;
+		U32 m_bucketCount; ///< It's a power of two.
+		U32 m_blockCount;
+		U32 m_blockSize;
+		U32 m_padding;
+		U64 m_tocOffset;
+		U64 m_tocSize;
+	};
+
+	struct Entry
+	{
+		U64 m_nameHash; ///< computeHash() of the name.
+		U64 m_offset; ///< The offset of the data in the archive.
+		U64 m_size; ///< The uncompressed size.
+		U32 m_nameOffset; ///< The offset of the name in the names. The names are null terminated.
+		U32 m_nameLength;
+		U32 m_firstBlock; ///< The first block of compressed entries.
+		Compression m_compression;
+	};
+
+	/// A compressed block. All the blocks of an entry have Header::m_blockSize size uncompressed except the last.
+	struct Block
+	{
+		U64 m_offset; ///< The offset of the block in the archive.
+		U32 m_compressedSize; ///< If it's equal to the uncompressed size the block is stored uncompressed.
+		U32 m_padding;
+	};
+};
+
+/// A pack archive that is open for reading. The table of contents is loaded at once and the entries are read at random
+/// positions. If the archive can be mapped the uncompressed entries can be mapped as well. It's thread safe.
+class PackArchive : public NonCopyable
+{
+public:
+	PackArchive(GenericMemoryPoolAllocator<U8> alloc)
+		: m_alloc(alloc)
+	{
+	}
+
+	~PackArchive();
+
+	ANKI_USE_RESULT Error open(const CString& filename);
+
+	/// Find an entry.
+	/// @param filename The name of the file in the archive.
+	/// @param[out] entryIdx The entry.
+	/// @return True if it's there.
+	Bool find(const CString& filename, U32& entryIdx) const;
+
+	U32 getEntryCount() const
+	{
+		return m_header.m_entryCount;
+	}
+
+	const PackArchiveFile::Entry& getEntry(U32 entryIdx) const
+	{
+		ANKI_ASSERT(entryIdx < m_header.m_entryCount);
+		return m_entries[entryIdx];
+	}
+
+	CString getEntryName(U32 entryIdx) const
+	{
+		return CString(m_names + getEntry(entryIdx).m_nameOffset);
+	}
+
+	U32 getBlockSize() const
+	{
+		return m_header.m_blockSize;
+	}
+
+	/// Return true if the entries that are not compressed can be mapped.
+	Bool isMapped() const
+	{
+		return m_file.isMapped();
+	}
+
+	/// Read a part of an entry that is not compressed.
+	/// @param entryIdx The entry.
+	/// @param offset The offset from the beginning of the entry.
+	/// @param[out] buff Where to read to.
+	/// @param size The number of bytes to read.
+	ANKI_USE_RESULT Error readUncompressed(U32 entryIdx, PtrSize offset, void* buff, PtrSize size);
+
+	/// Get a view of a part of an entry that is not compressed. Works only if isMapped() is true.
+	ANKI_USE_RESULT Error mapUncompressed(U32 entryIdx, PtrSize offset, PtrSize size, ConstWeakArray<U8>& data) const;
+
+	/// Decompress a block of a compressed entry.
+	/// @param entryIdx The entry.
+	/// @param blockIdx The block of the entry.
+	/// @param[out] buff Where to decompress to. It should be getBlockSize() big.
+	/// @param[in,out] scratch Memory for the compressed data if the archive is not mapped.
+	/// @param[out] size The uncompressed size of the block.
+	ANKI_USE_RESULT Error readBlock(
+		U32 entryIdx, U32 blockIdx, void* buff, DynamicArrayAuto<U8>& scratch, PtrSize& size);
+
+	/// Hint that a part of an entry will be read soon.
+	void adviseAccess(U32 entryIdx, PtrSize offset, PtrSize size, FileAccessHint hint);
+
+private:
+	GenericMemoryPoolAllocator<U8> m_alloc;
+	File m_file;
+	Mutex m_mtx; ///< Protects the reads if the archive is not mapped.
+
+	PackArchiveFile::Header m_header;
+	DynamicArray<U8> m_toc; ///< The table of contents if the archive is not mapped.
+	const U32* m_buckets = nullptr;
+	const PackArchiveFile::Entry* m_entries = nullptr;
+	const PackArchiveFile::Block* m_blocks = nullptr;
+	const char* m_names = nullptr;
+
+	ANKI_USE_RESULT Error readRaw(PtrSize offset, void* buff, PtrSize size);
+
+	ANKI_USE_RESULT Error checkToc() const;
+};
+
+/// Creates pack archives.
+class PackArchiveWriter : public NonCopyable
+{
+public:
+	PackArchiveWriter(GenericMemoryPoolAllocator<U8> alloc)
+		: m_alloc(alloc)
+	{
+	}
+
+	~PackArchiveWriter();
+
+	/// Start writing an archive.
+	/// @param filename The archive.
+	/// @param blockSize The uncompressed size of the blocks of the compressed entries.
+	ANKI_USE_RESULT Error begin(const CString& filename, U32 blockSize = PackArchiveFile::DEFAULT_BLOCK_SIZE);
+
+	/// Add a file to the archive. If the compression doesn't make the file smaller it's stored uncompressed.
+	/// @param filename The name of the file in the archive.
+	/// @param data The contents of the file.
+	/// @param compression The compression of the file.
+	ANKI_USE_RESULT Error addFile(
+		const CString& filename, ConstWeakArray<U8> data, PackArchiveFile::Compression compression);
+
+	/// Write the table of contents and close the archive.
+	ANKI_USE_RESULT Error end();
+
+private:
+	GenericMemoryPoolAllocator<U8> m_alloc;
+	File m_file;
+	PtrSize m_offset = 0;
+	U32 m_blockSize = 0;
+
+	DynamicArray<PackArchiveFile::Entry> m_entries;
+	DynamicArray<PackArchiveFile::Block> m_blocks;
+	DynamicArray<char> m_names;
+
+	ANKI_USE_RESULT Error write(const void* data, PtrSize size);
+
+	ANKI_USE_RESULT Error pad(PtrSize alignment);
+
+	void destroy();
+};
+/// @}
+
+} // end namespace anki
@@ -4,6 +4,7 @@
 // http://www.anki3d.org/LICENSE
 
 #include <anki/resource/ResourceFilesystem.h>
+#include <anki/resource/PackArchive.h>
 #include <anki/util/Filesystem.h>
 #include <anki/misc/ConfigSet.h>
 #include <anki/core/Trace.h>
@@ -56,6 +57,21 @@ public:
 	{
 		return m_file.getSize();
 	}
+
+	Bool isMapped() const override
+	{
+		return m_file.isMapped();
+	}
+
+	ANKI_USE_RESULT Error map(PtrSize offset, PtrSize size, ConstWeakArray<U8>& data) const override
+	{
+		return m_file.map(offset, size, data);
+	}
+
+	void adviseAccess(PtrSize offset, PtrSize size, FileAccessHint hint) override
+	{
+		m_file.adviseAccess(offset, size, hint);
+	}
 };
 
 /// ZIP file
@@ -81,7 +97,12 @@ public:
 		}
 	}
 
-	ANKI_USE_RESULT Error open(const CString& archive, const CString& archivedFname)
+	/// Open a file of a zip archive.
+	/// @param archive The archive.
+	/// @param offset The offset of the file in the central directory of the archive.
+	/// @param number The number of the file in the archive.
+	/// @param size The uncompressed size of the file.
+	ANKI_USE_RESULT Error open(const CString& archive, U64 offset, U32 number, PtrSize size)
 	{
 		// Open archive
 		m_archive = unzOpen(&archive[0]);
@@ -91,9 +112,11 @@ public:
 			return Error::FILE_ACCESS;
 		}
 
-		// Locate archived
-		const int caseSensitive = 1;
-		if(unzLocateFile(m_archive, &archivedFname[0], caseSensitive) != UNZ_OK)
+		// Go to the archived file without searching for it
+		unz_file_pos pos;
+		pos.pos_in_zip_directory = uLong(offset);
+		pos.num_of_file = number;
+		if(unzGoToFilePos(m_archive, &pos) != UNZ_OK)
 		{
 			ANKI_RESOURCE_LOGE("Failed to locate file in archive");
 			return Error::FILE_ACCESS;
@@ -106,11 +129,7 @@ public:
 			return Error::FILE_ACCESS;
 		}
 
-		// Get size just in case
-		unz_file_info zinfo;
-		zinfo.uncompressed_size = 0;
-		unzGetCurrentFileInfo(m_archive, &zinfo, nullptr, 0, nullptr, 0, nullptr, 0);
-		m_size = zinfo.uncompressed_size;
+		m_size = size;
 		ANKI_ASSERT(m_size != 0);
 
 		return Error::NONE;
@@ -193,16 +212,236 @@ public:
 	}
 };
 
+/// File in a pack archive. The compressed files are decompressed one block at a time.
+class PackResourceFile final : public ResourceFile
+{
+public:
+	PackArchive* m_pack = nullptr;
+	U32 m_entryIdx = 0;
+	PtrSize m_size = 0;
+	PtrSize m_pos = 0;
+	Bool8 m_compressed = false;
+
+	DynamicArrayAuto<U8> m_block; ///< The last decompressed block.
+	PtrSize m_blockSize = 0;
+	U32 m_blockIdx = MAX_U32;
+	DynamicArrayAuto<U8> m_scratch;
+
+	PackResourceFile(GenericMemoryPoolAllocator<U8> alloc)
+		: ResourceFile(alloc)
+		, m_block(alloc)
+		, m_scratch(alloc)
+	{
+	}
+
+	void open(PackArchive* pack, U32 entryIdx)
+	{
+		m_pack = pack;
+		m_entryIdx = entryIdx;
+		m_size = pack->getEntry(entryIdx).m_size;
+		m_compressed = pack->getEntry(entryIdx).m_compression != PackArchiveFile::Compression::NONE;
+	}
+
+	ANKI_USE_RESULT Error read(void* buff, PtrSize size) override
+	{
+		ANKI_TRACE_SCOPED_EVENT(RSRC_FILE_READ);
+
+		if(size > m_size - m_pos)
+		{
+			ANKI_RESOURCE_LOGE("File read failed");
+			return Error::FILE_ACCESS;
+		}
+
+		if(!m_compressed)
+		{
+			ANKI_CHECK(m_pack->readUncompressed(m_entryIdx, m_pos, buff, size));
+			m_pos += size;
+			return Error::NONE;
+		}
+
+		const U32 blockSize = m_pack->getBlockSize();
+		U8* out = static_cast<U8*>(buff);
+		while(size > 0)
+		{
+			const U32 blockIdx = U32(m_pos / blockSize);
+			const PtrSize offsetInBlock = m_pos % blockSize;
+
+			if(blockIdx != m_blockIdx)
+			{
+				if(offsetInBlock == 0 && size >= blockSize)
+				{
+					// Whole block, decompress it in place
+					PtrSize readSize;
+					ANKI_CHECK(m_pack->readBlock(m_entryIdx, blockIdx, out, m_scratch, readSize));
+					out += readSize;
+					m_pos += readSize;
+					size -= readSize;
+					continue;
+				}
+
+				m_blockIdx = MAX_U32;
+				m_block.resize(blockSize);
+				ANKI_CHECK(m_pack->readBlock(m_entryIdx, blockIdx, &m_block[0], m_scratch, m_blockSize));
+				m_blockIdx = blockIdx;
+			}
+
+			const PtrSize copySize = min(size, m_blockSize - offsetInBlock);
+			memcpy(out, &m_block[offsetInBlock], copySize);
+			out += copySize;
+			m_pos += copySize;
+			size -= copySize;
+		}
+
+		return Error::NONE;
+	}
+
+	ANKI_USE_RESULT Error readAllText(GenericMemoryPoolAllocator<U8> alloc, String& out) override
+	{
+		ANKI_ASSERT(m_size);
+		out.create(alloc, '?', m_size);
+		return read(&out[0], m_size);
+	}
+
+	ANKI_USE_RESULT Error readU32(U32& u) override
+	{
+		// Assume machine and file have same endianness
+		return read(&u, sizeof(u));
+	}
+
+	ANKI_USE_RESULT Error readF32(F32& u) override
+	{
+		// Assume machine and file have same endianness
+		return read(&u, sizeof(u));
+	}
+
+	ANKI_USE_RESULT Error seek(PtrSize offset, SeekOrigin origin) override
+	{
+		// The blocks are independent so there is nothing to do. The offsets wrap to allow moving backwards
+		PtrSize newPos;
+		if(origin == SeekOrigin::BEGINNING)
+		{
+			newPos = offset;
+		}
+		else if(origin == SeekOrigin::CURRENT)
+		{
+			newPos = m_pos + offset;
+		}
+		else
+		{
+			newPos = m_size + offset;
+		}
+
+		if(newPos > m_size)
+		{
+			ANKI_RESOURCE_LOGE("Seeking out of the file");
+			return Error::FUNCTION_FAILED;
+		}
+
+		m_pos = newPos;
+		return Error::NONE;
+	}
+
+	PtrSize getSize() const override
+	{
+		return m_size;
+	}
+
+	Bool isMapped() const override
+	{
+		return !m_compressed && m_pack->isMapped();
+	}
+
+	ANKI_USE_RESULT Error map(PtrSize offset, PtrSize size, ConstWeakArray<U8>& data) const override
+	{
+		ANKI_ASSERT(isMapped());
+		return m_pack->mapUncompressed(m_entryIdx, offset, size, data);
+	}
+
+	void adviseAccess(PtrSize offset, PtrSize size, FileAccessHint hint) override
+	{
+		m_pack->adviseAccess(m_entryIdx, offset, size, hint);
+	}
+};
+
+/// The magic of the index cache file. The file has the magic, the number of records and the records. A record is
+/// the size of the record followed by Path::m_indexCacheRecord.
+static const char* INDEX_CACHE_MAGIC = "ANKIIDX1";
+
+/// Append some bytes to a record of the index cache.
+static void appendIndexCache(GenericMemoryPoolAllocator<U8> alloc, DynamicArray<U8>& record, const void* data, U32 size)
+{
+	const PtrSize offset = record.getSize();
+	record.resize(alloc, offset + size);
+	memcpy(&record[offset], data, size);
+}
+
+template<typename T>
+static void appendIndexCache(GenericMemoryPoolAllocator<U8> alloc, DynamicArray<U8>& record, const T& value)
+{
+	appendIndexCache(alloc, record, &value, sizeof(value));
+}
+
+/// Reads the index cache. It fails instead of reading past the end.
+class IndexCacheReader
+{
+public:
+	const U8* m_pos;
+	const U8* m_end;
+	Bool m_failed = false;
+
+	IndexCacheReader(const U8* begin, PtrSize size)
+		: m_pos(begin)
+		, m_end(begin + size)
+	{
+	}
+
+	const U8* read(PtrSize size)
+	{
+		if(m_failed || size > PtrSize(m_end - m_pos))
+		{
+			m_failed = true;
+			return nullptr;
+		}
+
+		const U8* out = m_pos;
+		m_pos += size;
+		return out;
+	}
+
+	template<typename T>
+	T read()
+	{
+		T value = {};
+		const U8* data = read(sizeof(T));
+		if(data)
+		{
+			memcpy(&value, data, sizeof(T));
+		}
+		return value;
+	}
+
+	/// Read a string. It's not null terminated.
+	const char* readString(U32& length)
+	{
+		length = read<U32>();
+		return reinterpret_cast<const char*>(read(length));
+	}
+};
+
 ResourceFilesystem::~ResourceFilesystem()
 {
 	for(Path& p : m_paths)
 	{
-		p.m_files.destroy(m_alloc);
 		p.m_path.destroy(m_alloc);
+		p.m_indexCacheRecord.destroy(m_alloc);
+		m_alloc.deleteInstance(p.m_pack);
 	}
 
 	m_paths.destroy(m_alloc);
 	m_cacheDir.destroy(m_alloc);
+	m_index.destroy(m_alloc);
+	m_indexCache.destroy(m_alloc);
+	m_indexCacheFilename.destroy(m_alloc);
 }
 
 Error ResourceFilesystem::init(const ConfigSet& config, const CString& cacheDir)
@@ -216,11 +455,19 @@ Error ResourceFilesystem::init(const ConfigSet& config, const CString& cacheDir)
 		return Error::USER_DATA;
 	}
 
+	if(config.getNumber("rsrc.indexCache"))
+	{
+		StringAuto filename(m_alloc);
+		filename.sprintf("%s/rsrc_index.ankicache", &cacheDir[0]);
+		loadIndexCache(filename.toCString());
+	}
+
 	for(auto& path : paths)
 	{
 		ANKI_CHECK(addNewPath(path.toCString()));
 	}
 
+	storeIndexCache();
 	addCachePath(cacheDir);
 
 	return Error::NONE;
@@ -235,58 +482,59 @@ void ResourceFilesystem::addCachePath(const CString& path)
 	m_paths.emplaceBack(m_alloc, std::move(p));
 }
 
+void ResourceFilesystem::addIndexEntry(const CString& filename, const IndexEntry& entry)
+{
+	const StringId id = StringTableSingleton::get().intern(filename);
+	*m_index.emplace(m_alloc, id, entry) = entry;
+}
+
 Error ResourceFilesystem::addNewPath(const CString& path)
 {
 	U fileCount = 0;
 	static const CString extension(".ankizip");
+	static const CString packExtension(".ankipack");
 
 	auto pos = path.find(extension);
-	if(pos != CString::NPOS && pos == path.getLength() - extension.getLength())
+	auto packPos = path.find(packExtension);
+	if(packPos != CString::NPOS && packPos == path.getLength() - packExtension.getLength())
 	{
-		// It's an archive
-
-		// Open
-		unzFile zfile = unzOpen(&path[0]);
-		if(!zfile)
+		// It's a pack archive. Keep it open, the reads go straight to it
+		PackArchive* pack = m_alloc.newInstance<PackArchive>(m_alloc);
+		const Error err = pack->open(path);
+		if(err)
 		{
-			ANKI_RESOURCE_LOGE("Failed to open archive");
-			return Error::FILE_ACCESS;
-		}
-
-		// List files
-		if(unzGoToFirstFile(zfile) != UNZ_OK)
-		{
-			unzClose(zfile);
-			ANKI_RESOURCE_LOGE("unzGoToFirstFile() failed. Empty archive?");
-			return Error::FILE_ACCESS;
+			m_alloc.deleteInstance(pack);
+			return err;
 		}
 
-		Path p;
+		m_paths.emplaceFront(m_alloc, Path());
+		Path& p = m_paths.getFront();
 		p.m_isArchive = true;
+		p.m_pack = pack;
 		p.m_path.sprintf(m_alloc, "%s", &path[0]);
 
-		do
+		m_index.reserve(m_alloc, m_index.getSize() + pack->getEntryCount());
+		for(U32 i = 0; i < pack->getEntryCount(); ++i)
 		{
-			Array<char, 1024> filename;
-
-			unz_file_info info;
-			if(unzGetCurrentFileInfo(zfile, &info, &filename[0], filename.getSize(), nullptr, 0, nullptr, 0) != UNZ_OK)
-			{
-				unzClose(zfile);
-				ANKI_RESOURCE_LOGE("unzGetCurrentFileInfo() failed");
-				return Error::FILE_ACCESS;
-			}
+			IndexEntry entry;
+			entry.m_path = &p;
+			entry.m_offset = i;
+			entry.m_size = pack->getEntry(i).m_size;
+			entry.m_compression = U32(pack->getEntry(i).m_compression);
+			addIndexEntry(pack->getEntryName(i), entry);
+		}
 
-			// If compressed size is zero then it's a dir
-			if(info.uncompressed_size > 0)
-			{
-				p.m_files.pushBackSprintf(m_alloc, "%s", &filename[0]);
-				++fileCount;
-			}
-		} while(unzGoToNextFile(zfile) == UNZ_OK);
+		fileCount = pack->getEntryCount();
+	}
+	else if(pos != CString::NPOS && pos == path.getLength() - extension.getLength())
+	{
+		// It's an archive
+		m_paths.emplaceFront(m_alloc, Path());
+		Path& p = m_paths.getFront();
+		p.m_isArchive = true;
+		p.m_path.sprintf(m_alloc, "%s", &path[0]);
 
-		m_paths.emplaceFront(m_alloc, std::move(p));
-		unzClose(zfile);
+		ANKI_CHECK(addZipArchive(p, fileCount));
 	}
 	else
 	{
@@ -312,14 +560,15 @@ Error ResourceFilesystem::addNewPath(const CString& path)
 			UserData* udd = static_cast<UserData*>(ud);
 			ResourceFilesystem* self = udd->m_sys;
 
-			Path& p = self->m_paths.getFront();
-			p.m_files.pushBackSprintf(self->m_alloc, "%s", &fname[0]);
+			IndexEntry entry;
+			entry.m_path = &self->m_paths.getFront();
+			self->addIndexEntry(fname, entry);
 
 			++(*udd->m_fileCount);
 			return Error::NONE;
 		}));
 
-		if(p.m_files.getSize() < 1)
+		if(fileCount < 1)
 		{
 			ANKI_RESOURCE_LOGE("Directory is empty: %s", &path[0]);
 			return Error::USER_DATA;
@@ -330,71 +579,319 @@ Error ResourceFilesystem::addNewPath(const CString& path)
 	return Error::NONE;
 }
 
-Error ResourceFilesystem::openFile(const ResourceFilename& filename, ResourceFilePtr& filePtr)
+Error ResourceFilesystem::addZipArchive(Path& p, U& fileCount)
 {
-	ResourceFile* rfile = nullptr;
-	Error err = Error::NONE;
+	const CString path = p.m_path.toCString();
 
-	// Search for the fname in reverse order
-	for(const Path& p : m_paths)
+	// Try the index cache first. The archive is the same if the size and the modification time didn't change
+	const Bool useIndexCache = !m_indexCacheFilename.isEmpty();
+	U64 fileSize = 0;
+	U64 modificationTime = 0;
+	if(useIndexCache)
 	{
-		// Check if it's cache
-		if(p.m_isCache)
+		File file;
+		ANKI_CHECK(file.open(path, FileOpenFlag::READ | FileOpenFlag::BINARY));
+		fileSize = file.getSize();
+		ANKI_CHECK(getFileModificationTime(path, modificationTime));
+
+		if(addZipArchiveFromIndexCache(p, fileSize, modificationTime, fileCount))
 		{
-			StringAuto newFname(m_alloc);
-			newFname.sprintf("%s/%s", &p.m_path[0], &filename[0]);
+			return Error::NONE;
+		}
+	}
 
-			if(fileExists(newFname.toCString()))
-			{
-				// In cache
+	// Open
+	unzFile zfile = unzOpen(&path[0]);
+	if(!zfile)
+	{
+		ANKI_RESOURCE_LOGE("Failed to open archive");
+		return Error::FILE_ACCESS;
+	}
 
-				CResourceFile* file = m_alloc.newInstance<CResourceFile>(m_alloc);
-				rfile = file;
+	// List files
+	if(unzGoToFirstFile(zfile) != UNZ_OK)
+	{
+		unzClose(zfile);
+		ANKI_RESOURCE_LOGE("unzGoToFirstFile() failed. Empty archive?");
+		return Error::FILE_ACCESS;
+	}
+
+	DynamicArray<U8>& record = p.m_indexCacheRecord;
+	if(useIndexCache)
+	{
+		appendIndexCache(m_alloc, record, U32(path.getLength()));
+		appendIndexCache(m_alloc, record, &path[0], U32(path.getLength()));
+		appendIndexCache(m_alloc, record, fileSize);
+		appendIndexCache(m_alloc, record, modificationTime);
+		appendIndexCache(m_alloc, record, U32(0)); // The file count, it's patched below
+	}
+	const PtrSize fileCountOffset = (useIndexCache) ? record.getSize() - sizeof(U32) : 0;
+
+	do
+	{
+		Array<char, 1024> filename;
 
-				err = file->m_file.open(&newFname[0], FileOpenFlag::READ);
+		unz_file_info info;
+		unz_file_pos pos;
+		if(unzGetCurrentFileInfo(zfile, &info, &filename[0], filename.getSize(), nullptr, 0, nullptr, 0) != UNZ_OK
+			|| unzGetFilePos(zfile, &pos) != UNZ_OK)
+		{
+			unzClose(zfile);
+			ANKI_RESOURCE_LOGE("unzGetCurrentFileInfo() failed");
+			return Error::FILE_ACCESS;
+		}
+
+		// If compressed size is zero then it's a dir
+		if(info.uncompressed_size > 0)
+		{
+			IndexEntry entry;
+			entry.m_path = &p;
+			entry.m_offset = pos.pos_in_zip_directory;
+			entry.m_number = U32(pos.num_of_file);
+			entry.m_size = info.uncompressed_size;
+			entry.m_compression = U32(info.compression_method);
+			const CString fname(&filename[0]);
+			addIndexEntry(fname, entry);
+			++fileCount;
+
+			if(useIndexCache)
+			{
+				appendIndexCache(m_alloc, record, entry.m_offset);
+				appendIndexCache(m_alloc, record, entry.m_size);
+				appendIndexCache(m_alloc, record, entry.m_number);
+				appendIndexCache(m_alloc, record, entry.m_compression);
+				appendIndexCache(m_alloc, record, U32(fname.getLength()));
+				appendIndexCache(m_alloc, record, &fname[0], U32(fname.getLength()));
 			}
 		}
-		else
+	} while(unzGoToNextFile(zfile) == UNZ_OK);
+
+	unzClose(zfile);
+
+	if(useIndexCache)
+	{
+		const U32 count = U32(fileCount);
+		memcpy(&record[fileCountOffset], &count, sizeof(count));
+		m_indexCacheDirty = true;
+	}
+
+	return Error::NONE;
+}
+
+Bool ResourceFilesystem::addZipArchiveFromIndexCache(Path& p, U64 fileSize, U64 modificationTime, U& fileCount)
+{
+	if(m_indexCache.getSize() == 0)
+	{
+		return false;
+	}
+
+	IndexCacheReader reader(&m_indexCache[0], m_indexCache.getSize());
+	reader.read(strlen(INDEX_CACHE_MAGIC));
+	const U32 recordCount = reader.read<U32>();
+	for(U32 r = 0; r < recordCount && !reader.m_failed; ++r)
+	{
+		const U32 recordSize = reader.read<U32>();
+		const U8* recordData = reader.read(recordSize);
+		if(!recordData)
 		{
-			// In data path or archive
+			break;
+		}
 
-			for(const String& pfname : p.m_files)
-			{
-				if(pfname != filename)
-				{
-					continue;
-				}
+		IndexCacheReader record(recordData, recordSize);
+		U32 pathLength;
+		const char* path = record.readString(pathLength);
+		if(record.m_failed || pathLength != p.m_path.getLength() || memcmp(path, &p.m_path[0], pathLength) != 0)
+		{
+			continue;
+		}
 
-				// Found
-				if(p.m_isArchive)
-				{
-					ZipResourceFile* file = m_alloc.newInstance<ZipResourceFile>(m_alloc);
-					rfile = file;
+		if(record.read<U64>() != fileSize || record.read<U64>() != modificationTime)
+		{
+			// It's out of date
+			return false;
+		}
 
-					err = file->open(p.m_path.toCString(), filename);
-				}
-				else
-				{
-					StringAuto newFname(m_alloc);
-					newFname.sprintf("%s/%s", &p.m_path[0], &filename[0]);
+		// Check the whole record before touching the index
+		const U32 entryCount = record.read<U32>();
+		const U8* firstEntry = record.m_pos;
+		for(U32 i = 0; i < entryCount && !record.m_failed; ++i)
+		{
+			record.read(sizeof(U64) * 2 + sizeof(U32) * 2);
+			U32 nameLength;
+			record.readString(nameLength);
+		}
 
-					CResourceFile* file = m_alloc.newInstance<CResourceFile>(m_alloc);
-					rfile = file;
+		if(record.m_failed || record.m_pos != record.m_end)
+		{
+			ANKI_RESOURCE_LOGW("The index cache is corrupt: %s", m_indexCacheFilename.cstr());
+			return false;
+		}
 
-					err = file->m_file.open(&newFname[0], FileOpenFlag::READ);
+		// Add the entries
+		IndexCacheReader entries(firstEntry, PtrSize(record.m_end - firstEntry));
+		m_index.reserve(m_alloc, m_index.getSize() + entryCount);
+		for(U32 i = 0; i < entryCount; ++i)
+		{
+			IndexEntry entry;
+			entry.m_path = &p;
+			entry.m_offset = entries.read<U64>();
+			entry.m_size = entries.read<U64>();
+			entry.m_number = entries.read<U32>();
+			entry.m_compression = entries.read<U32>();
+
+			U32 nameLength;
+			const char* name = entries.readString(nameLength);
+			StringAuto fname(m_alloc);
+			fname.create(name, name + nameLength);
+			addIndexEntry(fname.toCString(), entry);
+		}
 
-#if 0
-					printf("Opening asset %s\n", &newFname[0]);
-#endif
-				}
+		p.m_indexCacheRecord.create(m_alloc, recordSize);
+		memcpy(&p.m_indexCacheRecord[0], recordData, recordSize);
+		fileCount = entryCount;
+		return true;
+	}
+
+	return false;
+}
+
+void ResourceFilesystem::loadIndexCache(const CString& filename)
+{
+	ANKI_ASSERT(m_indexCacheFilename.isEmpty());
+	m_indexCacheFilename.create(m_alloc, filename);
+
+	if(!fileExists(filename))
+	{
+		return;
+	}
+
+	File file;
+	Array<char, 8> magic;
+	if(file.open(filename, FileOpenFlag::READ | FileOpenFlag::BINARY) || file.getSize() < magic.getSize()
+		|| file.read(&magic[0], magic.getSize()) || memcmp(&magic[0], INDEX_CACHE_MAGIC, magic.getSize()) != 0)
+	{
+		ANKI_RESOURCE_LOGW("Ignoring the index cache: %s", &filename[0]);
+		return;
+	}
+
+	m_indexCache.create(m_alloc, file.getSize());
+	if(file.seek(0, File::SeekOrigin::BEGINNING) || file.read(&m_indexCache[0], m_indexCache.getSize()))
+	{
+		ANKI_RESOURCE_LOGW("Ignoring the index cache: %s", &filename[0]);
+		m_indexCache.destroy(m_alloc);
+	}
+}
+
+void ResourceFilesystem::storeIndexCache()
+{
+	if(m_indexCacheDirty)
+	{
+		DynamicArray<U8> data;
+		appendIndexCache(m_alloc, data, INDEX_CACHE_MAGIC, U32(strlen(INDEX_CACHE_MAGIC)));
+		U32 recordCount = 0;
+		for(const Path& p : m_paths)
+		{
+			recordCount += p.m_indexCacheRecord.getSize() > 0;
+		}
+		appendIndexCache(m_alloc, data, recordCount);
+
+		for(const Path& p : m_paths)
+		{
+			if(p.m_indexCacheRecord.getSize() > 0)
+			{
+				appendIndexCache(m_alloc, data, U32(p.m_indexCacheRecord.getSize()));
+				appendIndexCache(m_alloc, data, &p.m_indexCacheRecord[0], U32(p.m_indexCacheRecord.getSize()));
 			}
-		} // end if cache
+		}
 
-		if(rfile)
+		File file;
+		if(file.open(m_indexCacheFilename.toCString(), FileOpenFlag::WRITE | FileOpenFlag::BINARY)
+			|| file.write(&data[0], data.getSize()))
 		{
-			break;
+			ANKI_RESOURCE_LOGW("Failed to write the index cache: %s", m_indexCacheFilename.cstr());
+		}
+
+		data.destroy(m_alloc);
+	}
+
+	for(Path& p : m_paths)
+	{
+		p.m_indexCacheRecord.destroy(m_alloc);
+	}
+
+	m_indexCache.destroy(m_alloc);
+	m_indexCacheFilename.destroy(m_alloc);
+	m_indexCacheDirty = false;
+}
+
+Error ResourceFilesystem::openFile(const ResourceFilename& filename, ResourceFilePtr& filePtr)
+{
+	ResourceFile* rfile = nullptr;
+	Error err = Error::NONE;
+
+	// Search the index
+	StringId id;
+	const IndexEntry* entry = nullptr;
+	if(StringTableSingleton::get().find(filename, id))
+	{
+		auto it = m_index.find(id);
+		if(it != m_index.getEnd())
+		{
+			entry = &(*it);
+		}
+	}
+
+	if(entry)
+	{
+		const Path& p = *entry->m_path;
+		if(p.m_pack)
+		{
+			PackResourceFile* file = m_alloc.newInstance<PackResourceFile>(m_alloc);
+			rfile = file;
+
+			file->open(p.m_pack, U32(entry->m_offset));
+		}
+		else if(p.m_isArchive)
+		{
+			ZipResourceFile* file = m_alloc.newInstance<ZipResourceFile>(m_alloc);
+			rfile = file;
+
+			err = file->open(p.m_path.toCString(), entry->m_offset, entry->m_number, entry->m_size);
+		}
+		else
+		{
+			StringAuto newFname(m_alloc);
+			newFname.sprintf("%s/%s", &p.m_path[0], &filename[0]);
+
+			CResourceFile* file = m_alloc.newInstance<CResourceFile>(m_alloc);
+			rfile = file;
+
+			err = file->m_file.open(&newFname[0], FileOpenFlag::READ | FileOpenFlag::MMAP);
 		}
-	} // end for all paths
+	}
+	else
+	{
+		// Not in the data paths, the files of the cache are created at runtime so check the disk
+		for(const Path& p : m_paths)
+		{
+			if(!p.m_isCache)
+			{
+				continue;
+			}
+
+			StringAuto newFname(m_alloc);
+			newFname.sprintf("%s/%s", &p.m_path[0], &filename[0]);
+
+			if(fileExists(newFname.toCString()))
+			{
+				CResourceFile* file = m_alloc.newInstance<CResourceFile>(m_alloc);
+				rfile = file;
+
+				err = file->m_file.open(&newFname[0], FileOpenFlag::READ | FileOpenFlag::MMAP);
+				break;
+			}
+		}
+	}
 
 	if(err)
 	{
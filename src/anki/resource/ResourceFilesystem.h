@@ -10,12 +10,15 @@
 #include <anki/util/StringList.h>
 #include <anki/util/File.h>
 #include <anki/util/Ptr.h>
+#include <anki/util/FlatHashMap.h>
+#include <anki/util/StringTable.h>
 
 namespace anki
 {
 
 // Forward
 class ConfigSet;
+class PackArchive;
 
 /// @addtogroup resource
 /// @{
@@ -55,6 +58,28 @@ public:
 	/// Get the size of the file.
 	virtual PtrSize getSize() const = 0;
 
+	/// Return true if the file is mapped to memory and map() can be used. Loose files are mapped, archived are not.
+	virtual Bool isMapped() const
+	{
+		return false;
+	}
+
+	/// Get a read-only view of a part of a mapped file without copying. It doesn't move the position indicator. The
+	/// view is valid as long as the file is alive.
+	/// @param offset The offset from the beginning of the file.
+	/// @param size The size of the view.
+	/// @param[out] data The view.
+	virtual ANKI_USE_RESULT Error map(PtrSize offset, PtrSize size, ConstWeakArray<U8>& data) const
+	{
+		ANKI_ASSERT(!"Not mapped");
+		return Error::FUNCTION_FAILED;
+	}
+
+	/// Hint about how a part of a mapped file will be accessed. It does nothing if the file is not mapped.
+	virtual void adviseAccess(PtrSize offset, PtrSize size, FileAccessHint hint)
+	{
+	}
+
 	Atomic<I32>& getRefcount()
 	{
 		return m_refcount;
@@ -73,7 +98,8 @@ private:
 /// Resource file smart pointer.
 using ResourceFilePtr = IntrusivePtr<ResourceFile>;
 
-/// Resource filesystem.
+/// Resource filesystem. The files of all the data paths are put in a single hash table when the paths are added so
+/// opening a file is a single lookup.
 class ResourceFilesystem : public NonCopyable
 {
 public:
@@ -86,7 +112,7 @@ public:
 
 	ANKI_USE_RESULT Error init(const ConfigSet& config, const CString& cacheDir);
 
-	/// Search the path list to find the file. Then open the file for reading. It's thread-safe.
+	/// Find the file in the index and open it for reading. It's thread-safe.
 	ANKI_USE_RESULT Error openFile(const ResourceFilename& filename, ResourceFilePtr& file);
 
 #if !ANKI_TESTS
@@ -95,39 +121,80 @@ private:
 	class Path : public NonCopyable
 	{
 	public:
-		StringList m_files; ///< Files inside the directory.
 		String m_path; ///< A directory or an archive.
+		PackArchive* m_pack = nullptr; ///< If it's a pack archive.
+		DynamicArray<U8> m_indexCacheRecord; ///< The entries of a zip archive as they are stored in the index cache.
 		Bool8 m_isArchive = false;
 		Bool8 m_isCache = false;
 
 		Path() = default;
 
 		Path(Path&& b)
-			: m_files(std::move(b.m_files))
-			, m_path(std::move(b.m_path))
+			: m_path(std::move(b.m_path))
+			, m_pack(b.m_pack)
+			, m_indexCacheRecord(std::move(b.m_indexCacheRecord))
 			, m_isArchive(std::move(b.m_isArchive))
 			, m_isCache(std::move(b.m_isCache))
 		{
+			b.m_pack = nullptr;
 		}
 
 		Path& operator=(Path&& b)
 		{
-			m_files = std::move(b.m_files);
 			m_path = std::move(b.m_path);
+			m_pack = b.m_pack;
+			b.m_pack = nullptr;
+			m_indexCacheRecord = std::move(b.m_indexCacheRecord);
 			m_isArchive = std::move(b.m_isArchive);
 			m_isCache = std::move(b.m_isCache);
 			return *this;
 		}
 	};
 
+	/// Where a file is.
+	class IndexEntry
+	{
+	public:
+		const Path* m_path = nullptr; ///< The directory or the archive.
+		U64 m_offset = 0; ///< Zip: the offset of the entry in the central directory. Pack: the entry index.
+		U64 m_size = 0; ///< The uncompressed size. Zero for the files of directories.
+		U32 m_number = 0; ///< Zip: the number of the entry in the archive.
+		U32 m_compression = 0; ///< Zip: the compression method. Pack: PackArchiveFile::Compression.
+	};
+
 	GenericMemoryPoolAllocator<U8> m_alloc;
 	List<Path> m_paths;
 	String m_cacheDir;
 
-	/// Add a filesystem path or an archive. The path is read-only.
+	/// All the files by their name interned in the StringTableSingleton.
+	FlatHashMap<StringId, IndexEntry> m_index;
+
+	/// The contents of the index cache file. It's used only while adding the paths.
+	DynamicArray<U8> m_indexCache;
+	String m_indexCacheFilename; ///< If it's empty the index cache is disabled.
+	Bool8 m_indexCacheDirty = false;
+
+	/// Add a filesystem path, a zip archive (.ankizip) or a pack archive (.ankipack). The path is read-only. The files
+	/// of the path replace the files of the paths that were added before.
 	ANKI_USE_RESULT Error addNewPath(const CString& path);
 
 	void addCachePath(const CString& path);
+
+	/// Add the files of a zip archive to the index. Enumerate the archive only if the index cache is out of date.
+	ANKI_USE_RESULT Error addZipArchive(Path& p, U& fileCount);
+
+	/// Add the files of a zip archive from the index cache.
+	/// @return True if the archive was in the cache and the cache was up to date.
+	Bool addZipArchiveFromIndexCache(Path& p, U64 fileSize, U64 modificationTime, U& fileCount);
+
+	/// Add a file to the index. It replaces a file with the same name.
+	void addIndexEntry(const CString& filename, const IndexEntry& entry);
+
+	/// Load the index cache file. If it's missing or corrupt the archives will be enumerated.
+	void loadIndexCache(const CString& filename);
+
+	/// Write the index cache file if it's out of date and stop using the cache.
+	void storeIndexCache();
 };
 /// @}
 
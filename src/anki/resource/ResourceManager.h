@@ -6,9 +6,9 @@
 #pragma once
 
 #include <anki/resource/TransferGpuAllocator.h>
-#include <anki/util/List.h>
+#include <anki/util/FlatHashMap.h>
 #include <anki/util/Functions.h>
-#include <anki/util/String.h>
+#include <anki/util/StringTable.h>
 
 namespace anki
 {
@@ -42,20 +42,27 @@ protected:
 
 	Type* findLoadedResource(const CString& filename)
 	{
-		auto it = find(filename);
+		// If the filename is not interned no resource has it
+		StringId id;
+		if(!StringTableSingleton::get().find(filename, id))
+		{
+			return nullptr;
+		}
+
+		auto it = m_ptrs.find(id);
 		return (it != m_ptrs.end()) ? *it : nullptr;
 	}
 
 	void registerResource(Type* ptr)
 	{
 		ANKI_ASSERT(ptr->getRefcount().load() == 0);
-		ANKI_ASSERT(find(ptr->getFilename()) == m_ptrs.getEnd());
-		m_ptrs.pushBack(m_alloc, ptr);
+		ANKI_ASSERT(m_ptrs.find(ptr->getFilenameId()) == m_ptrs.getEnd());
+		m_ptrs.emplace(m_alloc, ptr->getFilenameId(), ptr);
 	}
 
 	void unregisterResource(Type* ptr)
 	{
-		auto it = find(ptr->getFilename());
+		auto it = m_ptrs.find(ptr->getFilenameId());
 		ANKI_ASSERT(it != m_ptrs.end());
 		m_ptrs.erase(m_alloc, it);
 	}
@@ -66,25 +73,8 @@ protected:
 	}
 
 private:
-	using Container = List<Type*>;
-
 	ResourceAllocator<U8> m_alloc;
-	Container m_ptrs;
-
-	typename Container::Iterator find(const CString& filename)
-	{
-		typename Container::Iterator it;
-
-		for(it = m_ptrs.getBegin(); it != m_ptrs.getEnd(); ++it)
-		{
-			if((*it)->getFilename() == filename)
-			{
-				break;
-			}
-		}
-
-		return it;
-	}
+	FlatHashMap<StringId, Type*> m_ptrs; ///< The resources by their interned filename.
 };
 
 class ResourceManagerInitInfo
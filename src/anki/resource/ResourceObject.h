@@ -9,6 +9,7 @@
 #include <anki/resource/ResourceFilesystem.h>
 #include <anki/util/Atomic.h>
 #include <anki/util/String.h>
+#include <anki/util/StringTable.h>
 
 namespace anki
 {
@@ -51,14 +52,21 @@ public:
 	CString getFilename() const
 	{
 		ANKI_ASSERT(!m_fname.isEmpty());
-		return m_fname.toCString();
+		return StringTableSingleton::get().getString(m_fname);
 	}
 
 anki_internal:
+	/// The filename interned in the StringTableSingleton.
+	StringId getFilenameId() const
+	{
+		ANKI_ASSERT(!m_fname.isEmpty());
+		return m_fname;
+	}
+
 	void setFilename(const CString& fname)
 	{
 		ANKI_ASSERT(m_fname.isEmpty());
-		m_fname.create(getAllocator(), fname);
+		m_fname = StringTableSingleton::get().intern(fname);
 	}
 
 	void setUuid(U64 uuid)
@@ -83,7 +91,7 @@ anki_internal:
 private:
 	ResourceManager* m_manager;
 	Atomic<I32> m_refcount;
-	String m_fname; ///< Unique resource name.
+	StringId m_fname; ///< Unique resource name.
 	U64 m_uuid = 0;
 };
 /// @}
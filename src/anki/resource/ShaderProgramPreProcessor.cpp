@@ -253,12 +253,13 @@ Error ShaderProgramPreprocessor::parseFile(CString fname, U32 depth)
 Error ShaderProgramPreprocessor::parseLine(CString line, CString fname, Bool& foundPragmaOnce, U32 depth)
 {
 	// Tokenize
-	DynamicArrayAuto<StringAuto> tokens(m_alloc);
-	tokenizeLine(line, tokens);
+	LineTokenStorage tokenStorage(m_alloc);
+	LineTokens tokens(m_alloc);
+	tokenizeLine(line, tokenStorage, tokens);
 	ANKI_ASSERT(tokens.getSize() > 0);
 
-	const StringAuto* token = tokens.getBegin();
-	const StringAuto* end = tokens.getEnd();
+	const CString* token = tokens.getBegin();
+	const CString* end = tokens.getEnd();
 
 	// Skip the hash
 	Bool foundAloneHash = false;
@@ -345,10 +346,10 @@ Error ShaderProgramPreprocessor::parseLine(CString line, CString fname, Bool& fo
 }
 
 Error ShaderProgramPreprocessor::parseInclude(
-	const StringAuto* begin, const StringAuto* end, CString line, CString fname, U32 depth)
+	const CString* begin, const CString* end, CString line, CString fname, U32 depth)
 {
 	// Gather the path
-	StringAuto path(m_alloc);
+	StringInline<256> path(m_alloc);
 	for(; begin < end; ++begin)
 	{
 		path.append(*begin);
@@ -365,7 +366,7 @@ Error ShaderProgramPreprocessor::parseInclude(
 
 	if((firstChar == '\"' && lastChar == '\"') || (firstChar == '<' && lastChar == '>'))
 	{
-		StringAuto fname2(m_alloc);
+		StringInline<256> fname2(m_alloc);
 		fname2.create(path.begin() + 1, path.begin() + path.getLength() - 1);
 
 		if(parseFile(fname2.toCString(), depth + 1))
@@ -382,7 +383,7 @@ Error ShaderProgramPreprocessor::parseInclude(
 }
 
 Error ShaderProgramPreprocessor::parsePragmaMutator(
-	const StringAuto* begin, const StringAuto* end, CString line, CString fname)
+	const CString* begin, const CString* end, CString line, CString fname)
 {
 	ANKI_ASSERT(begin && end);
 
@@ -432,7 +433,7 @@ Error ShaderProgramPreprocessor::parsePragmaMutator(
 			}
 		}
 
-		mutator.m_name.create(begin->toCString());
+		mutator.m_name.create(*begin);
 		++begin;
 	}
 
@@ -443,7 +444,7 @@ Error ShaderProgramPreprocessor::parsePragmaMutator(
 		{
 			Mutator::ValueType value = 0;
 
-			if(tokenIsComment(begin->toCString()))
+			if(tokenIsComment(*begin))
 			{
 				break;
 			}
@@ -479,8 +480,7 @@ Error ShaderProgramPreprocessor::parsePragmaMutator(
 	return Error::NONE;
 }
 
-Error ShaderProgramPreprocessor::parsePragmaInput(
-	const StringAuto* begin, const StringAuto* end, CString line, CString fname)
+Error ShaderProgramPreprocessor::parsePragmaInput(const CString* begin, const CString* end, CString line, CString fname)
 {
 	ANKI_ASSERT(begin && end);
 
@@ -519,14 +519,14 @@ Error ShaderProgramPreprocessor::parsePragmaInput(
 	}
 
 	// type
-	const StringAuto& dataTypeStr = *begin;
+	const CString dataTypeStr = (begin < end) ? *begin : CString();
 	{
 		if(begin >= end)
 		{
 			ANKI_PP_ERROR_MALFORMED();
 		}
 
-		if(computeShaderVariableDataType(begin->toCString(), input.m_dataType))
+		if(computeShaderVariableDataType(*begin, input.m_dataType))
 		{
 			ANKI_PP_ERROR_MALFORMED();
 		}
@@ -549,17 +549,17 @@ Error ShaderProgramPreprocessor::parsePragmaInput(
 			}
 		}
 
-		input.m_name.create(begin->toCString());
+		input.m_name.create(*begin);
 		++begin;
 	}
 
 	// Preprocessor expression
-	StringAuto preproc(m_alloc);
+	StringInline<256> preproc(m_alloc);
 	{
 		// Create the string
 		for(; begin < end; ++begin)
 		{
-			preproc.append(begin->toCString());
+			preproc.append(*begin);
 		}
 
 		if(!preproc.isEmpty())
@@ -703,8 +703,7 @@ Error ShaderProgramPreprocessor::parsePragmaInput(
 	return Error::NONE;
 }
 
-Error ShaderProgramPreprocessor::parsePragmaStart(
-	const StringAuto* begin, const StringAuto* end, CString line, CString fname)
+Error ShaderProgramPreprocessor::parsePragmaStart(const CString* begin, const CString* end, CString line, CString fname)
 {
 	ANKI_ASSERT(begin && end);
 
@@ -774,8 +773,7 @@ Error ShaderProgramPreprocessor::parsePragmaStart(
 	return Error::NONE;
 }
 
-Error ShaderProgramPreprocessor::parsePragmaEnd(
-	const StringAuto* begin, const StringAuto* end, CString line, CString fname)
+Error ShaderProgramPreprocessor::parsePragmaEnd(const CString* begin, const CString* end, CString line, CString fname)
 {
 	ANKI_ASSERT(begin && end);
 
@@ -799,7 +797,7 @@ Error ShaderProgramPreprocessor::parsePragmaEnd(
 }
 
 Error ShaderProgramPreprocessor::parsePragmaDescriptorSet(
-	const StringAuto* begin, const StringAuto* end, CString line, CString fname)
+	const CString* begin, const CString* end, CString line, CString fname)
 {
 	ANKI_ASSERT(begin && end);
 
@@ -821,30 +819,26 @@ Error ShaderProgramPreprocessor::parsePragmaDescriptorSet(
 	return Error::NONE;
 }
 
-void ShaderProgramPreprocessor::tokenizeLine(CString line, DynamicArrayAuto<StringAuto>& tokens)
+void ShaderProgramPreprocessor::tokenizeLine(CString line, LineTokenStorage& storage, LineTokens& tokens)
 {
 	ANKI_ASSERT(line.getLength() > 0);
 
-	StringAuto l(m_alloc);
-	l.create(line);
+	storage.create(line);
 
-	// Replace all tabs with spaces
-	for(char& c : l)
+	// Split on spaces and tabs in place. The tokens point to the storage
+	Bool inToken = false;
+	for(char& c : storage)
 	{
-		if(c == '\t')
+		if(c == ' ' || c == '\t')
 		{
-			c = ' ';
+			c = '\0';
+			inToken = false;
+		}
+		else if(!inToken)
+		{
+			tokens.emplaceBack(&c);
+			inToken = true;
 		}
-	}
-
-	// Split
-	StringListAuto spaceTokens(m_alloc);
-	spaceTokens.splitString(l.toCString(), ' ', false);
-
-	// Create the array
-	for(const String& s : spaceTokens)
-	{
-		tokens.emplaceBack(m_alloc, s.toCString());
 	}
 }
 
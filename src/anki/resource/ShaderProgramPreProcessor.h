@@ -164,6 +164,10 @@ private:
 
 	static const U32 MAX_INCLUDE_DEPTH = 8;
 
+	/// The tokens of a line point to a copy of the line. Most lines fit so tokenizing doesn't allocate.
+	using LineTokenStorage = StringInline<256>;
+	using LineTokens = DynamicArrayInline<CString, 16>;
+
 	GenericMemoryPoolAllocator<U8> m_alloc;
 	StringAuto m_fname;
 	ResourceFilesystem* m_fsystem = nullptr;
@@ -185,16 +189,15 @@ private:
 	ANKI_USE_RESULT Error parseFile(CString fname, U32 depth);
 	ANKI_USE_RESULT Error parseLine(CString line, CString fname, Bool& foundPragmaOnce, U32 depth);
 	ANKI_USE_RESULT Error parseInclude(
-		const StringAuto* begin, const StringAuto* end, CString line, CString fname, U32 depth);
-	ANKI_USE_RESULT Error parsePragmaMutator(
-		const StringAuto* begin, const StringAuto* end, CString line, CString fname);
-	ANKI_USE_RESULT Error parsePragmaInput(const StringAuto* begin, const StringAuto* end, CString line, CString fname);
-	ANKI_USE_RESULT Error parsePragmaStart(const StringAuto* begin, const StringAuto* end, CString line, CString fname);
-	ANKI_USE_RESULT Error parsePragmaEnd(const StringAuto* begin, const StringAuto* end, CString line, CString fname);
+		const CString* begin, const CString* end, CString line, CString fname, U32 depth);
+	ANKI_USE_RESULT Error parsePragmaMutator(const CString* begin, const CString* end, CString line, CString fname);
+	ANKI_USE_RESULT Error parsePragmaInput(const CString* begin, const CString* end, CString line, CString fname);
+	ANKI_USE_RESULT Error parsePragmaStart(const CString* begin, const CString* end, CString line, CString fname);
+	ANKI_USE_RESULT Error parsePragmaEnd(const CString* begin, const CString* end, CString line, CString fname);
 	ANKI_USE_RESULT Error parsePragmaDescriptorSet(
-		const StringAuto* begin, const StringAuto* end, CString line, CString fname);
+		const CString* begin, const CString* end, CString line, CString fname);
 
-	void tokenizeLine(CString line, DynamicArrayAuto<StringAuto>& tokens);
+	void tokenizeLine(CString line, LineTokenStorage& storage, LineTokens& tokens);
 
 	static Bool tokenIsComment(CString token)
 	{
@@ -143,16 +143,11 @@ ShaderProgramResource::~ShaderProgramResource()
 {
 	auto alloc = getAllocator();
 
-	while(!m_variants.isEmpty())
-	{
-		auto it = m_variants.getBegin();
-		ShaderProgramResourceVariant* variant = *it;
-		m_variants.erase(getAllocator(), it);
-
-		variant->m_blockInfos.destroy(alloc);
-		variant->m_texUnits.destroy(alloc);
-		alloc.deleteInstance(variant);
-	}
+	m_variants.iterate([&](U64 hash, ShaderProgramResourceVariant& variant) {
+		variant.m_blockInfos.destroy(alloc);
+		variant.m_texUnits.destroy(alloc);
+	});
+	m_variants.destroy(alloc);
 
 	for(Input& var : m_inputVars)
 	{
@@ -288,22 +283,10 @@ void ShaderProgramResource::getOrCreateVariant(ConstWeakArray<ShaderProgramResou
 	// Compute hash
 	U64 hash = computeVariantHash(mutation, constants);
 
-	LockGuard<Mutex> lock(m_mtx);
-
-	auto it = m_variants.find(hash);
-	if(it != m_variants.getEnd())
-	{
-		variant = *it;
-	}
-	else
-	{
-		// Create one
-		ShaderProgramResourceVariant* v = getAllocator().newInstance<ShaderProgramResourceVariant>();
-		initVariant(mutation, constants, *v);
-
-		m_variants.emplace(getAllocator(), hash, v);
-		variant = v;
-	}
+	// The lookup doesn't lock, only the creation of a new variant does
+	variant = &m_variants.getOrCreate(getAllocator(), hash, [&](ShaderProgramResourceVariant& v) {
+		initVariant(mutation, constants, v);
+	});
 }
 
 void ShaderProgramResource::initVariant(ConstWeakArray<ShaderProgramResourceMutation> mutations,
@@ -9,6 +9,7 @@
 #include <anki/resource/ShaderProgramPreProcessor.h>
 #include <anki/Gr.h>
 #include <anki/util/BitSet.h>
+#include <anki/util/ConcurrentHashMap.h>
 
 // Forward
 struct te_variable;
@@ -347,8 +348,7 @@ private:
 
 	String m_source;
 
-	mutable HashMap<U64, ShaderProgramResourceVariant*> m_variants;
-	mutable Mutex m_mtx;
+	mutable ConcurrentHashMap<U64, ShaderProgramResourceVariant> m_variants;
 
 	U8 m_descriptorSet = 0;
 	ShaderTypeBit m_shaderStages = ShaderTypeBit::NONE;
@@ -246,9 +246,9 @@ Error TextureResource::load(LoadingContext& ctx)
 
 			if(ctx.m_texType == TextureType::_3D)
 			{
-				const auto& vol = ctx.m_loader.getVolume(mip);
-				surfOrVolSize = vol.m_data.getSize();
-				surfOrVolData = &vol.m_data[0];
+				const ConstWeakArray<U8> volData = ctx.m_loader.getVolume(mip).getData();
+				surfOrVolSize = volData.getSize();
+				surfOrVolData = &volData[0];
 
 				allocationSize = computeVolumeSize(ctx.m_tex->getWidth() >> mip,
 					ctx.m_tex->getHeight() >> mip,
@@ -257,9 +257,9 @@ Error TextureResource::load(LoadingContext& ctx)
 			}
 			else
 			{
-				const auto& surf = ctx.m_loader.getSurface(mip, face, layer);
-				surfOrVolSize = surf.m_data.getSize();
-				surfOrVolData = &surf.m_data[0];
+				const ConstWeakArray<U8> surfData = ctx.m_loader.getSurface(mip, face, layer).getData();
+				surfOrVolSize = surfData.getSize();
+				surfOrVolData = &surfData[0];
 
 				allocationSize = computeSurfaceSize(
 					ctx.m_tex->getWidth() >> mip, ctx.m_tex->getHeight() >> mip, ctx.m_tex->getFormat());
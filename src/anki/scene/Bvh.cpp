@@ -0,0 +1,439 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/scene/Bvh.h>
+#include <algorithm>
+
+namespace anki
+{
+
+/// Spread the 10 low bits so there are 2 zero bits between them.
+static U32 expandBits(U32 v)
+{
+	v = (v * 0x00010001u) & 0xFF0000FFu;
+	v = (v * 0x00000101u) & 0x0F00F00Fu;
+	v = (v * 0x00000011u) & 0xC30C30C3u;
+	v = (v * 0x00000005u) & 0x49249249u;
+	return v;
+}
+
+/// The Morton code of a point with coordinates in [0, 1].
+static U32 computeMortonCode(const Vec3& p)
+{
+	const Vec3 q = (p * 1024.0f).max(Vec3(0.0f)).min(Vec3(1023.0f));
+	return (expandBits(U32(q.x())) << 2u) | (expandBits(U32(q.y())) << 1u) | expandBits(U32(q.z()));
+}
+
+static F32 computeArea(const Vec3& min, const Vec3& max)
+{
+	const Vec3 e = max - min;
+	return 2.0f * (e.x() * e.y() + e.y() * e.z() + e.z() * e.x());
+}
+
+Bvh::~Bvh()
+{
+	ANKI_ASSERT(m_placeableCount == 0);
+
+	m_nodes.destroy(m_alloc);
+	m_dirtyNodes.destroy(m_alloc);
+	m_leafObjects.destroy(m_alloc);
+	m_objectBoxes.destroy(m_alloc);
+	m_objectPlaceables.destroy(m_alloc);
+	m_objectLeafPositions.destroy(m_alloc);
+	m_objectNodes.destroy(m_alloc);
+	m_freeObjects.destroy(m_alloc);
+	m_pendingObjects.destroy(m_alloc);
+}
+
+void Bvh::place(const Aabb& volume, BvhPlaceable* placeable)
+{
+	ANKI_ASSERT(placeable);
+	LockGuard<Mutex> lock(m_mtx);
+
+	U32 objectIdx = placeable->m_objectIdx;
+	if(objectIdx != MAX_U32)
+	{
+		// Already placed, update the box and refit later
+		m_objectBoxes[objectIdx] = volume;
+
+		if(!(m_objectLeafPositions[objectIdx] & PENDING_BIT))
+		{
+			const U32 nodeIdx = m_objectNodes[objectIdx];
+			m_dirtyNodes[nodeIdx] = 1;
+			m_maxDirtyNode = max(m_maxDirtyNode, nodeIdx);
+			m_hasDirtyNodes = true;
+		}
+
+		return;
+	}
+
+	// New placeable
+	if(m_freeObjects.getSize() > 0)
+	{
+		objectIdx = m_freeObjects.getBack();
+		m_freeObjects.resize(m_alloc, m_freeObjects.getSize() - 1);
+	}
+	else
+	{
+		objectIdx = m_objectBoxes.getSize();
+		m_objectBoxes.emplaceBack(m_alloc);
+		m_objectPlaceables.emplaceBack(m_alloc);
+		m_objectLeafPositions.emplaceBack(m_alloc);
+		m_objectNodes.emplaceBack(m_alloc);
+	}
+
+	m_objectBoxes[objectIdx] = volume;
+	m_objectPlaceables[objectIdx] = placeable;
+	m_objectLeafPositions[objectIdx] = PENDING_BIT | m_pendingObjects.getSize();
+	m_objectNodes[objectIdx] = MAX_U32;
+	m_pendingObjects.emplaceBack(m_alloc, objectIdx);
+
+	placeable->m_objectIdx = objectIdx;
+	++m_placeableCount;
+}
+
+void Bvh::remove(BvhPlaceable& placeable)
+{
+	LockGuard<Mutex> lock(m_mtx);
+	removeInternal(placeable);
+}
+
+void Bvh::removeInternal(BvhPlaceable& placeable)
+{
+	const U32 objectIdx = placeable.m_objectIdx;
+	if(objectIdx == MAX_U32)
+	{
+		return;
+	}
+
+	const U32 leafPos = m_objectLeafPositions[objectIdx];
+	if(leafPos & PENDING_BIT)
+	{
+		// Swap-remove it from the pending
+		const U32 pendingIdx = leafPos & ~PENDING_BIT;
+		const U32 lastObjectIdx = m_pendingObjects.getBack();
+		m_pendingObjects[pendingIdx] = lastObjectIdx;
+		m_objectLeafPositions[lastObjectIdx] = PENDING_BIT | pendingIdx;
+		m_pendingObjects.resize(m_alloc, m_pendingObjects.getSize() - 1);
+	}
+	else
+	{
+		// Leave a hole in the leaf. The refit will shrink the leaf's box
+		m_leafObjects[leafPos] = MAX_U32;
+		const U32 nodeIdx = m_objectNodes[objectIdx];
+		m_dirtyNodes[nodeIdx] = 1;
+		m_maxDirtyNode = max(m_maxDirtyNode, nodeIdx);
+		m_hasDirtyNodes = true;
+		++m_removedCount;
+	}
+
+	m_objectPlaceables[objectIdx] = nullptr;
+	m_freeObjects.emplaceBack(m_alloc, objectIdx);
+	placeable.m_objectIdx = MAX_U32;
+
+	ANKI_ASSERT(m_placeableCount > 0);
+	--m_placeableCount;
+}
+
+void Bvh::update()
+{
+	// Rebuild after many changes or to drop the nodes when everything is removed
+	const U32 changeCount = m_pendingObjects.getSize() + m_removedCount;
+	const Bool emptied = m_placeableCount == 0 && m_nodes.getSize() > 0;
+	if(emptied || changeCount > max(U32(MIN_REBUILD_CHANGE_COUNT), m_placeableCount / REBUILD_CHANGE_FRACTION))
+	{
+		build();
+		return;
+	}
+
+	if(m_hasDirtyNodes)
+	{
+		refit();
+
+		// The moving placeables may have stretched the boxes a lot
+		if(computeArea() > max(m_buildArea, EPSILON) * REBUILD_AREA_FACTOR)
+		{
+			build();
+		}
+	}
+}
+
+void Bvh::build()
+{
+	ANKI_TRACE_SCOPED_EVENT(SCENE_BVH_BUILD);
+
+	m_nodes.destroy(m_alloc);
+	m_dirtyNodes.destroy(m_alloc);
+	m_leafObjects.destroy(m_alloc);
+	m_pendingObjects.destroy(m_alloc);
+	m_removedCount = 0;
+	m_hasDirtyNodes = false;
+	m_maxDirtyNode = 0;
+	m_buildArea = 0.0f;
+
+	if(m_placeableCount == 0)
+	{
+		return;
+	}
+
+	// Sort the placeables by the Morton code of their center
+	Vec3 centerMin(MAX_F32);
+	Vec3 centerMax(MIN_F32);
+	for(U32 objectIdx = 0; objectIdx < m_objectBoxes.getSize(); ++objectIdx)
+	{
+		if(m_objectPlaceables[objectIdx])
+		{
+			const Aabb& box = m_objectBoxes[objectIdx];
+			const Vec3 center = ((box.getMin() + box.getMax()) * 0.5f).xyz();
+			centerMin = centerMin.min(center);
+			centerMax = centerMax.max(center);
+		}
+	}
+
+	const Vec3 scale = Vec3(1.0f) / (centerMax - centerMin).max(Vec3(EPSILON));
+
+	class SortEntry
+	{
+	public:
+		U32 m_code;
+		U32 m_objectIdx;
+	};
+
+	DynamicArrayAuto<SortEntry> entries(m_alloc);
+	entries.create(m_placeableCount);
+	U32 count = 0;
+	for(U32 objectIdx = 0; objectIdx < m_objectBoxes.getSize(); ++objectIdx)
+	{
+		if(m_objectPlaceables[objectIdx])
+		{
+			const Aabb& box = m_objectBoxes[objectIdx];
+			const Vec3 center = ((box.getMin() + box.getMax()) * 0.5f).xyz();
+			entries[count].m_code = computeMortonCode((center - centerMin) * scale);
+			entries[count].m_objectIdx = objectIdx;
+			++count;
+		}
+	}
+	ANKI_ASSERT(count == m_placeableCount);
+
+	std::sort(entries.getBegin(), entries.getEnd(), [](const SortEntry& a, const SortEntry& b) {
+		return a.m_code < b.m_code;
+	});
+
+	m_leafObjects.create(m_alloc, count);
+	for(U32 i = 0; i < count; ++i)
+	{
+		m_leafObjects[i] = entries[i].m_objectIdx;
+		m_objectLeafPositions[entries[i].m_objectIdx] = i;
+	}
+
+	// Split the sorted placeables in 4 ranges recursively. The nodes array is also the queue of the breadth-first
+	// build. The range of every node is kept while the node waits in the queue
+	class Range
+	{
+	public:
+		U32 m_begin;
+		U32 m_end;
+	};
+
+	DynamicArrayAuto<Range> ranges(m_alloc);
+	m_nodes.emplaceBack(m_alloc);
+	m_nodes[0].m_parent = MAX_U32;
+	m_nodes[0].m_parentChild = 0;
+	ranges.emplaceBack(Range{0, count});
+
+	for(U32 nodeIdx = 0; nodeIdx < m_nodes.getSize(); ++nodeIdx)
+	{
+		const Range range = ranges[nodeIdx];
+		const U32 rangeSize = range.m_end - range.m_begin;
+
+		// Make leafs as full as possible when the range fits in 4 leafs
+		const U32 childCount = (rangeSize <= MAX_LEAF_PLACEABLES * 4)
+								   ? (rangeSize + MAX_LEAF_PLACEABLES - 1) / MAX_LEAF_PLACEABLES
+								   : 4;
+		ANKI_ASSERT(childCount > 0 && childCount <= 4);
+
+		m_nodes[nodeIdx].m_childCount = U8(childCount);
+		for(U32 child = 0; child < 4; ++child)
+		{
+			m_nodes[nodeIdx].m_children[child] = MAX_U32;
+			m_nodes[nodeIdx].m_leafObjectCounts[child] = 0;
+		}
+
+		for(U32 child = 0; child < childCount; ++child)
+		{
+			const U32 begin = range.m_begin + rangeSize * child / childCount;
+			const U32 end = range.m_begin + rangeSize * (child + 1) / childCount;
+
+			if(end - begin <= MAX_LEAF_PLACEABLES)
+			{
+				m_nodes[nodeIdx].m_children[child] = begin;
+				m_nodes[nodeIdx].m_leafObjectCounts[child] = U8(end - begin);
+				for(U32 i = begin; i < end; ++i)
+				{
+					m_objectNodes[m_leafObjects[i]] = nodeIdx;
+				}
+			}
+			else
+			{
+				const U32 childNodeIdx = m_nodes.getSize();
+				m_nodes[nodeIdx].m_children[child] = childNodeIdx;
+
+				// The emplaceBack may move the nodes so don't keep references to them
+				m_nodes.emplaceBack(m_alloc);
+				m_nodes[childNodeIdx].m_parent = nodeIdx;
+				m_nodes[childNodeIdx].m_parentChild = U8(child);
+				ranges.emplaceBack(Range{begin, end});
+			}
+		}
+	}
+
+	// Compute the boxes. The children are after their parents so go backwards
+	m_dirtyNodes.create(m_alloc, m_nodes.getSize(), 0);
+	for(U32 nodeIdx = m_nodes.getSize(); nodeIdx-- > 0;)
+	{
+		refitNode(nodeIdx);
+	}
+
+	m_buildArea = computeArea();
+}
+
+void Bvh::refitNode(U32 nodeIdx)
+{
+	Node& node = m_nodes[nodeIdx];
+
+	for(U32 child = 0; child < 4; ++child)
+	{
+		Vec3 min(MAX_F32);
+		Vec3 max(MIN_F32);
+
+		if(child >= node.m_childCount)
+		{
+			// Unused. An inverted box is always outside
+		}
+		else if(node.m_leafObjectCounts[child] > 0)
+		{
+			const U32 begin = node.m_children[child];
+			for(U32 i = begin; i < begin + node.m_leafObjectCounts[child]; ++i)
+			{
+				const U32 objectIdx = m_leafObjects[i];
+				if(objectIdx != MAX_U32)
+				{
+					min = min.min(m_objectBoxes[objectIdx].getMin().xyz());
+					max = max.max(m_objectBoxes[objectIdx].getMax().xyz());
+				}
+			}
+		}
+		else
+		{
+			const Node& childNode = m_nodes[node.m_children[child]];
+			for(U32 i = 0; i < childNode.m_childCount; ++i)
+			{
+				min = min.min(Vec3(childNode.m_minX[i], childNode.m_minY[i], childNode.m_minZ[i]));
+				max = max.max(Vec3(childNode.m_maxX[i], childNode.m_maxY[i], childNode.m_maxZ[i]));
+			}
+		}
+
+		node.m_minX[child] = min.x();
+		node.m_minY[child] = min.y();
+		node.m_minZ[child] = min.z();
+		node.m_maxX[child] = max.x();
+		node.m_maxY[child] = max.y();
+		node.m_maxZ[child] = max.z();
+	}
+}
+
+void Bvh::refit()
+{
+	ANKI_ASSERT(m_hasDirtyNodes);
+
+	// The parents are before their children so walk backwards and mark the parents on the way
+	for(U32 nodeIdx = m_maxDirtyNode + 1; nodeIdx-- > 0;)
+	{
+		if(m_dirtyNodes[nodeIdx])
+		{
+			m_dirtyNodes[nodeIdx] = 0;
+			refitNode(nodeIdx);
+
+			const U32 parent = m_nodes[nodeIdx].m_parent;
+			if(parent != MAX_U32)
+			{
+				ANKI_ASSERT(parent < nodeIdx);
+				m_dirtyNodes[parent] = 1;
+			}
+		}
+	}
+
+	m_hasDirtyNodes = false;
+	m_maxDirtyNode = 0;
+}
+
+F32 Bvh::computeArea() const
+{
+	F32 area = 0.0f;
+	if(m_nodes.getSize() > 0)
+	{
+		const Node& root = m_nodes[0];
+		for(U32 child = 0; child < root.m_childCount; ++child)
+		{
+			// Skip the empty children. They have inverted boxes
+			if(root.m_minX[child] <= root.m_maxX[child])
+			{
+				area += anki::computeArea(Vec3(root.m_minX[child], root.m_minY[child], root.m_minZ[child]),
+					Vec3(root.m_maxX[child], root.m_maxY[child], root.m_maxZ[child]));
+			}
+		}
+	}
+
+	return area;
+}
+
+U32 Bvh::testNodeChildren(const Node& node, const Frustum& frustum)
+{
+	U32 mask;
+
+#if ANKI_SIMD == ANKI_SIMD_SSE
+	const __m128 minX = _mm_load_ps(&node.m_minX[0]);
+	const __m128 minY = _mm_load_ps(&node.m_minY[0]);
+	const __m128 minZ = _mm_load_ps(&node.m_minZ[0]);
+	const __m128 maxX = _mm_load_ps(&node.m_maxX[0]);
+	const __m128 maxY = _mm_load_ps(&node.m_maxY[0]);
+	const __m128 maxZ = _mm_load_ps(&node.m_maxZ[0]);
+
+	__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+	for(const Plane& plane : frustum.getPlanesWorldSpace())
+	{
+		// Test the corner that is the most in the direction of the normal. If it's behind the plane the box is outside
+		const Vec4& n = plane.getNormal();
+		const __m128 x = _mm_mul_ps((n.x() >= 0.0f) ? maxX : minX, _mm_set1_ps(n.x()));
+		const __m128 y = _mm_mul_ps((n.y() >= 0.0f) ? maxY : minY, _mm_set1_ps(n.y()));
+		const __m128 z = _mm_mul_ps((n.z() >= 0.0f) ? maxZ : minZ, _mm_set1_ps(n.z()));
+		const __m128 dist = _mm_add_ps(_mm_add_ps(x, y), z);
+
+		inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, _mm_set1_ps(plane.getOffset())));
+	}
+
+	mask = U32(_mm_movemask_ps(inside));
+#else
+	mask = 0;
+	for(U32 child = 0; child < 4; ++child)
+	{
+		Bool inside = true;
+		for(const Plane& plane : frustum.getPlanesWorldSpace())
+		{
+			const Vec4& n = plane.getNormal();
+			const F32 dist = n.x() * ((n.x() >= 0.0f) ? node.m_maxX[child] : node.m_minX[child])
+							 + n.y() * ((n.y() >= 0.0f) ? node.m_maxY[child] : node.m_minY[child])
+							 + n.z() * ((n.z() >= 0.0f) ? node.m_maxZ[child] : node.m_minZ[child]);
+			inside = inside && dist >= plane.getOffset();
+		}
+
+		mask |= U32(inside) << child;
+	}
+#endif
+
+	return mask & ((1u << node.m_childCount) - 1u);
+}
+
+} // end namespace anki
@@ -0,0 +1,241 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/scene/Common.h>
+#include <anki/Math.h>
+#include <anki/collision/Aabb.h>
+#include <anki/collision/Frustum.h>
+#include <anki/util/DynamicArray.h>
+#include <anki/util/Thread.h>
+#include <anki/core/Trace.h>
+
+namespace anki
+{
+
+// Forward
+class BvhPlaceable;
+
+/// @addtogroup scene
+/// @{
+
+/// A bounding volume hierarchy for visibility tests. It's an alternative to the Octree. Every node has up to 4 children
+/// and it keeps their boxes in SoA form so a frustum plane is tested against the 4 boxes at once. The nodes are in a
+/// flat array in breadth-first order. Every placeable is stored once in a leaf.
+///
+/// The tree is built from the placeables sorted by the Morton code of their center. When a placeable moves only the
+/// boxes of its leaf and the leaf's ancestors are recomputed (refit). New placeables are kept in a list that is tested
+/// one by one until the next rebuild. The tree is rebuilt when there are many new or removed placeables or when the
+/// refits have made the boxes too large.
+class Bvh : public NonCopyable
+{
+public:
+	Bvh(SceneAllocator<U8> alloc)
+		: m_alloc(alloc)
+	{
+	}
+
+	~Bvh();
+
+	/// Place or re-place an element in the tree. The changes are applied in update().
+	/// @note It's thread-safe against place and remove methods.
+	void place(const Aabb& volume, BvhPlaceable* placeable);
+
+	/// Remove an element from the tree.
+	/// @note It's thread-safe against place and remove methods.
+	void remove(BvhPlaceable& placeable);
+
+	/// Refit or rebuild the tree after the place and remove calls. Call it before the visibility tests.
+	void update();
+
+	/// Walk the tree.
+	/// @tparam TTestAabbFunc The lambda that will perform an additional test to the boxes that are inside the frustum.
+	///                       Signature of lambda: Bool(*)(const Aabb& box)
+	/// @tparam TNewPlaceableFunc The lambda to do something with a visible placeable.
+	///                           Signature: void(*)(void* placeableUserData).
+	/// @param frustum The frustum to test against.
+	/// @param testFunc See TTestAabbFunc.
+	/// @param newPlaceableFunc See TNewPlaceableFunc.
+	/// @note It's thread-safe against other walkTree calls.
+	template<typename TTestAabbFunc, typename TNewPlaceableFunc>
+	void walkTree(const Frustum& frustum, TTestAabbFunc testFunc, TNewPlaceableFunc newPlaceableFunc) const;
+
+	U32 getPlaceableCount() const
+	{
+		return m_placeableCount;
+	}
+
+	U32 getNodeCount() const
+	{
+		return m_nodes.getSize();
+	}
+
+private:
+	static const U32 MAX_LEAF_PLACEABLES = 4; ///< The placeables of a leaf child.
+	static const U32 MAX_DEPTH = 32;
+
+	/// Rebuild if the new and removed placeables are more than that fraction of all placeables.
+	static const U32 REBUILD_CHANGE_FRACTION = 8;
+	static const U32 MIN_REBUILD_CHANGE_COUNT = 32;
+
+	/// Rebuild if the refits made the surface area of the tree larger than that factor.
+	static constexpr F32 REBUILD_AREA_FACTOR = 2.0f;
+
+	/// Used in m_objectLeafPositions for the placeables that are not in the tree yet.
+	static const U32 PENDING_BIT = 1u << 31u;
+
+	/// A node with 4 children. A child is another node or a leaf with up to MAX_LEAF_PLACEABLES placeables.
+	class alignas(16) Node
+	{
+	public:
+		/// @name The boxes of the children
+		/// @{
+		Array<F32, 4> m_minX;
+		Array<F32, 4> m_minY;
+		Array<F32, 4> m_minZ;
+		Array<F32, 4> m_maxX;
+		Array<F32, 4> m_maxY;
+		Array<F32, 4> m_maxZ;
+		/// @}
+
+		/// The index of the child node or the first placeable in m_leafObjects if it's a leaf.
+		Array<U32, 4> m_children;
+		Array<U8, 4> m_leafObjectCounts; ///< Zero if the child is a node.
+		U32 m_parent;
+		U8 m_parentChild;
+		U8 m_childCount;
+	};
+
+	SceneAllocator<U8> m_alloc;
+	Mutex m_mtx;
+
+	DynamicArray<Node> m_nodes; ///< The nodes in breadth-first order.
+	DynamicArray<U8> m_dirtyNodes; ///< The nodes that need a refit.
+	U32 m_maxDirtyNode = 0;
+	Bool8 m_hasDirtyNodes = false;
+
+	/// The placeables of the leafs sorted by the Morton code. MAX_U32 for the removed ones.
+	DynamicArray<U32> m_leafObjects;
+
+	/// @name The placeables by their index
+	/// @{
+	DynamicArray<Aabb> m_objectBoxes;
+	DynamicArray<BvhPlaceable*> m_objectPlaceables;
+	DynamicArray<U32> m_objectLeafPositions; ///< The index in m_leafObjects or PENDING_BIT | index in m_pendingObjects.
+	DynamicArray<U32> m_objectNodes; ///< The node of the leaf.
+	DynamicArray<U32> m_freeObjects;
+	/// @}
+
+	DynamicArray<U32> m_pendingObjects; ///< New placeables that are not in the tree yet.
+	U32 m_removedCount = 0; ///< Removed placeables since the last build.
+	U32 m_placeableCount = 0;
+	F32 m_buildArea = 0.0f; ///< The surface area of the tree after the last build.
+
+	void removeInternal(BvhPlaceable& placeable);
+
+	/// Build the tree from scratch.
+	void build();
+
+	/// Recompute the boxes of a node from its placeables and its child nodes.
+	void refitNode(U32 nodeIdx);
+
+	/// Recompute the boxes of the dirty nodes and their ancestors.
+	void refit();
+
+	/// The surface area of all the children of the root.
+	F32 computeArea() const;
+
+	/// Test the 4 children of a node against the frustum.
+	/// @return A bit for every child that is inside.
+	static U32 testNodeChildren(const Node& node, const Frustum& frustum);
+
+	Aabb getChildAabb(const Node& node, U32 child) const
+	{
+		return Aabb(Vec3(node.m_minX[child], node.m_minY[child], node.m_minZ[child]),
+			Vec3(node.m_maxX[child], node.m_maxY[child], node.m_maxZ[child]));
+	}
+};
+
+/// An entity that can be placed in a Bvh.
+class BvhPlaceable : public NonCopyable
+{
+	friend class Bvh;
+
+public:
+	void* m_userData = nullptr;
+
+private:
+	U32 m_objectIdx = MAX_U32; ///< MAX_U32 if it's not in a Bvh.
+};
+
+template<typename TTestAabbFunc, typename TNewPlaceableFunc>
+inline void Bvh::walkTree(const Frustum& frustum, TTestAabbFunc testFunc, TNewPlaceableFunc newPlaceableFunc) const
+{
+	// The placeables that are not in the tree yet
+	for(U32 objectIdx : m_pendingObjects)
+	{
+		const Aabb& box = m_objectBoxes[objectIdx];
+		if(frustum.insideFrustum(box) && testFunc(box))
+		{
+			ANKI_ASSERT(m_objectPlaceables[objectIdx]->m_userData);
+			newPlaceableFunc(m_objectPlaceables[objectIdx]->m_userData);
+		}
+	}
+
+	if(m_nodes.getSize() == 0)
+	{
+		return;
+	}
+
+	// Every level pushes up to 3 more nodes than it pops
+	Array<U32, MAX_DEPTH * 3 + 1> stack;
+	U32 stackSize = 0;
+	stack[stackSize++] = 0;
+	U visibleNodes = 0;
+
+	while(stackSize > 0)
+	{
+		const Node& node = m_nodes[stack[--stackSize]];
+		++visibleNodes;
+
+		U32 mask = testNodeChildren(node, frustum);
+		while(mask)
+		{
+			const U32 child = getLeastSignificantBit(mask);
+			mask &= mask - 1;
+
+			if(!testFunc(getChildAabb(node, child)))
+			{
+				continue;
+			}
+
+			const U32 leafObjectCount = node.m_leafObjectCounts[child];
+			if(leafObjectCount == 0)
+			{
+				ANKI_ASSERT(stackSize < stack.getSize());
+				stack[stackSize++] = node.m_children[child];
+			}
+			else
+			{
+				const U32 begin = node.m_children[child];
+				for(U32 i = begin; i < begin + leafObjectCount; ++i)
+				{
+					const U32 objectIdx = m_leafObjects[i];
+					if(objectIdx != MAX_U32)
+					{
+						ANKI_ASSERT(m_objectPlaceables[objectIdx]->m_userData);
+						newPlaceableFunc(m_objectPlaceables[objectIdx]->m_userData);
+					}
+				}
+			}
+		}
+	}
+
+	ANKI_TRACE_INC_COUNTER(BVH_VISIBLE_NODES, visibleNodes);
+}
+/// @}
+
+} // end namespace anki
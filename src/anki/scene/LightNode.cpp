@@ -164,6 +164,7 @@ Error LightNode::loadLensFlare(const CString& filename)
 PointLightNode::PointLightNode(SceneGraph* scene, CString name)
 	: LightNode(scene, name)
 {
+	setUpdatedEveryFrame();
 }
 
 PointLightNode::~PointLightNode()
@@ -235,7 +236,7 @@ Error PointLightNode::frameUpdate(Second prevUpdateTime, Second crntTime)
 		rot = Mat3(Euler(0.0, 0.0, PI));
 		m_shadowData[5].m_localTrf.setRotation(Mat3x4(rot));
 
-		const Vec4& origin = getComponent<MoveComponent>().getWorldTransform().getOrigin();
+		const Vec4 origin = getComponent<MoveComponent>().getWorldTransform().getOrigin();
 		for(U i = 0; i < 6; i++)
 		{
 			m_shadowData[i].m_frustum.setAll(ang, ang, zNear, dist);
@@ -256,6 +257,7 @@ Error PointLightNode::frameUpdate(Second prevUpdateTime, Second crntTime)
 SpotLightNode::SpotLightNode(SceneGraph* scene, CString name)
 	: LightNode(scene, name)
 {
+	setUpdatedEveryFrame();
 }
 
 Error SpotLightNode::init()
@@ -42,7 +42,7 @@ public:
 	Octree* m_octree = nullptr;
 	SpinLock m_lock;
 	const Frustum* m_frustum = nullptr;
-	U32 m_testId = MAX_U32;
+	OctreeVisitedSet* m_visited = nullptr;
 	OctreeNodeVisibilityTestCallback m_testCallback = nullptr;
 	void* m_testCallbackUserData = nullptr;
 	DynamicArrayAuto<void*>* m_out = nullptr;
@@ -60,6 +60,7 @@ Octree::~Octree()
 	ANKI_ASSERT(m_placeableCount == 0);
 	cleanupInternal();
 	ANKI_ASSERT(m_rootLeaf == nullptr);
+	m_freePlaceableIndices.destroy(m_alloc);
 }
 
 void Octree::init(const Vec3& sceneAabbMin, const Vec3& sceneAabbMax, U32 maxDepth)
@@ -82,6 +83,20 @@ void Octree::place(const Aabb& volume, OctreePlaceable* placeable)
 	// Remove the placeable from the Octree
 	removeInternal(*placeable);
 
+	// Give it an index if it's new
+	if(placeable->m_index == MAX_U32)
+	{
+		if(m_freePlaceableIndices.getSize() > 0)
+		{
+			placeable->m_index = m_freePlaceableIndices.getBack();
+			m_freePlaceableIndices.resize(m_alloc, m_freePlaceableIndices.getSize() - 1);
+		}
+		else
+		{
+			placeable->m_index = m_placeableIndexCount++;
+		}
+	}
+
 	// Create the root leaf
 	if(!m_rootLeaf)
 	{
@@ -99,6 +114,12 @@ void Octree::remove(OctreePlaceable& placeable)
 {
 	LockGuard<Mutex> lock(m_globalMtx);
 	removeInternal(placeable);
+
+	if(placeable.m_index != MAX_U32)
+	{
+		m_freePlaceableIndices.emplaceBack(m_alloc, placeable.m_index);
+		placeable.m_index = MAX_U32;
+	}
 }
 
 Bool Octree::volumeTotallyInsideLeaf(const Aabb& volume, const Leaf& leaf)
@@ -326,7 +347,7 @@ void Octree::removeInternal(OctreePlaceable& placeable)
 }
 
 void Octree::gatherVisibleRecursive(const Frustum& frustum,
-	U32 testId,
+	OctreeVisitedSet& visited,
 	OctreeNodeVisibilityTestCallback testCallback,
 	void* testCallbackUserData,
 	Leaf* leaf,
@@ -337,7 +358,7 @@ void Octree::gatherVisibleRecursive(const Frustum& frustum,
 	// Add the placeables that belong to that leaf
 	for(PlaceableNode& placeableNode : leaf->m_placeables)
 	{
-		if(!placeableNode.m_placeable->alreadyVisited(testId))
+		if(!visited.alreadyVisited(*placeableNode.m_placeable))
 		{
 			ANKI_ASSERT(placeableNode.m_placeable->m_userData);
 			out.emplaceBack(placeableNode.m_placeable->m_userData);
@@ -361,7 +382,7 @@ void Octree::gatherVisibleRecursive(const Frustum& frustum,
 
 			if(inside)
 			{
-				gatherVisibleRecursive(frustum, testId, testCallback, testCallbackUserData, child, out);
+				gatherVisibleRecursive(frustum, visited, testCallback, testCallbackUserData, child, out);
 			}
 		}
 	}
@@ -428,7 +449,7 @@ void Octree::debugDrawRecursive(const Leaf& leaf, OctreeDebugDrawer& drawer) con
 }
 
 void Octree::gatherVisibleParallel(const Frustum* frustum,
-	U32 testId,
+	OctreeVisitedSet* visited,
 	OctreeNodeVisibilityTestCallback testCallback,
 	void* testCallbackUserData,
 	DynamicArrayAuto<void*>* out,
@@ -436,14 +457,14 @@ void Octree::gatherVisibleParallel(const Frustum* frustum,
 	ThreadHiveSemaphore* waitSemaphore,
 	ThreadHiveSemaphore*& signalSemaphore)
 {
-	ANKI_ASSERT(out && frustum);
+	ANKI_ASSERT(out && frustum && visited);
 
 	// Create the ctx
 	GatherParallelCtx* ctx = static_cast<GatherParallelCtx*>(
 		hive.allocateScratchMemory(sizeof(GatherParallelCtx), alignof(GatherParallelCtx)));
 	ctx->m_octree = this;
 	ctx->m_frustum = frustum;
-	ctx->m_testId = testId;
+	ctx->m_visited = visited;
 	ctx->m_testCallback = testCallback;
 	ctx->m_testCallbackUserData = testCallbackUserData;
 	ctx->m_out = out;
@@ -485,7 +506,7 @@ void Octree::gatherVisibleParallelTask(
 	DynamicArrayAuto<void*>& out = *ctx.m_out;
 	OctreeNodeVisibilityTestCallback testCallback = ctx.m_testCallback;
 	void* testCallbackUserData = ctx.m_testCallbackUserData;
-	const U32 testId = ctx.m_testId;
+	OctreeVisitedSet& visited = *ctx.m_visited;
 
 	// Add the placeables that belong to that leaf
 	if(leaf->m_placeables.getSize() > 0)
@@ -494,7 +515,7 @@ void Octree::gatherVisibleParallelTask(
 
 		for(PlaceableNode& placeableNode : leaf->m_placeables)
 		{
-			if(!placeableNode.m_placeable->alreadyVisited(testId))
+			if(!visited.alreadyVisited(*placeableNode.m_placeable))
 			{
 				ANKI_ASSERT(placeableNode.m_placeable->m_userData);
 				out.emplaceBack(placeableNode.m_placeable->m_userData);
@@ -9,6 +9,7 @@
 #include <anki/Math.h>
 #include <anki/collision/Aabb.h>
 #include <anki/util/WeakArray.h>
+#include <anki/util/DynamicArray.h>
 #include <anki/util/Enum.h>
 #include <anki/util/ObjectAllocator.h>
 #include <anki/util/List.h>
@@ -19,6 +20,7 @@ namespace anki
 
 // Forward
 class OctreePlaceable;
+class OctreeVisitedSet;
 class ThreadHive;
 class ThreadHiveSemaphore;
 
@@ -39,6 +41,7 @@ public:
 class Octree : public NonCopyable
 {
 	friend class OctreePlaceable;
+	friend class OctreeVisitedSet;
 
 public:
 	Octree(SceneAllocator<U8> alloc)
@@ -60,24 +63,24 @@ public:
 
 	/// Gather visible placeables.
 	/// @param frustum The frustum to test against.
-	/// @param testId A unique index for this test.
+	/// @param visited The placeables this test has visited.
 	/// @param testCallback A ptr to a function that will be used to perform an additional test to the box of the
 	///                     Octree node. Can be nullptr.
 	/// @param testCallbackUserData Parameter to the testCallback. Can be nullptr.
 	/// @param out The output of the tests.
 	/// @note It's thread-safe against other gatherVisible calls.
 	void gatherVisible(const Frustum& frustum,
-		U32 testId,
+		OctreeVisitedSet& visited,
 		OctreeNodeVisibilityTestCallback testCallback,
 		void* testCallbackUserData,
 		DynamicArrayAuto<void*>& out)
 	{
-		gatherVisibleRecursive(frustum, testId, testCallback, testCallbackUserData, m_rootLeaf, out);
+		gatherVisibleRecursive(frustum, visited, testCallback, testCallbackUserData, m_rootLeaf, out);
 	}
 
 	/// Similar to gatherVisible but it spawns ThreadHive tasks.
 	void gatherVisibleParallel(const Frustum* frustum,
-		U32 testId,
+		OctreeVisitedSet* visited,
 		OctreeNodeVisibilityTestCallback testCallback,
 		void* testCallbackUserData,
 		DynamicArrayAuto<void*>* out,
@@ -89,14 +92,14 @@ public:
 	/// @tparam TTestAabbFunc The lambda that will test an Aabb. Signature of lambda: Bool(*)(const Aabb& leafBox)
 	/// @tparam TNewPlaceableFunc The lambda to do something with a visible placeable.
 	///                           Signature: void(*)(void* placeableUserData).
-	/// @param testId The test index.
+	/// @param visited The placeables this test has visited.
 	/// @param testFunc See TTestAabbFunc.
 	/// @param newPlaceableFunc See TNewPlaceableFunc.
 	template<typename TTestAabbFunc, typename TNewPlaceableFunc>
-	void walkTree(U32 testId, TTestAabbFunc testFunc, TNewPlaceableFunc newPlaceableFunc)
+	void walkTree(OctreeVisitedSet& visited, TTestAabbFunc testFunc, TNewPlaceableFunc newPlaceableFunc)
 	{
 		ANKI_ASSERT(m_rootLeaf);
-		walkTreeInternal(*m_rootLeaf, testId, testFunc, newPlaceableFunc);
+		walkTreeInternal(*m_rootLeaf, visited, testFunc, newPlaceableFunc);
 	}
 
 	/// Debug draw.
@@ -201,6 +204,12 @@ private:
 	Leaf* m_rootLeaf = nullptr;
 	U32 m_placeableCount = 0;
 
+	/// @name The indices of the placeables. OctreeVisitedSet uses them
+	/// @{
+	DynamicArray<U32> m_freePlaceableIndices;
+	U32 m_placeableIndexCount = 0;
+	/// @}
+
 	Leaf* newLeaf()
 	{
 		return m_leafAlloc.newInstance(m_alloc);
@@ -252,7 +261,7 @@ private:
 	void removeInternal(OctreePlaceable& placeable);
 
 	static void gatherVisibleRecursive(const Frustum& frustum,
-		U32 testId,
+		OctreeVisitedSet& visited,
 		OctreeNodeVisibilityTestCallback testCallback,
 		void* testCallbackUserData,
 		Leaf* leaf,
@@ -274,44 +283,64 @@ private:
 	void debugDrawRecursive(const Leaf& leaf, OctreeDebugDrawer& drawer) const;
 
 	template<typename TTestAabbFunc, typename TNewPlaceableFunc>
-	void walkTreeInternal(Leaf& leaf, U32 testId, TTestAabbFunc testFunc, TNewPlaceableFunc newPlaceableFunc);
+	void walkTreeInternal(
+		Leaf& leaf, OctreeVisitedSet& visited, TTestAabbFunc testFunc, TNewPlaceableFunc newPlaceableFunc);
 };
 
 /// An entity that can be placed in octrees.
 class OctreePlaceable : public NonCopyable
 {
 	friend class Octree;
+	friend class OctreeVisitedSet;
 
 public:
 	void* m_userData = nullptr;
 
-	void reset()
+private:
+	IntrusiveList<Octree::LeafNode> m_leafs; ///< A list of leafs this placeable belongs.
+	U32 m_index = MAX_U32; ///< A unique index while it's in the octree. MAX_U32 if it's not.
+};
+
+/// The placeables that a single test has visited. A placeable can belong to many leafs and the set is used to visit it
+/// only once. Every test needs its own set so there is no limit to the tests of a frame and no state to reset.
+class OctreeVisitedSet : public NonCopyable
+{
+	friend class Octree;
+
+public:
+	/// @param alloc The allocator of the set. A frame allocator is a good fit.
+	/// @param octree The set can be used in that octree until the next place or remove.
+	template<typename TAllocator>
+	OctreeVisitedSet(TAllocator alloc, const Octree& octree)
+		: m_bits(alloc)
 	{
-		m_visitedMask.set(0);
+		m_bits.create((octree.m_placeableIndexCount + 63) / 64, 0);
 	}
 
 private:
-	Atomic<U64> m_visitedMask = {0u};
-	IntrusiveList<Octree::LeafNode> m_leafs; ///< A list of leafs this placeable belongs.
+	DynamicArrayAuto<U64> m_bits;
 
-	/// Check if already visited.
-	/// @note It's thread-safe.
-	Bool alreadyVisited(U32 testId)
+	/// Mark as visited.
+	/// @return True if it was already visited.
+	Bool alreadyVisited(const OctreePlaceable& placeable)
 	{
-		ANKI_ASSERT(testId < 64);
-		const U64 testMask = U64(1u) << U64(testId);
-		const U64 prev = m_visitedMask.fetchOr(testMask);
-		return !!(testMask & prev);
+		const U32 idx = placeable.m_index;
+		ANKI_ASSERT(idx / 64 < m_bits.getSize() && "The set is older than the placeable");
+		const U64 mask = U64(1) << U64(idx % 64);
+		const U64 prev = m_bits[idx / 64];
+		m_bits[idx / 64] = prev | mask;
+		return !!(prev & mask);
 	}
 };
 
 template<typename TTestAabbFunc, typename TNewPlaceableFunc>
-inline void Octree::walkTreeInternal(Leaf& leaf, U32 testId, TTestAabbFunc testFunc, TNewPlaceableFunc newPlaceableFunc)
+inline void Octree::walkTreeInternal(
+	Leaf& leaf, OctreeVisitedSet& visited, TTestAabbFunc testFunc, TNewPlaceableFunc newPlaceableFunc)
 {
 	// Visit the placeables that belong to that leaf
 	for(PlaceableNode& placeableNode : leaf.m_placeables)
 	{
-		if(!placeableNode.m_placeable->alreadyVisited(testId))
+		if(!visited.alreadyVisited(*placeableNode.m_placeable))
 		{
 			ANKI_ASSERT(placeableNode.m_placeable->m_userData);
 			newPlaceableFunc(placeableNode.m_placeable->m_userData);
@@ -330,7 +359,7 @@ inline void Octree::walkTreeInternal(Leaf& leaf, U32 testId, TTestAabbFunc testF
 			if(testFunc(aabb))
 			{
 				++visibleLeafs;
-				walkTreeInternal(*child, testId, testFunc, newPlaceableFunc);
+				walkTreeInternal(*child, visited, testFunc, newPlaceableFunc);
 			}
 		}
 	}
@@ -251,6 +251,7 @@ public:
 ParticleEmitterNode::ParticleEmitterNode(SceneGraph* scene, CString name)
 	: SceneNode(scene, name)
 {
+	setUpdatedEveryFrame();
 }
 
 ParticleEmitterNode::~ParticleEmitterNode()
@@ -28,6 +28,7 @@ public:
 	ReflectionProbeNode(SceneGraph* scene, CString name)
 		: SceneNode(scene, name)
 	{
+		setUpdatedEveryFrame();
 	}
 
 	~ReflectionProbeNode();
@@ -8,6 +8,10 @@
 #include <anki/scene/PhysicsDebugNode.h>
 #include <anki/scene/ModelNode.h>
 #include <anki/scene/Octree.h>
+#include <anki/scene/Bvh.h>
+#include <anki/scene/TransformHierarchy.h>
+#include <anki/scene/components/MoveComponent.h>
+#include <anki/scene/components/SpatialComponent.h>
 #include <anki/core/Trace.h>
 #include <anki/physics/PhysicsWorld.h>
 #include <anki/resource/ResourceManager.h>
@@ -20,29 +24,6 @@ namespace anki
 
 const U NODE_UPDATE_BATCH = 10;
 
-class UpdateSceneNodesCtx
-{
-public:
-	SceneGraph* m_scene = nullptr;
-
-	IntrusiveList<SceneNode>::Iterator m_crntNode;
-	SpinLock m_crntNodeLock;
-
-	Second m_prevUpdateTime;
-	Second m_crntTime;
-};
-
-class UpdateSceneNodesTask : public ThreadPoolTask
-{
-public:
-	UpdateSceneNodesCtx* m_ctx;
-
-	Error operator()(U32 taskId, PtrSize threadsCount)
-	{
-		return m_ctx->m_scene->updateNodes(*m_ctx);
-	}
-};
-
 SceneGraph::SceneGraph()
 {
 }
@@ -56,11 +37,25 @@ SceneGraph::~SceneGraph()
 	(void)err;
 
 	deleteNodesMarkedForDeletion();
+	m_nodesDict.destroy(m_alloc);
+	m_dirtyNodes.destroy(m_alloc);
+	m_spatialsToPlace.destroy(m_alloc);
+	m_componentPools.destroy(m_alloc);
 
 	if(m_octree)
 	{
 		m_alloc.deleteInstance(m_octree);
 	}
+
+	if(m_bvh)
+	{
+		m_alloc.deleteInstance(m_bvh);
+	}
+
+	if(m_transforms)
+	{
+		m_alloc.deleteInstance(m_transforms);
+	}
 }
 
 Error SceneGraph::init(AllocAlignedCallback allocCb,
@@ -92,8 +87,17 @@ Error SceneGraph::init(AllocAlignedCallback allocCb,
 
 	m_maxReflectionProxyDistance = config.getNumber("scene.imageReflectionMaxDistance");
 
-	m_octree = m_alloc.newInstance<Octree>(m_alloc);
-	m_octree->init(m_sceneMin, m_sceneMax, 5); // TODO
+	if(config.getNumber("scene.bvh"))
+	{
+		m_bvh = m_alloc.newInstance<Bvh>(m_alloc);
+	}
+	else
+	{
+		m_octree = m_alloc.newInstance<Octree>(m_alloc);
+		m_octree->init(m_sceneMin, m_sceneMax, 5); // TODO
+	}
+
+	m_transforms = m_alloc.newInstance<TransformHierarchy>(m_alloc);
 
 	// Init the default main camera
 	ANKI_CHECK(newSceneNode<PerspectiveCameraNode>("mainCamera", m_defaultMainCam));
@@ -112,21 +116,25 @@ Error SceneGraph::registerNode(SceneNode* node)
 	ANKI_ASSERT(node);
 
 	// Add to dict if it has a name
-	if(node->getName())
+	if(!node->getNameId().isEmpty())
 	{
-		if(tryFindSceneNode(node->getName()))
+		if(m_nodesDict.find(node->getNameId()) != m_nodesDict.getEnd())
 		{
 			ANKI_SCENE_LOGE("Node with the same name already exists");
 			return Error::USER_DATA;
 		}
 
-		m_nodesDict.emplace(m_alloc, node->getName(), node);
+		m_nodesDict.emplace(m_alloc, node->getNameId(), node);
 	}
 
 	// Add to vector
 	m_nodes.pushBack(node);
 	++m_nodesCount;
 
+	// Update it at least once. It's marked since its construction
+	ANKI_ASSERT(node->getMarkedForUpdate());
+	addDirtyNode(node);
+
 	return Error::NONE;
 }
 
@@ -142,14 +150,36 @@ void SceneGraph::unregisterNode(SceneNode* node)
 	}
 
 	// Remove from dict
-	if(node->getName())
+	if(!node->getNameId().isEmpty())
 	{
-		auto it = m_nodesDict.find(node->getName());
+		auto it = m_nodesDict.find(node->getNameId());
 		ANKI_ASSERT(it != m_nodesDict.getEnd());
 		m_nodesDict.erase(m_alloc, it);
 	}
 }
 
+void SceneGraph::addDirtyNode(SceneNode* node)
+{
+	LockGuard<SpinLock> lock(m_dirtyNodesMtx);
+	if(m_dirtyNodeCount == m_dirtyNodes.getSize())
+	{
+		m_dirtyNodes.resize(m_alloc, max<U32>(64, m_dirtyNodeCount * 2));
+	}
+
+	m_dirtyNodes[m_dirtyNodeCount++] = node;
+}
+
+void SceneGraph::addSpatialToPlace(SpatialComponent* sp)
+{
+	LockGuard<SpinLock> lock(m_spatialsToPlaceMtx);
+	if(m_spatialsToPlaceCount == m_spatialsToPlace.getSize())
+	{
+		m_spatialsToPlace.resize(m_alloc, max<U32>(64, m_spatialsToPlaceCount * 2));
+	}
+
+	m_spatialsToPlace[m_spatialsToPlaceCount++] = sp;
+}
+
 SceneNode& SceneGraph::findSceneNode(const CString& name)
 {
 	SceneNode* node = tryFindSceneNode(name);
@@ -159,7 +189,14 @@ SceneNode& SceneGraph::findSceneNode(const CString& name)
 
 SceneNode* SceneGraph::tryFindSceneNode(const CString& name)
 {
-	auto it = m_nodesDict.find(name);
+	// If the name is not interned no node has it
+	StringId id;
+	if(!StringTableSingleton::get().find(name, id) || id.isEmpty())
+	{
+		return nullptr;
+	}
+
+	auto it = m_nodesDict.find(id);
 	return (it == m_nodesDict.getEnd()) ? nullptr : (*it);
 }
 
@@ -167,6 +204,32 @@ void SceneGraph::deleteNodesMarkedForDeletion()
 {
 	/// Delete all nodes pending deletion. At this point all scene threads
 	/// should have finished their tasks
+	if(m_objectsMarkedForDeletionCount.load() == 0)
+	{
+		return;
+	}
+
+	// Forget the dirty nodes that will be deleted
+	U32 dirtyNodeCount = 0;
+	for(U32 i = 0; i < m_dirtyNodeCount; ++i)
+	{
+		if(!m_dirtyNodes[i]->getMarkedForDeletion())
+		{
+			m_dirtyNodes[dirtyNodeCount++] = m_dirtyNodes[i];
+		}
+	}
+	m_dirtyNodeCount = dirtyNodeCount;
+
+	U32 spatialsToPlaceCount = 0;
+	for(U32 i = 0; i < m_spatialsToPlaceCount; ++i)
+	{
+		if(!m_spatialsToPlace[i]->getSceneNode().getMarkedForDeletion())
+		{
+			m_spatialsToPlace[spatialsToPlaceCount++] = m_spatialsToPlace[i];
+		}
+	}
+	m_spatialsToPlaceCount = spatialsToPlaceCount;
+
 	while(m_objectsMarkedForDeletionCount.load() > 0)
 	{
 		Bool found = false;
@@ -212,7 +275,6 @@ Error SceneGraph::update(Second prevUpdateTime, Second crntTime)
 	}
 
 	ThreadPool& threadPool = *m_threadpool;
-	(void)threadPool;
 
 	// Update
 	{
@@ -226,22 +288,45 @@ Error SceneGraph::update(Second prevUpdateTime, Second crntTime)
 		ANKI_TRACE_SCOPED_EVENT(SCENE_NODES_UPDATE);
 		ANKI_CHECK(m_events.updateAllEvents(prevUpdateTime, crntTime));
 
-		// Then the rest
-		Array<UpdateSceneNodesTask, ThreadPool::MAX_THREADS> jobs2;
-		UpdateSceneNodesCtx updateCtx;
-		updateCtx.m_scene = this;
-		updateCtx.m_crntNode = m_nodes.getBegin();
-		updateCtx.m_prevUpdateTime = prevUpdateTime;
-		updateCtx.m_crntTime = crntTime;
+		// Compute the world transforms level by level. It marks the nodes of the moved MoveComponents
+		{
+			ANKI_TRACE_SCOPED_EVENT(SCENE_TRANSFORMS_UPDATE);
+			m_transforms->update(&threadPool, m_timestamp, onWorldTransformUpdated, nullptr);
+		}
+
+		// Then the rest. Update only the subtrees that have marked nodes
+		++m_updateCount;
+		DynamicArrayAuto<SceneNode*> roots(m_frameAlloc);
+		gatherDirtySubtrees(roots);
+
+		const U64 updateCount = m_updateCount;
+		ANKI_CHECK(threadPool.parallelFor(
+			roots.getSize(), NODE_UPDATE_BATCH, [&](U32 threadId, PtrSize start, PtrSize end) -> Error {
+				Error err = Error::NONE;
+				for(PtrSize i = start; i < end && !err; ++i)
+				{
+					err = updateNode(prevUpdateTime, crntTime, updateCount, *roots[i]);
+				}
 
-		for(U i = 0; i < threadPool.getThreadCount(); i++)
+				return err;
+			}));
+	}
+
+	// Place the spatials that changed in the nodes that got updated. The octree and the BVH are changed by one thread
+	{
+		ANKI_TRACE_SCOPED_EVENT(SCENE_SPATIALS_PLACE);
+		for(U32 i = 0; i < m_spatialsToPlaceCount; ++i)
 		{
-			UpdateSceneNodesTask& job = jobs2[i];
-			job.m_ctx = &updateCtx;
-			threadPool.assignNewTask(i, &job);
+			m_spatialsToPlace[i]->updatePlacement();
 		}
+		m_spatialsToPlaceCount = 0;
+	}
 
-		ANKI_CHECK(threadPool.waitForAllThreadsToFinish());
+	if(m_bvh)
+	{
+		// Apply the changes of the spatials
+		ANKI_TRACE_SCOPED_EVENT(SCENE_BVH_UPDATE);
+		m_bvh->update();
 	}
 
 	m_stats.m_updateTime = HighRezTimer::getCurrentTime() - m_stats.m_updateTime;
@@ -255,82 +340,125 @@ void SceneGraph::doVisibilityTests(RenderQueue& rqueue)
 	m_stats.m_visibilityTestsTime = HighRezTimer::getCurrentTime() - m_stats.m_visibilityTestsTime;
 }
 
-Error SceneGraph::updateNode(Second prevTime, Second crntTime, SceneNode& node)
+void SceneGraph::onWorldTransformUpdated(void* userData, void* transformUserData)
 {
-	ANKI_TRACE_INC_COUNTER(SCENE_NODES_UPDATED, 1);
-
-	Error err = Error::NONE;
-
-	// Components update
-	Timestamp componentTimestam = 0;
-	err = node.iterateComponents([&](SceneComponent& comp) -> Error {
-		Bool updated = false;
-		Error e = comp.updateReal(prevTime, crntTime, updated);
-		componentTimestam = max(componentTimestam, comp.getTimestamp());
+	(void)userData;
+	static_cast<MoveComponent*>(transformUserData)->getSceneNode().markForUpdate();
+}
 
-		return e;
-	});
+void SceneGraph::gatherDirtySubtrees(DynamicArrayAuto<SceneNode*>& roots)
+{
+	// Take the dirty nodes. The nodes that will be marked from now on will be updated in the next update
+	DynamicArrayAuto<SceneNode*> dirtyNodes(m_frameAlloc);
+	{
+		LockGuard<SpinLock> lock(m_dirtyNodesMtx);
+		if(m_dirtyNodeCount > 0)
+		{
+			dirtyNodes.create(m_dirtyNodeCount);
+			memcpy(&dirtyNodes[0], &m_dirtyNodes[0], m_dirtyNodeCount * sizeof(SceneNode*));
+			m_dirtyNodeCount = 0;
+		}
+	}
 
-	// Update children
-	if(!err)
+	if(dirtyNodes.getSize() == 0)
 	{
-		err = node.visitChildrenMaxDepth(
-			0, [&](SceneNode& child) -> Error { return updateNode(prevTime, crntTime, child); });
+		return;
 	}
 
-	// Frame update
-	if(!err)
+	roots.create(dirtyNodes.getSize());
+	U rootCount = 0;
+	for(SceneNode* node : dirtyNodes)
 	{
-		err = node.frameUpdateComplete(prevTime, crntTime, componentTimestam);
+		// Skip the duplicates and the nodes that were updated by their parents
+		if(!node->getMarkedForUpdate() || node->m_updateVisit == m_updateCount)
+		{
+			continue;
+		}
+
+		node->m_updateVisit = m_updateCount;
+
+		// Find the top marked ancestor. Stop at a visited ancestor since it's a root or it's under one
+		SceneNode* topMarked = nullptr;
+		SceneNode* visited = nullptr;
+		for(SceneNode* parent = node->getParent(); parent; parent = parent->getParent())
+		{
+			if(parent->m_updateVisit == m_updateCount)
+			{
+				visited = parent;
+				break;
+			}
+
+			if(parent->getMarkedForUpdate())
+			{
+				topMarked = parent;
+			}
+		}
+
+		if(topMarked == nullptr && visited == nullptr)
+		{
+			roots[rootCount++] = node;
+		}
+		else
+		{
+			// The ancestor will update the node. Mark the path from the ancestor to the node so it's visited
+			SceneNode* stop = (visited) ? visited : topMarked;
+			for(SceneNode* parent = node->getParent(); parent != stop; parent = parent->getParent())
+			{
+				parent->m_updateVisit = m_updateCount;
+			}
+		}
 	}
 
-	return err;
+	roots.resize(rootCount);
 }
 
-Error SceneGraph::updateNodes(UpdateSceneNodesCtx& ctx) const
+Error SceneGraph::updateNode(Second prevTime, Second crntTime, U64 updateCount, SceneNode& node)
 {
-	ANKI_TRACE_SCOPED_EVENT(SCENE_NODES_UPDATE);
+	ANKI_TRACE_INC_COUNTER(SCENE_NODES_VISITED, 1);
 
-	IntrusiveList<SceneNode>::ConstIterator end = m_nodes.getEnd();
-
-	Bool quit = false;
 	Error err = Error::NONE;
-	while(!quit && !err)
+	const Bool marked = node.m_markedForUpdate.exchange(0) != 0;
+
+	// Components update
+	Timestamp componentTimestamp = 0;
+	Bool updated = false;
+	if(marked)
 	{
-		// Fetch a batch of scene nodes that don't have parent
-		Array<SceneNode*, NODE_UPDATE_BATCH> batch;
-		U batchSize = 0;
+		ANKI_TRACE_INC_COUNTER(SCENE_NODES_UPDATED, 1);
 
-		{
-			LockGuard<SpinLock> lock(ctx.m_crntNodeLock);
+		err = node.iterateComponents([&](SceneComponent& comp) -> Error {
+			Bool compUpdated = false;
+			Error e = comp.updateReal(prevTime, crntTime, compUpdated);
+			componentTimestamp = max(componentTimestamp, comp.getTimestamp());
+			updated = updated || compUpdated;
 
-			while(1)
-			{
-				if(batchSize == batch.getSize())
-				{
-					break;
-				}
+			return e;
+		});
+	}
 
-				if(ctx.m_crntNode == end)
-				{
-					quit = true;
-					break;
-				}
+	// Update the children that are marked or that are on the path to marked nodes
+	if(!err)
+	{
+		err = node.visitChildrenMaxDepth(0, [&](SceneNode& child) -> Error {
+			if(child.getMarkedForUpdate() || child.m_updateVisit == updateCount)
+			{
+				return updateNode(prevTime, crntTime, updateCount, child);
+			}
 
-				SceneNode& node = *ctx.m_crntNode;
-				if(node.getParent() == nullptr)
-				{
-					batch[batchSize++] = &node;
-				}
+			return Error::NONE;
+		});
+	}
 
-				++ctx.m_crntNode;
-			}
-		}
+	// Frame update
+	if(!err && marked)
+	{
+		err = node.frameUpdateComplete(prevTime, crntTime, componentTimestamp);
 
-		// Process nodes
-		for(U i = 0; i < batchSize && !err; ++i)
+		// Update it in the next update as well. If something changed the components need to update the previous
+		// values (previous transforms etc)
+		if(updated || node.getUpdatedEveryFrame())
 		{
-			err = updateNode(ctx.m_prevUpdateTime, ctx.m_crntTime, *batch[i]);
+			node.markForUpdate();
 		}
 	}
 
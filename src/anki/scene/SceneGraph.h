@@ -10,7 +10,7 @@
 #include <anki/Math.h>
 #include <anki/util/Singleton.h>
 #include <anki/util/HighRezTimer.h>
-#include <anki/util/HashMap.h>
+#include <anki/util/FlatHashMap.h>
 #include <anki/core/App.h>
 #include <anki/scene/events/EventManager.h>
 
@@ -24,8 +24,10 @@ class CameraNode;
 class Input;
 class ConfigSet;
 class PerspectiveCameraNode;
-class UpdateSceneNodesCtx;
 class Octree;
+class Bvh;
+class TransformHierarchy;
+class SpatialComponent;
 
 /// @addtogroup scene
 /// @{
@@ -43,7 +45,6 @@ public:
 class SceneGraph
 {
 	friend class SceneNode;
-	friend class UpdateSceneNodesTask;
 
 public:
 	SceneGraph();
@@ -221,9 +222,23 @@ anki_internal:
 		return m_nodesUuid++;
 	}
 
-	SceneComponentLists& getSceneComponentLists()
+	/// Add a node to the nodes that will be updated in the next update. Called by SceneNode::markForUpdate.
+	void addDirtyNode(SceneNode* node);
+
+	/// Add a SpatialComponent that will be placed at the end of the current update. Called by the SpatialComponents
+	/// that changed.
+	void addSpatialToPlace(SpatialComponent* sp);
+
+	SceneComponentPools& getSceneComponentPools()
+	{
+		return m_componentPools;
+	}
+
+	/// Iterate all the components of a type.
+	template<typename TComponent, typename Func>
+	void iterateComponents(Func func)
 	{
-		return m_componentLists;
+		m_componentPools.iterateComponents<TComponent>(func);
 	}
 
 	F32 getEarlyZDistance() const
@@ -231,12 +246,37 @@ anki_internal:
 		return m_earlyZDist;
 	}
 
+	/// Return true if the spatials are placed in the BVH instead of the octree. It's set by the "scene.bvh" option.
+	Bool getUsingBvh() const
+	{
+		return m_bvh != nullptr;
+	}
+
 	Octree& getOctree()
 	{
 		ANKI_ASSERT(m_octree);
 		return *m_octree;
 	}
 
+	Bvh& getBvh()
+	{
+		ANKI_ASSERT(m_bvh);
+		return *m_bvh;
+	}
+
+	/// The transforms of the MoveComponents.
+	TransformHierarchy& getTransformHierarchy()
+	{
+		ANKI_ASSERT(m_transforms);
+		return *m_transforms;
+	}
+
+	const TransformHierarchy& getTransformHierarchy() const
+	{
+		ANKI_ASSERT(m_transforms);
+		return *m_transforms;
+	}
+
 private:
 	const Timestamp* m_globalTimestamp = nullptr;
 	Timestamp m_timestamp = 0; ///< Cached timestamp
@@ -255,7 +295,18 @@ private:
 
 	IntrusiveList<SceneNode> m_nodes;
 	U32 m_nodesCount = 0;
-	HashMap<CString, SceneNode*> m_nodesDict;
+
+	/// The nodes that are marked for update. It may contain the same node more than once or nodes that are not marked
+	/// any more if they were updated along with their parent.
+	DynamicArray<SceneNode*> m_dirtyNodes;
+	U32 m_dirtyNodeCount = 0;
+	SpinLock m_dirtyNodesMtx;
+	/// The SpatialComponents that changed in the current update.
+	DynamicArray<SpatialComponent*> m_spatialsToPlace;
+	U32 m_spatialsToPlaceCount = 0;
+	SpinLock m_spatialsToPlaceMtx;
+	U64 m_updateCount = 0;
+	FlatHashMap<StringId, SceneNode*> m_nodesDict; ///< The named nodes by their interned name.
 
 	SceneNode* m_mainCam = nullptr;
 	Timestamp m_activeCameraChangeTimestamp = 0;
@@ -264,6 +315,9 @@ private:
 	EventManager m_events;
 
 	Octree* m_octree = nullptr;
+	Bvh* m_bvh = nullptr;
+
+	TransformHierarchy* m_transforms = nullptr;
 
 	Vec3 m_sceneMin = {-1000.0f, -200.0f, -1000.0f};
 	Vec3 m_sceneMax = {1000.0f, 200.0f, 1000.0f};
@@ -274,7 +328,7 @@ private:
 
 	U64 m_nodesUuid = 0;
 
-	SceneComponentLists m_componentLists;
+	SceneComponentPools m_componentPools;
 
 	F32 m_earlyZDist = -1.0;
 
@@ -287,8 +341,14 @@ private:
 	/// Delete the nodes that are marked for deletion
 	void deleteNodesMarkedForDeletion();
 
-	ANKI_USE_RESULT Error updateNodes(UpdateSceneNodesCtx& ctx) const;
-	ANKI_USE_RESULT static Error updateNode(Second prevTime, Second crntTime, SceneNode& node);
+	/// Gather the dirty nodes that don't have dirty ancestors. Their subtrees are updated in parallel.
+	/// Called by the TransformHierarchy for every new world transform.
+	static void onWorldTransformUpdated(void* userData, void* transformUserData);
+
+	void gatherDirtySubtrees(DynamicArrayAuto<SceneNode*>& roots);
+
+	/// Update the node if it's marked and then the children that are marked or have marked descendants.
+	ANKI_USE_RESULT static Error updateNode(Second prevTime, Second crntTime, U64 updateCount, SceneNode& node);
 
 	/// Do visibility tests.
 	static void doVisibilityTests(SceneNode& frustumable, SceneGraph& scene, RenderQueue& rqueue);
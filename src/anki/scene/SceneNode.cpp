@@ -5,6 +5,7 @@
 
 #include <anki/scene/SceneNode.h>
 #include <anki/scene/SceneGraph.h>
+#include <anki/scene/components/MoveComponent.h>
 
 namespace anki
 {
@@ -13,10 +14,7 @@ SceneNode::SceneNode(SceneGraph* scene, CString name)
 	: m_scene(scene)
 	, m_uuid(scene->getNewUuid())
 {
-	if(name)
-	{
-		m_name.create(getSceneAllocator(), name);
-	}
+	m_name = StringTableSingleton::get().intern(name);
 }
 
 SceneNode::~SceneNode()
@@ -28,11 +26,10 @@ SceneNode::~SceneNode()
 	for(; it != end; ++it)
 	{
 		SceneComponent* comp = *it;
-		alloc.deleteInstance(comp);
+		getComponentPools().deleteInstance(alloc, comp);
 	}
 
 	Base::destroy(alloc);
-	m_name.destroy(alloc);
 	m_components.destroy(alloc);
 }
 
@@ -53,6 +50,25 @@ void SceneNode::setMarkedForDeletion()
 	(void)err;
 }
 
+void SceneNode::addChild(SceneNode* obj)
+{
+	Base::addChild(getSceneAllocator(), obj);
+
+	Error err = obj->iterateComponentsOfType<MoveComponent>([](MoveComponent& mov) -> Error {
+		mov.onNodeParentChanged();
+		return Error::NONE;
+	});
+	(void)err;
+}
+
+void SceneNode::markForUpdate()
+{
+	if(m_markedForUpdate.load() == 0 && m_markedForUpdate.exchange(1) == 0)
+	{
+		m_scene->addDirtyNode(this);
+	}
+}
+
 Timestamp SceneNode::getGlobalTimestamp() const
 {
 	return m_scene->getGlobalTimestamp();
@@ -75,4 +91,9 @@ ResourceManager& SceneNode::getResourceManager()
 	return m_scene->getResourceManager();
 }
 
+SceneComponentPools& SceneNode::getComponentPools()
+{
+	return m_scene->getSceneComponentPools();
+}
+
 } // end namespace anki
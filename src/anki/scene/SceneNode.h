@@ -11,6 +11,7 @@
 #include <anki/util/BitSet.h>
 #include <anki/util/List.h>
 #include <anki/util/Enum.h>
+#include <anki/util/StringTable.h>
 #include <anki/scene/components/SceneComponent.h>
 
 namespace anki
@@ -25,6 +26,8 @@ class ResourceManager;
 /// Interface class backbone of scene
 class SceneNode : public Hierarchy<SceneNode>, public IntrusiveListEnabled<SceneNode>
 {
+	friend class SceneGraph;
+
 public:
 	using Base = Hierarchy<SceneNode>;
 
@@ -49,7 +52,13 @@ public:
 	/// Return the name. It may be empty for nodes that we don't want to track
 	CString getName() const
 	{
-		return (!m_name.isEmpty()) ? m_name.toCString() : CString();
+		return StringTableSingleton::get().getString(m_name);
+	}
+
+	/// Return the name interned in the StringTableSingleton.
+	StringId getNameId() const
+	{
+		return m_name;
 	}
 
 	U64 getUuid() const
@@ -64,6 +73,22 @@ public:
 
 	void setMarkedForDeletion();
 
+	/// Ask the SceneGraph to update the node and its children in the next update. The components call it when they
+	/// change. New nodes and the nodes that are updated every frame are always updated.
+	/// @note It's thread-safe.
+	void markForUpdate();
+
+	Bool getMarkedForUpdate() const
+	{
+		return m_markedForUpdate.load() != 0;
+	}
+
+	/// Return true if the node is updated in every SceneGraph::update.
+	Bool getUpdatedEveryFrame() const
+	{
+		return m_flags.get(Flag::UPDATE_EVERY_FRAME);
+	}
+
 	Timestamp getGlobalTimestamp() const;
 
 	Timestamp getComponentMaxTimestamp() const
@@ -76,12 +101,10 @@ public:
 
 	SceneFrameAllocator<U8> getFrameAllocator() const;
 
-	void addChild(SceneNode* obj)
-	{
-		Base::addChild(getSceneAllocator(), obj);
-	}
+	void addChild(SceneNode* obj);
 
-	/// This is called by the scene every frame after logic and before rendering. By default it does nothing.
+	/// This is called by the scene every frame after logic and before rendering. By default it does nothing. It's
+	/// called only if the node is marked for update so nodes that override it should call setUpdatedEveryFrame().
 	/// @param prevUpdateTime Timestamp of the previous update
 	/// @param crntTime Timestamp of this update
 	virtual ANKI_USE_RESULT Error frameUpdate(Second prevUpdateTime, Second crntTime)
@@ -120,12 +143,17 @@ public:
 	template<typename Component, typename Func>
 	ANKI_USE_RESULT Error iterateComponentsOfType(Func func) const
 	{
+		const U first = m_componentsOfType[Component::CLASS_TYPE].m_first;
+		if(first == MAX_U16)
+		{
+			return Error::NONE;
+		}
+
 		Error err = Error::NONE;
-		auto it = m_components.getBegin();
-		auto end = m_components.getEnd();
-		for(; !err && it != end; ++it)
+		const U last = m_componentsOfType[Component::CLASS_TYPE].m_last;
+		for(U i = first; !err && i <= last; ++i)
 		{
-			auto* comp = *it;
+			SceneComponent* comp = m_components[i];
 			if(comp->getType() == Component::CLASS_TYPE)
 			{
 				err = func(*static_cast<Component*>(comp));
@@ -135,36 +163,26 @@ public:
 		return err;
 	}
 
-	/// Try geting a pointer to the first component of the requested type
+	/// Try geting a pointer to the last component of the requested type
 	template<typename Component>
 	Component* tryGetComponent()
 	{
-		U count = m_components.getSize();
-		while(count-- != 0)
-		{
-			SceneComponent* comp = m_components[count];
-			if(comp->getType() == Component::CLASS_TYPE)
-			{
-				return static_cast<Component*>(comp);
-			}
-		}
-		return nullptr;
+		const U idx = m_componentsOfType[Component::CLASS_TYPE].m_last;
+		return (idx != MAX_U16) ? static_cast<Component*>(m_components[idx]) : nullptr;
 	}
 
-	/// Try geting a pointer to the first component of the requested type
+	/// Try geting a pointer to the last component of the requested type
 	template<typename Component>
 	const Component* tryGetComponent() const
 	{
-		U count = m_components.getSize();
-		while(count-- != 0)
-		{
-			const SceneComponent* comp = m_components[count];
-			if(comp->getType() == Component::CLASS_TYPE)
-			{
-				return static_cast<const Component*>(comp);
-			}
-		}
-		return nullptr;
+		const U idx = m_componentsOfType[Component::CLASS_TYPE].m_last;
+		return (idx != MAX_U16) ? static_cast<const Component*>(m_components[idx]) : nullptr;
+	}
+
+	/// Check if the node has a component of a specific type.
+	Bool hasComponent(SceneComponentType type) const
+	{
+		return m_componentsOfType[type].m_first != MAX_U16;
 	}
 
 	/// Get a pointer to the first component of the requested type
@@ -211,32 +229,74 @@ protected:
 	template<typename TComponent, typename... TArgs>
 	TComponent* newComponent(TArgs&&... args)
 	{
-		TComponent* comp = getSceneAllocator().newInstance<TComponent>(this, std::forward<TArgs>(args)...);
+		TComponent* comp = getComponentPools().newInstance<TComponent>(
+			getSceneAllocator(), this, std::forward<TArgs>(args)...);
+		indexComponent(comp->getType(), m_components.getSize());
 		m_components.emplaceBack(getSceneAllocator(), comp);
+
+		if(TComponent::UPDATE_EVERY_FRAME)
+		{
+			setUpdatedEveryFrame();
+		}
+
 		return comp;
 	}
 
+	/// Update the node in every SceneGraph::update and not only when it's marked for update.
+	void setUpdatedEveryFrame()
+	{
+		m_flags.set(Flag::UPDATE_EVERY_FRAME);
+	}
+
 	ResourceManager& getResourceManager();
 
 private:
 	enum class Flag : U8
 	{
-		MARKED_FOR_DELETION = 1 << 0
+		MARKED_FOR_DELETION = 1 << 0,
+		UPDATE_EVERY_FRAME = 1 << 1
 	};
 	ANKI_ENUM_ALLOW_NUMERIC_OPERATIONS(Flag, friend)
 
+	/// The range of the components of a type in m_components.
+	class ComponentRange
+	{
+	public:
+		U16 m_first = MAX_U16; ///< MAX_U16 if there are none.
+		U16 m_last = MAX_U16;
+	};
+
 	SceneGraph* m_scene = nullptr;
 
 	DynamicArray<SceneComponent*> m_components;
+	Array<ComponentRange, U(SceneComponentType::COUNT)> m_componentsOfType;
 
-	String m_name; ///< A unique name
+	StringId m_name; ///< A unique name
 	BitMask<Flag> m_flags;
 
 	U64 m_uuid;
 
 	Timestamp m_maxComponentTimestamp = 0;
 
+	/// It's 1 if the node is in the dirty nodes of the SceneGraph. New nodes start with 1 and the SceneGraph adds them
+	/// when they are registered.
+	Atomic<U32> m_markedForUpdate = {1};
+	U64 m_updateVisit = 0; ///< The last SceneGraph::update that had to visit the node.
+
 	void cacheImportantComponents();
+
+	SceneComponentPools& getComponentPools();
+
+	void indexComponent(SceneComponentType type, PtrSize idx)
+	{
+		ANKI_ASSERT(idx < MAX_U16);
+		ComponentRange& range = m_componentsOfType[type];
+		if(range.m_first == MAX_U16)
+		{
+			range.m_first = U16(idx);
+		}
+		range.m_last = U16(idx);
+	}
 };
 /// @}
 
@@ -0,0 +1,435 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/scene/TransformHierarchy.h>
+#include <anki/util/ThreadPool.h>
+#include <algorithm>
+
+namespace anki
+{
+
+/// Re-order an array. The new element i is the old element newToOld[i].
+template<typename T>
+static void reorderArray(SceneAllocator<U8> alloc, DynamicArray<T>& arr, const DynamicArrayAuto<U32>& newToOld)
+{
+	DynamicArray<T> newArr;
+	if(newToOld.getSize() > 0)
+	{
+		newArr.create(alloc, newToOld.getSize());
+		for(U32 i = 0; i < newToOld.getSize(); ++i)
+		{
+			newArr[i] = arr[newToOld[i]];
+		}
+	}
+
+	arr.destroy(alloc);
+	arr = std::move(newArr);
+}
+
+TransformHierarchy::~TransformHierarchy()
+{
+	m_locals.destroy(m_alloc);
+	m_worlds.destroy(m_alloc);
+	m_prevWorlds.destroy(m_alloc);
+	m_timestamps.destroy(m_alloc);
+	m_parents.destroy(m_alloc);
+	m_flags.destroy(m_alloc);
+	m_ids.destroy(m_alloc);
+	m_userData.destroy(m_alloc);
+	m_indices.destroy(m_alloc);
+	m_idParents.destroy(m_alloc);
+	m_freeIds.destroy(m_alloc);
+	m_levelOffsets.destroy(m_alloc);
+	m_childOffsets.destroy(m_alloc);
+	m_children.destroy(m_alloc);
+	m_visitIndices.destroy(m_alloc);
+	m_dirtyIds.destroy(m_alloc);
+}
+
+U32 TransformHierarchy::newTransform(TransformHierarchyFlag flags, void* userData)
+{
+	U32 id;
+	if(m_freeIds.getSize() > 0)
+	{
+		id = m_freeIds.getBack();
+		m_freeIds.resize(m_alloc, m_freeIds.getSize() - 1);
+	}
+	else
+	{
+		id = U32(m_indices.getSize());
+		m_indices.emplaceBack(m_alloc, MAX_U32);
+		m_idParents.emplaceBack(m_alloc, U32(NO_PARENT));
+	}
+
+	// Append it. It's a root for now
+	const U32 idx = U32(m_locals.getSize());
+	m_locals.emplaceBack(m_alloc, Transform::getIdentity());
+	m_worlds.emplaceBack(m_alloc, Transform::getIdentity());
+	m_prevWorlds.emplaceBack(m_alloc, Transform::getIdentity());
+	m_timestamps.emplaceBack(m_alloc, 0);
+	m_parents.emplaceBack(m_alloc, U32(NO_PARENT));
+	m_flags.emplaceBack(m_alloc, U8(flags));
+	m_ids.emplaceBack(m_alloc, id);
+	m_userData.emplaceBack(m_alloc, userData);
+
+	m_indices[id] = idx;
+	m_idParents[id] = NO_PARENT;
+	++m_transformCount;
+	m_sorted = false;
+	markDirty(idx);
+
+	return id;
+}
+
+void TransformHierarchy::deleteTransform(U32 id)
+{
+	const U32 idx = getIndex(id);
+	m_flags[idx] |= DELETED;
+	m_indices[id] = MAX_U32;
+	m_idParents[id] = NO_PARENT;
+	m_freeIds.emplaceBack(m_alloc, id);
+
+	ANKI_ASSERT(m_transformCount > 0);
+	--m_transformCount;
+	m_sorted = false;
+}
+
+void TransformHierarchy::setParent(U32 id, U32 parentId)
+{
+	ANKI_ASSERT(id != parentId);
+	ANKI_ASSERT(parentId == NO_PARENT || m_indices[parentId] != MAX_U32);
+
+	if(m_idParents[id] != parentId)
+	{
+		m_idParents[id] = parentId;
+		m_sorted = false;
+		markDirty(getIndex(id));
+	}
+}
+
+Bool TransformHierarchy::computeWorldTransform(U32 idx, U32 parentIdx, Timestamp timestamp)
+{
+	const U8 flags = m_flags[idx];
+	const Bool ignoreParent = parentIdx == NO_PARENT || (flags & U8(TransformHierarchyFlag::IGNORE_PARENT_TRANSFORM));
+	const Bool parentUpdated = !ignoreParent && m_timestamps[parentIdx] == timestamp;
+	if(!(flags & DIRTY) && !parentUpdated)
+	{
+		return false;
+	}
+
+	// Keep the previous only once per timestamp
+	if(m_timestamps[idx] != timestamp)
+	{
+		m_prevWorlds[idx] = m_worlds[idx];
+	}
+
+	if(ignoreParent)
+	{
+		m_worlds[idx] = m_locals[idx];
+	}
+	else if(flags & U8(TransformHierarchyFlag::IGNORE_LOCAL_TRANSFORM))
+	{
+		m_worlds[idx] = m_worlds[parentIdx];
+	}
+	else
+	{
+		m_worlds[idx] = m_worlds[parentIdx].combineTransformations(m_locals[idx]);
+	}
+
+	m_flags[idx] = U8(flags & ~DIRTY);
+	m_timestamps[idx] = timestamp;
+	return true;
+}
+
+void TransformHierarchy::updateWorldTransform(U32 id, Timestamp timestamp)
+{
+	const U32 parentId = m_idParents[id];
+	const U32 parentIdx = (parentId != NO_PARENT) ? m_indices[parentId] : U32(NO_PARENT);
+	m_flags[getIndex(id)] |= DIRTY;
+	computeWorldTransform(getIndex(id), parentIdx, timestamp);
+}
+
+void TransformHierarchy::sort()
+{
+	DynamicArrayAuto<U32> depths(m_alloc);
+	depths.create(m_indices.getSize(), MAX_U32);
+	DynamicArrayAuto<U32> stack(m_alloc);
+	U32 levelCount = 0;
+
+	// Compute the depths. Walk up to the first ancestor with known depth and then set the depths of the path
+	for(U32 id = 0; id < m_indices.getSize(); ++id)
+	{
+		if(m_indices[id] == MAX_U32 || depths[id] != MAX_U32)
+		{
+			continue;
+		}
+
+		U32 crnt = id;
+		U32 depth;
+		while(true)
+		{
+			if(depths[crnt] != MAX_U32)
+			{
+				depth = depths[crnt];
+				break;
+			}
+
+			const U32 parent = m_idParents[crnt];
+			if(parent == NO_PARENT || m_indices[parent] == MAX_U32)
+			{
+				depth = 0;
+				depths[crnt] = 0;
+				break;
+			}
+
+			stack.emplaceBack(crnt);
+			crnt = parent;
+		}
+
+		levelCount = max(levelCount, depth + 1);
+		while(stack.getSize() > 0)
+		{
+			depths[stack.getBack()] = ++depth;
+			levelCount = max(levelCount, depth + 1);
+			stack.resize(stack.getSize() - 1);
+		}
+	}
+
+	// Counting sort by depth
+	m_levelOffsets.destroy(m_alloc);
+	m_levelOffsets.create(m_alloc, levelCount + 1, 0);
+	for(U32 id = 0; id < m_indices.getSize(); ++id)
+	{
+		if(m_indices[id] != MAX_U32)
+		{
+			++m_levelOffsets[depths[id] + 1];
+		}
+	}
+
+	for(U32 l = 1; l < m_levelOffsets.getSize(); ++l)
+	{
+		m_levelOffsets[l] += m_levelOffsets[l - 1];
+	}
+	ANKI_ASSERT(m_levelOffsets.getBack() == m_transformCount);
+
+	DynamicArrayAuto<U32> newToOld(m_alloc);
+	newToOld.create(m_transformCount);
+	DynamicArrayAuto<U32> levelCursors(m_alloc);
+	levelCursors.create(levelCount);
+	for(U32 l = 0; l < levelCount; ++l)
+	{
+		levelCursors[l] = m_levelOffsets[l];
+	}
+
+	// Keep the old order inside the levels
+	for(U32 oldIdx = 0; oldIdx < m_ids.getSize(); ++oldIdx)
+	{
+		if(!(m_flags[oldIdx] & DELETED))
+		{
+			newToOld[levelCursors[depths[m_ids[oldIdx]]]++] = oldIdx;
+		}
+	}
+
+	reorderArray(m_alloc, m_locals, newToOld);
+	reorderArray(m_alloc, m_worlds, newToOld);
+	reorderArray(m_alloc, m_prevWorlds, newToOld);
+	reorderArray(m_alloc, m_timestamps, newToOld);
+	reorderArray(m_alloc, m_flags, newToOld);
+	reorderArray(m_alloc, m_ids, newToOld);
+	reorderArray(m_alloc, m_userData, newToOld);
+
+	// Fix the indices
+	for(U32 idx = 0; idx < m_ids.getSize(); ++idx)
+	{
+		m_indices[m_ids[idx]] = idx;
+	}
+
+	m_parents.destroy(m_alloc);
+	if(m_transformCount > 0)
+	{
+		m_parents.create(m_alloc, m_transformCount);
+	}
+
+	for(U32 idx = 0; idx < m_ids.getSize(); ++idx)
+	{
+		const U32 parentId = m_idParents[m_ids[idx]];
+		m_parents[idx] = (parentId != NO_PARENT && m_indices[parentId] != MAX_U32) ? m_indices[parentId] : NO_PARENT;
+		ANKI_ASSERT(m_parents[idx] == NO_PARENT || m_parents[idx] < idx);
+	}
+
+	// Find the children. Count them, make the counts offsets and then fill them
+	m_childOffsets.destroy(m_alloc);
+	m_childOffsets.create(m_alloc, m_transformCount + 1, 0);
+	U32 childCount = 0;
+	for(U32 idx = 0; idx < m_transformCount; ++idx)
+	{
+		if(m_parents[idx] != NO_PARENT)
+		{
+			++m_childOffsets[m_parents[idx] + 1];
+			++childCount;
+		}
+	}
+
+	for(U32 idx = 1; idx < m_childOffsets.getSize(); ++idx)
+	{
+		m_childOffsets[idx] += m_childOffsets[idx - 1];
+	}
+
+	m_children.destroy(m_alloc);
+	if(childCount > 0)
+	{
+		m_children.create(m_alloc, childCount);
+		DynamicArrayAuto<U32> childCursors(m_alloc);
+		childCursors.create(m_transformCount);
+		for(U32 idx = 0; idx < m_transformCount; ++idx)
+		{
+			childCursors[idx] = m_childOffsets[idx];
+		}
+
+		for(U32 idx = 0; idx < m_transformCount; ++idx)
+		{
+			if(m_parents[idx] != NO_PARENT)
+			{
+				m_children[childCursors[m_parents[idx]]++] = idx;
+			}
+		}
+	}
+
+	m_visitIndices.destroy(m_alloc);
+	if(m_transformCount > 0)
+	{
+		m_visitIndices.create(m_alloc, m_transformCount);
+	}
+
+	m_sorted = true;
+}
+
+void TransformHierarchy::update(
+	ThreadPool* threadPool, Timestamp timestamp, TransformHierarchyUpdatedCallback callback, void* callbackUserData)
+{
+	ANKI_ASSERT(timestamp > 0);
+	if(m_dirtyIds.getSize() == 0)
+	{
+		return;
+	}
+
+	if(!m_sorted)
+	{
+		sort();
+	}
+
+	// The dirty transforms are the roots of the subtrees that will be visited. The indices are sorted by depth so
+	// sorting the roots by index puts them in level order
+	DynamicArrayAuto<U32> roots(m_alloc);
+	roots.create(m_dirtyIds.getSize());
+	U32 rootCount = 0;
+	for(U32 id : m_dirtyIds)
+	{
+		const U32 idx = m_indices[id];
+		if(idx != MAX_U32 && !(m_flags[idx] & QUEUED))
+		{
+			m_flags[idx] |= QUEUED;
+			roots[rootCount++] = idx;
+		}
+	}
+	m_dirtyIds.destroy(m_alloc);
+	std::sort(roots.getBegin(), roots.getBegin() + rootCount);
+
+	// Every level depends on the previous so the levels are processed in order. A level visits its roots and the
+	// children of the transforms of the previous level that got a new world transform
+	U32 rootIdx = 0;
+	U32 prevCount = 0;
+	Bool prevWhole = false;
+	for(U32 l = 0; l < getLevelCount(); ++l)
+	{
+		const U32 begin = m_levelOffsets[l];
+		const U32 end = m_levelOffsets[l + 1];
+		const U32 prevBegin = (l > 0) ? m_levelOffsets[l - 1] : 0;
+
+		U32 rootEnd = rootIdx;
+		while(rootEnd < rootCount && roots[rootEnd] < end)
+		{
+			++rootEnd;
+		}
+
+		U32 candidateCount = rootEnd - rootIdx;
+		for(U32 i = 0; i < prevCount; ++i)
+		{
+			const U32 idx = (prevWhole) ? prevBegin + i : m_visitIndices[prevBegin + i];
+			if(m_timestamps[idx] == timestamp)
+			{
+				candidateCount += m_childOffsets[idx + 1] - m_childOffsets[idx];
+			}
+		}
+
+		// If most of the level will be visited visit all of it. It's cheaper than gathering the transforms
+		const Bool whole = candidateCount * 2 >= end - begin;
+		U32 count = 0;
+		if(whole)
+		{
+			count = end - begin;
+		}
+		else
+		{
+			for(U32 r = rootIdx; r < rootEnd; ++r)
+			{
+				m_visitIndices[begin + count++] = roots[r];
+			}
+
+			for(U32 i = 0; i < prevCount; ++i)
+			{
+				const U32 idx = (prevWhole) ? prevBegin + i : m_visitIndices[prevBegin + i];
+				if(m_timestamps[idx] != timestamp)
+				{
+					continue;
+				}
+
+				for(U32 c = m_childOffsets[idx]; c < m_childOffsets[idx + 1]; ++c)
+				{
+					const U32 child = m_children[c];
+					if(!(m_flags[child] & QUEUED))
+					{
+						m_flags[child] |= QUEUED;
+						m_visitIndices[begin + count++] = child;
+					}
+				}
+			}
+		}
+		rootIdx = rootEnd;
+
+		auto updateRange = [&](U32 first, U32 last) {
+			for(U32 i = first; i < last; ++i)
+			{
+				const U32 idx = (whole) ? begin + i : m_visitIndices[begin + i];
+				m_flags[idx] = U8(m_flags[idx] & ~QUEUED);
+				if(computeWorldTransform(idx, m_parents[idx], timestamp) && callback)
+				{
+					callback(callbackUserData, m_userData[idx]);
+				}
+			}
+		};
+
+		if(threadPool == nullptr || count < LEVEL_GRAIN_SIZE * 2)
+		{
+			updateRange(0, count);
+		}
+		else
+		{
+			const Error err =
+				threadPool->parallelFor(count, LEVEL_GRAIN_SIZE, [&](U32, PtrSize start, PtrSize stop) -> Error {
+					updateRange(U32(start), U32(stop));
+					return Error::NONE;
+				});
+			(void)err;
+		}
+
+		prevCount = count;
+		prevWhole = whole;
+	}
+
+	ANKI_ASSERT(rootIdx == rootCount);
+}
+
+} // end namespace anki
@@ -0,0 +1,208 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/scene/Common.h>
+#include <anki/Math.h>
+#include <anki/util/DynamicArray.h>
+#include <anki/util/Enum.h>
+#include <anki/util/Thread.h>
+
+namespace anki
+{
+
+// Forward
+class ThreadPool;
+
+/// @addtogroup scene
+/// @{
+
+enum class TransformHierarchyFlag : U8
+{
+	NONE = 0,
+
+	/// The world transform is the parent's world transform.
+	IGNORE_LOCAL_TRANSFORM = 1 << 0,
+
+	/// The world transform is the local transform.
+	IGNORE_PARENT_TRANSFORM = 1 << 1
+};
+ANKI_ENUM_ALLOW_NUMERIC_OPERATIONS(TransformHierarchyFlag, inline)
+
+/// Called for every transform that got a new world transform.
+using TransformHierarchyUpdatedCallback = void (*)(void* userData, void* transformUserData);
+
+/// The local and world transforms of a hierarchy. The transforms are kept in flat arrays that are sorted by the depth
+/// in the hierarchy so the world transforms are computed level by level and the transforms of a level in parallel.
+/// The transforms are accessed by IDs that don't change when the arrays are sorted. The getters return copies because
+/// the arrays move when transforms are created or sorted.
+class TransformHierarchy : public NonCopyable
+{
+public:
+	static const U32 NO_PARENT = MAX_U32;
+
+	TransformHierarchy(SceneAllocator<U8> alloc)
+		: m_alloc(alloc)
+	{
+	}
+
+	~TransformHierarchy();
+
+	/// Create a transform with identity local transform and no parent.
+	/// @param flags How the world transform is computed.
+	/// @param userData The value that is passed to the TransformHierarchyUpdatedCallback.
+	/// @return The ID of the new transform.
+	U32 newTransform(TransformHierarchyFlag flags, void* userData);
+
+	/// Delete a transform. The children should get a new parent before the next update().
+	void deleteTransform(U32 id);
+
+	/// Set the parent. Use NO_PARENT to remove it.
+	void setParent(U32 id, U32 parentId);
+
+	U32 getParent(U32 id) const
+	{
+		return m_idParents[id];
+	}
+
+	/// Set the local transform. The world transform will be computed in the next update().
+	/// @note It's thread-safe for different IDs.
+	void setLocalTransform(U32 id, const Transform& trf)
+	{
+		const U32 idx = getIndex(id);
+		m_locals[idx] = trf;
+		markDirty(idx);
+	}
+
+	Transform getLocalTransform(U32 id) const
+	{
+		return m_locals[getIndex(id)];
+	}
+
+	Transform getWorldTransform(U32 id) const
+	{
+		return m_worlds[getIndex(id)];
+	}
+
+	/// The world transform before the last change.
+	Transform getPreviousWorldTransform(U32 id) const
+	{
+		return m_prevWorlds[getIndex(id)];
+	}
+
+	/// Make the previous world transform the same as the world transform.
+	void resetPreviousWorldTransform(U32 id)
+	{
+		const U32 idx = getIndex(id);
+		m_prevWorlds[idx] = m_worlds[idx];
+	}
+
+	/// The timestamp of the last change of the world transform.
+	Timestamp getWorldTransformTimestamp(U32 id) const
+	{
+		return m_timestamps[getIndex(id)];
+	}
+
+	/// Return true if the local transform changed after the last update of the world transform.
+	Bool isDirty(U32 id) const
+	{
+		return (m_flags[getIndex(id)] & DIRTY) != 0;
+	}
+
+	/// Compute the world transform of a single transform. Use it for changes after update(). The world transform of the
+	/// parent should be up to date and the children are not updated.
+	void updateWorldTransform(U32 id, Timestamp timestamp);
+
+	/// Compute the world transforms of the dirty transforms and the transforms below them. Only the subtrees of the
+	/// dirty transforms are visited.
+	/// @param threadPool If it's not nullptr the levels with many transforms are split between its threads.
+	/// @param timestamp The timestamp of the new world transforms.
+	/// @param callback Called for the new world transforms. It's called from many threads. Can be nullptr.
+	/// @param callbackUserData Passed to the callback.
+	void update(ThreadPool* threadPool,
+		Timestamp timestamp,
+		TransformHierarchyUpdatedCallback callback = nullptr,
+		void* callbackUserData = nullptr);
+
+	U32 getTransformCount() const
+	{
+		return m_transformCount;
+	}
+
+	/// The number of levels after the last update().
+	U32 getLevelCount() const
+	{
+		return (m_levelOffsets.getSize() > 0) ? U32(m_levelOffsets.getSize() - 1) : 0;
+	}
+
+private:
+	static const U32 LEVEL_GRAIN_SIZE = 256;
+
+	/// The internal flags that share m_flags with the TransformHierarchyFlag.
+	static const U8 QUEUED = 1 << 5; ///< It's already in the list of the transforms that update() will visit.
+	static const U8 DIRTY = 1 << 6;
+	static const U8 DELETED = 1 << 7;
+
+	SceneAllocator<U8> m_alloc;
+
+	/// @name The transforms sorted by their depth. They may have holes of deleted transforms until they are sorted
+	/// @{
+	DynamicArray<Transform> m_locals;
+	DynamicArray<Transform> m_worlds;
+	DynamicArray<Transform> m_prevWorlds;
+	DynamicArray<Timestamp> m_timestamps;
+	DynamicArray<U32> m_parents; ///< The index of the parent.
+	DynamicArray<U8> m_flags;
+	DynamicArray<U32> m_ids;
+	DynamicArray<void*> m_userData;
+	/// @}
+
+	/// @name By ID
+	/// @{
+	DynamicArray<U32> m_indices; ///< The index in the sorted arrays. MAX_U32 if the ID is free.
+	DynamicArray<U32> m_idParents;
+	DynamicArray<U32> m_freeIds;
+	/// @}
+
+	DynamicArray<U32> m_levelOffsets; ///< The first index of every level and one past the last.
+	DynamicArray<U32> m_childOffsets; ///< The first child of every index in m_children and one past the last.
+	DynamicArray<U32> m_children; ///< The indices of the children of every transform.
+
+	/// The transforms that update() visits in every level. The ones of a level are in the range of the level.
+	DynamicArray<U32> m_visitIndices;
+	U32 m_transformCount = 0;
+	Bool8 m_sorted = true;
+
+	DynamicArray<U32> m_dirtyIds; ///< The IDs of the transforms that got dirty after the last update().
+	SpinLock m_dirtyIdsLock;
+
+	U32 getIndex(U32 id) const
+	{
+		ANKI_ASSERT(id < m_indices.getSize() && m_indices[id] != MAX_U32);
+		return m_indices[id];
+	}
+
+	/// Set the DIRTY flag and keep the ID for the next update(). It's thread-safe for different indices.
+	void markDirty(U32 idx)
+	{
+		if(!(m_flags[idx] & DIRTY))
+		{
+			m_flags[idx] |= DIRTY;
+			LockGuard<SpinLock> lock(m_dirtyIdsLock);
+			m_dirtyIds.emplaceBack(m_alloc, m_ids[idx]);
+		}
+	}
+
+	/// Compute the world transform if the transform is dirty or the parent got a new world transform.
+	/// @return True if the world transform changed.
+	Bool computeWorldTransform(U32 idx, U32 parentIdx, Timestamp timestamp);
+
+	/// Sort the transforms by depth, remove the holes and find the children of every transform.
+	void sort();
+};
+/// @}
+
+} // end namespace anki
@@ -5,6 +5,7 @@
 
 #include <anki/scene/VisibilityInternal.h>
 #include <anki/scene/SceneGraph.h>
+#include <anki/scene/Bvh.h>
 #include <anki/scene/components/FrustumComponent.h>
 #include <anki/scene/components/LensFlareComponent.h>
 #include <anki/scene/components/RenderComponent.h>
@@ -22,7 +23,8 @@
 namespace anki
 {
 
-void VisibilityContext::submitNewWork(const FrustumComponent& frc, RenderQueue& rqueue, ThreadHive& hive)
+void VisibilityContext::submitNewWork(
+	const FrustumComponent& frc, RenderQueue& rqueue, ThreadHive& hive, ThreadHiveTaskPriority priority)
 {
 	ANKI_TRACE_SCOPED_EVENT(SCENE_VIS_SUBMIT_WORK);
 
@@ -63,6 +65,7 @@ void VisibilityContext::submitNewWork(const FrustumComponent& frc, RenderQueue&
 	FrustumVisibilityContext* frcCtx = alloc.newInstance<FrustumVisibilityContext>();
 	frcCtx->m_visCtx = this;
 	frcCtx->m_frc = &frc;
+	frcCtx->m_priority = priority;
 	frcCtx->m_queueViews.create(alloc, hive.getThreadCount());
 	frcCtx->m_visTestsSignalSem = hive.newSemaphore(1);
 	frcCtx->m_renderQueue = &rqueue;
@@ -79,6 +82,7 @@ void VisibilityContext::submitNewWork(const FrustumComponent& frc, RenderQueue&
 		fillDepthTask.m_callback = FillRasterizerWithCoverageTask::callback;
 		fillDepthTask.m_argument = alloc.newInstance<FillRasterizerWithCoverageTask>(frcCtx);
 		fillDepthTask.m_signalSemaphore = hive.newSemaphore(1);
+		fillDepthTask.m_priority = priority;
 
 		hive.submitTasks(&fillDepthTask, 1);
 
@@ -97,6 +101,7 @@ void VisibilityContext::submitNewWork(const FrustumComponent& frc, RenderQueue&
 	gatherTask.m_argument = alloc.newInstance<GatherVisiblesFromOctreeTask>(frcCtx);
 	gatherTask.m_signalSemaphore = nullptr; // No need to signal anything because it will spawn new tasks
 	gatherTask.m_waitSemaphore = prepareRasterizerSem;
+	gatherTask.m_priority = priority;
 
 	hive.submitTasks(&gatherTask, 1);
 
@@ -106,6 +111,7 @@ void VisibilityContext::submitNewWork(const FrustumComponent& frc, RenderQueue&
 	combineTask.m_argument = alloc.newInstance<CombineResultsTask>(frcCtx);
 	ANKI_ASSERT(frcCtx->m_visTestsSignalSem);
 	combineTask.m_waitSemaphore = frcCtx->m_visTestsSignalSem;
+	combineTask.m_priority = priority;
 
 	hive.submitTasks(&combineTask, 1);
 }
@@ -136,32 +142,45 @@ void GatherVisiblesFromOctreeTask::gather(ThreadHive& hive, ThreadHiveSemaphore&
 {
 	ANKI_TRACE_SCOPED_EVENT(SCENE_VIS_OCTREE);
 
-	U testIdx = m_frcCtx->m_visCtx->m_testsCount.fetchAdd(1);
+	auto newPlaceableFunc = [&](void* placeableUserData) {
+		ANKI_ASSERT(placeableUserData);
+		SpatialComponent* scomp = static_cast<SpatialComponent*>(placeableUserData);
 
-	// Walk the tree
-	m_frcCtx->m_visCtx->m_scene->getOctree().walkTree(testIdx,
-		[&](const Aabb& box) {
-			Bool visible = m_frcCtx->m_frc->insideFrustum(box);
-			if(visible && m_frcCtx->m_r)
-			{
-				visible = m_frcCtx->m_r->visibilityTest(box, box);
-			}
+		ANKI_ASSERT(m_spatialCount < m_spatials.getSize());
 
-			return visible;
-		},
-		[&](void* placeableUserData) {
-			ANKI_ASSERT(placeableUserData);
-			SpatialComponent* scomp = static_cast<SpatialComponent*>(placeableUserData);
+		m_spatials[m_spatialCount++] = scomp;
 
-			ANKI_ASSERT(m_spatialCount < m_spatials.getSize());
+		if(m_spatialCount == m_spatials.getSize())
+		{
+			flush(hive, sem);
+		}
+	};
 
-			m_spatials[m_spatialCount++] = scomp;
+	SceneGraph& scene = *m_frcCtx->m_visCtx->m_scene;
+	if(scene.getUsingBvh())
+	{
+		// The BVH tests the frustum itself
+		scene.getBvh().walkTree(m_frcCtx->m_frc->getFrustum(),
+			[&](const Aabb& box) { return m_frcCtx->m_r == nullptr || m_frcCtx->m_r->visibilityTest(box, box); },
+			newPlaceableFunc);
+	}
+	else
+	{
+		OctreeVisitedSet visited(scene.getFrameAllocator(), scene.getOctree());
 
-			if(m_spatialCount == m_spatials.getSize())
-			{
-				flush(hive, sem);
-			}
-		});
+		// Walk the tree
+		scene.getOctree().walkTree(visited,
+			[&](const Aabb& box) {
+				Bool visible = m_frcCtx->m_frc->insideFrustum(box);
+				if(visible && m_frcCtx->m_r)
+				{
+					visible = m_frcCtx->m_r->visibilityTest(box, box);
+				}
+
+				return visible;
+			},
+			newPlaceableFunc);
+	}
 
 	// Flush the remaining
 	flush(hive, sem);
@@ -171,6 +190,7 @@ void GatherVisiblesFromOctreeTask::gather(ThreadHive& hive, ThreadHiveSemaphore&
 	task.m_callback = dummyCallback;
 	task.m_argument = nullptr;
 	task.m_signalSemaphore = m_frcCtx->m_visTestsSignalSem;
+	task.m_priority = m_frcCtx->m_priority;
 	hive.submitTasks(&task, 1);
 }
 
@@ -192,6 +212,7 @@ void GatherVisiblesFromOctreeTask::flush(ThreadHive& hive, ThreadHiveSemaphore&
 		task.m_callback = VisibilityTestTask::callback;
 		task.m_argument = vis;
 		task.m_signalSemaphore = m_frcCtx->m_visTestsSignalSem;
+		task.m_priority = m_frcCtx->m_priority;
 		hive.submitTasks(&task, 1);
 
 		// Clear count
@@ -471,12 +492,12 @@ void VisibilityTestTask::test(ThreadHive& hive, U32 taskId)
 			decalc->setupDecalQueueElement(*el);
 		}
 
-		// Add more frustums to the list
+		// Add more frustums to the list. They are not on the critical path of the main camera
 		if(nextQueues.getSize() > 0)
 		{
 			count = 0;
 			err = node.iterateComponentsOfType<FrustumComponent>([&](FrustumComponent& frc) {
-				m_frcCtx->m_visCtx->submitNewWork(frc, nextQueues[count++], hive);
+				m_frcCtx->m_visCtx->submitNewWork(frc, nextQueues[count++], hive, ThreadHiveTaskPriority::NORMAL);
 				return Error::NONE;
 			});
 			(void)err;
@@ -682,7 +703,7 @@ void SceneGraph::doVisibilityTests(SceneNode& fsn, SceneGraph& scene, RenderQueu
 	VisibilityContext ctx;
 	ctx.m_scene = &scene;
 	ctx.m_earlyZDist = scene.getEarlyZDistance();
-	ctx.submitNewWork(fsn.getComponent<FrustumComponent>(), rqueue, hive);
+	ctx.submitNewWork(fsn.getComponent<FrustumComponent>(), rqueue, hive, ThreadHiveTaskPriority::CRITICAL);
 
 	hive.waitAllTasks();
 	ctx.m_testedFrcs.destroy(scene.getFrameAllocator());
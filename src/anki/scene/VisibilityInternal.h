@@ -10,6 +10,7 @@
 #include <anki/scene/components/FrustumComponent.h>
 #include <anki/scene/Octree.h>
 #include <anki/util/Thread.h>
+#include <anki/util/ThreadHive.h>
 #include <anki/core/Trace.h>
 #include <anki/renderer/RenderQueue.h>
 
@@ -124,14 +125,15 @@ class VisibilityContext
 {
 public:
 	SceneGraph* m_scene = nullptr;
-	Atomic<U32> m_testsCount = {0};
 
 	F32 m_earlyZDist = -1.0f; ///< Cache this.
 
 	List<const FrustumComponent*> m_testedFrcs;
 	Mutex m_mtx;
 
-	void submitNewWork(const FrustumComponent& frc, RenderQueue& result, ThreadHive& hive);
+	/// @param priority The priority of all the tasks that will test the frustum.
+	void submitNewWork(
+		const FrustumComponent& frc, RenderQueue& result, ThreadHive& hive, ThreadHiveTaskPriority priority);
 };
 
 /// A context for a specific test of a frustum component.
@@ -141,6 +143,7 @@ class FrustumVisibilityContext
 public:
 	VisibilityContext* m_visCtx = nullptr;
 	const FrustumComponent* m_frc = nullptr;
+	ThreadHiveTaskPriority m_priority = ThreadHiveTaskPriority::NORMAL;
 
 	// S/W rasterizer members
 	SoftwareRasterizer* m_r = nullptr;
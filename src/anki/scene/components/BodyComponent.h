@@ -19,6 +19,7 @@ class BodyComponent : public SceneComponent
 {
 public:
 	static const SceneComponentType CLASS_TYPE = SceneComponentType::BODY;
+	static const Bool UPDATE_EVERY_FRAME = true;
 
 	BodyComponent(SceneNode* node, PhysicsBodyPtr body)
 		: SceneComponent(CLASS_TYPE, node)
@@ -44,6 +44,7 @@ public:
 	{
 		m_sizes = Vec3(width, height, depth);
 		m_markedForUpdate = true;
+		markNodeForUpdate();
 	}
 
 	F32 getWidth() const
@@ -71,6 +72,7 @@ public:
 		ANKI_ASSERT(trf.getScale() == 1.0f);
 		m_trf = trf;
 		m_markedForUpdate = true;
+		markNodeForUpdate();
 	}
 
 	/// Implements SceneComponent::update.
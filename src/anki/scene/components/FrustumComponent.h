@@ -94,12 +94,14 @@ public:
 	void markShapeForUpdate()
 	{
 		m_flags.set(SHAPE_MARKED_FOR_UPDATE);
+		markNodeForUpdate();
 	}
 
 	/// Call when the transformation of the frustum got changed.
 	void markTransformForUpdate()
 	{
 		m_flags.set(TRANSFORM_MARKED_FOR_UPDATE);
+		markNodeForUpdate();
 	}
 
 	/// Is a spatial inside the frustum?
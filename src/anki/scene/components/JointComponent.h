@@ -19,6 +19,7 @@ class JointComponent : public SceneComponent
 {
 public:
 	static const SceneComponentType CLASS_TYPE = SceneComponentType::JOINT;
+	static const Bool UPDATE_EVERY_FRAME = true;
 
 	JointComponent(SceneNode* node)
 		: SceneComponent(SceneComponentType::JOINT, node)
@@ -43,6 +43,7 @@ public:
 	{
 		m_trf = trf;
 		m_flags.set(TRF_DIRTY);
+		markNodeForUpdate();
 	}
 
 	const Vec4& getDiffuseColor() const
@@ -59,6 +60,7 @@ public:
 	{
 		m_radius = x;
 		m_flags.set(DIRTY);
+		markNodeForUpdate();
 	}
 
 	F32 getRadius() const
@@ -70,6 +72,7 @@ public:
 	{
 		m_distance = x;
 		m_flags.set(DIRTY);
+		markNodeForUpdate();
 	}
 
 	F32 getDistance() const
@@ -82,6 +85,7 @@ public:
 		m_innerAngleCos = cos(ang / 2.0);
 		m_innerAngle = ang;
 		m_flags.set(DIRTY);
+		markNodeForUpdate();
 	}
 
 	F32 getInnerAngleCos() const
@@ -99,6 +103,7 @@ public:
 		m_outerAngleCos = cos(ang / 2.0);
 		m_outerAngle = ang;
 		m_flags.set(DIRTY);
+		markNodeForUpdate();
 	}
 
 	F32 getOuterAngle() const
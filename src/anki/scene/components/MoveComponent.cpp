@@ -5,88 +5,114 @@
 
 #include <anki/scene/components/MoveComponent.h>
 #include <anki/scene/SceneNode.h>
+#include <anki/scene/SceneGraph.h>
 
 namespace anki
 {
 
 MoveComponent::MoveComponent(SceneNode* node, MoveComponentFlag flags)
 	: SceneComponent(CLASS_TYPE, node)
-	, m_flags(flags)
 {
+	TransformHierarchyFlag trfFlags = TransformHierarchyFlag::NONE;
+	if(!!(flags & MoveComponentFlag::IGNORE_LOCAL_TRANSFORM))
+	{
+		trfFlags |= TransformHierarchyFlag::IGNORE_LOCAL_TRANSFORM;
+	}
+
+	if(!!(flags & MoveComponentFlag::IGNORE_PARENT_TRANSFORM))
+	{
+		trfFlags |= TransformHierarchyFlag::IGNORE_PARENT_TRANSFORM;
+	}
+
+	TransformHierarchy& trfs = getTransformHierarchy();
+	m_transformId = trfs.newTransform(trfFlags, this);
+	trfs.setParent(m_transformId, getParentTransformId());
+
+	// The children that already exist become children of this. This is not in the node's components yet
+	Error err = node->visitChildrenMaxDepth(1, [&](SceneNode& childNode) -> Error {
+		return childNode.iterateComponentsOfType<MoveComponent>([&](MoveComponent& mov) -> Error {
+			trfs.setParent(mov.m_transformId, m_transformId);
+			mov.markNodeForUpdate();
+			return Error::NONE;
+		});
+	});
+	(void)err;
+
 	markForUpdate();
 }
 
 MoveComponent::~MoveComponent()
 {
+	// Detach the children's transforms. The node is going away so they will follow
+	TransformHierarchy& trfs = getTransformHierarchy();
+	Error err = m_node->visitChildrenMaxDepth(1, [&](SceneNode& childNode) -> Error {
+		return childNode.iterateComponentsOfType<MoveComponent>([&](MoveComponent& mov) -> Error {
+			if(trfs.getParent(mov.m_transformId) == m_transformId)
+			{
+				trfs.setParent(mov.m_transformId, TransformHierarchy::NO_PARENT);
+			}
+			return Error::NONE;
+		});
+	});
+	(void)err;
+
+	trfs.deleteTransform(m_transformId);
 }
 
-Error MoveComponent::update(Second, Second, Bool& updated)
+TransformHierarchy& MoveComponent::getTransformHierarchy()
 {
-	updated = updateWorldTransform(*m_node);
-	return Error::NONE;
+	return m_node->getSceneGraph().getTransformHierarchy();
 }
 
-Bool MoveComponent::updateWorldTransform(SceneNode& node)
+const TransformHierarchy& MoveComponent::getTransformHierarchy() const
 {
-	m_prevWTrf = m_wtrf;
-	const Bool dirty = m_flags.get(MoveComponentFlag::MARKED_FOR_UPDATE);
-
-	// If dirty then update world transform
-	if(dirty)
-	{
-		const SceneNode* parent = node.getParent();
+	return m_node->getSceneGraph().getTransformHierarchy();
+}
 
-		if(parent)
-		{
-			const MoveComponent* parentMove = parent->tryGetComponent<MoveComponent>();
+U32 MoveComponent::getParentTransformId() const
+{
+	const SceneNode* parent = m_node->getParent();
+	const MoveComponent* parentMove = (parent) ? parent->tryGetComponent<MoveComponent>() : nullptr;
+	return (parentMove) ? parentMove->m_transformId : U32(TransformHierarchy::NO_PARENT);
+}
 
-			if(parentMove == nullptr)
-			{
-				// Parent not movable
-				m_wtrf = m_ltrf;
-			}
-			else if(m_flags.get(MoveComponentFlag::IGNORE_PARENT_TRANSFORM))
-			{
-				m_wtrf = m_ltrf;
-			}
-			else if(m_flags.get(MoveComponentFlag::IGNORE_LOCAL_TRANSFORM))
-			{
-				m_wtrf = parentMove->getWorldTransform();
-			}
-			else
-			{
-				m_wtrf = parentMove->getWorldTransform().combineTransformations(m_ltrf);
-			}
-		}
-		else
-		{
-			// No parent
+void MoveComponent::onNodeParentChanged()
+{
+	getTransformHierarchy().setParent(m_transformId, getParentTransformId());
+	markNodeForUpdate();
+}
 
-			m_wtrf = m_ltrf;
-		}
+Error MoveComponent::update(Second, Second, Bool& updated)
+{
+	TransformHierarchy& trfs = getTransformHierarchy();
+	const Timestamp timestamp = m_node->getGlobalTimestamp();
 
-		// Now it's a good time to cleanse parent
-		m_flags.unset(MoveComponentFlag::MARKED_FOR_UPDATE);
+	// The local transform changed after the SceneGraph computed the world transforms. The parent was updated before
+	// this node so compute it here and pass the change to the children
+	if(trfs.isDirty(m_transformId))
+	{
+		trfs.updateWorldTransform(m_transformId, timestamp);
+		markChildrenForUpdate();
 	}
 
-	// If this is dirty then make children dirty as well. Don't walk the whole tree because you will re-walk it later
-	if(dirty)
+	updated = trfs.getWorldTransformTimestamp(m_transformId) == timestamp;
+	if(!updated)
 	{
-		Error err = node.visitChildrenMaxDepth(1, [](SceneNode& childNode) -> Error {
-			Error e = childNode.iterateComponentsOfType<MoveComponent>([](MoveComponent& mov) -> Error {
-				mov.markForUpdate();
-				return Error::NONE;
-			});
+		trfs.resetPreviousWorldTransform(m_transformId);
+	}
 
-			(void)e;
+	return Error::NONE;
+}
 
+void MoveComponent::markChildrenForUpdate()
+{
+	Error err = m_node->visitChildrenMaxDepth(1, [](SceneNode& childNode) -> Error {
+		return childNode.iterateComponentsOfType<MoveComponent>([](MoveComponent& mov) -> Error {
+			mov.markForUpdate();
 			return Error::NONE;
 		});
-
-		(void)err;
-	}
-
-	return dirty;
+	});
+	(void)err;
 }
 
 } // end namespace anki
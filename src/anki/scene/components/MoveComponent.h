@@ -7,7 +7,7 @@
 
 #include <anki/scene/Common.h>
 #include <anki/scene/components/SceneComponent.h>
-#include <anki/util/BitMask.h>
+#include <anki/scene/TransformHierarchy.h>
 #include <anki/util/Enum.h>
 #include <anki/Math.h>
 
@@ -26,9 +26,6 @@ enum class MoveComponentFlag : U8
 
 	/// Ignore parent's transform
 	IGNORE_PARENT_TRANSFORM = 1 << 2,
-
-	/// If dirty then is marked for update
-	MARKED_FOR_UPDATE = 1 << 3,
 };
 ANKI_ENUM_ALLOW_NUMERIC_OPERATIONS(MoveComponentFlag, inline)
 
@@ -89,16 +86,19 @@ public:
 		return m_ltrf.getScale();
 	}
 
-	const Transform& getWorldTransform() const
+	Transform getWorldTransform() const
 	{
-		return m_wtrf;
+		return getTransformHierarchy().getWorldTransform(m_transformId);
 	}
 
-	const Transform& getPreviousWorldTransform() const
+	Transform getPreviousWorldTransform() const
 	{
-		return m_prevWTrf;
+		return getTransformHierarchy().getPreviousWorldTransform(m_transformId);
 	}
 
+	/// Called by the SceneNode when it gets a new parent.
+	void onNodeParentChanged();
+
 	/// Called when there is an update in the world transformation.
 	virtual ANKI_USE_RESULT Error onMoveComponentUpdate(SceneNode& node, Second prevTime, Second crntTime)
 	{
@@ -108,9 +108,8 @@ public:
 	/// @name SceneComponent overrides
 	/// @{
 
-	/// Update self and children world transform recursively, if root node. Need to call this at every frame.
-	/// @note Don't update if child because we start from roots and go to children and we don't want a child to be
-	///       updated before the parent
+	/// The world transforms are computed by the SceneGraph before the nodes are updated. This only computes the world
+	/// transform if the local changed later in the frame and it sets @a updated if the world transform changed.
 	ANKI_USE_RESULT Error update(Second, Second, Bool& updated) override;
 
 	ANKI_USE_RESULT Error onUpdate(Second prevTime, Second crntTime) final
@@ -165,21 +164,23 @@ private:
 	/// The transformation in local space
 	Transform m_ltrf = Transform::getIdentity();
 
-	/// The transformation in world space (local combined with parent's transformation)
-	Transform m_wtrf = Transform::getIdentity();
+	/// The world transforms live in the TransformHierarchy of the SceneGraph.
+	U32 m_transformId;
 
-	/// Keep the previous transformation for checking if it moved
-	Transform m_prevWTrf = Transform::getIdentity();
-
-	BitMask<MoveComponentFlag> m_flags;
+	TransformHierarchy& getTransformHierarchy();
+	const TransformHierarchy& getTransformHierarchy() const;
 
 	void markForUpdate()
 	{
-		m_flags.set(MoveComponentFlag::MARKED_FOR_UPDATE);
+		getTransformHierarchy().setLocalTransform(m_transformId, m_ltrf);
+		markNodeForUpdate();
 	}
 
-	/// Called every frame. It updates the @a m_wtrf if @a shouldUpdateWTrf is true. Then it moves to the children.
-	Bool updateWorldTransform(SceneNode& node);
+	/// Mark the MoveComponents of the children.
+	void markChildrenForUpdate();
+
+	/// The TransformHierarchy ID of the parent node's MoveComponent.
+	U32 getParentTransformId() const;
 };
 /// @}
 
@@ -19,6 +19,7 @@ class PlayerControllerComponent : public SceneComponent
 {
 public:
 	static const SceneComponentType CLASS_TYPE = SceneComponentType::PLAYER_CONTROLLER;
+	static const Bool UPDATE_EVERY_FRAME = true;
 
 	PlayerControllerComponent(SceneNode* node, PhysicsPlayerControllerPtr player)
 		: SceneComponent(CLASS_TYPE, node)
@@ -11,6 +11,7 @@ namespace anki
 void ReflectionProxyComponent::setQuad(U index, const Vec4& a, const Vec4& b, const Vec4& c, const Vec4& d)
 {
 	m_dirty = true;
+	markNodeForUpdate();
 
 	m_faces[index].m_vertices[0] = a;
 	m_faces[index].m_vertices[1] = b;
@@ -16,18 +16,10 @@ SceneComponent::SceneComponent(SceneComponentType type, SceneNode* node)
 	, m_uuid(node->getSceneGraph().getNewUuid())
 	, m_idx(node->getComponentCount())
 {
-	if(m_type != SceneComponentType::NONE)
-	{
-		m_node->getSceneGraph().getSceneComponentLists().insertNew(this);
-	}
 }
 
 SceneComponent::~SceneComponent()
 {
-	if(m_type != SceneComponentType::NONE)
-	{
-		m_node->getSceneGraph().getSceneComponentLists().remove(this);
-	}
 }
 
 Timestamp SceneComponent::getGlobalTimestamp() const
@@ -51,6 +43,11 @@ Error SceneComponent::updateReal(Second prevTime, Second crntTime, Bool& updated
 	return err;
 }
 
+void SceneComponent::markNodeForUpdate()
+{
+	m_node->markForUpdate();
+}
+
 SceneGraph& SceneComponent::getSceneGraph()
 {
 	return m_node->getSceneGraph();
@@ -71,18 +68,104 @@ SceneFrameAllocator<U8> SceneComponent::getFrameAllocator() const
 	return m_node->getFrameAllocator();
 }
 
-void SceneComponentLists::insertNew(SceneComponent* comp)
+void* SceneComponentPools::allocate(
+	SceneAllocator<U8> alloc, SceneComponentType type, PtrSize size, U8& sizeClassIdx, U32& slot)
 {
-	ANKI_ASSERT(comp);
+	Pool& pool = m_pools[type];
+	const PtrSize objectSize = getAlignedRoundUp(OBJECT_ALIGNMENT, max<PtrSize>(size, sizeof(FreeObject)));
+
+	// Find the size class
+	sizeClassIdx = MAX_U8;
+	for(U i = 0; i < pool.m_sizeClasses.getSize(); ++i)
+	{
+		if(pool.m_sizeClasses[i].m_objectSize == objectSize)
+		{
+			sizeClassIdx = U8(i);
+			break;
+		}
+	}
+
+	if(sizeClassIdx == MAX_U8)
+	{
+		ANKI_ASSERT(pool.m_sizeClasses.getSize() < MAX_U8);
+		sizeClassIdx = U8(pool.m_sizeClasses.getSize());
+		pool.m_sizeClasses.emplaceBack(alloc);
+		pool.m_sizeClasses.getBack().m_objectSize = objectSize;
+	}
 
-	m_lists[comp->getType()].pushBack(comp);
+	SizeClass& sizeClass = pool.m_sizeClasses[sizeClassIdx];
+
+	// Need a new chunk
+	if(sizeClass.m_freeList == nullptr)
+	{
+		const U32 chunkIdx = U32(sizeClass.m_chunks.getSize());
+		sizeClass.m_chunks.emplaceBack(alloc);
+		Chunk& chunk = sizeClass.m_chunks.getBack();
+		chunk.m_memory =
+			static_cast<U8*>(alloc.getMemoryPool().allocate(objectSize * OBJECTS_PER_CHUNK, OBJECT_ALIGNMENT));
+
+		// Push the objects in reverse so they are allocated in the order they are in memory
+		for(U32 i = OBJECTS_PER_CHUNK; i-- > 0;)
+		{
+			FreeObject* obj = reinterpret_cast<FreeObject*>(chunk.m_memory + i * objectSize);
+			obj->m_next = sizeClass.m_freeList;
+			obj->m_slot = chunkIdx * OBJECTS_PER_CHUNK + i;
+			sizeClass.m_freeList = obj;
+		}
+	}
+
+	FreeObject* out = sizeClass.m_freeList;
+	sizeClass.m_freeList = out->m_next;
+	slot = out->m_slot;
+
+	sizeClass.m_chunks[slot / OBJECTS_PER_CHUNK].m_liveMask |= U64(1) << (slot % OBJECTS_PER_CHUNK);
+	++pool.m_componentCount;
+	return out;
 }
 
-void SceneComponentLists::remove(SceneComponent* comp)
+void SceneComponentPools::deleteInstance(SceneAllocator<U8> alloc, SceneComponent* comp)
 {
+	(void)alloc;
 	ANKI_ASSERT(comp);
+	Pool& pool = m_pools[comp->getType()];
+	SizeClass& sizeClass = pool.m_sizeClasses[comp->m_sizeClass];
+	const U32 slot = comp->m_poolSlot;
+	Chunk& chunk = sizeClass.m_chunks[slot / OBJECTS_PER_CHUNK];
+	const U64 bit = U64(1) << (slot % OBJECTS_PER_CHUNK);
+	ANKI_ASSERT((chunk.m_liveMask & bit)
+				&& chunk.m_memory + (slot % OBJECTS_PER_CHUNK) * sizeClass.m_objectSize
+					   == reinterpret_cast<U8*>(comp));
+
+	chunk.m_liveMask &= ~bit;
+	ANKI_ASSERT(pool.m_componentCount > 0);
+	--pool.m_componentCount;
+
+	// Destroy and put it back to the free list
+	comp->~SceneComponent();
+	FreeObject* obj = reinterpret_cast<FreeObject*>(comp);
+	obj->m_next = sizeClass.m_freeList;
+	obj->m_slot = slot;
+	sizeClass.m_freeList = obj;
+}
 
-	m_lists[comp->getType()].erase(comp);
+void SceneComponentPools::destroy(SceneAllocator<U8> alloc)
+{
+	for(Pool& pool : m_pools)
+	{
+		ANKI_ASSERT(pool.m_componentCount == 0 && "Components are still alive");
+
+		for(SizeClass& sizeClass : pool.m_sizeClasses)
+		{
+			for(Chunk& chunk : sizeClass.m_chunks)
+			{
+				alloc.getMemoryPool().free(chunk.m_memory);
+			}
+
+			sizeClass.m_chunks.destroy(alloc);
+		}
+
+		pool.m_sizeClasses.destroy(alloc);
+	}
 }
 
 } // end namespace anki
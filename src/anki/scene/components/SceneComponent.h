@@ -9,6 +9,7 @@
 #include <anki/util/Functions.h>
 #include <anki/util/BitMask.h>
 #include <anki/util/List.h>
+#include <anki/util/DynamicArray.h>
 
 namespace anki
 {
@@ -42,9 +43,18 @@ enum class SceneComponentType : U16
 };
 
 /// Scene node component
-class SceneComponent : public IntrusiveListEnabled<SceneComponent>
+class SceneComponent
 {
+	friend class SceneComponentPools;
+
 public:
+	/// The type of the components that don't declare one.
+	static const SceneComponentType CLASS_TYPE = SceneComponentType::NONE;
+
+	/// If it's false the component is updated only when its node is marked for update. Components that poll things
+	/// (physics, scripts, animations) should set it to true.
+	static const Bool UPDATE_EVERY_FRAME = false;
+
 	/// Construct the scene component.
 	SceneComponent(SceneComponentType type, SceneNode* node);
 
@@ -114,43 +124,121 @@ protected:
 	SceneNode* m_node = nullptr;
 	Timestamp m_timestamp = 1; ///< Indicates when an update happened
 
+	/// Ask for the update of the node. Call it when the component needs an update.
+	void markNodeForUpdate();
+
 private:
 	SceneComponentType m_type;
+	U8 m_sizeClass = MAX_U8; ///< The size class in the SceneComponentPools.
 	U64 m_uuid;
 	U32 m_idx;
+	U32 m_poolSlot = MAX_U32; ///< The chunk and the position in the chunk in the SceneComponentPools.
 };
 
-/// Multiple lists of all types of components.
-class SceneComponentLists : public NonCopyable
+/// The storage of all the components. The components of each type are allocated from their own chunks so components of
+/// the same type are close in memory. Every chunk knows which of its objects are alive so the per type passes walk the
+/// chunks in place.
+/// @note Not thread-safe.
+class SceneComponentPools : public NonCopyable
 {
 anki_internal:
-	SceneComponentLists()
+	SceneComponentPools()
+	{
+	}
+
+	~SceneComponentPools()
 	{
 	}
 
-	~SceneComponentLists()
+	/// Allocate and construct a component.
+	template<typename TComponent, typename... TArgs>
+	TComponent* newInstance(SceneAllocator<U8> alloc, SceneNode* node, TArgs&&... args)
 	{
+		static_assert(alignof(TComponent) <= OBJECT_ALIGNMENT, "Wrong component alignment");
+
+		U8 sizeClass;
+		U32 slot;
+		void* mem = allocate(alloc, TComponent::CLASS_TYPE, sizeof(TComponent), sizeClass, slot);
+		TComponent* comp = ::new(mem) TComponent(node, std::forward<TArgs>(args)...);
+		ANKI_ASSERT(comp->getType() == TComponent::CLASS_TYPE && "The type doesn't match the pool");
+		ANKI_ASSERT(static_cast<SceneComponent*>(comp) == mem && "The SceneComponent should be the first base");
+		comp->m_sizeClass = sizeClass;
+		comp->m_poolSlot = slot;
+		return comp;
 	}
 
-	void insertNew(SceneComponent* comp);
+	/// Destroy and deallocate a component.
+	void deleteInstance(SceneAllocator<U8> alloc, SceneComponent* comp);
 
-	void remove(SceneComponent* comp);
+	/// Free the memory of the pools. All the components should have been deleted.
+	void destroy(SceneAllocator<U8> alloc);
 
+	/// Iterate the live components of a type. They are visited in the order they are in memory.
 	template<typename TSceneComponentType, typename Func>
 	void iterateComponents(Func func)
 	{
-		auto it = m_lists[TSceneComponentType::CLASS_TYPE].getBegin();
-		auto end = m_lists[TSceneComponentType::CLASS_TYPE].getEnd();
-
-		while(it != end)
+		Pool& pool = m_pools[TSceneComponentType::CLASS_TYPE];
+		for(SizeClass& sizeClass : pool.m_sizeClasses)
 		{
-			func(static_cast<TSceneComponentType&>(*it));
-			++it;
+			for(Chunk& chunk : sizeClass.m_chunks)
+			{
+				U64 mask = chunk.m_liveMask;
+				while(mask)
+				{
+					const U32 idx = getLeastSignificantBit(mask);
+					mask &= mask - 1;
+					U8* mem = chunk.m_memory + idx * sizeClass.m_objectSize;
+					func(static_cast<TSceneComponentType&>(*reinterpret_cast<SceneComponent*>(mem)));
+				}
+			}
 		}
 	}
 
+	U32 getComponentCount(SceneComponentType type) const
+	{
+		return m_pools[type].m_componentCount;
+	}
+
 private:
-	Array<IntrusiveList<SceneComponent>, U(SceneComponentType::COUNT)> m_lists;
+	static const U32 OBJECTS_PER_CHUNK = 64; ///< One bit of Chunk::m_liveMask for every object.
+	static const U32 OBJECT_ALIGNMENT = 16;
+
+	class Chunk
+	{
+	public:
+		U8* m_memory = nullptr;
+		U64 m_liveMask = 0; ///< The objects that are alive.
+	};
+
+	/// A free object. It's stored in the memory of the object.
+	class FreeObject
+	{
+	public:
+		FreeObject* m_next;
+		U32 m_slot;
+	};
+
+	/// The objects of a type that have the same size. Classes derived from the same component type may have different
+	/// sizes.
+	class SizeClass
+	{
+	public:
+		PtrSize m_objectSize = 0;
+		FreeObject* m_freeList = nullptr;
+		DynamicArray<Chunk> m_chunks;
+	};
+
+	class Pool
+	{
+	public:
+		DynamicArray<SizeClass> m_sizeClasses;
+		U32 m_componentCount = 0;
+	};
+
+	Array<Pool, U(SceneComponentType::COUNT)> m_pools;
+
+	/// Allocate the memory of an object and mark it alive. The object should be constructed right after.
+	void* allocate(SceneAllocator<U8> alloc, SceneComponentType type, PtrSize size, U8& sizeClass, U32& slot);
 };
 /// @}
 
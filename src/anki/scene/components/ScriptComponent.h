@@ -20,6 +20,7 @@ class ScriptComponent : public SceneComponent
 {
 public:
 	static const SceneComponentType CLASS_TYPE = SceneComponentType::SCRIPT;
+	static const Bool UPDATE_EVERY_FRAME = true;
 
 	ScriptComponent(SceneNode* node);
 
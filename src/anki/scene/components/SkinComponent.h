@@ -21,6 +21,7 @@ class SkinComponent : public SceneComponent
 {
 public:
 	static const SceneComponentType CLASS_TYPE = SceneComponentType::SKIN;
+	static const Bool UPDATE_EVERY_FRAME = true;
 	static const U MAX_ANIMATION_TRACKS = 2;
 
 	SkinComponent(SceneNode* node, SkeletonResourcePtr skeleton);
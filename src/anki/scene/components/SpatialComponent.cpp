@@ -17,11 +17,16 @@ SpatialComponent::SpatialComponent(SceneNode* node, const CollisionShape* shape)
 	ANKI_ASSERT(shape);
 	markForUpdate();
 	m_octreeInfo.m_userData = this;
+	m_bvhInfo.m_userData = this;
 }
 
 SpatialComponent::~SpatialComponent()
 {
-	if(m_placed)
+	if(m_placed && getSceneGraph().getUsingBvh())
+	{
+		getSceneGraph().getBvh().remove(m_bvhInfo);
+	}
+	else if(m_placed)
 	{
 		getSceneGraph().getOctree().remove(m_octreeInfo);
 	}
@@ -34,14 +39,34 @@ Error SpatialComponent::update(Second, Second, Bool& updated)
 	{
 		m_shape->computeAabb(m_aabb);
 		m_markedForUpdate = false;
+		if(!m_placementPending)
+		{
+			m_placementPending = true;
+			getSceneGraph().addSpatialToPlace(this);
+		}
+	}
 
-		getSceneGraph().getOctree().place(m_aabb, &m_octreeInfo);
-		m_placed = true;
+	return Error::NONE;
+}
+
+void SpatialComponent::updatePlacement()
+{
+	if(!m_placementPending)
+	{
+		return;
 	}
 
-	m_octreeInfo.reset();
+	if(getSceneGraph().getUsingBvh())
+	{
+		getSceneGraph().getBvh().place(m_aabb, &m_bvhInfo);
+	}
+	else
+	{
+		getSceneGraph().getOctree().place(m_aabb, &m_octreeInfo);
+	}
 
-	return Error::NONE;
+	m_placementPending = false;
+	m_placed = true;
 }
 
 } // end namespace anki
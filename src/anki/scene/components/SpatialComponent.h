@@ -7,6 +7,7 @@
 
 #include <anki/scene/components/SceneComponent.h>
 #include <anki/scene/Octree.h>
+#include <anki/scene/Bvh.h>
 #include <anki/Collision.h>
 #include <anki/util/BitMask.h>
 #include <anki/util/Enum.h>
@@ -69,8 +70,13 @@ public:
 	void markForUpdate()
 	{
 		m_markedForUpdate = true;
+		markNodeForUpdate();
 	}
 
+	/// Place it in the Octree or the Bvh if its volume changed in the last update. The SceneGraph calls it for the
+	/// components that changed after the nodes are updated.
+	void updatePlacement();
+
 	/// @name SceneComponent overrides
 	/// @{
 	ANKI_USE_RESULT Error update(Second, Second, Bool& updated) override;
@@ -78,6 +84,7 @@ public:
 
 private:
 	Bool8 m_markedForUpdate = false;
+	Bool8 m_placementPending = false;
 	Bool8 m_placed = false;
 
 	const CollisionShape* m_shape;
@@ -85,6 +92,7 @@ private:
 	Vec4 m_origin = Vec4(MAX_F32, MAX_F32, MAX_F32, 0.0);
 
 	OctreePlaceable m_octreeInfo;
+	BvhPlaceable m_bvhInfo;
 };
 
 /// A class that holds spatial information and implements the SpatialComponent virtuals. You just need to update the
@@ -0,0 +1,103 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+// WARNING: This file is auto generated.
+
+#include <anki/script/LuaBinder.h>
+#include <anki/core/Trace.h>
+
+namespace anki
+{
+
+/// Pre-wrap function getLastFrameZoneTime.
+static inline int pwrapgetLastFrameZoneTime(lua_State* l)
+{
+	LuaUserData* ud;
+	(void)ud;
+	void* voidp;
+	(void)voidp;
+	PtrSize size;
+	(void)size;
+
+	LuaBinder::checkArgsCount(l, 1);
+
+	// Pop arguments
+	const char* arg0;
+	if(LuaBinder::checkString(l, 1, arg0))
+	{
+		return -1;
+	}
+
+	// Call the function
+	F64 ret = CoreTracerSingleton::get().m_profiler.getLastFrameZoneTime(arg0);
+
+	// Push return value
+	lua_pushnumber(l, ret);
+
+	return 1;
+}
+
+/// Wrap function getLastFrameZoneTime.
+static int wrapgetLastFrameZoneTime(lua_State* l)
+{
+	int res = pwrapgetLastFrameZoneTime(l);
+	if(res >= 0)
+	{
+		return res;
+	}
+
+	lua_error(l);
+	return 0;
+}
+
+/// Pre-wrap function getLastFrameZoneCallCount.
+static inline int pwrapgetLastFrameZoneCallCount(lua_State* l)
+{
+	LuaUserData* ud;
+	(void)ud;
+	void* voidp;
+	(void)voidp;
+	PtrSize size;
+	(void)size;
+
+	LuaBinder::checkArgsCount(l, 1);
+
+	// Pop arguments
+	const char* arg0;
+	if(LuaBinder::checkString(l, 1, arg0))
+	{
+		return -1;
+	}
+
+	// Call the function
+	U32 ret = CoreTracerSingleton::get().m_profiler.getLastFrameZoneCallCount(arg0);
+
+	// Push return value
+	lua_pushnumber(l, ret);
+
+	return 1;
+}
+
+/// Wrap function getLastFrameZoneCallCount.
+static int wrapgetLastFrameZoneCallCount(lua_State* l)
+{
+	int res = pwrapgetLastFrameZoneCallCount(l);
+	if(res >= 0)
+	{
+		return res;
+	}
+
+	lua_error(l);
+	return 0;
+}
+
+/// Wrap the module.
+void wrapModuleProfiler(lua_State* l)
+{
+	LuaBinder::pushLuaCFunc(l, "getLastFrameZoneTime", wrapgetLastFrameZoneTime);
+	LuaBinder::pushLuaCFunc(l, "getLastFrameZoneCallCount", wrapgetLastFrameZoneCallCount);
+}
+
+} // end namespace anki
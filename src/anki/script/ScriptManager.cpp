@@ -14,6 +14,7 @@ namespace anki
 #define ANKI_SCRIPT_CALL_WRAP(x_) void wrapModule##x_(lua_State*)
 ANKI_SCRIPT_CALL_WRAP(Logger);
 ANKI_SCRIPT_CALL_WRAP(Math);
+ANKI_SCRIPT_CALL_WRAP(Profiler);
 ANKI_SCRIPT_CALL_WRAP(Renderer);
 ANKI_SCRIPT_CALL_WRAP(Scene);
 #undef ANKI_SCRIPT_CALL_WRAP
@@ -41,6 +42,7 @@ Error ScriptManager::init(AllocAlignedCallback allocCb, void* allocCbData)
 #define ANKI_SCRIPT_CALL_WRAP(x_) wrapModule##x_(l)
 	ANKI_SCRIPT_CALL_WRAP(Logger);
 	ANKI_SCRIPT_CALL_WRAP(Math);
+	ANKI_SCRIPT_CALL_WRAP(Profiler);
 	ANKI_SCRIPT_CALL_WRAP(Renderer);
 	ANKI_SCRIPT_CALL_WRAP(Scene);
 #undef ANKI_SCRIPT_CALL_WRAP
@@ -405,6 +405,11 @@ using StackAllocator = GenericPoolAllocator<T, StackMemoryPool>;
 /// Allocator that uses a ChainMemoryPool
 template<typename T>
 using ChainAllocator = GenericPoolAllocator<T, ChainMemoryPool>;
+
+/// Allocator that uses a ThreadCachingMemoryPool. Use it instead of HeapAllocator for small and frequent allocations
+/// from many threads.
+template<typename T>
+using ThreadCachingAllocator = GenericPoolAllocator<T, ThreadCachingMemoryPool>;
 /// @}
 
 } // end namespace anki
@@ -0,0 +1,150 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/util/FlatHashMap.h>
+#include <anki/util/Thread.h>
+
+namespace anki
+{
+
+/// @addtogroup util_containers
+/// @{
+
+/// Hash map for caches that are read a lot more than they are written from many threads. The lookups are lock-free and
+/// the insertions are serialized by a mutex. The elements can't be erased one by one, only the whole map is destroyed.
+///
+/// The values live in nodes that never move so the pointers to them are valid until the map is destroyed. The table
+/// holds pointers to the nodes and when it grows the old one is kept around because readers might still be looking
+/// into it. The old tables are released when the map is destroyed, they are less than the current table in total.
+/// @tparam TKey The key. It should be comparable with operator==.
+/// @tparam TValue The value. It doesn't have to be copyable.
+/// @tparam THasher The hasher. See FlatHashMapHasher.
+template<typename TKey, typename TValue, typename THasher = FlatHashMapHasher>
+class ConcurrentHashMap : public NonCopyable
+{
+public:
+	using Key = TKey;
+	using Value = TValue;
+	using Hasher = THasher;
+
+	static constexpr U32 INITIAL_STORAGE_SIZE = 64;
+	static constexpr F32 MAX_LOAD_FACTOR = 0.5f;
+
+	ConcurrentHashMap() = default;
+
+	/// You need to manually destroy the map.
+	/// @see ConcurrentHashMap::destroy
+	~ConcurrentHashMap()
+	{
+		ANKI_ASSERT(m_table.load() == nullptr && "Forgot to destroy");
+	}
+
+	/// Destroy the map. It's not thread safe.
+	template<typename TAllocator>
+	void destroy(TAllocator alloc);
+
+	/// Find a value. It's thread safe and lock-free. The key can be of a different type than TKey if THasher can hash
+	/// it and it can be compared with TKey.
+	/// @return The value or nullptr if the key is not in the map.
+	template<typename TLookupKey>
+	TValue* find(const TLookupKey& key) const;
+
+	/// Find a value and if it's not there create it. It's thread safe. The lookup is lock-free, the creation locks.
+	/// @param alloc The allocator.
+	/// @param key The key.
+	/// @param initValue A functor that takes a TValue& and initializes the new value. It's called only once for every
+	///                  key, with the lock held, and no other thread can see the value before it returns.
+	/// @return The value.
+	template<typename TAllocator, typename TInitFunc>
+	TValue& getOrCreate(TAllocator alloc, const TKey& key, TInitFunc initValue);
+
+	/// Construct a value if the key is not in the map. It's thread safe. The lookup is lock-free, the creation locks.
+	/// @return The value with that key.
+	template<typename TAllocator, typename... TArgs>
+	TValue& emplace(TAllocator alloc, const TKey& key, TArgs&&... args)
+	{
+		TValue* value = find(key);
+		if(ANKI_LIKELY(value != nullptr))
+		{
+			return *value;
+		}
+
+		return getOrCreateInternal(alloc, key, [](TValue&) {}, std::forward<TArgs>(args)...);
+	}
+
+	/// Get the number of elements. It's thread safe but it might be stale.
+	U32 getSize() const
+	{
+		return m_elementCount.load();
+	}
+
+	/// Iterate all the elements. It's not thread safe with the insertions.
+	/// @param func A functor that takes a const TKey& and a TValue&.
+	template<typename TFunc>
+	void iterate(TFunc func);
+
+private:
+	class Node
+	{
+	public:
+		TKey m_key;
+		TValue m_value;
+
+		template<typename... TArgs>
+		Node(const TKey& key, TArgs&&... args)
+			: m_key(key)
+			, m_value(std::forward<TArgs>(args)...)
+		{
+		}
+	};
+
+	/// The table is followed by its entries.
+	class Table
+	{
+	public:
+		Table* m_prev = nullptr; ///< The older table.
+		U32 m_capacity = 0; ///< Power of two.
+
+		Atomic<Node*>* getEntries()
+		{
+			return reinterpret_cast<Atomic<Node*>*>(this + 1);
+		}
+
+		const Atomic<Node*>* getEntries() const
+		{
+			return reinterpret_cast<const Atomic<Node*>*>(this + 1);
+		}
+	};
+
+	Atomic<Table*> m_table = {nullptr};
+	Atomic<U32> m_elementCount = {0};
+	Mutex m_mtx; ///< Serializes the insertions.
+
+	template<typename TLookupKey>
+	static U64 computeHash(const TLookupKey& key)
+	{
+		U64 h = THasher()(key);
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		return h;
+	}
+
+	template<typename TAllocator, typename TInitFunc, typename... TArgs>
+	TValue& getOrCreateInternal(TAllocator alloc, const TKey& key, TInitFunc initValue, TArgs&&... args);
+
+	template<typename TAllocator>
+	Table* newTable(TAllocator alloc, U32 capacity);
+
+	/// Put a node to a table that has space. Call it with the lock held.
+	static void insertNode(Table& table, Node* node);
+};
+/// @}
+
+} // end namespace anki
+
+#include <anki/util/ConcurrentHashMap.inl.h>
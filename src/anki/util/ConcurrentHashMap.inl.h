@@ -0,0 +1,183 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/util/ConcurrentHashMap.h>
+
+namespace anki
+{
+
+template<typename TKey, typename TValue, typename THasher>
+template<typename TAllocator>
+void ConcurrentHashMap<TKey, TValue, THasher>::destroy(TAllocator alloc)
+{
+	Table* table = m_table.load();
+	if(table)
+	{
+		// The nodes are in the newest table only
+		for(U32 i = 0; i < table->m_capacity; ++i)
+		{
+			Node* node = table->getEntries()[i].load();
+			if(node)
+			{
+				alloc.deleteInstance(node);
+			}
+		}
+	}
+
+	while(table)
+	{
+		Table* prev = table->m_prev;
+		alloc.getMemoryPool().free(table);
+		table = prev;
+	}
+
+	m_table.store(nullptr);
+	m_elementCount.store(0);
+}
+
+template<typename TKey, typename TValue, typename THasher>
+template<typename TLookupKey>
+TValue* ConcurrentHashMap<TKey, TValue, THasher>::find(const TLookupKey& key) const
+{
+	// The table and the nodes are published with release so acquire them to see their contents
+	const Table* table = m_table.load(AtomicMemoryOrder::ACQUIRE);
+	if(table == nullptr)
+	{
+		return nullptr;
+	}
+
+	const U32 mask = table->m_capacity - 1;
+	U32 idx = U32(computeHash(key)) & mask;
+	while(true)
+	{
+		Node* node = table->getEntries()[idx].load(AtomicMemoryOrder::ACQUIRE);
+		if(node == nullptr)
+		{
+			return nullptr;
+		}
+
+		if(node->m_key == key)
+		{
+			return &node->m_value;
+		}
+
+		idx = (idx + 1) & mask;
+	}
+}
+
+template<typename TKey, typename TValue, typename THasher>
+template<typename TAllocator, typename TInitFunc>
+TValue& ConcurrentHashMap<TKey, TValue, THasher>::getOrCreate(TAllocator alloc, const TKey& key, TInitFunc initValue)
+{
+	TValue* value = find(key);
+	if(ANKI_LIKELY(value != nullptr))
+	{
+		return *value;
+	}
+
+	return getOrCreateInternal(alloc, key, initValue);
+}
+
+template<typename TKey, typename TValue, typename THasher>
+template<typename TAllocator, typename TInitFunc, typename... TArgs>
+TValue& ConcurrentHashMap<TKey, TValue, THasher>::getOrCreateInternal(
+	TAllocator alloc, const TKey& key, TInitFunc initValue, TArgs&&... args)
+{
+	LockGuard<Mutex> lock(m_mtx);
+
+	// Some other thread might have created it in the meantime
+	TValue* value = find(key);
+	if(value)
+	{
+		return *value;
+	}
+
+	Node* node = alloc.template newInstance<Node>(key, std::forward<TArgs>(args)...);
+	initValue(node->m_value);
+
+	// Grow if needed. Readers might still use the old table so keep it
+	Table* table = m_table.load();
+	const U32 elementCount = m_elementCount.load() + 1;
+	if(table == nullptr || F32(elementCount) > F32(table->m_capacity) * MAX_LOAD_FACTOR)
+	{
+		Table* newTbl = newTable(alloc, (table) ? table->m_capacity * 2 : INITIAL_STORAGE_SIZE);
+		newTbl->m_prev = table;
+
+		if(table)
+		{
+			for(U32 i = 0; i < table->m_capacity; ++i)
+			{
+				Node* oldNode = table->getEntries()[i].load();
+				if(oldNode)
+				{
+					insertNode(*newTbl, oldNode);
+				}
+			}
+		}
+
+		table = newTbl;
+		insertNode(*table, node);
+		m_table.store(table, AtomicMemoryOrder::RELEASE);
+	}
+	else
+	{
+		insertNode(*table, node);
+	}
+
+	m_elementCount.store(elementCount);
+	return node->m_value;
+}
+
+template<typename TKey, typename TValue, typename THasher>
+template<typename TAllocator>
+typename ConcurrentHashMap<TKey, TValue, THasher>::Table* ConcurrentHashMap<TKey, TValue, THasher>::newTable(
+	TAllocator alloc, U32 capacity)
+{
+	ANKI_ASSERT(isPowerOfTwo(capacity));
+	const PtrSize size = sizeof(Table) + sizeof(Atomic<Node*>) * capacity;
+	void* mem = alloc.getMemoryPool().allocate(size, max(alignof(Table), alignof(Atomic<Node*>)));
+
+	Table* table = ::new(mem) Table();
+	table->m_capacity = capacity;
+	for(U32 i = 0; i < capacity; ++i)
+	{
+		::new(&table->getEntries()[i]) Atomic<Node*>(nullptr);
+	}
+
+	return table;
+}
+
+template<typename TKey, typename TValue, typename THasher>
+void ConcurrentHashMap<TKey, TValue, THasher>::insertNode(Table& table, Node* node)
+{
+	const U32 mask = table.m_capacity - 1;
+	U32 idx = U32(computeHash(node->m_key)) & mask;
+	while(table.getEntries()[idx].load() != nullptr)
+	{
+		idx = (idx + 1) & mask;
+	}
+
+	table.getEntries()[idx].store(node, AtomicMemoryOrder::RELEASE);
+}
+
+template<typename TKey, typename TValue, typename THasher>
+template<typename TFunc>
+void ConcurrentHashMap<TKey, TValue, THasher>::iterate(TFunc func)
+{
+	Table* table = m_table.load();
+	if(table)
+	{
+		for(U32 i = 0; i < table->m_capacity; ++i)
+		{
+			Node* node = table->getEntries()[i].load();
+			if(node)
+			{
+				func(static_cast<const TKey&>(node->m_key), node->m_value);
+			}
+		}
+	}
+}
+
+} // end namespace anki
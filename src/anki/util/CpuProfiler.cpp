@@ -0,0 +1,307 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/util/CpuProfiler.h>
+#include <anki/util/HighRezTimer.h>
+
+namespace anki
+{
+
+static Atomic<U64> g_nextProfilerUuid = {1};
+
+/// A zone in the tree of a thread. It lives as long as the profiler and it accumulates the time of a single frame.
+class CpuProfiler::Node
+{
+public:
+	const char* m_name;
+	U32 m_parent;
+	U32 m_firstChild = MAX_U32;
+	U32 m_nextSibling = MAX_U32;
+	U32 m_callCount = 0;
+	Second m_inclusiveTime = 0.0;
+	Second m_startTime = 0.0; ///< A node is open at most once at a time so the start time can live here.
+
+	Node(const char* name, U32 parent)
+		: m_name(name)
+		, m_parent(parent)
+	{
+	}
+};
+
+class CpuProfiler::ThreadLocal
+{
+public:
+	ThreadId m_tid;
+	DynamicArray<Node> m_nodes;
+	U32 m_firstRoot = MAX_U32;
+	U32 m_crntNode = MAX_U32; ///< The zone the thread is in. MAX_U32 if it's not in any.
+	SpinLock m_lock; ///< Protects the nodes from newFrame(). It's contended only once per frame.
+};
+
+thread_local CpuProfiler::ThreadLocal* CpuProfiler::m_threadLocal = nullptr;
+thread_local U64 CpuProfiler::m_threadLocalProfilerUuid = 0;
+
+CpuProfiler::~CpuProfiler()
+{
+	for(ThreadLocal* threadLocal : m_allThreadLocal)
+	{
+		threadLocal->m_nodes.destroy(m_alloc);
+		m_alloc.deleteInstance(threadLocal);
+	}
+
+	m_allThreadLocal.destroy(m_alloc);
+	m_lastFrameZones.destroy(m_alloc);
+	m_lastFrameThreads.destroy(m_alloc);
+}
+
+void CpuProfiler::init(GenericMemoryPoolAllocator<U8> alloc)
+{
+	ANKI_ASSERT(!isInitialized());
+	m_alloc = alloc;
+	m_uuid = g_nextProfilerUuid.fetchAdd(1);
+}
+
+CpuProfiler::ThreadLocal& CpuProfiler::getThreadLocal()
+{
+	ThreadLocal* out = m_threadLocal;
+	if(ANKI_LIKELY(out && m_threadLocalProfilerUuid == m_uuid))
+	{
+		return *out;
+	}
+
+	const ThreadId tid = Thread::getCurrentThreadId();
+	LockGuard<Mutex> lock(m_threadLocalMtx);
+
+	// The thread might have used another profiler in the meantime
+	out = nullptr;
+	for(ThreadLocal* threadLocal : m_allThreadLocal)
+	{
+		if(threadLocal->m_tid == tid)
+		{
+			out = threadLocal;
+			break;
+		}
+	}
+
+	if(out == nullptr)
+	{
+		out = m_alloc.newInstance<ThreadLocal>();
+		out->m_tid = tid;
+		m_allThreadLocal.emplaceBack(m_alloc, out);
+	}
+
+	m_threadLocal = out;
+	m_threadLocalProfilerUuid = m_uuid;
+	return *out;
+}
+
+void CpuProfiler::beginZone(const char* zoneName)
+{
+	ANKI_ASSERT(isInitialized() && zoneName);
+	ThreadLocal& threadLocal = getThreadLocal();
+	LockGuard<SpinLock> lock(threadLocal.m_lock);
+
+	// Find the child of the current zone. The names are compared by address, they are expected to be literals
+	const U32 parent = threadLocal.m_crntNode;
+	U32 prev = MAX_U32;
+	U32 idx = (parent == MAX_U32) ? threadLocal.m_firstRoot : threadLocal.m_nodes[parent].m_firstChild;
+	while(idx != MAX_U32 && threadLocal.m_nodes[idx].m_name != zoneName)
+	{
+		prev = idx;
+		idx = threadLocal.m_nodes[idx].m_nextSibling;
+	}
+
+	if(idx == MAX_U32)
+	{
+		// First time this zone appears here, create it
+		idx = threadLocal.m_nodes.getSize();
+		threadLocal.m_nodes.emplaceBack(m_alloc, zoneName, parent);
+
+		if(prev != MAX_U32)
+		{
+			threadLocal.m_nodes[prev].m_nextSibling = idx;
+		}
+		else if(parent != MAX_U32)
+		{
+			threadLocal.m_nodes[parent].m_firstChild = idx;
+		}
+		else
+		{
+			threadLocal.m_firstRoot = idx;
+		}
+	}
+
+	threadLocal.m_crntNode = idx;
+	threadLocal.m_nodes[idx].m_startTime = HighRezTimer::getCurrentTime();
+}
+
+void CpuProfiler::endZone()
+{
+	const Second endTime = HighRezTimer::getCurrentTime();
+	ThreadLocal& threadLocal = getThreadLocal();
+	LockGuard<SpinLock> lock(threadLocal.m_lock);
+
+	const U32 idx = threadLocal.m_crntNode;
+	if(ANKI_UNLIKELY(idx == MAX_U32))
+	{
+		// Unbalanced, probably the zone began before the profiler was enabled
+		return;
+	}
+
+	Node& node = threadLocal.m_nodes[idx];
+	node.m_inclusiveTime += endTime - node.m_startTime;
+	++node.m_callCount;
+	threadLocal.m_crntNode = node.m_parent;
+}
+
+Second CpuProfiler::gatherZones(ThreadLocal& threadLocal, U32 nodeIdx, U32 parentZone, U32 depth)
+{
+	Node& node = threadLocal.m_nodes[nodeIdx];
+
+	// Append the zone before the children
+	const U32 zoneIdx = m_lastFrameZoneCount++;
+	if(zoneIdx == m_lastFrameZones.getSize())
+	{
+		m_lastFrameZones.emplaceBack(m_alloc);
+	}
+
+	const U32 callCount = node.m_callCount;
+	CpuProfilerZone& zone = m_lastFrameZones[zoneIdx];
+	zone.m_name = node.m_name;
+	zone.m_parent = parentZone;
+	zone.m_depth = depth;
+	zone.m_thread = m_lastFrameThreadCount;
+	zone.m_callCount = callCount;
+	zone.m_inclusiveTime = node.m_inclusiveTime;
+
+	Second childrenTime = 0.0;
+	for(U32 child = node.m_firstChild; child != MAX_U32; child = threadLocal.m_nodes[child].m_nextSibling)
+	{
+		childrenTime += gatherZones(threadLocal, child, zoneIdx, depth + 1);
+	}
+
+	// Reset the node for the next frame
+	const Second inclusiveTime = node.m_inclusiveTime;
+	node.m_inclusiveTime = 0.0;
+	node.m_callCount = 0;
+
+	if(callCount == 0 && m_lastFrameZoneCount == zoneIdx + 1)
+	{
+		// Didn't run this frame and neither did its children, drop it
+		--m_lastFrameZoneCount;
+		return 0.0;
+	}
+
+	// A child might have ended after its parent got aggregated so don't go negative
+	m_lastFrameZones[zoneIdx].m_exclusiveTime = max(0.0, inclusiveTime - childrenTime);
+	return inclusiveTime;
+}
+
+void CpuProfiler::newFrame(U64 frame)
+{
+	ANKI_ASSERT(isInitialized());
+	const ThreadId crntTid = Thread::getCurrentThreadId();
+
+	LockGuard<Mutex> lock(m_threadLocalMtx);
+	LockGuard<Mutex> lock2(m_lastFrameMtx);
+
+	m_lastFrame = m_crntFrame;
+	m_crntFrame = frame;
+	m_lastFrameZoneCount = 0;
+	m_lastFrameThreadCount = 0;
+	m_lastFrameMainThread = MAX_U32;
+
+	for(ThreadLocal* threadLocal : m_allThreadLocal)
+	{
+		const U32 firstZone = m_lastFrameZoneCount;
+
+		{
+			LockGuard<SpinLock> lock3(threadLocal->m_lock);
+			for(U32 root = threadLocal->m_firstRoot; root != MAX_U32; root = threadLocal->m_nodes[root].m_nextSibling)
+			{
+				gatherZones(*threadLocal, root, MAX_U32, 0);
+			}
+		}
+
+		if(m_lastFrameZoneCount == firstZone)
+		{
+			// Nothing happened in that thread
+			continue;
+		}
+
+		if(m_lastFrameThreadCount == m_lastFrameThreads.getSize())
+		{
+			m_lastFrameThreads.emplaceBack(m_alloc);
+		}
+
+		CpuProfilerThread& thread = m_lastFrameThreads[m_lastFrameThreadCount];
+		thread.m_id = threadLocal->m_tid;
+		thread.m_firstZone = firstZone;
+		thread.m_zoneCount = m_lastFrameZoneCount - firstZone;
+
+		if(threadLocal->m_tid == crntTid)
+		{
+			m_lastFrameMainThread = m_lastFrameThreadCount;
+		}
+
+		++m_lastFrameThreadCount;
+	}
+}
+
+void CpuProfiler::getLastFrame(CpuProfilerFrame& frame) const
+{
+	LockGuard<Mutex> lock(m_lastFrameMtx);
+
+	frame.m_frame = m_lastFrame;
+	frame.m_mainThread = m_lastFrameMainThread;
+
+	frame.m_zones.destroy();
+	if(m_lastFrameZoneCount)
+	{
+		frame.m_zones.create(m_lastFrameZoneCount);
+		memcpy(&frame.m_zones[0], &m_lastFrameZones[0], sizeof(CpuProfilerZone) * m_lastFrameZoneCount);
+	}
+
+	frame.m_threads.destroy();
+	if(m_lastFrameThreadCount)
+	{
+		frame.m_threads.create(m_lastFrameThreadCount);
+		memcpy(&frame.m_threads[0], &m_lastFrameThreads[0], sizeof(CpuProfilerThread) * m_lastFrameThreadCount);
+	}
+}
+
+Second CpuProfiler::getLastFrameZoneTime(CString zoneName) const
+{
+	LockGuard<Mutex> lock(m_lastFrameMtx);
+
+	Second time = 0.0;
+	for(U32 i = 0; i < m_lastFrameZoneCount; ++i)
+	{
+		if(zoneName == m_lastFrameZones[i].m_name)
+		{
+			time += m_lastFrameZones[i].m_inclusiveTime;
+		}
+	}
+
+	return time;
+}
+
+U32 CpuProfiler::getLastFrameZoneCallCount(CString zoneName) const
+{
+	LockGuard<Mutex> lock(m_lastFrameMtx);
+
+	U32 count = 0;
+	for(U32 i = 0; i < m_lastFrameZoneCount; ++i)
+	{
+		if(zoneName == m_lastFrameZones[i].m_name)
+		{
+			count += m_lastFrameZones[i].m_callCount;
+		}
+	}
+
+	return count;
+}
+
+} // end namespace anki
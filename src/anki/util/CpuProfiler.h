@@ -0,0 +1,132 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/util/DynamicArray.h>
+#include <anki/util/Thread.h>
+#include <anki/util/String.h>
+
+namespace anki
+{
+
+/// @addtogroup util_other
+/// @{
+
+/// A zone of a single thread aggregated for a whole frame. @memberof CpuProfiler
+class CpuProfilerZone
+{
+public:
+	const char* m_name = nullptr;
+	U32 m_parent = MAX_U32; ///< Index of the parent zone. MAX_U32 if it's a root zone.
+	U32 m_depth = 0;
+	U32 m_thread = 0; ///< Index to CpuProfilerFrame::m_threads.
+	U32 m_callCount = 0;
+	Second m_inclusiveTime = 0.0; ///< The time spent in the zone.
+	Second m_exclusiveTime = 0.0; ///< The time spent in the zone minus the time spent in its child zones.
+};
+
+/// The zones of a single thread. @memberof CpuProfiler
+class CpuProfilerThread
+{
+public:
+	ThreadId m_id = 0;
+	U32 m_firstZone = 0; ///< Index to CpuProfilerFrame::m_zones.
+	U32 m_zoneCount = 0;
+};
+
+/// The aggregated zones of a whole frame. @memberof CpuProfiler
+class CpuProfilerFrame
+{
+public:
+	U64 m_frame = 0;
+
+	/// The zones of all threads. The zones of a thread are contiguous and in depth-first order so the parents are
+	/// always before their children.
+	DynamicArrayAuto<CpuProfilerZone> m_zones;
+
+	DynamicArrayAuto<CpuProfilerThread> m_threads;
+
+	U32 m_mainThread = MAX_U32; ///< The thread that called CpuProfiler::newFrame(). MAX_U32 if it had no zones.
+
+	CpuProfilerFrame(GenericMemoryPoolAllocator<U8> alloc)
+		: m_zones(alloc)
+		, m_threads(alloc)
+	{
+	}
+};
+
+/// Hierarchical CPU profiler. The zones of every thread form a tree and they are aggregated every frame so the
+/// inclusive time, the exclusive time and the call count of every zone of the previous frame can be queried at any
+/// time.
+class CpuProfiler : public NonCopyable
+{
+public:
+	CpuProfiler() = default;
+
+	~CpuProfiler();
+
+	void init(GenericMemoryPoolAllocator<U8> alloc);
+
+	Bool isInitialized() const
+	{
+		return !!m_alloc;
+	}
+
+	/// Begin a zone. It becomes a child of the zone the calling thread is in.
+	/// @param zoneName The name of the zone. The pointer should remain valid for the lifetime of the profiler.
+	void beginZone(const char* zoneName);
+
+	/// End the last zone the calling thread began.
+	void endZone();
+
+	/// Begin a new frame. It aggregates the zones that ended during the previous frame. The zones that are still open
+	/// will be accounted in the new frame.
+	void newFrame(U64 frame);
+
+	/// Get all the zones of the last complete frame.
+	void getLastFrame(CpuProfilerFrame& frame) const;
+
+	/// Get the inclusive time of a zone in the last complete frame. It's summed over all threads and all the places
+	/// of the hierarchy the zone appears in.
+	Second getLastFrameZoneTime(CString zoneName) const;
+
+	/// Get the number of times a zone ended in the last complete frame. See getLastFrameZoneTime().
+	U32 getLastFrameZoneCallCount(CString zoneName) const;
+
+private:
+	class Node;
+	class ThreadLocal;
+
+	GenericMemoryPoolAllocator<U8> m_alloc;
+	U64 m_uuid = 0; ///< Identifies the profiler in the thread local storage.
+	U64 m_crntFrame = 0;
+
+	static thread_local ThreadLocal* m_threadLocal;
+	static thread_local U64 m_threadLocalProfilerUuid;
+	DynamicArray<ThreadLocal*> m_allThreadLocal;
+	Mutex m_threadLocalMtx;
+
+	/// @name The last complete frame. Protected by m_lastFrameMtx
+	/// @{
+	U64 m_lastFrame = 0;
+	DynamicArray<CpuProfilerZone> m_lastFrameZones;
+	U32 m_lastFrameZoneCount = 0; ///< m_lastFrameZones only grows, this is the real size.
+	DynamicArray<CpuProfilerThread> m_lastFrameThreads;
+	U32 m_lastFrameThreadCount = 0;
+	U32 m_lastFrameMainThread = MAX_U32;
+	mutable Mutex m_lastFrameMtx;
+	/// @}
+
+	/// Get the thread local ThreadLocal structure.
+	ThreadLocal& getThreadLocal();
+
+	/// Append the zones of a node and its children to m_lastFrameZones.
+	/// @return The inclusive time of the node.
+	Second gatherZones(ThreadLocal& threadLocal, U32 nodeIdx, U32 parentZone, U32 depth);
+};
+/// @}
+
+} // end namespace anki
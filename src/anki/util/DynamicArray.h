@@ -387,6 +387,199 @@ public:
 private:
 	GenericMemoryPoolAllocator<T> m_alloc;
 };
+
+/// Dynamic array with automatic destruction that stores the first N elements inside the object. It uses the allocator
+/// only when it grows past N elements. Use it for temp arrays that are small most of the time.
+template<typename T, PtrSize N>
+class DynamicArrayInline
+{
+public:
+	using Value = T;
+	using Iterator = Value*;
+	using ConstIterator = const Value*;
+	using Reference = Value&;
+	using ConstReference = const Value&;
+
+	static constexpr F32 GROW_SCALE = 2.0f;
+
+	static_assert(N > 0, "Need some inline storage");
+
+	template<typename TAllocator>
+	DynamicArrayInline(TAllocator alloc)
+		: m_data(getInlineStorage())
+		, m_alloc(alloc)
+	{
+	}
+
+	// Non-copyable
+	DynamicArrayInline(const DynamicArrayInline& b) = delete;
+
+	~DynamicArrayInline()
+	{
+		destroy();
+	}
+
+	// Non-copyable
+	DynamicArrayInline& operator=(const DynamicArrayInline& b) = delete;
+
+	Reference operator[](const PtrSize n)
+	{
+		ANKI_ASSERT(n < m_size);
+		return m_data[n];
+	}
+
+	ConstReference operator[](const PtrSize n) const
+	{
+		ANKI_ASSERT(n < m_size);
+		return m_data[n];
+	}
+
+	Iterator getBegin()
+	{
+		return m_data;
+	}
+
+	ConstIterator getBegin() const
+	{
+		return m_data;
+	}
+
+	Iterator getEnd()
+	{
+		return m_data + m_size;
+	}
+
+	ConstIterator getEnd() const
+	{
+		return m_data + m_size;
+	}
+
+	/// Make it compatible with the C++11 range based for loop.
+	Iterator begin()
+	{
+		return getBegin();
+	}
+
+	/// Make it compatible with the C++11 range based for loop.
+	ConstIterator begin() const
+	{
+		return getBegin();
+	}
+
+	/// Make it compatible with the C++11 range based for loop.
+	Iterator end()
+	{
+		return getEnd();
+	}
+
+	/// Make it compatible with the C++11 range based for loop.
+	ConstIterator end() const
+	{
+		return getEnd();
+	}
+
+	/// Get first element.
+	Reference getFront()
+	{
+		ANKI_ASSERT(!isEmpty());
+		return m_data[0];
+	}
+
+	/// Get first element.
+	ConstReference getFront() const
+	{
+		ANKI_ASSERT(!isEmpty());
+		return m_data[0];
+	}
+
+	/// Get last element.
+	Reference getBack()
+	{
+		ANKI_ASSERT(!isEmpty());
+		return m_data[m_size - 1];
+	}
+
+	/// Get last element.
+	ConstReference getBack() const
+	{
+		ANKI_ASSERT(!isEmpty());
+		return m_data[m_size - 1];
+	}
+
+	PtrSize getSize() const
+	{
+		return m_size;
+	}
+
+	Bool isEmpty() const
+	{
+		return m_size == 0;
+	}
+
+	PtrSize getSizeInBytes() const
+	{
+		return m_size * sizeof(Value);
+	}
+
+	/// Return true if the elements are still in the inline storage.
+	Bool isInline() const
+	{
+		return m_data == getInlineStorage();
+	}
+
+	/// Only create the array. Useful if @a T is non-copyable or movable.
+	void create(PtrSize size)
+	{
+		ANKI_ASSERT(m_size == 0);
+		resize(size);
+	}
+
+	/// Only create the array.
+	void create(PtrSize size, const Value& v)
+	{
+		ANKI_ASSERT(m_size == 0);
+		resize(size, v);
+	}
+
+	/// Grow or shrink the array. @a T needs to be copyable and moveable. It never frees storage.
+	void resize(PtrSize size, const Value& v);
+
+	/// Grow or shrink the array. @a T needs to be moveable and default constructible. It never frees storage.
+	void resize(PtrSize size);
+
+	/// Push back value.
+	template<typename... TArgs>
+	Iterator emplaceBack(TArgs&&... args)
+	{
+		reserveStorage(m_size + 1);
+		::new(&m_data[m_size]) Value(std::forward<TArgs>(args)...);
+		++m_size;
+		return &m_data[m_size - 1];
+	}
+
+	/// Destroy the elements and go back to the inline storage.
+	void destroy();
+
+private:
+	alignas(Value) U8 m_inlineStorage[N * sizeof(Value)];
+	Value* m_data;
+	PtrSize m_size = 0;
+	PtrSize m_capacity = N;
+	GenericMemoryPoolAllocator<T> m_alloc;
+
+	Value* getInlineStorage()
+	{
+		return reinterpret_cast<Value*>(&m_inlineStorage[0]);
+	}
+
+	const Value* getInlineStorage() const
+	{
+		return reinterpret_cast<const Value*>(&m_inlineStorage[0]);
+	}
+
+	/// Grow the storage if needed. It doesn't construct any elements, it only moves the existing.
+	void reserveStorage(PtrSize newSize);
+};
 /// @}
 
 } // end namespace anki
@@ -204,4 +204,86 @@ typename DynamicArray<T>::Iterator DynamicArray<T>::emplaceAt(TAllocator alloc,
 	return &m_data[outIdx];
 }
 
+template<typename T, PtrSize N>
+void DynamicArrayInline<T, N>::reserveStorage(PtrSize newSize)
+{
+	if(ANKI_LIKELY(newSize <= m_capacity))
+	{
+		return;
+	}
+
+	// Spill to the allocator
+	const PtrSize newCapacity = max<PtrSize>(newSize, PtrSize(m_capacity * GROW_SCALE));
+	Value* newStorage =
+		static_cast<Value*>(m_alloc.getMemoryPool().allocate(newCapacity * sizeof(Value), alignof(Value)));
+
+	for(PtrSize i = 0; i < m_size; ++i)
+	{
+		::new(&newStorage[i]) Value(std::move(m_data[i]));
+		m_data[i].~T();
+	}
+
+	if(!isInline())
+	{
+		m_alloc.getMemoryPool().free(m_data);
+	}
+
+	m_data = newStorage;
+	m_capacity = newCapacity;
+}
+
+template<typename T, PtrSize N>
+void DynamicArrayInline<T, N>::resize(PtrSize newSize, const Value& v)
+{
+	reserveStorage(newSize);
+
+	for(PtrSize i = m_size; i < newSize; ++i)
+	{
+		::new(&m_data[i]) Value(v);
+	}
+
+	for(PtrSize i = newSize; i < m_size; ++i)
+	{
+		m_data[i].~T();
+	}
+
+	m_size = newSize;
+}
+
+template<typename T, PtrSize N>
+void DynamicArrayInline<T, N>::resize(PtrSize newSize)
+{
+	reserveStorage(newSize);
+
+	for(PtrSize i = m_size; i < newSize; ++i)
+	{
+		::new(&m_data[i]) Value();
+	}
+
+	for(PtrSize i = newSize; i < m_size; ++i)
+	{
+		m_data[i].~T();
+	}
+
+	m_size = newSize;
+}
+
+template<typename T, PtrSize N>
+void DynamicArrayInline<T, N>::destroy()
+{
+	for(PtrSize i = 0; i < m_size; ++i)
+	{
+		m_data[i].~T();
+	}
+
+	if(!isInline())
+	{
+		m_alloc.getMemoryPool().free(m_data);
+		m_data = getInlineStorage();
+	}
+
+	m_size = 0;
+	m_capacity = N;
+}
+
 } // end namespace anki
@@ -9,6 +9,13 @@
 #include <anki/util/Assert.h>
 #include <cstring>
 #include <cstdarg>
+#if ANKI_POSIX
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <cerrno>
+#endif
 
 namespace anki
 {
@@ -31,6 +38,7 @@ File& File::operator=(File&& b)
 		m_type = b.m_type;
 		m_flags = b.m_flags;
 		m_size = b.m_size;
+		m_mappedPos = b.m_mappedPos;
 	}
 
 	b.zero();
@@ -49,13 +57,17 @@ Error File::open(const CString& filename, FileOpenFlag flags)
 
 	// Only these flags are accepted
 	ANKI_ASSERT((flags
-					& (FileOpenFlag::READ | FileOpenFlag::WRITE | FileOpenFlag::APPEND | FileOpenFlag::BINARY
-						  | FileOpenFlag::ENDIAN_LITTLE | FileOpenFlag::ENDIAN_BIG))
+					& (FileOpenFlag::READ | FileOpenFlag::WRITE | FileOpenFlag::APPEND | FileOpenFlag::MMAP
+						  | FileOpenFlag::BINARY | FileOpenFlag::ENDIAN_LITTLE | FileOpenFlag::ENDIAN_BIG))
 				!= FileOpenFlag::NONE);
 
 	// Cannot be both
 	ANKI_ASSERT((flags & FileOpenFlag::READ) != (flags & FileOpenFlag::WRITE));
 
+	// Only read files can be mapped
+	ANKI_ASSERT(
+		(flags & FileOpenFlag::MMAP) == FileOpenFlag::NONE || (flags & FileOpenFlag::READ) != FileOpenFlag::NONE);
+
 	//
 	// Determine the file type and open it
 	//
@@ -75,6 +87,13 @@ Error File::open(const CString& filename, FileOpenFlag flags)
 			break;
 #endif
 		case Type::C:
+#if ANKI_POSIX
+			if((flags & FileOpenFlag::MMAP) != FileOpenFlag::NONE)
+			{
+				err = openMappedFile(filename, flags);
+				break;
+			}
+#endif
 			err = openCFile(filename, flags);
 			break;
 		default:
@@ -144,7 +163,7 @@ Error File::openCFile(const CString& filename, FileOpenFlag flags)
 	{
 		fseek(ANKI_CFILE, 0, SEEK_END);
 		I64 size = ftell(ANKI_CFILE);
-		if(size < 1)
+		if(size < 0)
 		{
 			ANKI_UTIL_LOGE("ftell() failed");
 			err = Error::FUNCTION_FAILED;
@@ -159,6 +178,53 @@ Error File::openCFile(const CString& filename, FileOpenFlag flags)
 	return err;
 }
 
+#if ANKI_POSIX
+Error File::openMappedFile(const CString& filename, FileOpenFlag flags)
+{
+	const int fd = ::open(filename.cstr(), O_RDONLY);
+	if(fd < 0)
+	{
+		ANKI_UTIL_LOGE("Failed to open file \"%s\"", filename.cstr());
+		return Error::FILE_ACCESS;
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) != 0)
+	{
+		ANKI_UTIL_LOGE("fstat() failed: %s", filename.cstr());
+		::close(fd);
+		return Error::FUNCTION_FAILED;
+	}
+
+	// Empty files can't be mapped. Open them as regular files
+	if(st.st_size == 0)
+	{
+		::close(fd);
+		return openCFile(filename, flags);
+	}
+
+	// The mapping keeps a reference to the file so the descriptor is not needed after that
+	void* mem = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if(mem == MAP_FAILED)
+	{
+		ANKI_UTIL_LOGW("mmap() failed. Will open it as a regular file: %s", filename.cstr());
+		return openCFile(filename, flags);
+	}
+
+	m_file = mem;
+	m_type = Type::MMAP;
+	m_flags = flags;
+	m_size = st.st_size;
+	m_mappedPos = 0;
+
+	// Most files are read from the beginning to the end
+	adviseAccess(0, m_size, FileAccessHint::SEQUENTIAL);
+
+	return Error::NONE;
+}
+#endif
+
 #if ANKI_OS == ANKI_OS_ANDROID
 Error File::openAndroidFile(const CString& filename, FileOpenFlag flags)
 {
@@ -200,6 +266,12 @@ void File::close()
 		{
 			fclose(ANKI_CFILE);
 		}
+#if ANKI_POSIX
+		else if(m_type == Type::MMAP)
+		{
+			munmap(m_file, m_size);
+		}
+#endif
 #if ANKI_OS == ANKI_OS_ANDROID
 		else if(m_type == Type::SPECIAL)
 		{
@@ -259,6 +331,12 @@ Error File::read(void* buff, PtrSize size)
 	{
 		readSize = fread(buff, 1, size, ANKI_CFILE);
 	}
+	else if(m_type == Type::MMAP)
+	{
+		readSize = min(size, m_size - m_mappedPos);
+		memcpy(buff, static_cast<const U8*>(m_file) + m_mappedPos, readSize);
+		m_mappedPos += readSize;
+	}
 #if ANKI_OS == ANKI_OS_ANDROID
 	else if(m_type == Type::SPECIAL)
 	{
@@ -280,15 +358,87 @@ Error File::read(void* buff, PtrSize size)
 	return err;
 }
 
+Error File::readAt(PtrSize offset, void* buff, PtrSize size)
+{
+	ANKI_ASSERT(buff);
+	ANKI_ASSERT(size > 0);
+	ANKI_ASSERT(m_file);
+	ANKI_ASSERT((m_flags & FileOpenFlag::READ) != FileOpenFlag::NONE);
+
+	Error err = Error::NONE;
+
+	if(m_type == Type::MMAP)
+	{
+		if(offset > m_size || size > m_size - offset)
+		{
+			err = Error::FILE_ACCESS;
+		}
+		else
+		{
+			memcpy(buff, static_cast<const U8*>(m_file) + offset, size);
+		}
+	}
+#if ANKI_POSIX
+	else if(m_type == Type::C)
+	{
+		// pread doesn't touch the position indicator so it's thread safe. It may read less so loop
+		const int fd = fileno(ANKI_CFILE);
+		U8* out = static_cast<U8*>(buff);
+		while(size > 0 && !err)
+		{
+			const ssize_t readSize = pread(fd, out, size, off_t(offset));
+			if(readSize > 0)
+			{
+				out += readSize;
+				offset += readSize;
+				size -= readSize;
+			}
+			else if(readSize == 0 || errno != EINTR)
+			{
+				err = Error::FILE_ACCESS;
+			}
+		}
+	}
+#endif
+	else
+	{
+		// Seek, read and restore the position indicator
+#if ANKI_OS == ANKI_OS_ANDROID
+		const PtrSize prevPos = (m_type == Type::SPECIAL) ? AAsset_seek(ANKI_AFILE, 0, SEEK_CUR) : ftell(ANKI_CFILE);
+#else
+		const PtrSize prevPos = ftell(ANKI_CFILE);
+#endif
+
+		err = seek(offset, SeekOrigin::BEGINNING);
+		if(!err)
+		{
+			err = read(buff, size);
+		}
+
+		if(seek(prevPos, SeekOrigin::BEGINNING))
+		{
+			err = Error::FILE_ACCESS;
+		}
+	}
+
+	if(err)
+	{
+		ANKI_UTIL_LOGE("File read failed");
+	}
+
+	return err;
+}
+
 PtrSize File::getSize() const
 {
 	ANKI_ASSERT(m_file);
 	ANKI_ASSERT(m_flags != FileOpenFlag::NONE);
 	PtrSize out = 0;
 
-	if(m_type == Type::C)
+	if(m_type == Type::C || m_type == Type::MMAP)
 	{
-		ANKI_ASSERT(m_size != 0);
+		// The size is known only for the files that are read
+		ANKI_ASSERT((m_flags & FileOpenFlag::READ) != FileOpenFlag::NONE);
 		out = m_size;
 	}
 #if ANKI_OS == ANKI_OS_ANDROID
@@ -434,6 +584,29 @@ Error File::seek(PtrSize offset, SeekOrigin origin)
 			err = Error::FUNCTION_FAILED;
 		}
 	}
+	else if(m_type == Type::MMAP)
+	{
+		// Like fseek the offset can be negative when it's not from the beginning
+		PtrSize pos = offset;
+		if(origin == SeekOrigin::CURRENT)
+		{
+			pos += m_mappedPos;
+		}
+		else if(origin == SeekOrigin::END)
+		{
+			pos += m_size;
+		}
+
+		if(pos > m_size)
+		{
+			ANKI_UTIL_LOGE("Seeking out of the file");
+			err = Error::FUNCTION_FAILED;
+		}
+		else
+		{
+			m_mappedPos = pos;
+		}
+	}
 #if ANKI_OS == ANKI_OS_ANDROID
 	else if(m_type == Type::SPECIAL)
 	{
@@ -452,6 +625,68 @@ Error File::seek(PtrSize offset, SeekOrigin origin)
 	return err;
 }
 
+Error File::map(PtrSize offset, PtrSize size, ConstWeakArray<U8>& data) const
+{
+	ANKI_ASSERT(m_file);
+
+	if(m_type != Type::MMAP)
+	{
+		ANKI_UTIL_LOGE("The file is not mapped");
+		return Error::FUNCTION_FAILED;
+	}
+
+	if(offset > m_size || size > m_size - offset)
+	{
+		ANKI_UTIL_LOGE("Mapping out of the file");
+		return Error::FUNCTION_FAILED;
+	}
+
+	data = ConstWeakArray<U8>(static_cast<const U8*>(m_file) + offset, size);
+	return Error::NONE;
+}
+
+void File::adviseAccess(PtrSize offset, PtrSize size, FileAccessHint hint)
+{
+#if ANKI_POSIX
+	if(m_type != Type::MMAP || offset >= m_size)
+	{
+		return;
+	}
+
+	size = min(size, m_size - offset);
+
+	int advice;
+	switch(hint)
+	{
+	case FileAccessHint::NORMAL:
+		advice = MADV_NORMAL;
+		break;
+	case FileAccessHint::SEQUENTIAL:
+		advice = MADV_SEQUENTIAL;
+		break;
+	case FileAccessHint::RANDOM:
+		advice = MADV_RANDOM;
+		break;
+	case FileAccessHint::WILL_NEED:
+		advice = MADV_WILLNEED;
+		break;
+	case FileAccessHint::DONT_NEED:
+		advice = MADV_DONTNEED;
+		break;
+	default:
+		ANKI_ASSERT(0);
+		advice = MADV_NORMAL;
+	}
+
+	// The address needs to be aligned to the page size
+	const PtrSize alignedOffset = getAlignedRoundDown(PtrSize(sysconf(_SC_PAGESIZE)), offset);
+	if(madvise(static_cast<U8*>(m_file) + alignedOffset, size + offset - alignedOffset, advice) != 0)
+	{
+		ANKI_UTIL_LOGW("madvise() failed");
+	}
+#endif
+}
+
 Error File::identifyFile(const CString& filename,
 	char* archiveFilename,
 	PtrSize archiveFilenameLength,
@@ -524,4 +759,12 @@ Error File::readAllText(StringAuto& out)
 	return err;
 }
 
+#if ANKI_POSIX
+int File::getFileDescriptor() const
+{
+	ANKI_ASSERT(m_file);
+	return (m_type == Type::C) ? fileno(ANKI_CFILE) : -1;
+}
+#endif
+
 } // end namespace anki
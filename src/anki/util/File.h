@@ -8,6 +8,7 @@
 #include <anki/util/String.h>
 #include <anki/util/Enum.h>
 #include <anki/util/NonCopyable.h>
+#include <anki/util/WeakArray.h>
 #include <cstdio>
 
 namespace anki
@@ -22,6 +23,7 @@ enum class FileOpenFlag : U8
 	NONE = 0,
 	READ = 1 << 0,
 	WRITE = 1 << 1,
+	MMAP = 1 << 2, ///< Map the file to memory. Only with READ. Where it's not supported it opens a regular file.
 	APPEND = WRITE | (1 << 3),
 	BINARY = 1 << 4,
 	ENDIAN_LITTLE = 1 << 5, ///< The default
@@ -29,11 +31,23 @@ enum class FileOpenFlag : U8
 };
 ANKI_ENUM_ALLOW_NUMERIC_OPERATIONS(FileOpenFlag, inline)
 
+/// How a part of a mapped file will be accessed. It's a hint to the OS.
+enum class FileAccessHint : U8
+{
+	NORMAL,
+	SEQUENTIAL, ///< Read it in order. Used by default when a file is mapped.
+	RANDOM,
+	WILL_NEED, ///< It will be read soon so start reading it ahead.
+	DONT_NEED ///< It won't be read for a while.
+};
+
 /// An abstraction over typical files and files in ziped archives. This class can read from regular C files, zip files
 /// and on Android from the packed asset files.
 /// To identify the file:
 /// - If the filename starts with '$' it will try to load a system specific file. For Android this is a file in the .apk
 /// - If the above are false then try to load a regular C file
+/// Regular files opened with FileOpenFlag::MMAP are mapped to memory. They are read with memcpy and map() gives views
+/// to their data without copying. Empty files and files that fail to map are opened as regular files.
 class File : public NonCopyable
 {
 public:
@@ -80,6 +94,13 @@ public:
 	/// Read data from the file
 	ANKI_USE_RESULT Error read(void* buff, PtrSize size);
 
+	/// Read data from a position of the file. It doesn't move the position indicator. On POSIX it can be called for the
+	/// same file from many threads at the same time. On the other platforms it can't.
+	/// @param offset The offset from the beginning of the file.
+	/// @param[out] buff Where to read to.
+	/// @param size The number of bytes to read.
+	ANKI_USE_RESULT Error readAt(PtrSize offset, void* buff, PtrSize size);
+
 	/// Read all the contents of a text file
 	/// If the file is not rewined it will probably fail
 	ANKI_USE_RESULT Error readAllText(GenericMemoryPoolAllocator<U8> alloc, String& out);
@@ -107,19 +128,42 @@ public:
 	/// The the size of the file.
 	PtrSize getSize() const;
 
+	/// Return true if the file is mapped to memory and map() can be used.
+	Bool isMapped() const
+	{
+		return m_type == Type::MMAP;
+	}
+
+	/// Get a read-only view of a part of a mapped file. It doesn't copy and it doesn't move the position indicator.
+	/// The view is valid until the file is closed.
+	/// @param offset The offset from the beginning of the file.
+	/// @param size The size of the view.
+	/// @param[out] data The view.
+	ANKI_USE_RESULT Error map(PtrSize offset, PtrSize size, ConstWeakArray<U8>& data) const;
+
+	/// Hint the OS about how a part of a mapped file will be accessed. It does nothing if the file is not mapped.
+	void adviseAccess(PtrSize offset, PtrSize size, FileAccessHint hint);
+
+#if ANKI_POSIX
+	/// Get the file descriptor of a regular C file. Mapped files and files of other types return -1.
+	int getFileDescriptor() const;
+#endif
+
 private:
 	/// Internal filetype
 	enum class Type : U8
 	{
 		NONE = 0,
 		C, ///< C file
+		MMAP, ///< Memory mapped C file
 		SPECIAL ///< For example file is located in the android apk
 	};
 
-	void* m_file = nullptr; ///< A native file type
+	void* m_file = nullptr; ///< A native file type. The mapped memory for mapped files
 	Type m_type = Type::NONE;
 	FileOpenFlag m_flags = FileOpenFlag::NONE; ///< All the flags. Set on open
-	U32 m_size = 0;
+	PtrSize m_size = 0;
+	PtrSize m_mappedPos = 0; ///< The position indicator of mapped files.
 
 	/// Get the current machine's endianness
 	static FileOpenFlag getMachineEndianness();
@@ -134,6 +178,11 @@ private:
 	/// Open a C file
 	ANKI_USE_RESULT Error openCFile(const CString& filename, FileOpenFlag flags);
 
+#if ANKI_POSIX
+	/// Open and map a C file
+	ANKI_USE_RESULT Error openMappedFile(const CString& filename, FileOpenFlag flags);
+#endif
+
 #if ANKI_OS == ANKI_OS_ANDROID
 	/// Open an Android file
 	ANKI_USE_RESULT Error openAndroidFile(const CString& filename, FileOpenFlag flags);
@@ -145,6 +194,7 @@ private:
 		m_type = Type::NONE;
 		m_flags = FileOpenFlag::NONE;
 		m_size = 0;
+		m_mappedPos = 0;
 	}
 };
 /// @}
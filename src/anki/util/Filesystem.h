@@ -25,6 +25,10 @@ void getFilepathFilename(const CString& filename, StringAuto& out);
 /// Return true if directory exists?
 Bool directoryExists(const CString& dir);
 
+/// Get the last modification time of a file. The units depend on the platform so only compare the times of the same
+/// platform.
+ANKI_USE_RESULT Error getFileModificationTime(const CString& filename, U64& time);
+
 /// Callback for the @ref walkDirectoryTree.
 /// @param filename The file or directory name.
 /// @param userData User data passed to walkDirectoryTree.
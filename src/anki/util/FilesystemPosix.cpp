@@ -48,6 +48,23 @@ Bool directoryExists(const CString& filename)
 	}
 }
 
+Error getFileModificationTime(const CString& filename, U64& time)
+{
+	struct stat s;
+	if(stat(filename.get(), &s) != 0)
+	{
+		ANKI_UTIL_LOGE("stat() failed: %s", filename.get());
+		return Error::FUNCTION_FAILED;
+	}
+
+#if ANKI_OS == ANKI_OS_MACOS
+	time = U64(s.st_mtimespec.tv_sec) * 1000000000 + U64(s.st_mtimespec.tv_nsec);
+#else
+	time = U64(s.st_mtim.tv_sec) * 1000000000 + U64(s.st_mtim.tv_nsec);
+#endif
+	return Error::NONE;
+}
+
 Error walkDirectoryTree(const CString& dir, void* userData, WalkDirectoryTreeCallback callback)
 {
 	ANKI_ASSERT(callback != nullptr);
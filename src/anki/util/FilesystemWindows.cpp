@@ -33,6 +33,19 @@ Bool directoryExists(const CString& filename)
 	return dwAttrib != INVALID_FILE_ATTRIBUTES && (dwAttrib & FILE_ATTRIBUTE_DIRECTORY);
 }
 
+Error getFileModificationTime(const CString& filename, U64& time)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if(!GetFileAttributesEx(filename.get(), GetFileExInfoStandard, &data))
+	{
+		ANKI_UTIL_LOGE("GetFileAttributesEx() failed: %s", filename.get());
+		return Error::FUNCTION_FAILED;
+	}
+
+	time = (U64(data.ftLastWriteTime.dwHighDateTime) << 32) | U64(data.ftLastWriteTime.dwLowDateTime);
+	return Error::NONE;
+}
+
 Error removeDirectory(const CString& dirname)
 {
 	// For some reason dirname should be double null terminated
@@ -0,0 +1,362 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/util/HashMap.h>
+#include <cstring>
+
+#if ANKI_SIMD == ANKI_SIMD_SSE
+#	include <emmintrin.h>
+#elif ANKI_SIMD == ANKI_SIMD_NEON
+#	include <arm_neon.h>
+#endif
+
+namespace anki
+{
+
+/// @addtogroup util_containers
+/// @{
+
+/// The default hasher of FlatHashMap. It forwards to DefaultHasher of the type it's given so a map can be searched with
+/// a different type than its key (eg search a String map with a CString) as long as the two types hash the same.
+class FlatHashMapHasher
+{
+public:
+	template<typename T>
+	U64 operator()(const T& a) const
+	{
+		return DefaultHasher<T>()(a);
+	}
+};
+
+/// The control bytes of a group of slots of FlatHashMap. @memberof FlatHashMap
+class alignas(16) FlatHashMapGroup
+{
+public:
+	static constexpr U32 SLOT_COUNT = 15;
+	static constexpr U8 EMPTY = 0x80;
+
+	/// The top bit is set if the slot is empty else it holds 7 bits of the hash of the key.
+	Array<U8, SLOT_COUNT> m_ctrl;
+
+	/// The number of keys that wanted to be in this group but found it full. The search of a key stops at the first
+	/// group without overflows. It saturates.
+	U8 m_overflowCount;
+
+	/// Get a bit mask of the slots whose control byte is equal to a value.
+	U32 match(U8 ctrl) const
+	{
+#if ANKI_SIMD == ANKI_SIMD_SSE
+		const __m128i all = _mm_load_si128(reinterpret_cast<const __m128i*>(this));
+		const __m128i eq = _mm_cmpeq_epi8(all, _mm_set1_epi8(I8(ctrl)));
+		return U32(_mm_movemask_epi8(eq)) & MASK;
+#elif ANKI_SIMD == ANKI_SIMD_NEON
+		static const U8 bits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+		const uint8x16_t eq = vceqq_u8(vld1q_u8(&m_ctrl[0]), vdupq_n_u8(ctrl));
+		const uint8x16_t masked = vandq_u8(eq, vld1q_u8(bits));
+		const uint8x8_t sum = vpadd_u8(vget_low_u8(masked), vget_high_u8(masked));
+		const uint8x8_t sum2 = vpadd_u8(sum, sum);
+		const uint8x8_t sum3 = vpadd_u8(sum2, sum2);
+		return (U32(vget_lane_u8(sum3, 0)) | (U32(vget_lane_u8(sum3, 1)) << 8)) & MASK;
+#else
+		U32 out = 0;
+		for(U32 i = 0; i < SLOT_COUNT; ++i)
+		{
+			out |= U32(m_ctrl[i] == ctrl) << i;
+		}
+		return out;
+#endif
+	}
+
+	/// Get a bit mask of the empty slots.
+	U32 matchEmpty() const
+	{
+#if ANKI_SIMD == ANKI_SIMD_SSE
+		const __m128i all = _mm_load_si128(reinterpret_cast<const __m128i*>(this));
+		return U32(_mm_movemask_epi8(all)) & MASK;
+#else
+		return match(EMPTY);
+#endif
+	}
+
+private:
+	static constexpr U32 MASK = (1u << SLOT_COUNT) - 1u;
+};
+
+static_assert(sizeof(FlatHashMapGroup) == 16, "The group is loaded with a single SIMD load");
+
+/// Open addressing hash map that keeps the keys and the values in a flat array. The slots are organized in groups of
+/// 15 and every group has a control byte per slot that holds 7 bits of the hash. A search compares all the control
+/// bytes of a group at once with SIMD and then compares the full keys of the few slots that matched. Instead of
+/// tombstones every group counts the keys that overflowed to the next groups so erase() leaves no trace behind.
+/// @tparam TKey The key. It should be comparable with operator==.
+/// @tparam TValue The value.
+/// @tparam THasher The hasher. See FlatHashMapHasher.
+template<typename TKey, typename TValue, typename THasher = FlatHashMapHasher>
+class FlatHashMap : public NonCopyable
+{
+public:
+	using Key = TKey;
+	using Value = TValue;
+	using Hasher = THasher;
+
+	static constexpr F32 MAX_LOAD_FACTOR = 0.875f;
+
+	/// Iterator. It dereferences to the value like HashMap's.
+	template<typename TMapPtr, typename TValuePtr, typename TValueRef>
+	class IteratorBase
+	{
+		friend class FlatHashMap;
+
+	public:
+		IteratorBase() = default;
+
+		/// Copy from a non-const iterator.
+		template<typename YMapPtr, typename YValuePtr, typename YValueRef>
+		IteratorBase(const IteratorBase<YMapPtr, YValuePtr, YValueRef>& b)
+			: m_map(b.m_map)
+			, m_slot(b.m_slot)
+		{
+		}
+
+		TValueRef operator*() const
+		{
+			return m_map->getSlot(m_slot).m_value;
+		}
+
+		TValuePtr operator->() const
+		{
+			return &m_map->getSlot(m_slot).m_value;
+		}
+
+		const TKey& getKey() const
+		{
+			return m_map->getSlot(m_slot).m_key;
+		}
+
+		IteratorBase& operator++()
+		{
+			m_slot = m_map->findOccupiedSlot(m_slot + 1);
+			return *this;
+		}
+
+		IteratorBase operator++(int)
+		{
+			IteratorBase out = *this;
+			++(*this);
+			return out;
+		}
+
+		Bool operator==(const IteratorBase& b) const
+		{
+			return m_slot == b.m_slot;
+		}
+
+		Bool operator!=(const IteratorBase& b) const
+		{
+			return !(*this == b);
+		}
+
+	private:
+		template<typename, typename, typename>
+		friend class IteratorBase;
+
+		TMapPtr m_map = nullptr;
+		U32 m_slot = MAX_U32;
+
+		IteratorBase(TMapPtr map, U32 slot)
+			: m_map(map)
+			, m_slot(slot)
+		{
+		}
+	};
+
+	using Iterator = IteratorBase<FlatHashMap*, TValue*, TValue&>;
+	using ConstIterator = IteratorBase<const FlatHashMap*, const TValue*, const TValue&>;
+
+	FlatHashMap() = default;
+
+	/// Move.
+	FlatHashMap(FlatHashMap&& b)
+	{
+		*this = std::move(b);
+	}
+
+	/// You need to manually destroy the map.
+	/// @see FlatHashMap::destroy
+	~FlatHashMap()
+	{
+		ANKI_ASSERT(m_groups == nullptr && "Forgot to destroy");
+	}
+
+	/// Move.
+	FlatHashMap& operator=(FlatHashMap&& b)
+	{
+		ANKI_ASSERT(m_groups == nullptr && "Forgot to destroy");
+		m_groups = b.m_groups;
+		m_slots = b.m_slots;
+		m_groupCount = b.m_groupCount;
+		m_elementCount = b.m_elementCount;
+		b.m_groups = nullptr;
+		b.m_slots = nullptr;
+		b.m_groupCount = 0;
+		b.m_elementCount = 0;
+		return *this;
+	}
+
+	Iterator getBegin()
+	{
+		return Iterator(this, findOccupiedSlot(0));
+	}
+
+	ConstIterator getBegin() const
+	{
+		return ConstIterator(this, findOccupiedSlot(0));
+	}
+
+	Iterator getEnd()
+	{
+		return Iterator(this, MAX_U32);
+	}
+
+	ConstIterator getEnd() const
+	{
+		return ConstIterator(this, MAX_U32);
+	}
+
+	Iterator begin()
+	{
+		return getBegin();
+	}
+
+	ConstIterator begin() const
+	{
+		return getBegin();
+	}
+
+	Iterator end()
+	{
+		return getEnd();
+	}
+
+	ConstIterator end() const
+	{
+		return getEnd();
+	}
+
+	Bool isEmpty() const
+	{
+		return m_elementCount == 0;
+	}
+
+	U32 getSize() const
+	{
+		return m_elementCount;
+	}
+
+	/// Destroy the map.
+	template<typename TAllocator>
+	void destroy(TAllocator alloc);
+
+	/// Construct an element inside the map. If the key is already in the map nothing happens.
+	/// @return An iterator to the element with that key.
+	template<typename TAllocator, typename... TArgs>
+	Iterator emplace(TAllocator alloc, const TKey& key, TArgs&&... args);
+
+	/// Erase an element.
+	template<typename TAllocator>
+	void erase(TAllocator alloc, Iterator it);
+
+	/// Find a value using a key. The key can be of a different type than TKey if THasher can hash it and it can be
+	/// compared with TKey.
+	template<typename TLookupKey>
+	Iterator find(const TLookupKey& key)
+	{
+		return Iterator(this, findSlot(key));
+	}
+
+	/// Find a value using a key. See the non-const version.
+	template<typename TLookupKey>
+	ConstIterator find(const TLookupKey& key) const
+	{
+		return ConstIterator(this, findSlot(key));
+	}
+
+	/// Reserve space for a number of elements.
+	template<typename TAllocator>
+	void reserve(TAllocator alloc, U32 elementCount);
+
+private:
+	class Slot
+	{
+	public:
+		TKey m_key;
+		TValue m_value;
+
+		template<typename... TArgs>
+		Slot(const TKey& key, TArgs&&... args)
+			: m_key(key)
+			, m_value(std::forward<TArgs>(args)...)
+		{
+		}
+	};
+
+	FlatHashMapGroup* m_groups = nullptr;
+	Slot* m_slots = nullptr; ///< Not constructed unless the slot is occupied.
+	U32 m_groupCount = 0; ///< Power of two.
+	U32 m_elementCount = 0;
+
+	Slot& getSlot(U32 slot)
+	{
+		ANKI_ASSERT(slot < m_groupCount * FlatHashMapGroup::SLOT_COUNT);
+		return m_slots[slot];
+	}
+
+	const Slot& getSlot(U32 slot) const
+	{
+		ANKI_ASSERT(slot < m_groupCount * FlatHashMapGroup::SLOT_COUNT);
+		return m_slots[slot];
+	}
+
+	/// Mix the bits of the hash because a lot of hashers are just the identity.
+	template<typename TLookupKey>
+	static U64 computeHash(const TLookupKey& key)
+	{
+		U64 h = THasher()(key);
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		return h;
+	}
+
+	static U8 getControl(U64 hash)
+	{
+		return U8(hash & 0x7F);
+	}
+
+	U32 getHomeGroup(U64 hash) const
+	{
+		return U32(hash >> 7) & (m_groupCount - 1);
+	}
+
+	/// Get the slot index of a key or MAX_U32.
+	template<typename TLookupKey>
+	U32 findSlot(const TLookupKey& key) const;
+
+	/// Find the first occupied slot starting from a slot. MAX_U32 if there is none.
+	U32 findOccupiedSlot(U32 slot) const;
+
+	/// Insert a new key without checking if it's there.
+	U32 insertSlot(U64 hash);
+
+	template<typename TAllocator>
+	void grow(TAllocator alloc, U32 groupCount);
+};
+/// @}
+
+} // end namespace anki
+
+#include <anki/util/FlatHashMap.inl.h>
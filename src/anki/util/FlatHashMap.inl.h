@@ -0,0 +1,235 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/util/FlatHashMap.h>
+
+namespace anki
+{
+
+template<typename TKey, typename TValue, typename THasher>
+template<typename TAllocator>
+void FlatHashMap<TKey, TValue, THasher>::destroy(TAllocator alloc)
+{
+	if(m_groups)
+	{
+		for(U32 slot = findOccupiedSlot(0); slot != MAX_U32; slot = findOccupiedSlot(slot + 1))
+		{
+			m_slots[slot].~Slot();
+		}
+
+		alloc.deallocate(m_groups, m_groupCount);
+		alloc.deallocate(m_slots, m_groupCount * FlatHashMapGroup::SLOT_COUNT);
+		m_groups = nullptr;
+		m_slots = nullptr;
+	}
+
+	m_groupCount = 0;
+	m_elementCount = 0;
+}
+
+template<typename TKey, typename TValue, typename THasher>
+template<typename TAllocator, typename... TArgs>
+typename FlatHashMap<TKey, TValue, THasher>::Iterator FlatHashMap<TKey, TValue, THasher>::emplace(
+	TAllocator alloc, const TKey& key, TArgs&&... args)
+{
+	U32 slot = findSlot(key);
+	if(slot != MAX_U32)
+	{
+		return Iterator(this, slot);
+	}
+
+	// Grow if the new element exceeds the load factor
+	const U32 capacity = m_groupCount * FlatHashMapGroup::SLOT_COUNT;
+	if(F32(m_elementCount + 1) > F32(capacity) * MAX_LOAD_FACTOR)
+	{
+		grow(alloc, max<U32>(1, m_groupCount * 2));
+	}
+
+	slot = insertSlot(computeHash(key));
+	::new(&m_slots[slot]) Slot(key, std::forward<TArgs>(args)...);
+	++m_elementCount;
+
+	return Iterator(this, slot);
+}
+
+template<typename TKey, typename TValue, typename THasher>
+template<typename TAllocator>
+void FlatHashMap<TKey, TValue, THasher>::erase(TAllocator alloc, Iterator it)
+{
+	ANKI_ASSERT(it.m_map == this && it.m_slot != MAX_U32);
+	const U32 slot = it.m_slot;
+	const U32 slotGroup = slot / FlatHashMapGroup::SLOT_COUNT;
+	FlatHashMapGroup& group = m_groups[slotGroup];
+	ANKI_ASSERT(group.m_ctrl[slot % FlatHashMapGroup::SLOT_COUNT] != FlatHashMapGroup::EMPTY);
+
+	// Undo the overflows the key caused on its way from its home group
+	const U64 hash = computeHash(m_slots[slot].m_key);
+	U32 g = getHomeGroup(hash);
+	for(U32 i = 1; g != slotGroup; ++i)
+	{
+		ANKI_ASSERT(m_groups[g].m_overflowCount > 0);
+		if(m_groups[g].m_overflowCount != MAX_U8)
+		{
+			--m_groups[g].m_overflowCount;
+		}
+
+		g = (g + i) & (m_groupCount - 1);
+	}
+
+	m_slots[slot].~Slot();
+	group.m_ctrl[slot % FlatHashMapGroup::SLOT_COUNT] = FlatHashMapGroup::EMPTY;
+	--m_elementCount;
+}
+
+template<typename TKey, typename TValue, typename THasher>
+template<typename TAllocator>
+void FlatHashMap<TKey, TValue, THasher>::reserve(TAllocator alloc, U32 elementCount)
+{
+	U32 groupCount = max<U32>(1, m_groupCount);
+	while(F32(elementCount) > F32(groupCount * FlatHashMapGroup::SLOT_COUNT) * MAX_LOAD_FACTOR)
+	{
+		groupCount *= 2;
+	}
+
+	if(groupCount != m_groupCount)
+	{
+		grow(alloc, groupCount);
+	}
+}
+
+template<typename TKey, typename TValue, typename THasher>
+template<typename TLookupKey>
+U32 FlatHashMap<TKey, TValue, THasher>::findSlot(const TLookupKey& key) const
+{
+	if(m_elementCount == 0)
+	{
+		return MAX_U32;
+	}
+
+	const U64 hash = computeHash(key);
+	const U8 ctrl = getControl(hash);
+	U32 g = getHomeGroup(hash);
+
+	// Triangular probing, it visits all the groups if their count is a power of two
+	for(U32 i = 1; i <= m_groupCount; ++i)
+	{
+		const FlatHashMapGroup& group = m_groups[g];
+
+		U32 mask = group.match(ctrl);
+		while(mask)
+		{
+			const U32 slot = g * FlatHashMapGroup::SLOT_COUNT + getLeastSignificantBit(mask);
+			if(m_slots[slot].m_key == key)
+			{
+				return slot;
+			}
+
+			mask &= mask - 1;
+		}
+
+		if(group.m_overflowCount == 0)
+		{
+			break;
+		}
+
+		g = (g + i) & (m_groupCount - 1);
+	}
+
+	return MAX_U32;
+}
+
+template<typename TKey, typename TValue, typename THasher>
+U32 FlatHashMap<TKey, TValue, THasher>::findOccupiedSlot(U32 slot) const
+{
+	const U32 slotCount = m_groupCount * FlatHashMapGroup::SLOT_COUNT;
+	while(slot < slotCount)
+	{
+		const U32 g = slot / FlatHashMapGroup::SLOT_COUNT;
+		const U32 bit = slot % FlatHashMapGroup::SLOT_COUNT;
+
+		// Check the rest of the group at once
+		const U32 occupied = ~m_groups[g].matchEmpty() & ((1u << FlatHashMapGroup::SLOT_COUNT) - 1u) & (~0u << bit);
+		if(occupied)
+		{
+			return g * FlatHashMapGroup::SLOT_COUNT + getLeastSignificantBit(occupied);
+		}
+
+		slot = (g + 1) * FlatHashMapGroup::SLOT_COUNT;
+	}
+
+	return MAX_U32;
+}
+
+template<typename TKey, typename TValue, typename THasher>
+U32 FlatHashMap<TKey, TValue, THasher>::insertSlot(U64 hash)
+{
+	U32 g = getHomeGroup(hash);
+	for(U32 i = 1;; ++i)
+	{
+		ANKI_ASSERT(i <= m_groupCount && "The load factor should leave empty slots");
+		FlatHashMapGroup& group = m_groups[g];
+
+		const U32 empty = group.matchEmpty();
+		if(empty)
+		{
+			const U32 bit = getLeastSignificantBit(empty);
+			group.m_ctrl[bit] = getControl(hash);
+			return g * FlatHashMapGroup::SLOT_COUNT + bit;
+		}
+
+		if(group.m_overflowCount != MAX_U8)
+		{
+			++group.m_overflowCount;
+		}
+
+		g = (g + i) & (m_groupCount - 1);
+	}
+}
+
+template<typename TKey, typename TValue, typename THasher>
+template<typename TAllocator>
+void FlatHashMap<TKey, TValue, THasher>::grow(TAllocator alloc, U32 groupCount)
+{
+	ANKI_ASSERT(isPowerOfTwo(groupCount) && groupCount * FlatHashMapGroup::SLOT_COUNT >= m_elementCount);
+
+	FlatHashMapGroup* oldGroups = m_groups;
+	Slot* oldSlots = m_slots;
+	const U32 oldGroupCount = m_groupCount;
+
+	m_groupCount = groupCount;
+	m_groups = static_cast<FlatHashMapGroup*>(
+		alloc.getMemoryPool().allocate(groupCount * sizeof(FlatHashMapGroup), alignof(FlatHashMapGroup)));
+	m_slots = static_cast<Slot*>(
+		alloc.getMemoryPool().allocate(groupCount * FlatHashMapGroup::SLOT_COUNT * sizeof(Slot), alignof(Slot)));
+
+	for(U32 g = 0; g < groupCount; ++g)
+	{
+		memset(&m_groups[g].m_ctrl[0], FlatHashMapGroup::EMPTY, FlatHashMapGroup::SLOT_COUNT);
+		m_groups[g].m_overflowCount = 0;
+	}
+
+	// Move the old elements
+	if(oldGroups)
+	{
+		for(U32 g = 0; g < oldGroupCount; ++g)
+		{
+			U32 occupied = ~oldGroups[g].matchEmpty() & ((1u << FlatHashMapGroup::SLOT_COUNT) - 1u);
+			while(occupied)
+			{
+				Slot& oldSlot = oldSlots[g * FlatHashMapGroup::SLOT_COUNT + getLeastSignificantBit(occupied)];
+				const U32 slot = insertSlot(computeHash(oldSlot.m_key));
+				::new(&m_slots[slot]) Slot(std::move(oldSlot));
+				oldSlot.~Slot();
+
+				occupied &= occupied - 1;
+			}
+		}
+
+		alloc.deallocate(oldGroups, oldGroupCount);
+		alloc.deallocate(oldSlots, oldGroupCount * FlatHashMapGroup::SLOT_COUNT);
+	}
+}
+
+} // end namespace anki
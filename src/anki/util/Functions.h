@@ -16,6 +16,9 @@
 #include <cstring>
 #include <algorithm>
 #include <functional>
+#if ANKI_COMPILER == ANKI_COMPILER_MSVC
+#	include <intrin.h>
+#endif
 
 namespace anki
 {
@@ -72,6 +75,32 @@ inline Int nextPowerOfTwo(Int x)
 	return pow(2, ceil(log(x) / log(2)));
 }
 
+/// Get the index of the least significant set bit. For example if mask is 12 this will return 2.
+inline U32 getLeastSignificantBit(U32 mask)
+{
+	ANKI_ASSERT(mask);
+#if ANKI_COMPILER == ANKI_COMPILER_MSVC
+	unsigned long bit;
+	_BitScanForward(&bit, mask);
+	return U32(bit);
+#else
+	return U32(__builtin_ctz(mask));
+#endif
+}
+
+/// 64bit version of getLeastSignificantBit.
+inline U32 getLeastSignificantBit(U64 mask)
+{
+	ANKI_ASSERT(mask);
+#if ANKI_COMPILER == ANKI_COMPILER_MSVC
+	unsigned long bit;
+	_BitScanForward64(&bit, mask);
+	return U32(bit);
+#else
+	return U32(__builtin_ctzll(mask));
+#endif
+}
+
 /// Get the aligned number rounded up.
 /// @param alignment The bytes of alignment
 /// @param value The value to align
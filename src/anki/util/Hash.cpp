@@ -5,63 +5,374 @@
 
 #include <anki/util/Hash.h>
 #include <anki/util/Assert.h>
+#include <cstring>
+
+#if ANKI_SIMD == ANKI_SIMD_SSE
+#	include <emmintrin.h>
+#elif ANKI_SIMD == ANKI_SIMD_NEON
+#	include <arm_neon.h>
+#endif
+
+#if ANKI_COMPILER == ANKI_COMPILER_MSVC
+#	include <intrin.h>
+#endif
 
 namespace anki
 {
 
-const U64 HASH_M = 0xc6a4a7935bd1e995;
-const U64 HASH_R = 47;
+const U64 PRIME32_1 = 0x9E3779B1u;
+const U64 PRIME32_2 = 0x85EBCA77u;
+const U64 PRIME32_3 = 0xC2B2AE3Du;
+const U64 PRIME64_1 = 0x9E3779B185EBCA87ull;
+const U64 PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+const U64 PRIME64_3 = 0x165667B19E3779F9ull;
+const U64 PRIME64_4 = 0x85EBCA77C2B2AE63ull;
+const U64 PRIME64_5 = 0x27D4EB2F165667C5ull;
+
+const PtrSize STRIPE_SIZE = 64;
+const PtrSize SECRET_SIZE = 192;
+const PtrSize STRIPES_PER_BLOCK = (SECRET_SIZE - STRIPE_SIZE) / 8;
+const PtrSize BLOCK_SIZE = STRIPES_PER_BLOCK * STRIPE_SIZE;
+const PtrSize MID_SIZE_MAX = 240;
+
+/// Random bytes that key the input. The big buffers are hashed with a copy that has the seed mixed in.
+alignas(16) static const U64 SECRET[SECRET_SIZE / sizeof(U64)] = {0x2cb0f69f4abea221ull,
+	0x9417034723148989ull,
+	0xdd555950609dfe03ull,
+	0xdbafb150deb12800ull,
+	0x7e789b2e6c442cb6ull,
+	0xf41e5636c7e4f8c4ull,
+	0x0959d150f8fba7e4ull,
+	0xa97316f13cdb9eeaull,
+	0x74cd8258f9520068ull,
+	0x55c74a62e116868bull,
+	0xd2f4c799a2023cbdull,
+	0xdf98cb79a37b51b9ull,
+	0x396f5885524f3905ull,
+	0xaf1d56386ca3b276ull,
+	0xa9ffbe6b5104e85aull,
+	0x6bd0c51b9fd533b3ull,
+	0x980ce91c50ab4b56ull,
+	0x28ac395780fe62c5ull,
+	0x768912e3a6bcedc7ull,
+	0x50b3e8c9332c7c88ull,
+	0xce3bbfe520bd47daull,
+	0xcba6c8e8e0bb7c4full,
+	0xbf194db8434a346dull,
+	0x7d8f2a7b60416d7full};
+
+static U64 read64(const U8* p)
+{
+	U64 out;
+	memcpy(&out, p, sizeof(out));
+	return out;
+}
+
+static U32 read32(const U8* p)
+{
+	U32 out;
+	memcpy(&out, p, sizeof(out));
+	return out;
+}
+
+static U64 rotl64(U64 x, U32 r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+/// Multiply two 64bit numbers into 128bits and fold the halves.
+static U64 mul128Fold64(U64 a, U64 b)
+{
+#if ANKI_COMPILER == ANKI_COMPILER_MSVC && defined(_M_X64)
+	U64 high;
+	const U64 low = _umul128(a, b, &high);
+	return low ^ high;
+#elif defined(__SIZEOF_INT128__)
+	__extension__ typedef unsigned __int128 U128;
+	const U128 product = U128(a) * U128(b);
+	return U64(product) ^ U64(product >> 64);
+#else
+	const U64 loLo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+	const U64 hiLo = (a >> 32) * (b & 0xFFFFFFFF);
+	const U64 loHi = (a & 0xFFFFFFFF) * (b >> 32);
+	const U64 hiHi = (a >> 32) * (b >> 32);
+	const U64 cross = (loLo >> 32) + (hiLo & 0xFFFFFFFF) + loHi;
+	const U64 high = (hiLo >> 32) + (cross >> 32) + hiHi;
+	const U64 low = (cross << 32) | (loLo & 0xFFFFFFFF);
+	return low ^ high;
+#endif
+}
 
-U64 appendHash(const void* buffer, U32 bufferSize, U64 h)
+static U64 avalanche(U64 h)
 {
-	const U64* data = static_cast<const U64*>(buffer);
-	const U64* end = data + (bufferSize / sizeof(U64));
+	h ^= h >> 37;
+	h *= 0x165667919E3779F9ull;
+	h ^= h >> 32;
+	return h;
+}
 
-	while(data != end)
+/// A stronger avalanche for the 4 to 8 byte inputs that don't get a multiplication of their own.
+static U64 rrmxmx(U64 h, PtrSize len)
+{
+	h ^= rotl64(h, 49) ^ rotl64(h, 24);
+	h *= 0x9FB21C651E98DF25ull;
+	h ^= (h >> 35) + len;
+	h *= 0x9FB21C651E98DF25ull;
+	h ^= h >> 28;
+	return h;
+}
+
+static U64 hash0To16(const U8* p, PtrSize len, const U8* secret, U64 seed)
+{
+	if(len > 8)
 	{
-		U64 k = *data++;
+		const U64 bitflip1 = (read64(secret + 24) ^ read64(secret + 32)) + seed;
+		const U64 bitflip2 = (read64(secret + 40) ^ read64(secret + 48)) - seed;
+		const U64 low = read64(p) ^ bitflip1;
+		const U64 high = read64(p + len - 8) ^ bitflip2;
+		return avalanche(len + rotl64(low, 32) + high + mul128Fold64(low, high));
+	}
+	else if(len >= 4)
+	{
+		seed ^= U64(U32(seed)) << 32;
+		const U64 bitflip = (read64(secret + 8) ^ read64(secret + 16)) - seed;
+		const U64 input = U64(read32(p + len - 4)) + (U64(read32(p)) << 32);
+		return rrmxmx(input ^ bitflip, len);
+	}
+	else if(len > 0)
+	{
+		const U32 combined = (U32(p[0]) << 16) | (U32(p[len >> 1]) << 24) | U32(p[len - 1]) | (U32(len) << 8);
+		const U64 bitflip = U64(read32(secret) ^ read32(secret + 4)) + seed;
+		return avalanche((U64(combined) ^ bitflip) * PRIME64_1);
+	}
+	else
+	{
+		return avalanche(seed ^ read64(secret + 56) ^ read64(secret + 64));
+	}
+}
+
+static U64 mix16(const U8* p, const U8* secret, U64 seed)
+{
+	return mul128Fold64(read64(p) ^ (read64(secret) + seed), read64(p + 8) ^ (read64(secret + 8) - seed));
+}
+
+static U64 hash17To240(const U8* p, PtrSize len, const U8* secret, U64 seed)
+{
+	U64 acc = len * PRIME64_1;
+
+	if(len <= 128)
+	{
+		// Mix from both ends so every byte is covered without a loop
+		if(len > 32)
+		{
+			if(len > 64)
+			{
+				if(len > 96)
+				{
+					acc += mix16(p + 48, secret + 96, seed);
+					acc += mix16(p + len - 64, secret + 112, seed);
+				}
+
+				acc += mix16(p + 32, secret + 64, seed);
+				acc += mix16(p + len - 48, secret + 80, seed);
+			}
 
-		k *= HASH_M;
-		k ^= k >> HASH_R;
-		k *= HASH_M;
+			acc += mix16(p + 16, secret + 32, seed);
+			acc += mix16(p + len - 32, secret + 48, seed);
+		}
 
-		h ^= k;
-		h *= HASH_M;
+		acc += mix16(p, secret, seed);
+		acc += mix16(p + len - 16, secret + 16, seed);
+		return avalanche(acc);
 	}
 
-	const U8* data2 = reinterpret_cast<const U8*>(data);
+	const PtrSize roundCount = len / 16;
+	for(PtrSize i = 0; i < 8; ++i)
+	{
+		acc += mix16(p + 16 * i, secret + 16 * i, seed);
+	}
+
+	acc = avalanche(acc);
 
-	switch(bufferSize & (sizeof(U64) - 1))
+	for(PtrSize i = 8; i < roundCount; ++i)
 	{
-	case 7:
-		h ^= static_cast<U64>(data2[6]) << 48;
-	case 6:
-		h ^= static_cast<U64>(data2[5]) << 40;
-	case 5:
-		h ^= static_cast<U64>(data2[4]) << 32;
-	case 4:
-		h ^= static_cast<U64>(data2[3]) << 24;
-	case 3:
-		h ^= static_cast<U64>(data2[2]) << 16;
-	case 2:
-		h ^= static_cast<U64>(data2[1]) << 8;
-	case 1:
-		h ^= static_cast<U64>(data2[0]);
-		h *= HASH_M;
-	};
+		acc += mix16(p + 16 * i, secret + 16 * (i - 8) + 3, seed);
+	}
 
-	h ^= h >> HASH_R;
-	h *= HASH_M;
-	h ^= h >> HASH_R;
+	acc += mix16(p + len - 16, secret + 136 - 17, seed);
+	return avalanche(acc);
+}
 
-	ANKI_ASSERT(h != 0);
-	return h;
+/// Consume a 64 byte stripe. Every 64bit lane gets the product of the halves of its keyed input and the unkeyed input
+/// of its neighbour lane.
+static void accumulateStripe(U64* ANKI_RESTRICT acc, const U8* ANKI_RESTRICT p, const U8* ANKI_RESTRICT secret)
+{
+#if ANKI_SIMD == ANKI_SIMD_SSE
+	__m128i* xacc = reinterpret_cast<__m128i*>(acc);
+	for(U i = 0; i < STRIPE_SIZE / 16; ++i)
+	{
+		const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p) + i);
+		const __m128i key = _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i);
+		const __m128i dataKey = _mm_xor_si128(data, key);
+		const __m128i dataKeyHigh = _mm_shuffle_epi32(dataKey, _MM_SHUFFLE(0, 3, 0, 1));
+		const __m128i product = _mm_mul_epu32(dataKey, dataKeyHigh);
+		const __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+		xacc[i] = _mm_add_epi64(product, _mm_add_epi64(xacc[i], swapped));
+	}
+#elif ANKI_SIMD == ANKI_SIMD_NEON
+	uint64x2_t* xacc = reinterpret_cast<uint64x2_t*>(acc);
+	for(U i = 0; i < STRIPE_SIZE / 16; ++i)
+	{
+		const uint64x2_t data = vreinterpretq_u64_u8(vld1q_u8(p + 16 * i));
+		const uint64x2_t key = vreinterpretq_u64_u8(vld1q_u8(secret + 16 * i));
+		const uint64x2_t dataKey = veorq_u64(data, key);
+		const uint64x2_t swapped = vextq_u64(data, data, 1);
+		xacc[i] = vmlal_u32(vaddq_u64(xacc[i], swapped), vmovn_u64(dataKey), vshrn_n_u64(dataKey, 32));
+	}
+#else
+	for(U i = 0; i < STRIPE_SIZE / 8; ++i)
+	{
+		const U64 data = read64(p + 8 * i);
+		const U64 dataKey = data ^ read64(secret + 8 * i);
+		acc[i ^ 1] += data;
+		acc[i] += (dataKey & 0xFFFFFFFF) * (dataKey >> 32);
+	}
+#endif
+}
+
+/// Scramble the accumulators after every block so the bits of the lanes don't pile up.
+static void scrambleAccumulators(U64* ANKI_RESTRICT acc, const U8* ANKI_RESTRICT secret)
+{
+#if ANKI_SIMD == ANKI_SIMD_SSE
+	__m128i* xacc = reinterpret_cast<__m128i*>(acc);
+	const __m128i prime = _mm_set1_epi32(I32(PRIME32_1));
+	for(U i = 0; i < STRIPE_SIZE / 16; ++i)
+	{
+		__m128i a = xacc[i];
+		a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+		a = _mm_xor_si128(a, _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i));
+
+		// There is no 64bit multiplication in SSE2, do it with two 32bit ones
+		const __m128i high = _mm_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1));
+		const __m128i productLow = _mm_mul_epu32(a, prime);
+		const __m128i productHigh = _mm_mul_epu32(high, prime);
+		xacc[i] = _mm_add_epi64(productLow, _mm_slli_epi64(productHigh, 32));
+	}
+#else
+	for(U i = 0; i < STRIPE_SIZE / 8; ++i)
+	{
+		U64 a = acc[i];
+		a ^= a >> 47;
+		a ^= read64(secret + 8 * i);
+		acc[i] = a * PRIME32_1;
+	}
+#endif
+}
+
+static U64 mergeAccumulators(const U64* acc, const U8* secret, U64 start)
+{
+	U64 result = start;
+	for(U i = 0; i < 4; ++i)
+	{
+		result += mul128Fold64(acc[2 * i] ^ read64(secret + 16 * i), acc[2 * i + 1] ^ read64(secret + 16 * i + 8));
+	}
+
+	return avalanche(result);
 }
 
-U64 computeHash(const void* buffer, U32 bufferSize, U64 seed)
+static Hash128 hashLong(const U8* p, PtrSize len, U64 seed)
 {
-	U64 h = seed ^ (bufferSize * HASH_M);
-	return appendHash(buffer, bufferSize, h);
+	ANKI_ASSERT(len > MID_SIZE_MAX);
+
+	// Mix the seed into the secret
+	alignas(16) U64 secretWithSeed[SECRET_SIZE / sizeof(U64)];
+	for(U i = 0; i < SECRET_SIZE / sizeof(U64); i += 2)
+	{
+		secretWithSeed[i] = SECRET[i] + seed;
+		secretWithSeed[i + 1] = SECRET[i + 1] - seed;
+	}
+	const U8* secret = reinterpret_cast<const U8*>(&secretWithSeed[0]);
+
+	alignas(16) U64 acc[8] = {PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3, PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1};
+
+	// Full blocks. Every stripe of a block uses the secret with a different offset
+	const PtrSize blockCount = (len - 1) / BLOCK_SIZE;
+	for(PtrSize b = 0; b < blockCount; ++b)
+	{
+		const U8* block = p + b * BLOCK_SIZE;
+		for(PtrSize s = 0; s < STRIPES_PER_BLOCK; ++s)
+		{
+			accumulateStripe(acc, block + s * STRIPE_SIZE, secret + s * 8);
+		}
+
+		scrambleAccumulators(acc, secret + SECRET_SIZE - STRIPE_SIZE);
+	}
+
+	// The last partial block
+	const U8* block = p + blockCount * BLOCK_SIZE;
+	const PtrSize stripeCount = ((len - 1) - blockCount * BLOCK_SIZE) / STRIPE_SIZE;
+	for(PtrSize s = 0; s < stripeCount; ++s)
+	{
+		accumulateStripe(acc, block + s * STRIPE_SIZE, secret + s * 8);
+	}
+
+	// The last stripe might overlap with the previous one
+	accumulateStripe(acc, p + len - STRIPE_SIZE, secret + SECRET_SIZE - STRIPE_SIZE - 7);
+
+	Hash128 out;
+	out.m_low = mergeAccumulators(acc, secret + 11, len * PRIME64_1);
+	out.m_high = mergeAccumulators(acc, secret + SECRET_SIZE - STRIPE_SIZE - 11, ~(len * PRIME64_2));
+	return out;
+}
+
+static U64 hash64(const void* buffer, PtrSize len, U64 seed)
+{
+	ANKI_ASSERT(buffer || len == 0);
+	const U8* p = static_cast<const U8*>(buffer);
+	const U8* secret = reinterpret_cast<const U8*>(&SECRET[0]);
+
+	U64 h;
+	if(len <= 16)
+	{
+		h = hash0To16(p, len, secret, seed);
+	}
+	else if(len <= MID_SIZE_MAX)
+	{
+		h = hash17To240(p, len, secret, seed);
+	}
+	else
+	{
+		h = hashLong(p, len, seed).m_low;
+	}
+
+	// Zero is used by a lot of places as the "no hash" value
+	return (h != 0) ? h : PRIME64_5;
+}
+
+U64 computeHash(const void* buffer, PtrSize bufferSize, U64 seed)
+{
+	return hash64(buffer, bufferSize, seed);
+}
+
+U64 appendHash(const void* buffer, PtrSize bufferSize, U64 prevHash)
+{
+	// The previous hash becomes the seed. It's keyed into every part of the input
+	return hash64(buffer, bufferSize, prevHash);
+}
+
+Hash128 computeHash128(const void* buffer, PtrSize bufferSize, U64 seed)
+{
+	if(bufferSize > MID_SIZE_MAX)
+	{
+		// One pass gives both halves
+		return hashLong(static_cast<const U8*>(buffer), bufferSize, seed);
+	}
+
+	// Small buffers are cheap to hash twice with unrelated seeds
+	Hash128 out;
+	out.m_low = hash64(buffer, bufferSize, seed);
+	out.m_high = hash64(buffer, bufferSize, rotl64(seed, 29) ^ PRIME64_4);
+	return out;
 }
 
 } // end namespace anki
@@ -13,19 +13,65 @@ namespace anki
 /// @addtogroup util_other
 /// @{
 
-/// Computes a hash of a buffer. This function implements the MurmurHash2 algorithm by Austin Appleby.
+/// A 128bit hash. Use it for content addressed caches where a 64bit collision would go unnoticed.
+class Hash128
+{
+public:
+	U64 m_low = 0;
+	U64 m_high = 0;
+
+	Bool operator==(const Hash128& b) const
+	{
+		return m_low == b.m_low && m_high == b.m_high;
+	}
+
+	Bool operator!=(const Hash128& b) const
+	{
+		return !(*this == b);
+	}
+};
+
+/// Computes a hash of a buffer. It's a variation of the XXH3 algorithm by Yann Collet. Small buffers are mixed with a
+/// few multiplications and big buffers are consumed in 64 byte stripes with SIMD. The hash is never zero.
 /// @param[in] buffer The buffer to hash.
 /// @param bufferSize The size of the buffer.
 /// @param seed A unique seed.
 /// @return The hash.
-ANKI_USE_RESULT U64 computeHash(const void* buffer, U32 bufferSize, U64 seed = 123);
+ANKI_USE_RESULT U64 computeHash(const void* buffer, PtrSize bufferSize, U64 seed = 123);
 
-/// Computes a hash of a buffer. This function implements the MurmurHash2 algorithm by Austin Appleby.
+/// Computes a hash of a buffer and combines it with a previous hash. See computeHash().
 /// @param[in] buffer The buffer to hash.
 /// @param bufferSize The size of the buffer.
 /// @param prevHash The hash to append to.
 /// @return The new hash.
-ANKI_USE_RESULT U64 appendHash(const void* buffer, U32 bufferSize, U64 prevHash);
+ANKI_USE_RESULT U64 appendHash(const void* buffer, PtrSize bufferSize, U64 prevHash);
+
+/// Computes a 128bit hash of a buffer. It costs the same as computeHash() for big buffers. See computeHash().
+/// @param[in] buffer The buffer to hash.
+/// @param bufferSize The size of the buffer.
+/// @param seed A unique seed.
+/// @return The hash.
+ANKI_USE_RESULT Hash128 computeHash128(const void* buffer, PtrSize bufferSize, U64 seed = 123);
+
+/// Computes the hash of a string at compile time. Use it for static names, eg
+/// @code
+/// constexpr U64 NAME_HASH = computeStringHash("name");
+/// @endcode
+/// It's FNV-1a so it's not the same as computeHash() of the string and it's not meant for long strings.
+/// @param[in] str The string.
+/// @return The hash.
+constexpr U64 computeStringHash(const char* str)
+{
+	U64 h = 0xcbf29ce484222325;
+	while(*str != '\0')
+	{
+		h ^= U64(U8(*str));
+		h *= 0x100000001b3;
+		++str;
+	}
+
+	return h;
+}
 /// @}
 
 } // end namespace anki
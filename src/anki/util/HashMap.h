@@ -38,6 +38,17 @@ public:
 	}
 };
 
+/// Specialization for U32 keys.
+template<>
+class DefaultHasher<U32>
+{
+public:
+	U64 operator()(const U32 a) const
+	{
+		return a;
+	}
+};
+
 /// Hash map template.
 template<typename TKey, typename TValue, typename THasher = DefaultHasher<TKey>>
 class HashMap
@@ -0,0 +1,588 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/util/IoService.h>
+#include <anki/util/Logger.h>
+#include <anki/util/Array.h>
+#include <cstring>
+#if ANKI_OS == ANKI_OS_LINUX
+#	include <linux/io_uring.h>
+#	include <sys/syscall.h>
+#	include <sys/mman.h>
+#	include <sys/eventfd.h>
+#	include <sys/uio.h>
+#	include <poll.h>
+#	include <unistd.h>
+#	include <cerrno>
+#endif
+
+namespace anki
+{
+
+Error IoBatch::wait()
+{
+	LockGuard<Mutex> lock(m_mtx);
+	while(!m_complete)
+	{
+		m_condVar.wait(m_mtx);
+	}
+
+	return (m_failed.load()) ? Error::FILE_ACCESS : Error::NONE;
+}
+
+#if ANKI_OS == ANKI_OS_LINUX
+/// The state of io_uring. There is no liburing so it talks to the kernel with the raw syscalls. It's used only by the
+/// io_uring thread.
+class IoService::Uring
+{
+public:
+	/// A read in flight.
+	class Slot
+	{
+	public:
+		IoBatch* m_batch = nullptr;
+		U32 m_requestIdx = 0;
+		int m_fd = -1;
+		PtrSize m_doneSize = 0; ///< Reads may complete partially so they are resubmitted.
+		iovec m_iovec;
+	};
+
+	static constexpr U32 ENTRY_COUNT = 64;
+	static constexpr U32 SLOT_COUNT = ENTRY_COUNT - 1; ///< One entry is for the poll of the eventfd.
+	static constexpr U64 POLL_USER_DATA = MAX_U64;
+	static constexpr PtrSize MAX_READ_SIZE = 1_GB; ///< Reads can't be bigger than 2GB.
+
+	Thread m_thread;
+
+	int m_ringFd = -1;
+	int m_eventFd = -1; ///< Written by the submitters to wake the thread.
+	U64 m_eventValue = 0;
+
+	void* m_sqRing = MAP_FAILED;
+	PtrSize m_sqRingSize = 0;
+	void* m_cqRing = MAP_FAILED;
+	PtrSize m_cqRingSize = 0;
+	void* m_sqes = MAP_FAILED;
+	PtrSize m_sqesSize = 0;
+
+	U32* m_sqTail = nullptr;
+	U32* m_sqMask = nullptr;
+	U32* m_sqArray = nullptr;
+	U32* m_cqHead = nullptr;
+	U32* m_cqTail = nullptr;
+	U32* m_cqMask = nullptr;
+	io_uring_cqe* m_cqes = nullptr;
+
+	U32 m_unsubmittedCount = 0;
+
+	Array<Slot, SLOT_COUNT> m_slots;
+	Array<U32, SLOT_COUNT> m_freeSlots;
+	U32 m_freeSlotCount = SLOT_COUNT;
+	Array<U32, SLOT_COUNT> m_retrySlots;
+	U32 m_retrySlotCount = 0;
+
+	Uring()
+		: m_thread("anki_iouring")
+	{
+		for(U32 i = 0; i < SLOT_COUNT; ++i)
+		{
+			m_freeSlots[i] = i;
+		}
+	}
+
+	io_uring_sqe& newSqe()
+	{
+		io_uring_sqe& sqe = static_cast<io_uring_sqe*>(m_sqes)[*m_sqTail & *m_sqMask];
+		memset(&sqe, 0, sizeof(sqe));
+		return sqe;
+	}
+
+	/// Make the entry of newSqe() visible to the kernel.
+	void commitSqe()
+	{
+		const U32 tail = *m_sqTail;
+		const U32 idx = tail & *m_sqMask;
+		m_sqArray[idx] = idx;
+		__atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+		++m_unsubmittedCount;
+	}
+
+	void pushRead(U32 slotIdx)
+	{
+		Slot& slot = m_slots[slotIdx];
+		const IoReadRequest& req = slot.m_batch->m_requests[slot.m_requestIdx];
+
+		slot.m_iovec.iov_base = static_cast<U8*>(req.m_buffer) + slot.m_doneSize;
+		slot.m_iovec.iov_len = min<PtrSize>(req.m_size - slot.m_doneSize, MAX_READ_SIZE);
+
+		io_uring_sqe& sqe = newSqe();
+		sqe.opcode = IORING_OP_READV;
+		sqe.fd = slot.m_fd;
+		sqe.off = req.m_offset + slot.m_doneSize;
+		sqe.addr = ptrToNumber(&slot.m_iovec);
+		sqe.len = 1;
+		sqe.user_data = slotIdx;
+		commitSqe();
+	}
+
+	void pushPoll()
+	{
+		io_uring_sqe& sqe = newSqe();
+		sqe.opcode = IORING_OP_POLL_ADD;
+		sqe.fd = m_eventFd;
+		sqe.poll_events = POLLIN;
+		sqe.user_data = POLL_USER_DATA;
+		commitSqe();
+	}
+};
+#endif
+
+IoService::~IoService()
+{
+	{
+		LockGuard<Mutex> lock(m_mtx);
+		m_quit = true;
+		m_condVar.notifyAll();
+	}
+
+#if ANKI_OS == ANKI_OS_LINUX
+	if(m_uring)
+	{
+		wakeUring();
+		Error err = m_uring->m_thread.join();
+		(void)err;
+		destroyUring();
+	}
+#endif
+
+	for(Thread* thread : m_threads)
+	{
+		Error err = thread->join();
+		(void)err;
+		m_alloc.deleteInstance(thread);
+	}
+	m_threads.destroy(m_alloc);
+
+	ANKI_ASSERT(m_pending.isEmpty());
+}
+
+Error IoService::init(GenericMemoryPoolAllocator<U8> alloc, U32 threadCount, Bool forceThreads)
+{
+	ANKI_ASSERT(threadCount > 0);
+	m_alloc = alloc;
+
+#if ANKI_OS == ANKI_OS_LINUX
+	if(!forceThreads && !initUring())
+	{
+		m_uring->m_thread.start(this, uringThreadCallback);
+		return Error::NONE;
+	}
+#endif
+
+#if !ANKI_POSIX
+	// File::readAt is not thread safe on the other platforms
+	threadCount = 1;
+#endif
+
+	m_threads.create(m_alloc, threadCount);
+	for(Thread*& thread : m_threads)
+	{
+		thread = m_alloc.newInstance<Thread>("anki_io");
+		thread->start(this, threadCallback);
+	}
+
+	return Error::NONE;
+}
+
+void IoService::submit(ConstWeakArray<IoReadRequest> requests, IoBatch& batch)
+{
+	ANKI_ASSERT(batch.isComplete() && "Can't submit a batch that is in flight");
+
+	{
+		LockGuard<Mutex> lock(batch.m_mtx);
+		batch.m_complete = false;
+	}
+	batch.m_failed.store(0);
+	batch.m_nextRequest = 0;
+
+	// The io_uring thread only talks to the kernel. The reads of mapped files are copies so do them here
+	U32 queuedCount = 0;
+	for(const IoReadRequest& req : requests)
+	{
+		ANKI_ASSERT(req.m_file && req.m_buffer && req.m_size > 0);
+		if(isQueued(req))
+		{
+			++queuedCount;
+		}
+		else if(req.m_file->readAt(req.m_offset, req.m_buffer, req.m_size))
+		{
+			batch.m_failed.store(1);
+		}
+	}
+
+	if(queuedCount == 0)
+	{
+		batch.m_pendingCount.store(1);
+		completeRequest(batch, Error::NONE);
+		return;
+	}
+
+	batch.m_requests.create(m_alloc, queuedCount);
+	queuedCount = 0;
+	for(const IoReadRequest& req : requests)
+	{
+		if(isQueued(req))
+		{
+			batch.m_requests[queuedCount++] = req;
+		}
+	}
+	batch.m_pendingCount.store(queuedCount);
+
+	{
+		LockGuard<Mutex> lock(m_mtx);
+		ANKI_ASSERT(!m_quit);
+		m_pending.pushBack(&batch);
+		m_condVar.notifyAll();
+	}
+
+#if ANKI_OS == ANKI_OS_LINUX
+	if(m_uring)
+	{
+		wakeUring();
+	}
+#endif
+}
+
+Bool IoService::isQueued(const IoReadRequest& req) const
+{
+#if ANKI_OS == ANKI_OS_LINUX
+	if(m_uring)
+	{
+		return req.m_file->getFileDescriptor() >= 0;
+	}
+#endif
+
+	return true;
+}
+
+Bool IoService::takeRequest(IoBatch*& batch, U32& requestIdx)
+{
+	if(m_pending.isEmpty())
+	{
+		return false;
+	}
+
+	batch = &m_pending.getFront();
+	requestIdx = batch->m_nextRequest++;
+	if(batch->m_nextRequest == batch->m_requests.getSize())
+	{
+		m_pending.popFront();
+	}
+
+	return true;
+}
+
+void IoService::completeRequest(IoBatch& batch, Error err)
+{
+	if(err)
+	{
+		batch.m_failed.store(1);
+	}
+
+	if(batch.m_pendingCount.fetchSub(1) > 1)
+	{
+		return;
+	}
+
+	// It's the last request. Call the callback before the batch is signaled so wait() covers it. Don't touch the batch
+	// after it's signaled because it might be deleted
+	batch.m_requests.destroy(m_alloc);
+	if(batch.m_callback)
+	{
+		batch.m_callback(batch.m_callbackUserData, (batch.m_failed.load()) ? Error::FILE_ACCESS : Error::NONE);
+	}
+
+	LockGuard<Mutex> lock(batch.m_mtx);
+	batch.m_complete = true;
+	batch.m_condVar.notifyAll();
+}
+
+Error IoService::threadCallback(ThreadCallbackInfo& info)
+{
+	static_cast<IoService*>(info.m_userData)->threadWorker();
+	return Error::NONE;
+}
+
+void IoService::threadWorker()
+{
+	while(true)
+	{
+		IoBatch* batch;
+		U32 requestIdx;
+
+		{
+			LockGuard<Mutex> lock(m_mtx);
+
+			while(m_pending.isEmpty() && !m_quit)
+			{
+				m_condVar.wait(m_mtx);
+			}
+
+			if(!takeRequest(batch, requestIdx))
+			{
+				// Quit and there is nothing left
+				break;
+			}
+		}
+
+		const IoReadRequest& req = batch->m_requests[requestIdx];
+		completeRequest(*batch, req.m_file->readAt(req.m_offset, req.m_buffer, req.m_size));
+	}
+}
+
+#if ANKI_OS == ANKI_OS_LINUX
+Error IoService::initUring()
+{
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	const int ringFd = int(syscall(__NR_io_uring_setup, Uring::ENTRY_COUNT, &params));
+	if(ringFd < 0)
+	{
+		ANKI_UTIL_LOGI("io_uring is not available, falling back to threads: %s", strerror(errno));
+		return Error::FUNCTION_FAILED;
+	}
+
+	m_uring = m_alloc.newInstance<Uring>();
+	Uring& u = *m_uring;
+	u.m_ringFd = ringFd;
+
+	// Map the rings
+	u.m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(U32);
+	u.m_sqRing = mmap(nullptr, u.m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED, ringFd, IORING_OFF_SQ_RING);
+
+	u.m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	u.m_cqRing = mmap(nullptr, u.m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED, ringFd, IORING_OFF_CQ_RING);
+
+	u.m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+	u.m_sqes = mmap(nullptr, u.m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED, ringFd, IORING_OFF_SQES);
+
+	u.m_eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+	if(u.m_sqRing == MAP_FAILED || u.m_cqRing == MAP_FAILED || u.m_sqes == MAP_FAILED || u.m_eventFd < 0)
+	{
+		ANKI_UTIL_LOGI("io_uring initialization failed, falling back to threads: %s", strerror(errno));
+		destroyUring();
+		return Error::FUNCTION_FAILED;
+	}
+
+	U8* sq = static_cast<U8*>(u.m_sqRing);
+	u.m_sqTail = reinterpret_cast<U32*>(sq + params.sq_off.tail);
+	u.m_sqMask = reinterpret_cast<U32*>(sq + params.sq_off.ring_mask);
+	u.m_sqArray = reinterpret_cast<U32*>(sq + params.sq_off.array);
+
+	U8* cq = static_cast<U8*>(u.m_cqRing);
+	u.m_cqHead = reinterpret_cast<U32*>(cq + params.cq_off.head);
+	u.m_cqTail = reinterpret_cast<U32*>(cq + params.cq_off.tail);
+	u.m_cqMask = reinterpret_cast<U32*>(cq + params.cq_off.ring_mask);
+	u.m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+	return Error::NONE;
+}
+
+void IoService::destroyUring()
+{
+	Uring& u = *m_uring;
+
+	if(u.m_sqes != MAP_FAILED)
+	{
+		munmap(u.m_sqes, u.m_sqesSize);
+	}
+
+	if(u.m_cqRing != MAP_FAILED)
+	{
+		munmap(u.m_cqRing, u.m_cqRingSize);
+	}
+
+	if(u.m_sqRing != MAP_FAILED)
+	{
+		munmap(u.m_sqRing, u.m_sqRingSize);
+	}
+
+	if(u.m_eventFd >= 0)
+	{
+		close(u.m_eventFd);
+	}
+
+	close(u.m_ringFd);
+
+	m_alloc.deleteInstance(m_uring);
+	m_uring = nullptr;
+}
+
+void IoService::wakeUring()
+{
+	const U64 one = 1;
+	const ssize_t ret = write(m_uring->m_eventFd, &one, sizeof(one));
+	(void)ret;
+}
+
+Error IoService::uringThreadCallback(ThreadCallbackInfo& info)
+{
+	static_cast<IoService*>(info.m_userData)->uringWorker();
+	return Error::NONE;
+}
+
+void IoService::uringWorker()
+{
+	Uring& u = *m_uring;
+	u.pushPoll();
+
+	while(true)
+	{
+		// Resubmit the partial reads
+		while(u.m_retrySlotCount > 0)
+		{
+			u.pushRead(u.m_retrySlots[--u.m_retrySlotCount]);
+		}
+
+		// Issue new reads while there is space
+		Bool quit = false;
+		while(u.m_freeSlotCount > 0)
+		{
+			IoBatch* batch;
+			U32 requestIdx;
+			{
+				LockGuard<Mutex> lock(m_mtx);
+				if(!takeRequest(batch, requestIdx))
+				{
+					quit = m_quit && u.m_freeSlotCount == Uring::SLOT_COUNT;
+					break;
+				}
+			}
+
+			const int fd = batch->m_requests[requestIdx].m_file->getFileDescriptor();
+			ANKI_ASSERT(fd >= 0 && "Mapped files are copied in submit()");
+
+			const U32 slotIdx = u.m_freeSlots[--u.m_freeSlotCount];
+			Uring::Slot& slot = u.m_slots[slotIdx];
+			slot.m_batch = batch;
+			slot.m_requestIdx = requestIdx;
+			slot.m_fd = fd;
+			slot.m_doneSize = 0;
+			u.pushRead(slotIdx);
+		}
+
+		if(quit)
+		{
+			break;
+		}
+
+		// Submit and wait for at least one completion. The poll of the eventfd completes when there is new work
+		const long ret =
+			syscall(__NR_io_uring_enter, u.m_ringFd, u.m_unsubmittedCount, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+		if(ret >= 0)
+		{
+			u.m_unsubmittedCount -= U32(ret);
+		}
+		else if(errno != EINTR && errno != EAGAIN && errno != EBUSY)
+		{
+			ANKI_UTIL_LOGE("io_uring_enter() failed, falling back to blocking reads: %s", strerror(errno));
+			uringFallback();
+			break;
+		}
+
+		// Process the completions
+		U32 head = *u.m_cqHead;
+		const U32 tail = __atomic_load_n(u.m_cqTail, __ATOMIC_ACQUIRE);
+		for(; head != tail; ++head)
+		{
+			const io_uring_cqe& cqe = u.m_cqes[head & *u.m_cqMask];
+
+			if(cqe.user_data == Uring::POLL_USER_DATA)
+			{
+				// Woken up. Reset the eventfd and poll again
+				const ssize_t readSize = read(u.m_eventFd, &u.m_eventValue, sizeof(u.m_eventValue));
+				(void)readSize;
+				u.pushPoll();
+				continue;
+			}
+
+			const U32 slotIdx = U32(cqe.user_data);
+			Uring::Slot& slot = u.m_slots[slotIdx];
+			const IoReadRequest& req = slot.m_batch->m_requests[slot.m_requestIdx];
+
+			Error err = Error::NONE;
+			Bool done = true;
+			if(cqe.res == -EINTR || cqe.res == -EAGAIN)
+			{
+				done = false;
+			}
+			else if(cqe.res < 0)
+			{
+				ANKI_UTIL_LOGE("File read failed: %s", strerror(-cqe.res));
+				err = Error::FILE_ACCESS;
+			}
+			else if(cqe.res == 0)
+			{
+				ANKI_UTIL_LOGE("File read failed: Unexpected end of file");
+				err = Error::FILE_ACCESS;
+			}
+			else
+			{
+				slot.m_doneSize += cqe.res;
+				done = slot.m_doneSize == req.m_size;
+			}
+
+			if(done)
+			{
+				completeRequest(*slot.m_batch, err);
+				u.m_freeSlots[u.m_freeSlotCount++] = slotIdx;
+			}
+			else
+			{
+				u.m_retrySlots[u.m_retrySlotCount++] = slotIdx;
+			}
+		}
+
+		__atomic_store_n(u.m_cqHead, head, __ATOMIC_RELEASE);
+	}
+}
+
+void IoService::uringFallback()
+{
+	Uring& u = *m_uring;
+
+	// Read the rest of the reads that were taken
+	Array<Bool8, Uring::SLOT_COUNT> freeSlots;
+	memset(&freeSlots[0], 0, sizeof(freeSlots));
+	for(U32 i = 0; i < u.m_freeSlotCount; ++i)
+	{
+		freeSlots[u.m_freeSlots[i]] = true;
+	}
+
+	for(U32 slotIdx = 0; slotIdx < Uring::SLOT_COUNT; ++slotIdx)
+	{
+		if(freeSlots[slotIdx])
+		{
+			continue;
+		}
+
+		Uring::Slot& slot = u.m_slots[slotIdx];
+		const IoReadRequest& req = slot.m_batch->m_requests[slot.m_requestIdx];
+		const PtrSize done = slot.m_doneSize;
+		const Error err =
+			req.m_file->readAt(req.m_offset + done, static_cast<U8*>(req.m_buffer) + done, req.m_size - done);
+		completeRequest(*slot.m_batch, err);
+	}
+
+	u.m_freeSlotCount = Uring::SLOT_COUNT;
+	u.m_retrySlotCount = 0;
+
+	// Then do the rest like the threads
+	threadWorker();
+}
+#endif
+
+} // end namespace anki
@@ -0,0 +1,164 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/util/File.h>
+#include <anki/util/Thread.h>
+#include <anki/util/List.h>
+#include <anki/util/DynamicArray.h>
+#include <anki/util/WeakArray.h>
+
+namespace anki
+{
+
+// Forward
+class IoService;
+
+/// @addtogroup util_file
+/// @{
+
+/// A read of the IoService.
+class IoReadRequest
+{
+public:
+	File* m_file = nullptr; ///< Opened for reading. It should stay open until the batch completes.
+	PtrSize m_offset = 0; ///< The offset from the beginning of the file.
+	PtrSize m_size = 0;
+	void* m_buffer = nullptr; ///< Where to read to.
+};
+
+/// Called when all the reads of an IoBatch complete, before the batch is signaled. It's called from a thread of the
+/// IoService so keep it short.
+/// @param userData The user data passed to IoBatch::setCallback.
+/// @param err An error if any of the reads failed.
+using IoBatchCallback = void (*)(void* userData, Error err);
+
+/// A number of reads that are submitted together and complete together. The batch is owned by the caller and it
+/// should stay alive until it completes. After it completes it can be submitted again.
+class IoBatch : public IntrusiveListEnabled<IoBatch>, public NonCopyable
+{
+	friend class IoService;
+
+public:
+	IoBatch() = default;
+
+	~IoBatch()
+	{
+		ANKI_ASSERT(m_pendingCount.load() == 0 && "Batch is not complete");
+	}
+
+	/// Set a callback that will be called when the batch completes. The batch is signaled after the callback returns so
+	/// wait() and isComplete() cover the callback as well. Don't delete or resubmit the batch inside the callback. Call
+	/// it before submitting the batch.
+	void setCallback(IoBatchCallback callback, void* userData)
+	{
+		ANKI_ASSERT(m_pendingCount.load() == 0);
+		m_callback = callback;
+		m_callbackUserData = userData;
+	}
+
+	/// Return true if all the reads completed.
+	Bool isComplete() const
+	{
+		LockGuard<Mutex> lock(m_mtx);
+		return m_complete;
+	}
+
+	/// Block until all the reads complete.
+	/// @return An error if any of the reads failed.
+	ANKI_USE_RESULT Error wait();
+
+private:
+	DynamicArray<IoReadRequest> m_requests; ///< A copy of the requests of the submit.
+	U32 m_nextRequest = 0; ///< The next request that will be issued. Protected by the lock of the IoService.
+	Atomic<U32> m_pendingCount = {0};
+	Atomic<U32> m_failed = {0};
+
+	IoBatchCallback m_callback = nullptr;
+	void* m_callbackUserData = nullptr;
+
+	mutable Mutex m_mtx;
+	ConditionVariable m_condVar;
+	Bool8 m_complete = true;
+};
+
+/// Reads files asynchronously. The reads are submitted in batches and they complete in any order so a loader can issue
+/// all of its reads at once and do other work while they are in flight. On Linux it uses io_uring. Where io_uring is
+/// not available it uses a number of threads that do blocking reads. If io_uring fails while it runs, the thread of
+/// io_uring finishes the reads with blocking reads.
+///
+/// Reads of regular files go to the kernel. Reads of mapped files are copies. With io_uring they are done by the thread
+/// that submits them. With the threads of the fallback they are done by those threads.
+class IoService : public NonCopyable
+{
+public:
+	IoService() = default;
+
+	/// Completes all the submitted reads and then stops the threads.
+	~IoService();
+
+	/// Initialize.
+	/// @param alloc The allocator of the copies of the requests.
+	/// @param threadCount The number of threads if io_uring is not available.
+	/// @param forceThreads Don't use io_uring even if it's available.
+	ANKI_USE_RESULT Error init(GenericMemoryPoolAllocator<U8> alloc, U32 threadCount = 2, Bool forceThreads = false);
+
+	/// Submit a number of reads. It's thread safe.
+	/// @param requests The reads. They are copied.
+	/// @param batch The batch that will be signaled when all the reads complete. It should be complete.
+	void submit(ConstWeakArray<IoReadRequest> requests, IoBatch& batch);
+
+	/// Return true if it uses io_uring.
+	Bool isUsingIoUring() const
+	{
+		return m_uring != nullptr;
+	}
+
+private:
+	class Uring;
+
+	GenericMemoryPoolAllocator<U8> m_alloc;
+	DynamicArray<Thread*> m_threads;
+	Uring* m_uring = nullptr;
+
+	Mutex m_mtx;
+	ConditionVariable m_condVar;
+	IntrusiveList<IoBatch> m_pending; ///< Batches that have requests that are not issued yet.
+	Bool8 m_quit = false;
+
+	static ANKI_USE_RESULT Error threadCallback(ThreadCallbackInfo& info);
+
+	/// The thread worker of the fallback.
+	void threadWorker();
+
+	/// Return false if the request is done in submit().
+	Bool isQueued(const IoReadRequest& req) const;
+
+	/// Get the next request that is not issued. Call it with m_mtx locked.
+	Bool takeRequest(IoBatch*& batch, U32& requestIdx);
+
+	void completeRequest(IoBatch& batch, Error err);
+
+#if ANKI_OS == ANKI_OS_LINUX
+	ANKI_USE_RESULT Error initUring();
+
+	void destroyUring();
+
+	static ANKI_USE_RESULT Error uringThreadCallback(ThreadCallbackInfo& info);
+
+	/// The thread worker of io_uring.
+	void uringWorker();
+
+	/// Wake the thread of io_uring.
+	void wakeUring();
+
+	/// Called by the thread of io_uring when io_uring fails. It completes the reads with blocking reads from then on.
+	void uringFallback();
+#endif
+};
+/// @}
+
+} // end namespace anki
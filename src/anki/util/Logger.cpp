@@ -6,6 +6,8 @@
 #include <anki/util/Logger.h>
 #include <anki/util/File.h>
 #include <anki/util/System.h>
+#include <anki/util/HighRezTimer.h>
+#include <anki/util/Hash.h>
 #include <cstring>
 #include <cstdarg>
 #include <cstdio>
@@ -19,34 +21,100 @@ namespace anki
 
 static const Array<const char*, static_cast<U>(Logger::MessageType::COUNT)> MSG_TEXT = {{"I", "E", "W", "F"}};
 
+/// Identical messages are written once every that many seconds with the number of repeats.
+static constexpr F64 DEDUPLICATION_PERIOD = 1.0;
+
+/// True for the sink thread. Its messages (eg from the handlers) are written synchronously.
+static thread_local Bool g_onSinkThread = false;
+
+class Logger::Record
+{
+public:
+	Atomic<U64> m_sequence; ///< The position the record is ready for. See the Vyukov's bounded queue.
+	U64 m_position;
+	Info m_info;
+	char* m_longMessage; ///< If the message doesn't fit in m_message. It's allocated with malloc.
+	U32 m_suppressedCount;
+	Array<char, RECORD_MESSAGE_SIZE> m_message;
+};
+
 Logger::Logger()
+	: m_sinkThread("anki_logger")
 {
 	addMessageHandler(this, &defaultSystemMessageHandler);
 }
 
 Logger::~Logger()
 {
+	stopAsync();
 }
 
 void Logger::addMessageHandler(void* data, MessageHandlerCallback callback)
 {
+	LockGuard<Mutex> lock(m_mutex);
+	ANKI_ASSERT(m_handlersCount < m_handlers.getSize());
 	m_handlers[m_handlersCount++] = Handler(data, callback);
 }
 
-void Logger::write(
-	const char* file, int line, const char* func, const char* subsystem, MessageType type, const char* msg)
+void Logger::removeMessageHandler(void* data, MessageHandlerCallback callback)
 {
-	m_mutex.lock();
+	LockGuard<Mutex> lock(m_mutex);
+	for(U32 i = 0; i < m_handlersCount; ++i)
+	{
+		if(m_handlers[i].m_data == data && m_handlers[i].m_callback == callback)
+		{
+			for(U32 j = i + 1; j < m_handlersCount; ++j)
+			{
+				m_handlers[j - 1] = m_handlers[j];
+			}
 
-	Info inf = {file, line, func, type, msg, subsystem};
+			--m_handlersCount;
+			break;
+		}
+	}
+}
+
+void Logger::addFileMessageHandler(File* file)
+{
+	addMessageHandler(file, &fileMessageHandler);
+}
+
+void Logger::callHandlers(const Info& info)
+{
+	LockGuard<Mutex> lock(m_mutex);
 
 	U count = m_handlersCount;
 	while(count-- != 0)
 	{
-		m_handlers[count].m_callback(m_handlers[count].m_data, inf);
+		m_handlers[count].m_callback(m_handlers[count].m_data, info);
+	}
+}
+
+void Logger::write(
+	const char* file, int line, const char* func, const char* subsystem, MessageType type, const char* msg)
+{
+	Bool async;
+	Record* record = beginAsyncWrite(file, line, func, subsystem, type, async);
+	if(async)
+	{
+		if(record)
+		{
+			const PtrSize len = strlen(msg);
+			char* out = &record->m_message[0];
+			if(len >= RECORD_MESSAGE_SIZE)
+			{
+				out = record->m_longMessage = static_cast<char*>(malloc(len + 1));
+			}
+
+			memcpy(out, msg, len + 1);
+		}
+
+		endAsyncWrite(record, type);
+		return;
 	}
 
-	m_mutex.unlock();
+	Info inf = {file, line, func, type, msg, subsystem};
+	callHandlers(inf);
 
 	if(type == MessageType::FATAL)
 	{
@@ -57,10 +125,41 @@ void Logger::write(
 void Logger::writeFormated(
 	const char* file, int line, const char* func, const char* subsystem, MessageType type, const char* fmt, ...)
 {
-	char buffer[1024 * 10];
 	va_list args;
-
 	va_start(args, fmt);
+
+	Bool async;
+	Record* record = beginAsyncWrite(file, line, func, subsystem, type, async);
+	if(async)
+	{
+		// Format straight to the ring buffer
+		if(record)
+		{
+			va_list argsCopy;
+			va_copy(argsCopy, args);
+
+			I len = vsnprintf(&record->m_message[0], RECORD_MESSAGE_SIZE, fmt, args);
+			if(len >= I(RECORD_MESSAGE_SIZE))
+			{
+				record->m_longMessage = static_cast<char*>(malloc(len + 1));
+				len = vsnprintf(record->m_longMessage, len + 1, fmt, argsCopy);
+			}
+
+			va_end(argsCopy);
+
+			if(len < 0)
+			{
+				fprintf(stderr, "Logger::writeFormated() failed. Will not recover");
+				abort();
+			}
+		}
+
+		va_end(args);
+		endAsyncWrite(record, type);
+		return;
+	}
+
+	char buffer[1024 * 10];
 	I len = vsnprintf(buffer, sizeof(buffer), fmt, args);
 	if(len < 0)
 	{
@@ -90,6 +189,364 @@ void Logger::writeFormated(
 	}
 }
 
+void Logger::startAsync(U32 recordCount, U32 rateLimit)
+{
+	ANKI_ASSERT(!isAsync());
+
+	recordCount = nextPowerOfTwo(max(recordCount, 2u));
+	m_ring = static_cast<Record*>(malloc(sizeof(Record) * recordCount));
+	for(U32 i = 0; i < recordCount; ++i)
+	{
+		::new(&m_ring[i]) Record();
+		m_ring[i].m_sequence.store(i);
+	}
+
+	m_ringMask = recordCount - 1;
+	m_writePos.store(0);
+	m_readPos.store(0);
+	m_rateLimit = rateLimit;
+	m_quit.store(false);
+
+	m_sinkThread.start(this, [](ThreadCallbackInfo& info) -> Error {
+		Logger& self = *static_cast<Logger*>(info.m_userData);
+		g_onSinkThread = true;
+
+		while(true)
+		{
+			if(self.drainRing() > 0)
+			{
+				continue;
+			}
+
+			// The ring buffer is empty
+			if(self.m_flushRequested.load(AtomicMemoryOrder::ACQUIRE))
+			{
+				self.flushRepeatedMessage();
+				self.m_flushRequested.store(false, AtomicMemoryOrder::RELEASE);
+			}
+
+			if(self.m_quit.load(AtomicMemoryOrder::ACQUIRE))
+			{
+				break;
+			}
+
+			if(self.m_repeatCount > 0)
+			{
+				// Don't sleep for long, the repeats should be written on time
+				if(HighRezTimer::getCurrentTime() - self.m_repeatTime >= DEDUPLICATION_PERIOD)
+				{
+					self.flushRepeatedMessage();
+				}
+				else
+				{
+					HighRezTimer::sleep(0.01);
+				}
+
+				continue;
+			}
+
+			LockGuard<Mutex> lock(self.m_sinkMtx);
+			self.m_sinkSleeping.store(true, AtomicMemoryOrder::SEQ_CST);
+			if(!self.isRecordReady() && !self.m_quit.load(AtomicMemoryOrder::SEQ_CST)
+				&& !self.m_flushRequested.load(AtomicMemoryOrder::SEQ_CST))
+			{
+				self.m_sinkCv.wait(self.m_sinkMtx);
+			}
+			self.m_sinkSleeping.store(false, AtomicMemoryOrder::SEQ_CST);
+		}
+
+		self.flushRepeatedMessage();
+		return Error::NONE;
+	});
+
+	m_async.store(true, AtomicMemoryOrder::SEQ_CST);
+}
+
+void Logger::stopAsync()
+{
+	if(!isAsync())
+	{
+		return;
+	}
+
+	// Wait for the threads that are writing to the ring buffer
+	m_async.store(false, AtomicMemoryOrder::SEQ_CST);
+	while(m_asyncWriterCount.load(AtomicMemoryOrder::SEQ_CST) > 0)
+	{
+		HighRezTimer::sleep(0.0001);
+	}
+
+	// The sink thread writes the rest and quits
+	m_quit.store(true, AtomicMemoryOrder::SEQ_CST);
+	{
+		LockGuard<Mutex> lock(m_sinkMtx);
+		m_sinkCv.notifyOne();
+	}
+
+	const Error err = m_sinkThread.join();
+	(void)err;
+
+	free(m_ring);
+	m_ring = nullptr;
+	m_ringMask = 0;
+}
+
+void Logger::flush()
+{
+	if(!isAsync() || g_onSinkThread)
+	{
+		return;
+	}
+
+	// Wait for the messages that were written before this call
+	const U64 writePos = m_writePos.load(AtomicMemoryOrder::SEQ_CST);
+	while(m_readPos.load(AtomicMemoryOrder::ACQUIRE) < writePos)
+	{
+		HighRezTimer::sleep(0.0001);
+	}
+
+	// And for the repeats
+	m_flushRequested.store(true, AtomicMemoryOrder::SEQ_CST);
+	{
+		LockGuard<Mutex> lock(m_sinkMtx);
+		m_sinkCv.notifyOne();
+	}
+
+	while(m_flushRequested.load(AtomicMemoryOrder::ACQUIRE))
+	{
+		HighRezTimer::sleep(0.0001);
+	}
+}
+
+Logger::Record* Logger::beginAsyncWrite(
+	const char* file, int line, const char* func, const char* subsystem, MessageType type, Bool& async)
+{
+	async = false;
+	if(g_onSinkThread)
+	{
+		return nullptr;
+	}
+
+	m_asyncWriterCount.fetchAdd(1, AtomicMemoryOrder::SEQ_CST);
+	if(!m_async.load(AtomicMemoryOrder::SEQ_CST))
+	{
+		m_asyncWriterCount.fetchSub(1, AtomicMemoryOrder::SEQ_CST);
+		return nullptr;
+	}
+
+	async = true;
+
+	U32 suppressedCount = 0;
+	if(type != MessageType::FATAL && !checkRateLimit(file, line, suppressedCount))
+	{
+		return nullptr;
+	}
+
+	Record* record = reserveRecord(type);
+	if(record)
+	{
+		record->m_info = {file, line, func, type, nullptr, subsystem};
+		record->m_longMessage = nullptr;
+		record->m_suppressedCount = suppressedCount;
+	}
+
+	return record;
+}
+
+void Logger::endAsyncWrite(Record* record, MessageType type)
+{
+	if(record)
+	{
+		record->m_sequence.store(record->m_position + 1, AtomicMemoryOrder::SEQ_CST);
+		wakeSink();
+	}
+
+	m_asyncWriterCount.fetchSub(1, AtomicMemoryOrder::SEQ_CST);
+
+	if(type == MessageType::FATAL)
+	{
+		flush();
+		abort();
+	}
+}
+
+Bool Logger::checkRateLimit(const char* file, int line, U32& suppressedCount)
+{
+	suppressedCount = 0;
+	if(m_rateLimit == 0)
+	{
+		return true;
+	}
+
+	// The filenames are literals so their addresses identify them
+	const U64 key = ptrToNumber(file) ^ (U64(line) << 48);
+	CallSite& site = m_callSites[((key * 0x9E3779B97F4A7C15ull) >> 32) % CALL_SITE_COUNT];
+	const U32 second = U32(HighRezTimer::getCurrentTime());
+
+	// It's not exact when many threads log from the same line the moment the second changes but it's good enough
+	if(site.m_key.load() != key || site.m_second.load() != second)
+	{
+		if(site.m_key.exchange(key) != key)
+		{
+			// Another line of code had the slot
+			site.m_suppressedCount.store(0);
+		}
+
+		site.m_second.store(second);
+		site.m_count.store(0);
+	}
+
+	if(site.m_count.fetchAdd(1) < m_rateLimit)
+	{
+		suppressedCount = site.m_suppressedCount.exchange(0);
+		return true;
+	}
+
+	site.m_suppressedCount.fetchAdd(1);
+	return false;
+}
+
+Logger::Record* Logger::reserveRecord(MessageType type)
+{
+	U64 pos = m_writePos.load(AtomicMemoryOrder::RELAXED);
+	while(true)
+	{
+		Record& record = m_ring[pos & m_ringMask];
+		const U64 sequence = record.m_sequence.load(AtomicMemoryOrder::ACQUIRE);
+		if(sequence == pos)
+		{
+			if(m_writePos.compareExchange(pos, pos + 1))
+			{
+				record.m_position = pos;
+				return &record;
+			}
+		}
+		else if(sequence < pos)
+		{
+			// Full. Drop the less important messages and wait for the sink thread for the rest
+			if(type == MessageType::NORMAL || type == MessageType::WARNING)
+			{
+				m_droppedCount.fetchAdd(1);
+				return nullptr;
+			}
+
+			wakeSink();
+			HighRezTimer::sleep(0.0001);
+			pos = m_writePos.load(AtomicMemoryOrder::RELAXED);
+		}
+		else
+		{
+			pos = m_writePos.load(AtomicMemoryOrder::RELAXED);
+		}
+	}
+}
+
+Bool Logger::isRecordReady() const
+{
+	const U64 pos = m_readPos.load(AtomicMemoryOrder::RELAXED);
+	return m_ring[pos & m_ringMask].m_sequence.load(AtomicMemoryOrder::SEQ_CST) == pos + 1;
+}
+
+void Logger::wakeSink()
+{
+	if(m_sinkSleeping.load(AtomicMemoryOrder::SEQ_CST))
+	{
+		LockGuard<Mutex> lock(m_sinkMtx);
+		m_sinkCv.notifyOne();
+	}
+}
+
+U32 Logger::drainRing()
+{
+	U32 count = 0;
+	U64 pos = m_readPos.load(AtomicMemoryOrder::RELAXED);
+	while(true)
+	{
+		Record& record = m_ring[pos & m_ringMask];
+		if(record.m_sequence.load(AtomicMemoryOrder::ACQUIRE) != pos + 1)
+		{
+			break;
+		}
+
+		Info& info = record.m_info;
+		info.m_msg = (record.m_longMessage) ? record.m_longMessage : &record.m_message[0];
+
+		if(record.m_suppressedCount)
+		{
+			flushRepeatedMessage();
+
+			Array<char, 128> msg;
+			snprintf(
+				&msg[0], msg.getSize(), "%u messages of this line of code were suppressed", record.m_suppressedCount);
+			Info suppressedInfo = info;
+			suppressedInfo.m_msg = &msg[0];
+			callHandlers(suppressedInfo);
+		}
+
+		// Deduplicate
+		const U64 hash = computeHash(info.m_msg, strlen(info.m_msg));
+		const Bool repeat = info.m_type != MessageType::FATAL && hash == m_lastMessageHash
+							&& info.m_file == m_lastInfo.m_file && info.m_line == m_lastInfo.m_line
+							&& info.m_type == m_lastInfo.m_type;
+		if(repeat)
+		{
+			++m_repeatCount;
+			if(HighRezTimer::getCurrentTime() - m_repeatTime >= DEDUPLICATION_PERIOD)
+			{
+				flushRepeatedMessage();
+			}
+		}
+		else
+		{
+			flushRepeatedMessage();
+			callHandlers(info);
+
+			m_lastInfo = info;
+			m_lastInfo.m_msg = nullptr;
+			m_lastMessageHash = hash;
+			m_repeatTime = HighRezTimer::getCurrentTime();
+		}
+
+		free(record.m_longMessage);
+		record.m_longMessage = nullptr;
+
+		record.m_sequence.store(pos + m_ringMask + 1, AtomicMemoryOrder::RELEASE);
+		++pos;
+		m_readPos.store(pos, AtomicMemoryOrder::RELEASE);
+		++count;
+	}
+
+	const U32 droppedCount = m_droppedCount.exchange(0);
+	if(droppedCount)
+	{
+		flushRepeatedMessage();
+
+		Array<char, 128> msg;
+		snprintf(&msg[0], msg.getSize(), "%u messages were dropped because the logger was full", droppedCount);
+		const Info info = {ANKI_FILE, __LINE__, ANKI_FUNC, MessageType::WARNING, &msg[0], "UTIL"};
+		callHandlers(info);
+	}
+
+	return count;
+}
+
+void Logger::flushRepeatedMessage()
+{
+	if(m_repeatCount == 0)
+	{
+		return;
+	}
+
+	Array<char, 128> msg;
+	snprintf(&msg[0], msg.getSize(), "The previous message was repeated %u times", m_repeatCount);
+	Info info = m_lastInfo;
+	info.m_msg = &msg[0];
+	callHandlers(info);
+
+	m_repeatCount = 0;
+	m_repeatTime = HighRezTimer::getCurrentTime();
+}
+
 void Logger::defaultSystemMessageHandler(void*, const Info& info)
 {
 #if ANKI_OS == ANKI_OS_LINUX
@@ -22,6 +22,12 @@ class File;
 /// thread safe.
 /// To add a new signal:
 /// @code logger.addMessageHandler((void*)obj, &function) @endcode
+///
+/// By default the message handlers run on the thread that writes the message. In async mode the messages are
+/// formatted into a lock-free ring buffer and the handlers run on a dedicated thread so the threads that log don't
+/// wait for each other or for the I/O. In async mode the same message repeated one after the other is written once
+/// with a count and the messages of a single line of code are rate limited. FATAL messages flush the ring buffer
+/// before aborting.
 class Logger
 {
 public:
@@ -58,9 +64,35 @@ public:
 	/// Add a new message handler
 	void addMessageHandler(void* data, MessageHandlerCallback callback);
 
+	/// Remove a message handler that was added with addMessageHandler.
+	void removeMessageHandler(void* data, MessageHandlerCallback callback);
+
+	/// Remove the handler that writes to the terminal.
+	void removeDefaultMessageHandler()
+	{
+		removeMessageHandler(this, &defaultSystemMessageHandler);
+	}
+
 	/// Add file message handler.
 	void addFileMessageHandler(File* file);
 
+	/// Start the async mode.
+	/// @param recordCount The number of messages the ring buffer can hold. It's rounded up to a power of two. If the
+	///                    ring buffer is full the NORMAL and WARNING messages are dropped, the rest wait.
+	/// @param rateLimit The max number of messages per second of a line of code. Zero disables the rate limiting.
+	void startAsync(U32 recordCount = 1024, U32 rateLimit = 100);
+
+	/// Write the remaining messages and stop the async mode.
+	void stopAsync();
+
+	/// Wait for the messages that were written so far to reach the handlers.
+	void flush();
+
+	Bool isAsync() const
+	{
+		return m_async.load(AtomicMemoryOrder::ACQUIRE);
+	}
+
 	/// Send a message
 	void write(const char* file, int line, const char* func, const char* subsystem, MessageType type, const char* msg);
 
@@ -86,10 +118,84 @@ private:
 		}
 	};
 
+	/// A message in the ring buffer of the async mode.
+	class Record;
+
+	/// The rate limiting state of a line of code.
+	class CallSite
+	{
+	public:
+		Atomic<U64> m_key = {0};
+		Atomic<U32> m_second = {0};
+		Atomic<U32> m_count = {0};
+		Atomic<U32> m_suppressedCount = {0};
+	};
+
+	static constexpr U32 RECORD_MESSAGE_SIZE = 232;
+	static constexpr U32 CALL_SITE_COUNT = 256;
+
 	Mutex m_mutex; ///< For thread safety
 	Array<Handler, 4> m_handlers;
 	U32 m_handlersCount = 0;
 
+	/// @name Async mode
+	/// @{
+	Atomic<Bool> m_async = {false};
+	Atomic<U32> m_asyncWriterCount = {0}; ///< The threads that are writing to the ring buffer.
+	Record* m_ring = nullptr;
+	U32 m_ringMask = 0;
+	Atomic<U64> m_writePos = {0};
+	Atomic<U64> m_readPos = {0}; ///< Written only by the sink thread.
+	Atomic<U32> m_droppedCount = {0};
+	U32 m_rateLimit = 0;
+	Array<CallSite, CALL_SITE_COUNT> m_callSites;
+
+	Thread m_sinkThread;
+	Mutex m_sinkMtx;
+	ConditionVariable m_sinkCv;
+	Atomic<Bool> m_sinkSleeping = {false};
+	Atomic<Bool> m_flushRequested = {false};
+	Atomic<Bool> m_quit = {false};
+	/// @}
+
+	/// @name Deduplication. Accessed only by the sink thread
+	/// @{
+	Info m_lastInfo = {};
+	U64 m_lastMessageHash = 0;
+	U32 m_repeatCount = 0;
+	F64 m_repeatTime = 0.0;
+	/// @}
+
+	void callHandlers(const Info& info);
+
+	/// Check the rate limit of a line of code.
+	/// @param[out] suppressedCount The messages that were suppressed before this one.
+	/// @return False if the message should be dropped.
+	Bool checkRateLimit(const char* file, int line, U32& suppressedCount);
+
+	/// Start writing a message to the ring buffer.
+	/// @param[out] async False if the message should be written synchronously.
+	/// @return The record to write the message to or nullptr if the message is dropped.
+	Record* beginAsyncWrite(
+		const char* file, int line, const char* func, const char* subsystem, MessageType type, Bool& async);
+
+	/// Make the record visible to the sink thread. The record can be nullptr.
+	void endAsyncWrite(Record* record, MessageType type);
+
+	/// Reserve a record in the ring buffer. May return nullptr if the ring buffer is full.
+	Record* reserveRecord(MessageType type);
+
+	Bool isRecordReady() const;
+
+	void wakeSink();
+
+	/// Handle the messages in the ring buffer. It runs in the sink thread.
+	/// @return The number of messages.
+	U32 drainRing();
+
+	/// Write the number of times the last message was repeated.
+	void flushRepeatedMessage();
+
 	static void defaultSystemMessageHandler(void*, const Info& info);
 	static void fileMessageHandler(void* file, const Info& info);
 };
@@ -161,6 +161,9 @@ void* BaseMemoryPool::allocate(PtrSize size, PtrSize alignmentBytes)
 	case Type::CHAIN:
 		out = static_cast<ChainMemoryPool*>(this)->allocate(size, alignmentBytes);
 		break;
+	case Type::THREAD_CACHING:
+		out = static_cast<ThreadCachingMemoryPool*>(this)->allocate(size, alignmentBytes);
+		break;
 	default:
 		ANKI_ASSERT(0);
 	}
@@ -181,11 +184,25 @@ void BaseMemoryPool::free(void* ptr)
 	case Type::CHAIN:
 		static_cast<ChainMemoryPool*>(this)->free(ptr);
 		break;
+	case Type::THREAD_CACHING:
+		static_cast<ThreadCachingMemoryPool*>(this)->free(ptr);
+		break;
 	default:
 		ANKI_ASSERT(0);
 	}
 }
 
+U32 BaseMemoryPool::getAllocationsCount() const
+{
+	// The thread caching pool doesn't update a shared counter on every allocation
+	if(m_type == Type::THREAD_CACHING)
+	{
+		return static_cast<const ThreadCachingMemoryPool*>(this)->getAllocationsCountInternal();
+	}
+
+	return m_allocationsCount.load();
+}
+
 HeapMemoryPool::HeapMemoryPool()
 	: BaseMemoryPool(Type::HEAP)
 {
@@ -264,6 +281,365 @@ void HeapMemoryPool::free(void* ptr)
 	m_allocCb(m_allocCbUserData, ptr, 0, 0);
 }
 
+/// The header of a slab. The big allocations have one as well.
+class ThreadCachingMemoryPool::Slab
+{
+public:
+	ThreadCachingMemoryPool* m_pool = nullptr;
+	Slab* m_next = nullptr; ///< The next slab of the same size class.
+	U32 m_sizeClass = LARGE_SIZE_CLASS;
+};
+
+/// The chunks of a single thread. Only that thread touches the lists.
+class alignas(ANKI_CACHE_LINE_SIZE) ThreadCachingMemoryPool::ThreadCache
+{
+public:
+	ThreadId m_tid = 0;
+	ThreadCache* m_next = nullptr;
+	Array<void*, SIZE_CLASS_COUNT> m_chunks; ///< Linked through their first bytes.
+	Array<U32, SIZE_CLASS_COUNT> m_chunkCounts;
+
+	/// Allocations minus frees of this thread. It can be negative if the thread frees memory of other threads. It's
+	/// atomic only because other threads read it.
+	Atomic<I32> m_allocationsCount = {0};
+
+	ThreadCache()
+	{
+		for(U32 i = 0; i < SIZE_CLASS_COUNT; ++i)
+		{
+			m_chunks[i] = nullptr;
+			m_chunkCounts[i] = 0;
+		}
+	}
+};
+
+class ThreadCachingMemoryPool::ThreadCacheRef
+{
+public:
+	U64 m_poolUuid = 0;
+	ThreadCache* m_cache = nullptr;
+};
+
+static Atomic<U64> g_nextThreadCachingPoolUuid = {1};
+
+thread_local Array<ThreadCachingMemoryPool::ThreadCacheRef, ThreadCachingMemoryPool::THREAD_CACHE_REF_COUNT>
+	ThreadCachingMemoryPool::m_threadCacheRefs;
+
+static inline void*& nextChunk(void* chunk)
+{
+	return *static_cast<void**>(chunk);
+}
+
+ThreadCachingMemoryPool::ThreadCachingMemoryPool()
+	: BaseMemoryPool(Type::THREAD_CACHING)
+{
+}
+
+ThreadCachingMemoryPool::~ThreadCachingMemoryPool()
+{
+	if(!isCreated())
+	{
+		return;
+	}
+
+	const U32 count = getAllocationsCountInternal();
+	if(count != 0)
+	{
+		ANKI_UTIL_LOGW("Memory pool destroyed before all memory being released (%u deallocations missed)", count);
+	}
+
+	ThreadCache* cache = m_threadCaches;
+	while(cache)
+	{
+		ThreadCache* next = cache->m_next;
+		cache->~ThreadCache();
+		m_allocCb(m_allocCbUserData, cache, 0, 0);
+		cache = next;
+	}
+
+	for(CentralFreeList& list : m_centralFreeLists)
+	{
+		Slab* slab = list.m_slabs;
+		while(slab)
+		{
+			Slab* next = slab->m_next;
+			invalidateMemory(slab, SLAB_SIZE);
+			m_allocCb(m_allocCbUserData, slab, 0, 0);
+			slab = next;
+		}
+	}
+}
+
+void ThreadCachingMemoryPool::create(AllocAlignedCallback allocCb, void* allocCbUserData)
+{
+	ANKI_ASSERT(!isCreated());
+	ANKI_ASSERT(allocCb != nullptr);
+
+	m_allocCb = allocCb;
+	m_allocCbUserData = allocCbUserData;
+	m_uuid = g_nextThreadCachingPoolUuid.fetchAdd(1);
+
+	// The size classes are 16 bytes apart up to 128 bytes and then there are 4 classes per power of two
+	U32 sizeClass = 0;
+	for(U32 size = 16; size <= MAX_SMALL_SIZE; ++sizeClass)
+	{
+		ANKI_ASSERT(sizeClass < SIZE_CLASS_COUNT);
+		m_chunkSizes[sizeClass] = size;
+		m_batchSizes[sizeClass] = clamp<U32>(U32(32_KB) / size, 2, 64);
+
+		const U32 step = (size < 128) ? 16 : nextPowerOfTwo(size + 1) / 8;
+		size += step;
+	}
+	ANKI_ASSERT(sizeClass == SIZE_CLASS_COUNT);
+
+	sizeClass = 0;
+	for(U32 i = 0; i < m_sizeClasses.getSize(); ++i)
+	{
+		while(m_chunkSizes[sizeClass] < i * 16)
+		{
+			++sizeClass;
+		}
+		m_sizeClasses[i] = U8(sizeClass);
+	}
+}
+
+ThreadCachingMemoryPool::ThreadCache& ThreadCachingMemoryPool::getThreadCache()
+{
+	ThreadCacheRef& ref = m_threadCacheRefs[m_uuid % THREAD_CACHE_REF_COUNT];
+	if(ANKI_LIKELY(ref.m_poolUuid == m_uuid))
+	{
+		return *ref.m_cache;
+	}
+
+	// Slow path, find or create the cache of this thread
+	const ThreadId tid = Thread::getCurrentThreadId();
+	LockGuard<Mutex> lock(m_threadCacheMtx);
+
+	ThreadCache* cache = m_threadCaches;
+	while(cache && cache->m_tid != tid)
+	{
+		cache = cache->m_next;
+	}
+
+	if(cache == nullptr)
+	{
+		cache = static_cast<ThreadCache*>(
+			m_allocCb(m_allocCbUserData, nullptr, sizeof(ThreadCache), alignof(ThreadCache)));
+		if(ANKI_UNLIKELY(cache == nullptr))
+		{
+			ANKI_CREATION_OOM_ACTION();
+		}
+
+		::new(cache) ThreadCache();
+		cache->m_tid = tid;
+		cache->m_next = m_threadCaches;
+		m_threadCaches = cache;
+	}
+
+	ref.m_poolUuid = m_uuid;
+	ref.m_cache = cache;
+	return *cache;
+}
+
+void* ThreadCachingMemoryPool::allocate(PtrSize size, PtrSize alignment)
+{
+	ANKI_ASSERT(isCreated());
+	ANKI_ASSERT(size > 0);
+	ANKI_ASSERT(alignment > 0 && isPowerOfTwo(alignment));
+	ThreadCache& cache = getThreadCache();
+
+	// Find the size class. The chunks of a class are aligned to the greatest power of two its size is a multiple of
+	U32 sizeClass = LARGE_SIZE_CLASS;
+	if(size <= MAX_SMALL_SIZE && alignment <= MAX_SMALL_ALIGNMENT)
+	{
+		sizeClass = m_sizeClasses[(size + 15) / 16];
+		while(sizeClass < SIZE_CLASS_COUNT && (m_chunkSizes[sizeClass] & (alignment - 1)) != 0)
+		{
+			++sizeClass;
+		}
+
+		if(sizeClass == SIZE_CLASS_COUNT)
+		{
+			sizeClass = LARGE_SIZE_CLASS;
+		}
+	}
+
+	void* out;
+	if(ANKI_LIKELY(sizeClass != LARGE_SIZE_CLASS))
+	{
+		if(ANKI_UNLIKELY(cache.m_chunks[sizeClass] == nullptr) && !refill(cache, sizeClass))
+		{
+			ANKI_OOM_ACTION();
+			return nullptr;
+		}
+
+		out = cache.m_chunks[sizeClass];
+		cache.m_chunks[sizeClass] = nextChunk(out);
+		--cache.m_chunkCounts[sizeClass];
+	}
+	else
+	{
+		// Big allocation. Give it a slab header and align it like a slab so free() can find the header
+		ANKI_ASSERT(alignment <= SLAB_SIZE / 2);
+		const PtrSize headerSize = getAlignedRoundUp(max<PtrSize>(alignment, MAX_SMALL_ALIGNMENT), sizeof(Slab));
+		U8* mem = static_cast<U8*>(m_allocCb(m_allocCbUserData, nullptr, size + headerSize, SLAB_SIZE));
+		if(ANKI_UNLIKELY(mem == nullptr))
+		{
+			ANKI_OOM_ACTION();
+			return nullptr;
+		}
+
+		Slab* slab = ::new(mem) Slab();
+		slab->m_pool = this;
+		out = mem + headerSize;
+	}
+
+	cache.m_allocationsCount.store(cache.m_allocationsCount.load() + 1);
+	return out;
+}
+
+void ThreadCachingMemoryPool::free(void* ptr)
+{
+	ANKI_ASSERT(isCreated());
+	ANKI_ASSERT(ptr);
+	ThreadCache& cache = getThreadCache();
+
+	Slab& slab = *numberToPtr<Slab*>(getAlignedRoundDown(SLAB_SIZE, ptrToNumber(ptr)));
+	ANKI_ASSERT(slab.m_pool == this && "Freeing memory of another pool");
+
+	const U32 sizeClass = slab.m_sizeClass;
+	if(ANKI_LIKELY(sizeClass != LARGE_SIZE_CLASS))
+	{
+		invalidateMemory(ptr, m_chunkSizes[sizeClass]);
+		nextChunk(ptr) = cache.m_chunks[sizeClass];
+		cache.m_chunks[sizeClass] = ptr;
+		++cache.m_chunkCounts[sizeClass];
+
+		if(ANKI_UNLIKELY(cache.m_chunkCounts[sizeClass] > m_batchSizes[sizeClass] * 2))
+		{
+			release(cache, sizeClass);
+		}
+	}
+	else
+	{
+		m_allocCb(m_allocCbUserData, &slab, 0, 0);
+	}
+
+	cache.m_allocationsCount.store(cache.m_allocationsCount.load() - 1);
+}
+
+Bool ThreadCachingMemoryPool::refill(ThreadCache& cache, U32 sizeClass)
+{
+	ANKI_ASSERT(cache.m_chunks[sizeClass] == nullptr);
+	const U32 batchSize = m_batchSizes[sizeClass];
+	CentralFreeList& central = m_centralFreeLists[sizeClass];
+
+	{
+		LockGuard<SpinLock> lock(central.m_lock);
+
+		U32 count = 0;
+		void* last = nullptr;
+		while(central.m_chunks && count < batchSize)
+		{
+			void* chunk = central.m_chunks;
+			central.m_chunks = nextChunk(chunk);
+
+			nextChunk(chunk) = last;
+			last = chunk;
+			++count;
+		}
+
+		if(count > 0)
+		{
+			cache.m_chunks[sizeClass] = last;
+			cache.m_chunkCounts[sizeClass] = count;
+			return true;
+		}
+	}
+
+	// The central list is empty, allocate a new slab. Do it outside the lock
+	Slab* slab = static_cast<Slab*>(m_allocCb(m_allocCbUserData, nullptr, SLAB_SIZE, SLAB_SIZE));
+	if(ANKI_UNLIKELY(slab == nullptr))
+	{
+		return false;
+	}
+
+	::new(slab) Slab();
+	slab->m_pool = this;
+	slab->m_sizeClass = sizeClass;
+	m_slabMemorySize.fetchAdd(PtrSize(SLAB_SIZE));
+
+	// Carve it. The first chunks go to the thread and the rest to the central list
+	const U32 chunkSize = m_chunkSizes[sizeClass];
+	U8* first = reinterpret_cast<U8*>(slab) + getAlignedRoundUp(MAX_SMALL_ALIGNMENT, sizeof(Slab));
+	const U32 chunkCount = U32((reinterpret_cast<U8*>(slab) + SLAB_SIZE - first) / chunkSize);
+	ANKI_ASSERT(chunkCount > batchSize);
+
+	void* cacheChunks = nullptr;
+	for(U32 i = batchSize; i > 0; --i)
+	{
+		void* chunk = first + (i - 1) * chunkSize;
+		nextChunk(chunk) = cacheChunks;
+		cacheChunks = chunk;
+	}
+
+	void* centralChunks = nullptr;
+	for(U32 i = chunkCount; i > batchSize; --i)
+	{
+		void* chunk = first + (i - 1) * chunkSize;
+		nextChunk(chunk) = centralChunks;
+		centralChunks = chunk;
+	}
+	void* lastCentralChunk = first + (chunkCount - 1) * chunkSize;
+
+	cache.m_chunks[sizeClass] = cacheChunks;
+	cache.m_chunkCounts[sizeClass] = batchSize;
+
+	LockGuard<SpinLock> lock(central.m_lock);
+	nextChunk(lastCentralChunk) = central.m_chunks;
+	central.m_chunks = centralChunks;
+	slab->m_next = central.m_slabs;
+	central.m_slabs = slab;
+
+	return true;
+}
+
+void ThreadCachingMemoryPool::release(ThreadCache& cache, U32 sizeClass)
+{
+	// Cut a batch from the top of the thread's list
+	const U32 batchSize = m_batchSizes[sizeClass];
+	void* first = cache.m_chunks[sizeClass];
+	void* last = first;
+	for(U32 i = 1; i < batchSize; ++i)
+	{
+		last = nextChunk(last);
+	}
+
+	cache.m_chunks[sizeClass] = nextChunk(last);
+	cache.m_chunkCounts[sizeClass] -= batchSize;
+
+	CentralFreeList& central = m_centralFreeLists[sizeClass];
+	LockGuard<SpinLock> lock(central.m_lock);
+	nextChunk(last) = central.m_chunks;
+	central.m_chunks = first;
+}
+
+U32 ThreadCachingMemoryPool::getAllocationsCountInternal() const
+{
+	I32 count = 0;
+
+	LockGuard<Mutex> lock(m_threadCacheMtx);
+	const ThreadCache* cache = m_threadCaches;
+	while(cache)
+	{
+		count += cache->m_allocationsCount.load();
+		cache = cache->m_next;
+	}
+
+	ANKI_ASSERT(count >= 0);
+	return U32(count);
+}
+
 StackMemoryPool::StackMemoryPool()
 	: BaseMemoryPool(Type::STACK)
 {
@@ -49,7 +49,7 @@ using AllocationSignature = U32;
 ///         returns nullptr
 void* allocAligned(void* userData, void* ptr, PtrSize size, PtrSize alignment);
 
-/// Generic memory pool. The base of HeapMemoryPool or StackMemoryPool or ChainMemoryPool.
+/// Generic memory pool. The base of HeapMemoryPool or StackMemoryPool or ChainMemoryPool or ThreadCachingMemoryPool.
 class BaseMemoryPool : public NonCopyable
 {
 public:
@@ -59,7 +59,8 @@ public:
 		NONE,
 		HEAP,
 		STACK,
-		CHAIN
+		CHAIN,
+		THREAD_CACHING
 	};
 
 	BaseMemoryPool(Type type)
@@ -104,10 +105,7 @@ public:
 	}
 
 	/// Return number of allocations
-	U32 getAllocationsCount() const
-	{
-		return m_allocationsCount.load();
-	}
+	U32 getAllocationsCount() const;
 
 protected:
 	/// User allocation function.
@@ -161,6 +159,87 @@ private:
 #endif
 };
 
+/// Thread safe general purpose memory pool. The small allocations are served from per thread caches of fixed size
+/// chunks (one cache per size class) and the caches exchange chunks in batches with a central free list that is
+/// refilled from slabs. Most allocations and frees don't touch any shared state. The big allocations go directly to the
+/// allocation callback. The slabs are released when the pool is destroyed.
+class ThreadCachingMemoryPool : public BaseMemoryPool
+{
+	friend class BaseMemoryPool;
+
+public:
+	/// Default constructor.
+	ThreadCachingMemoryPool();
+
+	/// Destroy.
+	~ThreadCachingMemoryPool() final;
+
+	/// The real constructor.
+	/// @param allocCb The allocation function callback
+	/// @param allocCbUserData The user data to pass to the allocation function
+	void create(AllocAlignedCallback allocCb, void* allocCbUserData);
+
+	/// Allocate memory. The operation is thread safe.
+	void* allocate(PtrSize size, PtrSize alignment);
+
+	/// Free memory. The operation is thread safe and it can happen in a different thread than the allocation.
+	/// @param[in, out] ptr Memory block to deallocate.
+	void free(void* ptr);
+
+	/// Get the memory that is reserved for the small allocations.
+	PtrSize getSlabMemorySize() const
+	{
+		return m_slabMemorySize.load();
+	}
+
+private:
+	class Slab;
+	class ThreadCache;
+	class ThreadCacheRef;
+
+	/// All slabs are aligned to their size so the slab of a chunk can be found from its address.
+	static const PtrSize SLAB_SIZE = 64_KB;
+	static const PtrSize MAX_SMALL_SIZE = 8_KB;
+	static const PtrSize MAX_SMALL_ALIGNMENT = 64;
+	static const U32 SIZE_CLASS_COUNT = 32;
+	static const U32 LARGE_SIZE_CLASS = MAX_U32;
+	static const U32 THREAD_CACHE_REF_COUNT = 8;
+
+	/// A free list of a size class that is shared by all threads.
+	class alignas(ANKI_CACHE_LINE_SIZE) CentralFreeList
+	{
+	public:
+		void* m_chunks = nullptr; ///< Linked through their first bytes.
+		Slab* m_slabs = nullptr;
+		SpinLock m_lock;
+	};
+
+	U64 m_uuid = 0; ///< Identifies the pool in the thread local storage.
+
+	Array<U32, SIZE_CLASS_COUNT> m_chunkSizes;
+	Array<U32, SIZE_CLASS_COUNT> m_batchSizes; ///< How many chunks move between the thread and central lists.
+	Array<U8, MAX_SMALL_SIZE / 16 + 1> m_sizeClasses; ///< Map (size + 15) / 16 to a size class.
+
+	Array<CentralFreeList, SIZE_CLASS_COUNT> m_centralFreeLists;
+	Atomic<PtrSize> m_slabMemorySize = {0};
+
+	static thread_local Array<ThreadCacheRef, THREAD_CACHE_REF_COUNT> m_threadCacheRefs;
+	ThreadCache* m_threadCaches = nullptr; ///< All of them.
+	mutable Mutex m_threadCacheMtx;
+
+	/// Get the cache of the calling thread.
+	ThreadCache& getThreadCache();
+
+	/// Move some chunks from the central list to a thread cache. It might allocate a new slab.
+	Bool refill(ThreadCache& cache, U32 sizeClass);
+
+	/// Move some chunks from a thread cache to the central list.
+	void release(ThreadCache& cache, U32 sizeClass);
+
+	/// Sum the allocations of all threads.
+	U32 getAllocationsCountInternal() const;
+};
+
 /// Thread safe memory pool. It's a preallocated memory pool that is used for memory allocations on top of that
 /// preallocated memory. It is mainly used by fast stack allocators
 class StackMemoryPool : public BaseMemoryPool
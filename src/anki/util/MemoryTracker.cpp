@@ -0,0 +1,269 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/util/MemoryTracker.h>
+#include <anki/util/System.h>
+#include <anki/util/File.h>
+#include <anki/util/Hash.h>
+#include <anki/util/Logger.h>
+#include <algorithm>
+
+namespace anki
+{
+
+/// It lives right before the memory that is returned to the user.
+class MemoryTracker::Header
+{
+public:
+	PtrSize m_size;
+	U32 m_offset; ///< From the start of the real allocation to the memory of the user.
+	U32 m_sampled;
+};
+
+class MemoryTracker::LogEntry
+{
+public:
+	PtrSize m_size;
+	U64 m_frame;
+	U64 m_stackHash;
+	Array<void*, MAX_STACK_DEPTH> m_stack;
+	U32 m_stackDepth;
+};
+
+MemoryTracker::~MemoryTracker()
+{
+	if(!isInitialized())
+	{
+		return;
+	}
+
+	if(m_liveBytes.load() != 0)
+	{
+		ANKI_UTIL_LOGW("Memory tracker %s destroyed before all memory being released (%u bytes)",
+			m_name,
+			U32(m_liveBytes.load()));
+	}
+
+	for(auto it : m_log)
+	{
+		m_logAlloc.deleteInstance(it);
+	}
+	m_log.destroy(m_logAlloc);
+}
+
+void MemoryTracker::init(const char* name, AllocAlignedCallback allocCb, void* allocCbUserData)
+{
+	ANKI_ASSERT(!isInitialized());
+	ANKI_ASSERT(name && allocCb);
+
+	m_name = name;
+	m_allocCb = allocCb;
+	m_allocCbUserData = allocCbUserData;
+	m_logAlloc = HeapAllocator<U8>(allocCb, allocCbUserData);
+}
+
+void* MemoryTracker::allocCallback(void* userData, void* ptr, PtrSize size, PtrSize alignment)
+{
+	ANKI_ASSERT(userData);
+	MemoryTracker& self = *static_cast<MemoryTracker*>(userData);
+	static_assert(sizeof(Header) <= 16, "The header should fit in the common alignment");
+
+	// Everything happens in this function to keep the number of frames that logAllocation() skips fixed
+	if(ptr == nullptr)
+	{
+		// Allocate
+		ANKI_ASSERT(size > 0);
+		ANKI_ASSERT(alignment > 0 && isPowerOfTwo(alignment));
+
+		// The header goes in front of the user's memory and it takes a whole alignment slot to keep the user's
+		// memory aligned
+		const PtrSize headerSize = max<PtrSize>(alignment, sizeof(Header));
+		U8* base = static_cast<U8*>(self.m_allocCb(
+			self.m_allocCbUserData, nullptr, size + headerSize, max<PtrSize>(alignment, alignof(Header))));
+		if(ANKI_UNLIKELY(base == nullptr))
+		{
+			return nullptr;
+		}
+
+		U8* out = base + headerSize;
+		Header& header = *(reinterpret_cast<Header*>(out) - 1);
+		header.m_size = size;
+		header.m_offset = U32(headerSize);
+		header.m_sampled = 0;
+
+		// Update the stats
+		const PtrSize liveBytes = self.m_liveBytes.fetchAdd(size) + size;
+		self.m_peakBytes.max(liveBytes);
+		self.m_allocatedBytes.fetchAdd(size);
+		const U64 allocationIdx = self.m_allocationCount.fetchAdd(1);
+
+		const U32 sampleRate = self.m_sampleRate.load();
+		if(ANKI_UNLIKELY(sampleRate != 0 && (allocationIdx % sampleRate) == 0))
+		{
+			self.logAllocation(out, size);
+			header.m_sampled = 1;
+		}
+
+		return out;
+	}
+	else
+	{
+		// Free
+		U8* out = static_cast<U8*>(ptr);
+		const Header& header = *(reinterpret_cast<const Header*>(out) - 1);
+
+		if(ANKI_UNLIKELY(header.m_sampled))
+		{
+			self.unlogAllocation(ptr);
+		}
+
+		self.m_liveBytes.fetchSub(header.m_size);
+		self.m_freeCount.fetchAdd(1);
+
+		self.m_allocCb(self.m_allocCbUserData, out - header.m_offset, 0, 0);
+		return nullptr;
+	}
+}
+
+MemoryTrackerStats MemoryTracker::getStats() const
+{
+	MemoryTrackerStats stats;
+	stats.m_liveBytes = m_liveBytes.load();
+	stats.m_peakBytes = m_peakBytes.load();
+	stats.m_allocationCount = m_allocationCount.load();
+	stats.m_freeCount = m_freeCount.load();
+	stats.m_frameAllocationCount = m_frameAllocationCount;
+	stats.m_frameAllocatedBytes = m_frameAllocatedBytes;
+	return stats;
+}
+
+void MemoryTracker::newFrame()
+{
+	const U64 allocationCount = m_allocationCount.load();
+	const PtrSize allocatedBytes = m_allocatedBytes.load();
+
+	m_frameAllocationCount = allocationCount - m_frameStartAllocationCount;
+	m_frameAllocatedBytes = allocatedBytes - m_frameStartAllocatedBytes;
+	m_frameStartAllocationCount = allocationCount;
+	m_frameStartAllocatedBytes = allocatedBytes;
+
+	m_frame.fetchAdd(1);
+}
+
+void MemoryTracker::enableAllocationLog(U32 sampleRate)
+{
+	ANKI_ASSERT(isInitialized());
+	m_sampleRate.store(sampleRate);
+}
+
+void MemoryTracker::logAllocation(void* ptr, PtrSize size)
+{
+	LogEntry* entry = m_logAlloc.newInstance<LogEntry>();
+	entry->m_size = size;
+	entry->m_frame = m_frame.load();
+
+	// Skip this function and allocCallback()
+	entry->m_stackDepth = getBackTraceAddresses(WeakArray<void*>(entry->m_stack), 2);
+	entry->m_stackHash = (entry->m_stackDepth)
+							 ? computeHash(&entry->m_stack[0], entry->m_stackDepth * sizeof(void*))
+							 : 0;
+
+	LockGuard<Mutex> lock(m_logMtx);
+	m_log.emplace(m_logAlloc, ptrToNumber(ptr), entry);
+}
+
+void MemoryTracker::unlogAllocation(void* ptr)
+{
+	LogEntry* entry = nullptr;
+
+	{
+		LockGuard<Mutex> lock(m_logMtx);
+		auto it = m_log.find(ptrToNumber(ptr));
+		ANKI_ASSERT(it != m_log.getEnd());
+		entry = *it;
+		m_log.erase(m_logAlloc, it);
+	}
+
+	m_logAlloc.deleteInstance(entry);
+}
+
+Error MemoryTracker::dumpAllocationLog(CString filename, U64 sinceFrame) const
+{
+	ANKI_ASSERT(isInitialized());
+	HeapAllocator<U8> alloc = m_logAlloc;
+
+	// Gather the entries. Copy them because the log might change while writing
+	DynamicArrayAuto<LogEntry> entries(alloc);
+	{
+		LockGuard<Mutex> lock(m_logMtx);
+		for(const LogEntry* entry : m_log)
+		{
+			if(entry->m_frame >= sinceFrame)
+			{
+				entries.emplaceBack(*entry);
+			}
+		}
+	}
+
+	std::sort(entries.getBegin(), entries.getEnd(), [](const LogEntry& a, const LogEntry& b) {
+		return a.m_stackHash < b.m_stackHash;
+	});
+
+	File file;
+	ANKI_CHECK(file.open(filename, FileOpenFlag::WRITE));
+
+	const U32 sampleRate = m_sampleRate.load();
+	ANKI_CHECK(file.writeText("# Live allocations of %s since frame %llu. One every %u allocations is logged\n",
+		m_name,
+		sinceFrame,
+		sampleRate));
+
+	class Walker : public BackTraceWalker
+	{
+	public:
+		File* m_file;
+		Error m_err = Error::NONE;
+
+		void operator()(const char* symbol) override
+		{
+			if(!m_err)
+			{
+				m_err = m_file->writeText("\t%s\n", symbol);
+			}
+		}
+	};
+
+	// Write the stacks in groups
+	U i = 0;
+	while(i < entries.getSize())
+	{
+		U end = i;
+		PtrSize size = 0;
+		U64 oldestFrame = MAX_U64;
+		while(end < entries.getSize() && entries[end].m_stackHash == entries[i].m_stackHash)
+		{
+			size += entries[end].m_size;
+			oldestFrame = min(oldestFrame, entries[end].m_frame);
+			++end;
+		}
+
+		ANKI_CHECK(file.writeText("stack %016llx: %u allocations, %llu bytes, oldest in frame %llu\n",
+			entries[i].m_stackHash,
+			U32(end - i),
+			U64(size),
+			oldestFrame));
+
+		Walker walker;
+		walker.m_file = &file;
+		walker.exec(WeakArray<void*>(&entries[i].m_stack[0], entries[i].m_stackDepth));
+		ANKI_CHECK(walker.m_err);
+
+		i = end;
+	}
+
+	return Error::NONE;
+}
+
+} // end namespace anki
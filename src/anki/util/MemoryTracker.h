@@ -0,0 +1,125 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/util/Allocator.h>
+#include <anki/util/HashMap.h>
+#include <anki/util/String.h>
+
+namespace anki
+{
+
+/// @addtogroup util_memory
+/// @{
+
+/// The statistics of a MemoryTracker. @memberof MemoryTracker
+class MemoryTrackerStats
+{
+public:
+	PtrSize m_liveBytes = 0;
+	PtrSize m_peakBytes = 0;
+	U64 m_allocationCount = 0; ///< All the allocations so far.
+	U64 m_freeCount = 0; ///< All the frees so far.
+	U64 m_frameAllocationCount = 0; ///< The allocations of the last complete frame.
+	PtrSize m_frameAllocatedBytes = 0; ///< The bytes allocated during the last complete frame.
+};
+
+/// Tracks the memory of a subsystem. It sits between the memory pools of the subsystem and the allocation callback:
+/// pass getAllocationCallback() and getAllocationCallbackUserData() to the subsystem instead of the original callback.
+/// It can also keep a log of the call stacks of a sample of the live allocations to find who owns the memory.
+class MemoryTracker : public NonCopyable
+{
+public:
+	MemoryTracker() = default;
+
+	~MemoryTracker();
+
+	/// @param name The name of the tracker. The pointer should remain valid for the lifetime of the tracker.
+	/// @param allocCb The original allocation callback.
+	/// @param allocCbUserData The user data of the original allocation callback.
+	void init(const char* name, AllocAlignedCallback allocCb, void* allocCbUserData);
+
+	Bool isInitialized() const
+	{
+		return m_allocCb != nullptr;
+	}
+
+	const char* getName() const
+	{
+		return m_name;
+	}
+
+	/// The callback the subsystem should use.
+	AllocAlignedCallback getAllocationCallback() const
+	{
+		return allocCallback;
+	}
+
+	/// The user data of the callback the subsystem should use.
+	void* getAllocationCallbackUserData()
+	{
+		return this;
+	}
+
+	/// Get the statistics. Call it from the thread that calls newFrame() if the per frame statistics are needed.
+	MemoryTrackerStats getStats() const;
+
+	/// Begin a new frame. It updates the per frame statistics.
+	void newFrame();
+
+	/// Start logging the call stacks of one every sampleRate allocations. Only the allocations that are still alive
+	/// are kept.
+	void enableAllocationLog(U32 sampleRate);
+
+	/// Write the sampled allocations that are still alive to a text file. The allocations are grouped by call stack
+	/// and the groups are sorted by stack ID so two dumps can be compared with a diff tool.
+	/// @param filename The file to write.
+	/// @param sinceFrame Ignore the allocations that happened before that frame. See newFrame().
+	ANKI_USE_RESULT Error dumpAllocationLog(CString filename, U64 sinceFrame = 0) const;
+
+private:
+	class Header;
+	class LogEntry;
+
+	static const U32 MAX_STACK_DEPTH = 16;
+
+	const char* m_name = nullptr;
+	AllocAlignedCallback m_allocCb = nullptr;
+	void* m_allocCbUserData = nullptr;
+
+	Atomic<PtrSize> m_liveBytes = {0};
+	Atomic<PtrSize> m_peakBytes = {0};
+	Atomic<U64> m_allocationCount = {0};
+	Atomic<U64> m_freeCount = {0};
+	Atomic<PtrSize> m_allocatedBytes = {0}; ///< All the bytes allocated so far.
+
+	/// @name Per frame statistics. Updated by newFrame()
+	/// @{
+	Atomic<U64> m_frame = {0};
+	U64 m_frameStartAllocationCount = 0;
+	PtrSize m_frameStartAllocatedBytes = 0;
+	U64 m_frameAllocationCount = 0;
+	PtrSize m_frameAllocatedBytes = 0;
+	/// @}
+
+	/// @name The allocation log
+	/// @{
+	Atomic<U32> m_sampleRate = {0};
+	HeapAllocator<U8> m_logAlloc; ///< It uses the original callback so it's not tracked.
+	HashMap<U64, LogEntry*> m_log; ///< Map the address of an allocation to its log entry.
+	mutable Mutex m_logMtx;
+	/// @}
+
+	static void* allocCallback(void* userData, void* ptr, PtrSize size, PtrSize alignment);
+
+	/// Log an allocation. It's called by allocCallback() and it mustn't be inlined to skip the right stack frames.
+	ANKI_DONT_INLINE void logAllocation(void* ptr, PtrSize size);
+
+	void unlogAllocation(void* ptr);
+};
+/// @}
+
+} // end namespace anki
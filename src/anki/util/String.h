@@ -12,6 +12,7 @@
 #include <anki/util/Forward.h>
 #include <cstring>
 #include <cstdio>
+#include <cstdarg>
 #include <cinttypes> // For PRId8 etc
 
 namespace anki
@@ -477,6 +478,12 @@ public:
 		return CStringType(&m_data[0]);
 	}
 
+	/// Compute the hash. It's the same as the hash of the CString.
+	U32 computeHash() const
+	{
+		return toCString().computeHash();
+	}
+
 	/// Append another string to this one.
 	void append(Allocator alloc, const String& b)
 	{
@@ -745,6 +752,212 @@ private:
 		m_alloc = std::move(b.m_alloc);
 	}
 };
+
+/// String with automatic cleanup that stores up to N characters (including the terminating character) inside the
+/// object. It uses the allocator only for longer strings. Use it for short temp strings like tokens and filenames.
+/// Unlike String it's never uninitialized, an empty StringInline is "".
+template<PtrSize N>
+class StringInline : public NonCopyable
+{
+public:
+	using Char = char; ///< Character type
+	using CStringType = CString;
+	using Iterator = Char*;
+	using ConstIterator = const Char*;
+	using Allocator = GenericMemoryPoolAllocator<Char>;
+
+	/// Create with allocator.
+	StringInline(Allocator alloc)
+		: m_data(alloc)
+	{
+		m_data.emplaceBack('\0');
+	}
+
+	/// Create with allocator and data.
+	StringInline(Allocator alloc, const CStringType& cstr)
+		: StringInline(alloc)
+	{
+		create(cstr);
+	}
+
+	/// Initialize using a const string.
+	void create(const CStringType& cstr)
+	{
+		create(cstr.cstr(), cstr.cstr() + cstr.getLength());
+	}
+
+	/// Initialize using a range. Copies the range of [first, last)
+	void create(ConstIterator first, ConstIterator last)
+	{
+		ANKI_ASSERT(isEmpty());
+		ANKI_ASSERT(first <= last);
+		const PtrSize length = last - first;
+		m_data.resize(length + 1);
+		if(length)
+		{
+			std::memcpy(&m_data[0], first, length * sizeof(Char));
+		}
+		m_data[length] = '\0';
+	}
+
+	/// Initialize using a character.
+	void create(Char c, PtrSize length)
+	{
+		ANKI_ASSERT(isEmpty());
+		m_data.resize(length + 1);
+		std::memset(&m_data[0], c, length * sizeof(Char));
+		m_data[length] = '\0';
+	}
+
+	/// Make it empty again. It doesn't keep any memory.
+	void destroy()
+	{
+		m_data.destroy();
+		m_data.emplaceBack('\0');
+	}
+
+	/// Append a const string to this one.
+	StringInline& append(const CStringType& cstr)
+	{
+		const PtrSize oldLength = getLength();
+		const PtrSize length = cstr.getLength();
+		m_data.resize(oldLength + length + 1);
+		if(length)
+		{
+			std::memcpy(&m_data[oldLength], cstr.cstr(), length * sizeof(Char));
+		}
+		m_data[oldLength + length] = '\0';
+		return *this;
+	}
+
+	/// Create formated string.
+	StringInline& sprintf(const Char* fmt, ...)
+	{
+		ANKI_ASSERT(isEmpty());
+		m_data.resize(N);
+
+		va_list args;
+		va_start(args, fmt);
+		I len = std::vsnprintf(&m_data[0], m_data.getSize(), fmt, args);
+		va_end(args);
+
+		if(len < 0)
+		{
+			ANKI_UTIL_LOGF("vsnprintf() failed");
+		}
+		else if(PtrSize(len) >= m_data.getSize())
+		{
+			// Didn't fit
+			m_data.resize(len + 1);
+			va_start(args, fmt);
+			len = std::vsnprintf(&m_data[0], m_data.getSize(), fmt, args);
+			va_end(args);
+		}
+
+		m_data.resize(len + 1);
+		return *this;
+	}
+
+	/// Get a C string.
+	const Char* cstr() const
+	{
+		return &m_data[0];
+	}
+
+	/// Return the CString.
+	CStringType toCString() const
+	{
+		return CStringType(&m_data[0]);
+	}
+
+	/// Return char at the specified position.
+	const Char& operator[](U pos) const
+	{
+		return m_data[pos];
+	}
+
+	/// Return char at the specified position as a modifiable reference.
+	Char& operator[](U pos)
+	{
+		return m_data[pos];
+	}
+
+	Iterator begin()
+	{
+		return &m_data[0];
+	}
+
+	ConstIterator begin() const
+	{
+		return &m_data[0];
+	}
+
+	Iterator end()
+	{
+		return &m_data[0] + getLength();
+	}
+
+	ConstIterator end() const
+	{
+		return &m_data[0] + getLength();
+	}
+
+	/// Return the string's length. It doesn't count the terminating character.
+	PtrSize getLength() const
+	{
+		return m_data.getSize() - 1;
+	}
+
+	Bool isEmpty() const
+	{
+		return m_data.getSize() == 1;
+	}
+
+	operator Bool() const
+	{
+		return !isEmpty();
+	}
+
+	/// Return true if the characters are still in the inline storage.
+	Bool isInline() const
+	{
+		return m_data.isInline();
+	}
+
+	/// Return true if strings are equal
+	Bool operator==(const CStringType& cstr) const
+	{
+		return toCString() == cstr;
+	}
+
+	/// Return true if strings are not equal
+	Bool operator!=(const CStringType& cstr) const
+	{
+		return !(*this == cstr);
+	}
+
+	/// @copydoc CString::find
+	PtrSize find(const CStringType& cstr, PtrSize position = 0) const
+	{
+		return toCString().find(cstr, position);
+	}
+
+	/// Compute the hash. It's the same as the hash of the CString.
+	U32 computeHash() const
+	{
+		return toCString().computeHash();
+	}
+
+	/// Convert to a number.
+	template<typename TNumber>
+	ANKI_USE_RESULT Error toNumber(TNumber& out) const
+	{
+		return toCString().toNumber(out);
+	}
+
+private:
+	DynamicArrayInline<Char, N> m_data;
+};
 /// @}
 
 } // end namespace anki
@@ -0,0 +1,154 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/util/StringTable.h>
+
+namespace anki
+{
+
+StringTable::StringTable(AllocAlignedCallback allocCb, void* allocCbUserData)
+	: m_alloc(allocCb, allocCbUserData)
+{
+	for(Atomic<Entry**>& page : m_pages)
+	{
+		page.store(nullptr);
+	}
+
+	m_emptyHash = computeHash(nullptr, 0);
+}
+
+StringTable::~StringTable()
+{
+	m_map.destroy(m_alloc);
+
+	for(Atomic<Entry**>& page : m_pages)
+	{
+		Entry** entries = page.load();
+		if(entries)
+		{
+			m_alloc.getMemoryPool().free(entries);
+		}
+	}
+
+	while(m_chunks)
+	{
+		Chunk* next = m_chunks->m_next;
+		m_alloc.getMemoryPool().free(m_chunks);
+		m_chunks = next;
+	}
+}
+
+StringTable::Key StringTable::makeKey(CString str)
+{
+	Key key;
+	key.m_str = str.cstr();
+	key.m_length = U32(str.getLength());
+	key.m_hash = computeHash(key.m_str, key.m_length);
+	return key;
+}
+
+Bool StringTable::find(CString str, StringId& id) const
+{
+	if(str.isEmpty())
+	{
+		id = StringId();
+		return true;
+	}
+
+	const StringId* it = m_map.find(makeKey(str));
+	if(it)
+	{
+		id = *it;
+		return true;
+	}
+
+	return false;
+}
+
+StringId StringTable::intern(CString str)
+{
+	if(str.isEmpty())
+	{
+		return StringId();
+	}
+
+	const Key key = makeKey(str);
+	const StringId* it = m_map.find(key);
+	if(ANKI_LIKELY(it != nullptr))
+	{
+		return *it;
+	}
+
+	LockGuard<Mutex> lock(m_mtx);
+
+	// Some other thread might have added it in the meantime
+	it = m_map.find(key);
+	if(it)
+	{
+		return *it;
+	}
+
+	const U32 id = m_count.load();
+	ANKI_ASSERT(id < PAGE_SIZE * MAX_PAGE_COUNT && "Too many strings");
+
+	Entry** page = m_pages[id / PAGE_SIZE].load();
+	if(page == nullptr)
+	{
+		page = static_cast<Entry**>(m_alloc.getMemoryPool().allocate(PAGE_SIZE * sizeof(Entry*), alignof(Entry*)));
+		m_pages[id / PAGE_SIZE].store(page, AtomicMemoryOrder::RELEASE);
+	}
+
+	// The entry is written before the map and the count publish the handle
+	Entry* entry = newEntry(key);
+	page[id % PAGE_SIZE] = entry;
+
+	Key newKey = key;
+	newKey.m_str = entry->getString();
+	m_map.emplace(m_alloc, newKey, StringId(id));
+	m_count.store(id + 1, AtomicMemoryOrder::RELEASE);
+
+	return StringId(id);
+}
+
+StringTable::Entry* StringTable::newEntry(const Key& key)
+{
+	const PtrSize size = getAlignedRoundUp(alignof(Entry), sizeof(Entry) + key.m_length + 1);
+
+	const PtrSize chunkHeaderSize = getAlignedRoundUp(alignof(Entry), sizeof(Chunk));
+	Entry* entry;
+	if(size > CHUNK_SIZE / 4)
+	{
+		// Big strings get their own chunk
+		U8* mem = static_cast<U8*>(m_alloc.getMemoryPool().allocate(chunkHeaderSize + size, alignof(Entry)));
+		Chunk* chunk = reinterpret_cast<Chunk*>(mem);
+		chunk->m_next = m_chunks;
+		m_chunks = chunk;
+
+		entry = reinterpret_cast<Entry*>(mem + chunkHeaderSize);
+	}
+	else
+	{
+		if(PtrSize(m_chunkEnd - m_chunkPos) < size)
+		{
+			U8* mem = static_cast<U8*>(m_alloc.getMemoryPool().allocate(CHUNK_SIZE, alignof(Entry)));
+			Chunk* chunk = reinterpret_cast<Chunk*>(mem);
+			chunk->m_next = m_chunks;
+			m_chunks = chunk;
+
+			m_chunkPos = mem + chunkHeaderSize;
+			m_chunkEnd = mem + CHUNK_SIZE;
+		}
+
+		entry = reinterpret_cast<Entry*>(m_chunkPos);
+		m_chunkPos += size;
+	}
+
+	entry->m_hash = key.m_hash;
+	entry->m_length = key.m_length;
+	memcpy(const_cast<char*>(entry->getString()), key.m_str, key.m_length + 1);
+	return entry;
+}
+
+} // end namespace anki
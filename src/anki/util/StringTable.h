@@ -0,0 +1,191 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <anki/util/ConcurrentHashMap.h>
+#include <anki/util/Singleton.h>
+#include <anki/util/String.h>
+
+namespace anki
+{
+
+/// @addtogroup util_containers
+/// @{
+
+/// A handle to a string of a StringTable. Two strings of the same table are equal if their handles are equal. The
+/// default handle is the empty string.
+class StringId
+{
+	friend class StringTable;
+
+public:
+	StringId() = default;
+
+	Bool operator==(const StringId& b) const
+	{
+		return m_id == b.m_id;
+	}
+
+	Bool operator!=(const StringId& b) const
+	{
+		return m_id != b.m_id;
+	}
+
+	Bool isEmpty() const
+	{
+		return m_id == 0;
+	}
+
+	U32 getIndex() const
+	{
+		return m_id;
+	}
+
+	/// It's unique so it's a perfect hash for hash maps.
+	U64 computeHash() const
+	{
+		return m_id;
+	}
+
+private:
+	U32 m_id = 0;
+
+	explicit StringId(U32 id)
+		: m_id(id)
+	{
+	}
+};
+
+/// A table of unique strings. Interning a string returns a 32bit handle that is the same for equal strings so the
+/// strings can be stored and compared as integers. The strings are stored once and they live as long as the table so
+/// don't intern strings that are generated without bound.
+///
+/// It's thread safe. The lookups are lock-free and the insertions of new strings lock.
+class StringTable : public NonCopyable
+{
+public:
+	/// The handles of a page are allocated at once.
+	static constexpr U32 PAGE_SIZE = 4096;
+	static constexpr U32 MAX_PAGE_COUNT = 4096;
+
+	StringTable()
+		: StringTable(allocAligned, nullptr)
+	{
+	}
+
+	StringTable(AllocAlignedCallback allocCb, void* allocCbUserData);
+
+	~StringTable();
+
+	/// Get the handle of a string and add the string if it's not there.
+	StringId intern(CString str);
+
+	/// Get the handle of a string if the string is in the table.
+	/// @return True if it's in the table.
+	Bool find(CString str, StringId& id) const;
+
+	/// Get the string of a handle. It's valid as long as the table. The empty handle gives an empty CString.
+	CString getString(StringId id) const
+	{
+		return (id.m_id) ? CString(getEntry(id).getString()) : CString();
+	}
+
+	/// Get the computeHash() of the characters of a handle's string. It's computed once when the string is added.
+	U64 getHash(StringId id) const
+	{
+		return (id.m_id) ? getEntry(id).m_hash : m_emptyHash;
+	}
+
+	/// Get the length of the string of a handle.
+	U32 getLength(StringId id) const
+	{
+		return (id.m_id) ? getEntry(id).m_length : 0;
+	}
+
+	/// Get the number of strings, including the empty one.
+	U32 getSize() const
+	{
+		return m_count.load(AtomicMemoryOrder::ACQUIRE);
+	}
+
+private:
+	/// A string. The characters follow.
+	class Entry
+	{
+	public:
+		U64 m_hash;
+		U32 m_length;
+
+		const char* getString() const
+		{
+			return reinterpret_cast<const char*>(this + 1);
+		}
+	};
+
+	/// The key of the hash map. It points to the string of the table or to the string that is searched.
+	class Key
+	{
+	public:
+		const char* m_str;
+		U32 m_length;
+		U64 m_hash;
+
+		Bool operator==(const Key& b) const
+		{
+			return m_hash == b.m_hash && m_length == b.m_length && memcmp(m_str, b.m_str, m_length) == 0;
+		}
+	};
+
+	class KeyHasher
+	{
+	public:
+		U64 operator()(const Key& key) const
+		{
+			return key.m_hash;
+		}
+	};
+
+	/// The memory the strings are stored in.
+	class Chunk
+	{
+	public:
+		Chunk* m_next;
+	};
+
+	static constexpr PtrSize CHUNK_SIZE = 64 * 1024;
+
+	HeapAllocator<U8> m_alloc;
+	ConcurrentHashMap<Key, StringId, KeyHasher> m_map;
+
+	/// The handles point to the entries with a 2 level array so the entries never move.
+	Array<Atomic<Entry**>, MAX_PAGE_COUNT> m_pages;
+	Atomic<U32> m_count = {1};
+
+	U64 m_emptyHash;
+
+	Mutex m_mtx; ///< Serializes the insertions.
+	Chunk* m_chunks = nullptr;
+	U8* m_chunkPos = nullptr;
+	U8* m_chunkEnd = nullptr;
+
+	const Entry& getEntry(StringId id) const
+	{
+		ANKI_ASSERT(id.m_id > 0 && id.m_id < m_count.load(AtomicMemoryOrder::ACQUIRE));
+		Entry** page = m_pages[id.m_id / PAGE_SIZE].load(AtomicMemoryOrder::ACQUIRE);
+		ANKI_ASSERT(page);
+		return *page[id.m_id % PAGE_SIZE];
+	}
+
+	static Key makeKey(CString str);
+
+	Entry* newEntry(const Key& key);
+};
+
+/// The string table of the engine. Resource filenames and scene node names are interned there.
+using StringTableSingleton = Singleton<StringTable>;
+/// @}
+
+} // end namespace anki
@@ -5,7 +5,11 @@
 
 #include <anki/util/System.h>
 #include <anki/util/Logger.h>
+#include <anki/util/Functions.h>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
 
 #if ANKI_POSIX
 #	include <unistd.h>
@@ -16,6 +20,10 @@
 #	error "Unimplemented"
 #endif
 
+#if ANKI_OS == ANKI_OS_LINUX
+#	include <dirent.h>
+#endif
+
 // For print backtrace
 #if ANKI_POSIX && ANKI_OS != ANKI_OS_ANDROID
 #	include <execinfo.h>
@@ -38,6 +46,177 @@ U32 getCpuCoresCount()
 #endif
 }
 
+#if ANKI_OS == ANKI_OS_LINUX
+/// Read the first number of a sysfs file. Works for lists like "0-3,8-11" as well.
+static Bool readSysfsNumber(U32 cpu, const char* file, I32& out)
+{
+	Array<char, 128> path;
+	snprintf(&path[0], path.getSize(), "/sys/devices/system/cpu/cpu%u/%s", cpu, file);
+
+	FILE* f = fopen(&path[0], "r");
+	if(!f)
+	{
+		return false;
+	}
+
+	const Bool ok = fscanf(f, "%d", &out) == 1;
+	fclose(f);
+	return ok;
+}
+
+/// Find the NUMA node of a CPU. The sysfs has a nodeX entry in the directory of every CPU.
+static I32 getCpuNumaNode(U32 cpu)
+{
+	Array<char, 64> path;
+	snprintf(&path[0], path.getSize(), "/sys/devices/system/cpu/cpu%u", cpu);
+
+	I32 node = 0;
+	DIR* dir = opendir(&path[0]);
+	if(dir)
+	{
+		while(dirent* entry = readdir(dir))
+		{
+			if(std::strncmp(entry->d_name, "node", 4) == 0 && sscanf(entry->d_name + 4, "%d", &node) == 1)
+			{
+				break;
+			}
+		}
+
+		closedir(dir);
+	}
+
+	return node;
+}
+#endif
+
+void getCpuPinningOrder(WeakArray<U32> cpus)
+{
+	const U32 cpuCount = cpus.getSize();
+	for(U32 i = 0; i < cpuCount; ++i)
+	{
+		cpus[i] = i;
+	}
+
+#if ANKI_OS == ANKI_OS_LINUX
+	class CpuInfo
+	{
+	public:
+		I32 m_node;
+		I32 m_l3; ///< The first CPU that shares the L3 with this one.
+		I32 m_package;
+		I32 m_core;
+		U32 m_smtRank; ///< 0 for the first hardware thread of a core, 1 for the second etc.
+		U32 m_coreRank; ///< The index of the core inside the L3 domain.
+		U32 m_l3Rank; ///< The index of the L3 domain inside the NUMA node.
+	};
+
+	CpuInfo* infos = static_cast<CpuInfo*>(malloc(sizeof(CpuInfo) * cpuCount));
+	if(infos == nullptr)
+	{
+		ANKI_UTIL_LOGF("Out of memory");
+	}
+
+	// Gather the topology
+	Bool topologyKnown = true;
+	for(U32 i = 0; i < cpuCount && topologyKnown; ++i)
+	{
+		CpuInfo& info = infos[i];
+		topologyKnown = readSysfsNumber(i, "topology/physical_package_id", info.m_package)
+						&& readSysfsNumber(i, "topology/core_id", info.m_core);
+
+		// Some VMs don't expose the caches. Assume one L3 per node in that case
+		info.m_node = getCpuNumaNode(i);
+		if(!readSysfsNumber(i, "cache/index3/shared_cpu_list", info.m_l3))
+		{
+			info.m_l3 = -1 - info.m_node;
+		}
+	}
+
+	if(!topologyKnown)
+	{
+		free(infos);
+		return;
+	}
+
+	// Compute the ranks. The number of CPUs is small so the quadratic loops are fine
+	for(U32 i = 0; i < cpuCount; ++i)
+	{
+		CpuInfo& info = infos[i];
+		info.m_smtRank = 0;
+		for(U32 j = 0; j < i; ++j)
+		{
+			if(infos[j].m_package == info.m_package && infos[j].m_core == info.m_core)
+			{
+				++info.m_smtRank;
+			}
+		}
+	}
+
+	for(U32 i = 0; i < cpuCount; ++i)
+	{
+		// Count the cores of the same L3 domain that come before this core. Use the first thread of every core
+		CpuInfo& info = infos[i];
+		info.m_coreRank = 0;
+		for(U32 j = 0; j < cpuCount; ++j)
+		{
+			const CpuInfo& other = infos[j];
+			if(other.m_package == info.m_package && other.m_core == info.m_core)
+			{
+				break;
+			}
+
+			if(other.m_l3 == info.m_l3 && other.m_smtRank == 0)
+			{
+				++info.m_coreRank;
+			}
+		}
+	}
+
+	for(U32 i = 0; i < cpuCount; ++i)
+	{
+		// Count the L3 domains of the same node that come before this one. Use the first thread of every domain
+		CpuInfo& info = infos[i];
+		info.m_l3Rank = 0;
+		for(U32 j = 0; j < cpuCount; ++j)
+		{
+			const CpuInfo& other = infos[j];
+			if(other.m_node == info.m_node && other.m_l3 < info.m_l3 && other.m_coreRank == 0 && other.m_smtRank == 0)
+			{
+				++info.m_l3Rank;
+			}
+		}
+	}
+
+	// Sort. Rotate over the nodes first, then over the L3 domains, then over the cores and then over the SMT threads
+	std::sort(&cpus[0], &cpus[0] + cpuCount, [&](U32 a, U32 b) {
+		const CpuInfo& ia = infos[a];
+		const CpuInfo& ib = infos[b];
+		if(ia.m_smtRank != ib.m_smtRank)
+		{
+			return ia.m_smtRank < ib.m_smtRank;
+		}
+		else if(ia.m_coreRank != ib.m_coreRank)
+		{
+			return ia.m_coreRank < ib.m_coreRank;
+		}
+		else if(ia.m_l3Rank != ib.m_l3Rank)
+		{
+			return ia.m_l3Rank < ib.m_l3Rank;
+		}
+		else if(ia.m_node != ib.m_node)
+		{
+			return ia.m_node < ib.m_node;
+		}
+		else
+		{
+			return a < b;
+		}
+	});
+
+	free(infos);
+#endif
+}
+
 void BackTraceWalker::exec()
 {
 #if ANKI_POSIX && ANKI_OS != ANKI_OS_ANDROID
@@ -46,27 +225,57 @@ void BackTraceWalker::exec()
 	if(array)
 	{
 		size_t size = backtrace(array, m_stackSize);
+		exec(WeakArray<void*>(array, size));
+		free(array);
+	}
+#else
+	ANKI_UTIL_LOGW("BackTraceWalker::exec() Not supported in this platform");
+#endif
+}
 
-		// Get symbols
-		char** strings = backtrace_symbols(array, size);
+void BackTraceWalker::exec(WeakArray<void*> addresses)
+{
+#if ANKI_POSIX && ANKI_OS != ANKI_OS_ANDROID
+	// Get symbols
+	char** strings = (addresses.getSize()) ? backtrace_symbols(&addresses[0], addresses.getSize()) : nullptr;
 
-		if(strings)
+	if(strings)
+	{
+		for(U i = 0; i < addresses.getSize(); ++i)
 		{
-			for(size_t i = 0; i < size; ++i)
-			{
-				operator()(strings[i]);
-			}
-
-			free(strings);
+			operator()(strings[i]);
 		}
 
-		free(array);
+		free(strings);
 	}
 #else
 	ANKI_UTIL_LOGW("BackTraceWalker::exec() Not supported in this platform");
 #endif
 }
 
+U32 getBackTraceAddresses(WeakArray<void*> addresses, U32 skip)
+{
+#if ANKI_POSIX && ANKI_OS != ANKI_OS_ANDROID
+	// Skip this function as well
+	++skip;
+
+	Array<void*, 128> array;
+	const U32 maxCount = min<U32>(addresses.getSize() + skip, array.getSize());
+	const U32 count = backtrace(&array[0], maxCount);
+	if(count <= skip)
+	{
+		return 0;
+	}
+
+	memcpy(&addresses[0], &array[skip], (count - skip) * sizeof(void*));
+	return count - skip;
+#else
+	(void)addresses;
+	(void)skip;
+	return 0;
+#endif
+}
+
 Bool runningFromATerminal()
 {
 #if ANKI_POSIX
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <anki/util/StdTypes.h>
+#include <anki/util/WeakArray.h>
 
 namespace anki
 {
@@ -16,6 +17,12 @@ namespace anki
 /// Get the number of CPU cores
 U32 getCpuCoresCount();
 
+/// Get an order of the logical CPUs that is good for pinning worker threads. Consecutive entries are spread over the
+/// NUMA nodes first, then over the L3 cache domains (CCXs) of every node and then over the physical cores. SMT siblings
+/// come last. If the topology is unknown the order is 0, 1, 2 etc.
+/// @param[out] cpus The order. Its size should be getCpuCoresCount().
+void getCpuPinningOrder(WeakArray<U32> cpus);
+
 /// Visit the program stack.
 class BackTraceWalker
 {
@@ -31,12 +38,22 @@ public:
 
 	virtual void operator()(const char* symbol) = 0;
 
+	/// Walk the current stack.
 	void exec();
 
+	/// Walk a stack that was captured with getBackTraceAddresses().
+	void exec(WeakArray<void*> addresses);
+
 private:
 	U m_stackSize;
 };
 
+/// Get the return addresses of the current stack without resolving them. It's much cheaper than BackTraceWalker.
+/// @param[out] addresses Where to write the addresses. The size of the array is the max stack depth.
+/// @param skip The number of the innermost frames to skip.
+/// @return The number of the written addresses.
+U32 getBackTraceAddresses(WeakArray<void*> addresses, U32 skip = 0);
+
 /// Return true if the engine is running from a terminal emulator.
 Bool runningFromATerminal();
 /// @}
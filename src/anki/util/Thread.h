@@ -8,6 +8,8 @@
 #include <anki/util/StdTypes.h>
 #include <anki/util/Array.h>
 #include <anki/util/NonCopyable.h>
+#include <anki/util/Atomic.h>
+#include <anki/util/Functions.h>
 #include <atomic>
 
 namespace anki
@@ -43,7 +45,8 @@ public:
 	/// Start the thread.
 	/// @param userData The user data of the thread callback
 	/// @param callback The thread callback that will be executed
-	/// @param pinToCore Pin the thread to a core.
+	/// @param pinToCore Pin the thread to a logical CPU. If it's negative the thread is not pinned. See
+	///                  getCpuPinningOrder() for a good way to pick CPUs.
 	void start(void* userData, ThreadCallback callback, I pinToCore = -1);
 
 	/// Wait for the thread to finish
@@ -217,6 +220,62 @@ public:
 private:
 	void* m_impl = nullptr;
 };
+
+/// Hands out chunks of an index range to the threads that ask for them. Threads that finish early simply get more
+/// chunks so it balances the load better than splitting the range in equal parts. It's the building block of the
+/// parallelFor() and parallelReduce() of ThreadPool and ThreadHive.
+/// @note It's thread-safe.
+class ParallelForRange : public NonCopyable
+{
+public:
+	/// @param elementCount The size of the range.
+	/// @param grainSize The number of elements of every chunk. The last chunk may be smaller.
+	ParallelForRange(PtrSize elementCount, PtrSize grainSize)
+		: m_elementCount(elementCount)
+		, m_grainSize(grainSize)
+	{
+		ANKI_ASSERT(grainSize > 0);
+	}
+
+	/// Get the next chunk.
+	/// @param[out] start The first element of the chunk.
+	/// @param[out] end One past the last element of the chunk.
+	/// @return False if there is no more work.
+	Bool next(PtrSize& start, PtrSize& end)
+	{
+		if(m_stopped.load())
+		{
+			return false;
+		}
+
+		start = m_cursor.fetchAdd(m_grainSize);
+		if(start >= m_elementCount)
+		{
+			return false;
+		}
+
+		end = min(start + m_grainSize, m_elementCount);
+		return true;
+	}
+
+	/// Stop handing out chunks. Used to bail out early when an error happens.
+	void stop()
+	{
+		m_stopped.store(true);
+	}
+
+	/// Get the number of chunks.
+	PtrSize getChunkCount() const
+	{
+		return (m_elementCount + m_grainSize - 1) / m_grainSize;
+	}
+
+private:
+	Atomic<PtrSize> m_cursor = {0};
+	Atomic<Bool> m_stopped = {false};
+	PtrSize m_elementCount;
+	PtrSize m_grainSize;
+};
 /// @}
 
 } // end namespace anki
@@ -4,6 +4,8 @@
 // http://www.anki3d.org/LICENSE
 
 #include <anki/util/ThreadHive.h>
+#include <anki/util/System.h>
+#include <anki/util/HighRezTimer.h>
 #include <cstring>
 #include <cstdio>
 
@@ -18,6 +20,167 @@ namespace anki
 #	define ANKI_HIVE_DEBUG_PRINT(...) ((void)0)
 #endif
 
+/// The hive the current thread belongs to. nullptr if it's not a hive thread.
+static thread_local ThreadHive* g_crntThreadHive = nullptr;
+
+/// The ID of the current thread in g_crntThreadHive.
+static thread_local U32 g_crntThreadHiveThreadId = MAX_U32;
+
+class ThreadHive::Task : public NonCopyable
+{
+public:
+	Task* m_next; ///< Next in the list.
+
+	ThreadHiveTaskCallback m_cb; ///< Callback that defines the task.
+	void* m_arg; ///< Args for the callback.
+
+	ThreadHiveSemaphore* m_signalSemaphore;
+
+	ThreadHiveTaskPriority m_priority;
+
+#if ANKI_ENABLE_TRACE
+	Second m_readyTime; ///< When it was pushed to a queue.
+#endif
+};
+
+/// The Chase-Lev deque. The owner thread pushes and pops from the bottom and the other threads steal from the top. See
+/// "Correct and Efficient Work-Stealing for Weak Memory Models" for the memory ordering.
+class alignas(ANKI_CACHE_LINE_SIZE) ThreadHive::TaskQueue : public NonCopyable
+{
+public:
+	TaskQueue(GenericMemoryPoolAllocator<U8> alloc)
+		: m_alloc(alloc)
+	{
+		m_buffer.set(newBuffer(INITIAL_CAPACITY));
+	}
+
+	~TaskQueue()
+	{
+		Buffer* buff = m_buffer.get();
+		while(buff)
+		{
+			Buffer* prev = buff->m_prev;
+			m_alloc.deallocate(buff, sizeof(Buffer) + sizeof(Atomic<Task*>) * buff->m_capacity);
+			buff = prev;
+		}
+	}
+
+	/// Push to the bottom. Only the owner thread can call it.
+	void push(Task* task)
+	{
+		const I64 b = m_bottom.load(AtomicMemoryOrder::RELAXED);
+		const I64 t = m_top.load(AtomicMemoryOrder::ACQUIRE);
+		Buffer* buff = m_buffer.load(AtomicMemoryOrder::RELAXED);
+
+		if(b - t > I64(buff->m_capacity) - 1)
+		{
+			buff = grow(buff, t, b);
+		}
+
+		buff->at(b).store(task, AtomicMemoryOrder::RELAXED);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_bottom.store(b + 1, AtomicMemoryOrder::RELAXED);
+	}
+
+	/// Pop from the bottom. Only the owner thread can call it.
+	Task* pop()
+	{
+		const I64 b = m_bottom.load(AtomicMemoryOrder::RELAXED) - 1;
+		Buffer* buff = m_buffer.load(AtomicMemoryOrder::RELAXED);
+		m_bottom.store(b, AtomicMemoryOrder::RELAXED);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		I64 t = m_top.load(AtomicMemoryOrder::RELAXED);
+
+		Task* task = nullptr;
+		if(t <= b)
+		{
+			task = buff->at(b).load(AtomicMemoryOrder::RELAXED);
+			if(t == b)
+			{
+				// Last element, compete with the thieves
+				if(!m_top.compareExchange(t, t + 1, AtomicMemoryOrder::SEQ_CST))
+				{
+					task = nullptr;
+				}
+
+				m_bottom.store(b + 1, AtomicMemoryOrder::RELAXED);
+			}
+		}
+		else
+		{
+			m_bottom.store(b + 1, AtomicMemoryOrder::RELAXED);
+		}
+
+		return task;
+	}
+
+	/// Steal from the top. Any thread can call it.
+	Task* steal()
+	{
+		I64 t = m_top.load(AtomicMemoryOrder::ACQUIRE);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const I64 b = m_bottom.load(AtomicMemoryOrder::ACQUIRE);
+
+		Task* task = nullptr;
+		if(t < b)
+		{
+			Buffer* buff = m_buffer.load(AtomicMemoryOrder::ACQUIRE);
+			task = buff->at(t).load(AtomicMemoryOrder::RELAXED);
+			if(!m_top.compareExchange(t, t + 1, AtomicMemoryOrder::SEQ_CST))
+			{
+				task = nullptr;
+			}
+		}
+
+		return task;
+	}
+
+private:
+	/// A ring buffer.
+	class Buffer
+	{
+	public:
+		Buffer* m_prev; ///< The buffer that this one replaced. Kept alive because a thief might still read it.
+		U32 m_capacity; ///< Power of two.
+
+		Atomic<Task*>& at(I64 idx)
+		{
+			return reinterpret_cast<Atomic<Task*>*>(this + 1)[idx & (m_capacity - 1)];
+		}
+	};
+
+	static const U32 INITIAL_CAPACITY = 256;
+
+	GenericMemoryPoolAllocator<U8> m_alloc;
+	Atomic<I64> m_top = {0};
+	Atomic<I64> m_bottom = {0};
+	Atomic<Buffer*> m_buffer = {nullptr};
+
+	Buffer* newBuffer(U32 capacity)
+	{
+		PtrSize alignment = alignof(Buffer);
+		Buffer* buff = reinterpret_cast<Buffer*>(
+			m_alloc.allocate(sizeof(Buffer) + sizeof(Atomic<Task*>) * capacity, &alignment));
+		buff->m_prev = nullptr;
+		buff->m_capacity = capacity;
+		return buff;
+	}
+
+	Buffer* grow(Buffer* oldBuff, I64 top, I64 bottom)
+	{
+		Buffer* buff = newBuffer(oldBuff->m_capacity * 2);
+		buff->m_prev = oldBuff;
+
+		for(I64 i = top; i < bottom; ++i)
+		{
+			buff->at(i).store(oldBuff->at(i).load(AtomicMemoryOrder::RELAXED), AtomicMemoryOrder::RELAXED);
+		}
+
+		m_buffer.store(buff, AtomicMemoryOrder::RELEASE);
+		return buff;
+	}
+};
+
 class ThreadHive::Thread
 {
 public:
@@ -26,13 +189,14 @@ public:
 	ThreadHive* m_hive;
 
 	/// Constructor
-	Thread(U32 id, ThreadHive* hive, Bool pinToCores)
+	/// @param pinToCore The logical CPU to pin the thread to or -1.
+	Thread(U32 id, ThreadHive* hive, I pinToCore)
 		: m_id(id)
 		, m_thread("anki_threadhive")
 		, m_hive(hive)
 	{
 		ANKI_ASSERT(hive);
-		m_thread.start(this, threadCallback, (pinToCores) ? I(m_id) : -1);
+		m_thread.start(this, threadCallback, pinToCore);
 	}
 
 private:
@@ -41,34 +205,47 @@ private:
 	{
 		Thread& self = *static_cast<Thread*>(info.m_userData);
 
+		g_crntThreadHive = self.m_hive;
+		g_crntThreadHiveThreadId = self.m_id;
+
 		self.m_hive->threadRun(self.m_id);
 		return Error::NONE;
 	}
 };
 
-class ThreadHive::Task : public NonCopyable
-{
-public:
-	Task* m_next; ///< Next in the list.
-
-	ThreadHiveTaskCallback m_cb; ///< Callback that defines the task.
-	void* m_arg; ///< Args for the callback.
-
-	ThreadHiveSemaphore* m_waitSemaphore;
-	ThreadHiveSemaphore* m_signalSemaphore;
-};
-
 ThreadHive::ThreadHive(U threadCount, GenericMemoryPoolAllocator<U8> alloc, Bool pinToCores)
 	: m_slowAlloc(alloc)
 	, m_alloc(alloc.getMemoryPool().getAllocationCallback(),
 		  alloc.getMemoryPool().getAllocationCallbackUserData(),
-		  1024 * 4)
+		  1024 * 16)
 	, m_threadCount(threadCount)
 {
-	m_threads = reinterpret_cast<Thread*>(m_slowAlloc.allocate(sizeof(Thread) * threadCount));
-	for(U i = 0; i < threadCount; ++i)
+	// Create the queues before the threads because the threads will try to steal from all of them
+	const U queueCount = (threadCount + 1) * PRIORITY_COUNT;
+	PtrSize alignment = alignof(TaskQueue);
+	m_queues = reinterpret_cast<TaskQueue*>(m_slowAlloc.allocate(sizeof(TaskQueue) * queueCount, &alignment));
+	for(U i = 0; i < queueCount; ++i)
 	{
-		::new(&m_threads[i]) Thread(i, this, pinToCores);
+		::new(&m_queues[i]) TaskQueue(m_slowAlloc);
+	}
+
+	// With no worker threads the waiting thread does all the work
+	if(threadCount > 0)
+	{
+		// Spread the threads over the CPU topology
+		DynamicArrayAuto<U32> cpus(m_slowAlloc);
+		if(pinToCores)
+		{
+			cpus.create(getCpuCoresCount());
+			getCpuPinningOrder(WeakArray<U32>(cpus));
+		}
+
+		m_threads = reinterpret_cast<Thread*>(m_slowAlloc.allocate(sizeof(Thread) * threadCount));
+		for(U i = 0; i < threadCount; ++i)
+		{
+			const I cpu = (pinToCores) ? I(cpus[i % cpus.getSize()]) : -1;
+			::new(&m_threads[i]) Thread(i, this, cpu);
+		}
 	}
 }
 
@@ -95,6 +272,33 @@ ThreadHive::~ThreadHive()
 
 		m_slowAlloc.deallocate(static_cast<void*>(m_threads), m_threadCount * sizeof(Thread));
 	}
+
+	if(m_queues)
+	{
+		const U queueCount = (m_threadCount + 1) * PRIORITY_COUNT;
+		for(U i = 0; i < queueCount; ++i)
+		{
+			m_queues[i].~TaskQueue();
+		}
+
+		m_slowAlloc.deallocate(static_cast<void*>(m_queues), queueCount * sizeof(TaskQueue));
+	}
+
+	m_deferredTasks.destroy(m_slowAlloc);
+}
+
+ThreadHive::TaskQueue& ThreadHive::getQueue(U32 threadId, ThreadHiveTaskPriority priority)
+{
+	ANKI_ASSERT(threadId <= m_threadCount && priority < ThreadHiveTaskPriority::COUNT);
+	return m_queues[threadId * PRIORITY_COUNT + U32(priority)];
+}
+
+ThreadHiveSemaphore* ThreadHive::newSemaphore(const U32 initialValue)
+{
+	ANKI_ASSERT(initialValue > 0);
+	PtrSize alignment = alignof(ThreadHiveSemaphore);
+	void* mem = m_alloc.allocate(sizeof(ThreadHiveSemaphore), &alignment);
+	return ::new(mem) ThreadHiveSemaphore(initialValue);
 }
 
 void ThreadHive::submitTasks(ThreadHiveTask* tasks, const U taskCount)
@@ -104,167 +308,483 @@ void ThreadHive::submitTasks(ThreadHiveTask* tasks, const U taskCount)
 	// Allocate tasks
 	Task* const htasks = m_alloc.newArray<Task>(taskCount);
 
-	// Initialize tasks
-	Task* prevTask = nullptr;
+	// Account the tasks before anything can run them
+	m_pendingTasks.fetchAdd(taskCount, AtomicMemoryOrder::ACQ_REL);
+
+	// Initialize tasks and park the ones that have unresolved dependencies
+	Task* readyHead = nullptr;
+	Task* readyTail = nullptr;
+	U32 readyCount = 0;
 	for(U i = 0; i < taskCount; ++i)
 	{
 		const ThreadHiveTask& inTask = tasks[i];
 		Task& outTask = htasks[i];
+		ANKI_ASSERT(inTask.m_priority < ThreadHiveTaskPriority::COUNT);
+		ANKI_ASSERT((inTask.m_priority != ThreadHiveTaskPriority::BACKGROUND || inTask.m_signalSemaphore == nullptr)
+					&& "BACKGROUND tasks might be deferred so they can't signal");
 
 		outTask.m_next = nullptr;
 		outTask.m_cb = inTask.m_callback;
 		outTask.m_arg = inTask.m_argument;
-		outTask.m_waitSemaphore = inTask.m_waitSemaphore;
 		outTask.m_signalSemaphore = inTask.m_signalSemaphore;
+		outTask.m_priority = inTask.m_priority;
 
-		// Connect tasks
-		if(prevTask)
+		ThreadHiveSemaphore* waitSem = inTask.m_waitSemaphore;
+		if(waitSem && waitSem->m_atomic.load(AtomicMemoryOrder::ACQUIRE) != 0)
 		{
-			prevTask->m_next = &outTask;
-		}
-		prevTask = &outTask;
-	}
+			LockGuard<SpinLock> lock(waitSem->m_waitingTasksLock);
 
-	// Push work
-	{
-		LockGuard<Mutex> lock(m_mtx);
+			// Check again because the semaphore might have been signaled before the lock
+			if(waitSem->m_atomic.load(AtomicMemoryOrder::ACQUIRE) != 0)
+			{
+				outTask.m_next = waitSem->m_waitingTasks;
+				waitSem->m_waitingTasks = &outTask;
+				++waitSem->m_waitingTaskCount;
+				continue;
+			}
+		}
 
-		if(m_head != nullptr)
+		// Ready, connect it
+		if(readyTail)
 		{
-			ANKI_ASSERT(m_tail && m_head);
-			m_tail->m_next = &htasks[0];
-			m_tail = &htasks[taskCount - 1];
+			readyTail->m_next = &outTask;
 		}
 		else
 		{
-			ANKI_ASSERT(m_tail == nullptr);
-			m_head = &htasks[0];
-			m_tail = &htasks[taskCount - 1];
+			readyHead = &outTask;
 		}
+		readyTail = &outTask;
+		++readyCount;
+	}
 
-		m_pendingTasks += taskCount;
-
-		ANKI_HIVE_DEBUG_PRINT("submit tasks\n");
+	if(readyCount)
+	{
+		pushReadyTasks(readyHead, readyCount);
 	}
 
-	// Notify all threads
-	m_cvar.notifyAll();
+	ANKI_HIVE_DEBUG_PRINT("submit tasks\n");
 }
 
-void ThreadHive::threadRun(U threadId)
+void ThreadHive::pushReadyTasks(Task* head, U32 taskCount)
 {
-	Task* task = nullptr;
+	ANKI_ASSERT(head && taskCount > 0);
 
-	while(!waitForWork(threadId, task))
+	// Account the tasks before anyone can pop them
+	Array<U32, PRIORITY_COUNT> counts = {};
+#if ANKI_ENABLE_TRACE
+	const Second now = HighRezTimer::getCurrentTime();
+#endif
+	for(Task* task = head; task; task = task->m_next)
 	{
-		// Run the task
-		ANKI_ASSERT(task && task->m_cb);
-		ANKI_HIVE_DEBUG_PRINT(
-			"tid: %lu will exec %p (udata: %p)\n", threadId, static_cast<void*>(task), static_cast<void*>(task->m_arg));
-		task->m_cb(task->m_arg, threadId, *this, task->m_signalSemaphore);
-
-#if ANKI_EXTRA_CHECKS
-		task->m_cb = nullptr;
+		++counts[task->m_priority];
+#if ANKI_ENABLE_TRACE
+		task->m_readyTime = now;
 #endif
+	}
 
-		// Signal the semaphore as early as possible
-		if(task->m_signalSemaphore)
+	for(U32 p = 0; p < PRIORITY_COUNT; ++p)
+	{
+		if(counts[p])
 		{
-			const U32 out = task->m_signalSemaphore->m_atomic.fetchSub(1);
-			(void)out;
-			ANKI_ASSERT(out > 0u);
-			ANKI_HIVE_DEBUG_PRINT("\tsem is %u\n", out - 1u);
+			const U32 depth = m_priorities[p].m_readyTaskCount.fetchAdd(counts[p], AtomicMemoryOrder::RELAXED);
+			m_priorities[p].m_maxReadyTaskCount.max(depth + counts[p]);
 		}
 	}
 
-	ANKI_HIVE_DEBUG_PRINT("tid: %lu thread quits!\n", threadId);
+	if(g_crntThreadHive == this)
+	{
+		// It's one of our threads, push to its local queues
+		Task* task = head;
+		while(task)
+		{
+			Task* next = task->m_next;
+			getQueue(g_crntThreadHiveThreadId, task->m_priority).push(task);
+			task = next;
+		}
+	}
+	else
+	{
+		LockGuard<SpinLock> lock(m_globalQueueLock);
+
+		Task* task = head;
+		while(task)
+		{
+			Task* next = task->m_next;
+			task->m_next = nullptr;
+
+			Priority& prio = m_priorities[task->m_priority];
+			if(prio.m_head != nullptr)
+			{
+				ANKI_ASSERT(prio.m_tail);
+				prio.m_tail->m_next = task;
+			}
+			else
+			{
+				ANKI_ASSERT(prio.m_tail == nullptr);
+				prio.m_head = task;
+			}
+
+			prio.m_tail = task;
+			task = next;
+		}
+
+		for(U32 p = 0; p < PRIORITY_COUNT; ++p)
+		{
+			if(counts[p])
+			{
+				m_priorities[p].m_globalTaskCount.fetchAdd(counts[p], AtomicMemoryOrder::RELEASE);
+			}
+		}
+	}
+
+	wakeThreads(taskCount);
 }
 
-Bool ThreadHive::waitForWork(U threadId, Task*& task)
+void ThreadHive::wakeThreads(U32 taskCount)
 {
-	LockGuard<Mutex> lock(m_mtx);
-
-	ANKI_HIVE_DEBUG_PRINT("tid: %lu locking\n", threadId);
+	// Pairs with the increment of m_sleepingThreadCount in waitForWork()
+	std::atomic_thread_fence(std::memory_order_seq_cst);
 
-	// Complete the previous task
-	if(task)
+	const U32 sleepingCount = m_sleepingThreadCount.load(AtomicMemoryOrder::RELAXED);
+	if(sleepingCount == 0)
 	{
-		--m_pendingTasks;
+		return;
+	}
 
-		if(task->m_signalSemaphore || m_pendingTasks == 0)
+	LockGuard<Mutex> lock(m_mtx);
+	if(taskCount >= sleepingCount)
+	{
+		m_cvar.notifyAll();
+	}
+	else
+	{
+		while(taskCount-- != 0)
 		{
-			// A dependency maybe got resolved or we are out of tasks. Wake them all
-			ANKI_HIVE_DEBUG_PRINT("tid: %lu wake all\n", threadId);
-			m_cvar.notifyAll();
+			m_cvar.notifyOne();
 		}
 	}
+}
+
+void ThreadHive::threadRun(U32 threadId)
+{
+	Task* task;
+	while((task = waitForWork(threadId, nullptr)) != nullptr)
+	{
+		runTask(threadId, *task);
+	}
 
-	while(!m_quit && (task = getNewTask()) == nullptr)
+	ANKI_HIVE_DEBUG_PRINT("tid: %u thread quits!\n", threadId);
+}
+
+void ThreadHive::runTask(U32 threadId, Task& task)
+{
+	ANKI_ASSERT(task.m_cb);
+	Priority& prio = m_priorities[task.m_priority];
+
+	// Don't start BACKGROUND tasks after the deadline, keep them for the next frame
+	if(task.m_priority == ThreadHiveTaskPriority::BACKGROUND)
 	{
-		ANKI_HIVE_DEBUG_PRINT("tid: %lu waiting\n", threadId);
+		const Second deadline = m_frameDeadline.load();
+		if(deadline < MAX_SECOND && HighRezTimer::getCurrentTime() > deadline)
+		{
+			ANKI_HIVE_DEBUG_PRINT("tid: %u will defer %p\n", threadId, static_cast<void*>(&task));
+			{
+				LockGuard<SpinLock> lock(m_deferredTasksLock);
+
+				if(m_deferredTaskCount == m_deferredTasks.getSize())
+				{
+					m_deferredTasks.resize(m_slowAlloc, max<U32>(16, m_deferredTaskCount * 2));
+				}
+
+				ThreadHiveTask& deferred = m_deferredTasks[m_deferredTaskCount++];
+				deferred.m_callback = task.m_cb;
+				deferred.m_argument = task.m_arg;
+				deferred.m_waitSemaphore = nullptr;
+				deferred.m_signalSemaphore = nullptr;
+				deferred.m_priority = ThreadHiveTaskPriority::BACKGROUND;
+			}
 
-		// Wait if there is no work.
-		m_cvar.wait(m_mtx);
+			prio.m_deferredTaskCount.fetchAdd(1);
+			completeTask(threadId, task);
+			return;
+		}
 	}
 
-	return m_quit;
+	prio.m_startedTaskCount.fetchAdd(1);
+#if ANKI_ENABLE_TRACE
+	prio.m_waitTimeNs.fetchAdd(U64((HighRezTimer::getCurrentTime() - task.m_readyTime) * 1000000000.0));
+#endif
+
+	ANKI_HIVE_DEBUG_PRINT(
+		"tid: %u will exec %p (udata: %p)\n", threadId, static_cast<void*>(&task), static_cast<void*>(task.m_arg));
+	task.m_cb(task.m_arg, threadId, *this, task.m_signalSemaphore);
+
+#if ANKI_EXTRA_CHECKS
+	task.m_cb = nullptr;
+#endif
+
+	completeTask(threadId, task);
 }
 
-ThreadHive::Task* ThreadHive::getNewTask()
+void ThreadHive::completeTask(U32 threadId, Task& task)
 {
-	Task* prevTask = nullptr;
-	Task* task = m_head;
-	while(task)
+	// Signal the semaphore and release the tasks that waited on it
+	ThreadHiveSemaphore* sem = task.m_signalSemaphore;
+	if(sem)
 	{
-		// Check if there are dependencies
-		const Bool allDepsCompleted = task->m_waitSemaphore == nullptr || task->m_waitSemaphore->m_atomic.load() == 0;
+		const U32 out = sem->m_atomic.fetchSub(1, AtomicMemoryOrder::ACQ_REL);
+		ANKI_ASSERT(out > 0u);
+		ANKI_HIVE_DEBUG_PRINT("\tsem is %u\n", out - 1u);
 
-		if(allDepsCompleted)
+		if(out == 1)
 		{
-			// Found something, pop it
-			if(prevTask)
+			// Someone might wait on that semaphore. Pairs with the store of m_waitedSemaphore in waitInternal()
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if(m_waitedSemaphore.load() == sem)
 			{
-				prevTask->m_next = task->m_next;
+				LockGuard<Mutex> lock(m_mtx);
+				m_cvar.notifyAll();
 			}
 
-			if(m_head == task)
+			Task* head;
+			U32 count;
 			{
-				m_head = task->m_next;
+				LockGuard<SpinLock> lock(sem->m_waitingTasksLock);
+				head = sem->m_waitingTasks;
+				count = sem->m_waitingTaskCount;
+				sem->m_waitingTasks = nullptr;
+				sem->m_waitingTaskCount = 0;
 			}
 
-			if(m_tail == task)
+			if(head)
 			{
-				m_tail = prevTask;
+				pushReadyTasks(head, count);
 			}
+		}
+	}
 
-#if ANKI_EXTRA_CHECKS
-			task->m_next = nullptr;
-#endif
-			break;
+	// Last task, wake whoever waits for all tasks. The fence pairs with the increment of m_waitingThreadCount
+	if(m_pendingTasks.fetchSub(1, AtomicMemoryOrder::ACQ_REL) == 1)
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(m_waitingThreadCount.load() > 0)
+		{
+			ANKI_HIVE_DEBUG_PRINT("tid: %u wake the waiter\n", threadId);
+			LockGuard<Mutex> lock(m_mtx);
+			m_cvar.notifyAll();
+		}
+	}
+}
+
+ThreadHive::Task* ThreadHive::tryGetTask(U32 threadId, Bool exhaustive)
+{
+	const U32 queueCount = m_threadCount + 1;
+
+	for(U32 p = 0; p < PRIORITY_COUNT; ++p)
+	{
+		const ThreadHiveTaskPriority priority = ThreadHiveTaskPriority(p);
+		Priority& prio = m_priorities[p];
+
+		if(!exhaustive && prio.m_readyTaskCount.load(AtomicMemoryOrder::RELAXED) == 0)
+		{
+			continue;
 		}
 
-		prevTask = task;
-		task = task->m_next;
+		// Try the local queue first
+		Task* task = getQueue(threadId, priority).pop();
+
+		// Then the global queue
+		if(!task && prio.m_globalTaskCount.load(AtomicMemoryOrder::ACQUIRE) > 0)
+		{
+			LockGuard<SpinLock> lock(m_globalQueueLock);
+
+			task = prio.m_head;
+			if(task)
+			{
+				prio.m_head = task->m_next;
+				if(prio.m_head == nullptr)
+				{
+					prio.m_tail = nullptr;
+				}
+
+				prio.m_globalTaskCount.fetchSub(1, AtomicMemoryOrder::RELAXED);
+			}
+		}
+
+		// Last, steal from the other threads
+		for(U32 i = 1; i < queueCount && !task; ++i)
+		{
+			const U32 victim = (threadId + i) % queueCount;
+			task = getQueue(victim, priority).steal();
+		}
+
+		if(task)
+		{
+			prio.m_readyTaskCount.fetchSub(1, AtomicMemoryOrder::RELAXED);
+			return task;
+		}
 	}
 
-	return task;
+	return nullptr;
 }
 
-void ThreadHive::waitAllTasks()
+Bool ThreadHive::shouldStop(U32 threadId, const ThreadHiveSemaphore* waitSemaphore) const
 {
-	ANKI_HIVE_DEBUG_PRINT("mt: waiting all\n");
+	if(threadId < m_threadCount)
+	{
+		return m_quit;
+	}
+	else if(waitSemaphore)
+	{
+		return waitSemaphore->m_atomic.load(AtomicMemoryOrder::ACQUIRE) == 0;
+	}
+	else
+	{
+		return m_pendingTasks.load(AtomicMemoryOrder::ACQUIRE) == 0;
+	}
+}
+
+ThreadHive::Task* ThreadHive::waitForWork(U32 threadId, const ThreadHiveSemaphore* waitSemaphore)
+{
+	Task* task = tryGetTask(threadId, false);
+	if(task)
+	{
+		return task;
+	}
 
 	LockGuard<Mutex> lock(m_mtx);
-	while(m_pendingTasks > 0)
+
+	// Announce that we'll sleep before looking for work for the last time. Pairs with the fence in wakeThreads()
+	m_sleepingThreadCount.fetchAdd(1, AtomicMemoryOrder::SEQ_CST);
+
+	while(!shouldStop(threadId, waitSemaphore) && (task = tryGetTask(threadId, true)) == nullptr)
 	{
+		ANKI_HIVE_DEBUG_PRINT("tid: %u waiting\n", threadId);
+
+		// Wait if there is no work.
 		m_cvar.wait(m_mtx);
 	}
 
-	m_head = nullptr;
-	m_tail = nullptr;
+	m_sleepingThreadCount.fetchSub(1, AtomicMemoryOrder::RELAXED);
+
+	return task;
+}
+
+void ThreadHive::waitInternal(ThreadHiveSemaphore* sem)
+{
+	ANKI_ASSERT(g_crntThreadHive != this && "Can't wait from a task");
+	const U32 prevWaitingThreadCount = m_waitingThreadCount.fetchAdd(1);
+	(void)prevWaitingThreadCount;
+	ANKI_ASSERT(prevWaitingThreadCount == 0 && "Only one thread can wait");
+
+	// Become part of the hive for a while
+	ThreadHive* const prevHive = g_crntThreadHive;
+	const U32 prevThreadId = g_crntThreadHiveThreadId;
+	const U32 threadId = m_threadCount;
+	g_crntThreadHive = this;
+	g_crntThreadHiveThreadId = threadId;
+
+	m_waitedSemaphore.store(sem);
+
+	Task* task;
+	while(!shouldStop(threadId, sem) && (task = waitForWork(threadId, sem)) != nullptr)
+	{
+		runTask(threadId, *task);
+	}
+
+	m_waitedSemaphore.store(nullptr);
+
+	g_crntThreadHive = prevHive;
+	g_crntThreadHiveThreadId = prevThreadId;
+
+	m_waitingThreadCount.fetchSub(1);
+}
+
+void ThreadHive::waitAllTasks()
+{
+	ANKI_HIVE_DEBUG_PRINT("mt: waiting all\n");
+
+	waitInternal(nullptr);
+
+#if ANKI_ASSERTS_ENABLED
+	for(const Priority& prio : m_priorities)
+	{
+		ANKI_ASSERT(prio.m_head == nullptr && prio.m_tail == nullptr);
+	}
+#endif
 	m_alloc.getMemoryPool().reset();
 
 	ANKI_HIVE_DEBUG_PRINT("mt: done waiting all\n");
 }
 
+void ThreadHive::waitSemaphore(ThreadHiveSemaphore* sem)
+{
+	ANKI_ASSERT(sem);
+	ANKI_HIVE_DEBUG_PRINT("mt: waiting semaphore\n");
+
+	waitInternal(sem);
+
+	ANKI_HIVE_DEBUG_PRINT("mt: done waiting semaphore\n");
+}
+
+void ThreadHive::setFrameDeadline(Second deadline)
+{
+	ANKI_ASSERT(g_crntThreadHive != this && "Can't be called from a task");
+	m_frameDeadline.store(deadline);
+
+	// Take the deferred tasks. The running tasks might defer more while they are submitted so don't hold the lock
+	DynamicArray<ThreadHiveTask> tasks;
+	U32 taskCount;
+	{
+		LockGuard<SpinLock> lock(m_deferredTasksLock);
+		taskCount = m_deferredTaskCount;
+		if(taskCount == 0)
+		{
+			return;
+		}
+
+		tasks = std::move(m_deferredTasks);
+		m_deferredTaskCount = 0;
+	}
+
+	// Give them another chance
+	ANKI_HIVE_DEBUG_PRINT("mt: resubmit %u deferred tasks\n", taskCount);
+	submitTasks(&tasks[0], taskCount);
+
+	// Give the storage back if no tasks were deferred in the meantime
+	LockGuard<SpinLock> lock(m_deferredTasksLock);
+	if(m_deferredTasks.getSize() == 0)
+	{
+		m_deferredTasks = std::move(tasks);
+	}
+	else
+	{
+		tasks.destroy(m_slowAlloc);
+	}
+}
+
+ThreadHiveStats ThreadHive::getStats(ThreadHiveTaskPriority priority) const
+{
+	const Priority& prio = m_priorities[priority];
+
+	ThreadHiveStats stats;
+	stats.m_queueDepth = prio.m_readyTaskCount.load();
+	stats.m_maxQueueDepth = prio.m_maxReadyTaskCount.load();
+	stats.m_startedTaskCount = prio.m_startedTaskCount.load();
+	stats.m_deferredTaskCount = prio.m_deferredTaskCount.load();
+	stats.m_waitTime = Second(prio.m_waitTimeNs.load()) / 1000000000.0;
+	return stats;
+}
+
+void ThreadHive::resetStats()
+{
+	for(Priority& prio : m_priorities)
+	{
+		prio.m_maxReadyTaskCount.store(prio.m_readyTaskCount.load());
+		prio.m_startedTaskCount.store(0);
+		prio.m_deferredTaskCount.store(0);
+		prio.m_waitTimeNs.store(0);
+	}
+}
+
 } // end namespace anki
@@ -8,41 +8,38 @@
 #include <anki/util/Thread.h>
 #include <anki/util/WeakArray.h>
 #include <anki/util/Allocator.h>
+#include <anki/util/DynamicArray.h>
+#include <anki/util/Enum.h>
 
 namespace anki
 {
 
 // Forward
 class ThreadHive;
+class ThreadHiveSemaphore;
 
 /// @addtogroup util_thread
 /// @{
 
-/// Opaque handle that defines a ThreadHive depedency. @memberof ThreadHive
-class ThreadHiveSemaphore
-{
-	friend class ThreadHive;
-
-public:
-	/// Increase the value of the semaphore. It's easy to brake things with that.
-	/// @note It's thread-safe.
-	void increaseSemaphore(U32 increase)
-	{
-		m_atomic.fetchAdd(increase);
-	}
-
-private:
-	Atomic<U32> m_atomic;
-
-	// No need to construct it or delete it
-	ThreadHiveSemaphore() = delete;
-	~ThreadHiveSemaphore() = delete;
-};
-
 /// The callback that defines a ThreadHibe task.
 /// @memberof ThreadHive
 using ThreadHiveTaskCallback = void (*)(void*, U32 threadId, ThreadHive& hive, ThreadHiveSemaphore* signalSemaphore);
 
+/// The priority class of a ThreadHive task. The threads always run the ready tasks of the highest priority first.
+/// @memberof ThreadHive
+enum class ThreadHiveTaskPriority : U8
+{
+	CRITICAL, ///< Work on the critical path of the frame.
+	NORMAL,
+	/// Work that runs when there is nothing else to do and whose results the frame doesn't wait for. See
+	/// ThreadHive::setFrameDeadline().
+	BACKGROUND,
+
+	COUNT,
+	FIRST = 0
+};
+ANKI_ENUM_ALLOW_NUMERIC_OPERATIONS(ThreadHiveTaskPriority, inline)
+
 /// Task for the ThreadHive. @memberof ThreadHive
 class ThreadHiveTask
 {
@@ -59,36 +56,49 @@ public:
 	/// When the task is completed that semaphore will be decremented by one. Can be used to set dependencies to future
 	/// tasks.
 	ThreadHiveSemaphore* m_signalSemaphore = nullptr;
+
+	/// The priority of the task. BACKGROUND tasks can't have a m_signalSemaphore and their m_argument should outlive
+	/// the frame because they might be deferred.
+	ThreadHiveTaskPriority m_priority = ThreadHiveTaskPriority::NORMAL;
+};
+
+/// Scheduling statistics of a ThreadHiveTaskPriority. @memberof ThreadHive
+class ThreadHiveStats
+{
+public:
+	U32 m_queueDepth = 0; ///< The ready tasks that haven't started yet.
+	U32 m_maxQueueDepth = 0; ///< The peak of m_queueDepth.
+	U32 m_startedTaskCount = 0;
+	U32 m_deferredTaskCount = 0;
+	Second m_waitTime = 0.0; ///< Sum of the time the started tasks waited in the queues. Only with ANKI_ENABLE_TRACE.
 };
 
 /// A scheduler of small tasks. It takes a number of tasks and schedules them in one of the threads. The tasks can
-/// depend on previously submitted tasks or be completely independent.
+/// depend on previously submitted tasks or be completely independent. Every thread has its own queue and idle threads
+/// steal work from the others. Tasks that wait on a semaphore are parked on it and become runnable only when the
+/// semaphore reaches zero. The ready tasks are picked by ThreadHiveTaskPriority.
 class ThreadHive : public NonCopyable
 {
 public:
-	static const U MAX_THREADS = 32;
-
 	/// Create the hive.
+	/// @param threadCount The number of worker threads. There is no upper limit.
+	/// @param alloc The allocator for the internal structures.
+	/// @param pinToCores Pin the threads to CPUs. The threads are spread over the CPU topology, see
+	///                   getCpuPinningOrder().
 	ThreadHive(U threadCount, GenericMemoryPoolAllocator<U8> alloc, Bool pinToCores = false);
 
 	~ThreadHive();
 
+	/// Get the number of threads that run tasks. It's the number of worker threads plus one for the thread that waits
+	/// in waitAllTasks() or waitSemaphore(). The ThreadHiveTaskCallback will see thread IDs in [0, getThreadCount()).
 	U getThreadCount() const
 	{
-		return m_threadCount;
+		return m_threadCount + 1;
 	}
 
 	/// Create a new semaphore with some initial value.
 	/// @param initialValue  Can't be zero.
-	ThreadHiveSemaphore* newSemaphore(const U32 initialValue)
-	{
-		ANKI_ASSERT(initialValue > 0);
-		PtrSize alignment = alignof(ThreadHiveSemaphore);
-		ThreadHiveSemaphore* sem =
-			reinterpret_cast<ThreadHiveSemaphore*>(m_alloc.allocate(sizeof(ThreadHiveSemaphore), &alignment));
-		sem->m_atomic.set(initialValue);
-		return sem;
-	}
+	ThreadHiveSemaphore* newSemaphore(const U32 initialValue);
 
 	/// Allocate some scratch memory. The memory becomes invalid after waitAllTasks() is called.
 	void* allocateScratchMemory(PtrSize size, U32 alignment)
@@ -102,51 +112,304 @@ public:
 		return out;
 	}
 
-	/// Submit tasks. The ThreadHiveTaskCallback callbacks can also call this.
+	/// Submit tasks. The ThreadHiveTaskCallback callbacks can also call this. In that case the tasks will be pushed to
+	/// the queue of the calling thread.
 	void submitTasks(ThreadHiveTask* tasks, const U taskCount);
 
 	/// Submit a single task without dependencies. The ThreadHiveTaskCallback callbacks can also call this.
-	void submitTask(ThreadHiveTaskCallback callback, void* arg)
+	void submitTask(
+		ThreadHiveTaskCallback callback, void* arg, ThreadHiveTaskPriority priority = ThreadHiveTaskPriority::NORMAL)
 	{
 		ThreadHiveTask task;
 		task.m_callback = callback;
 		task.m_argument = arg;
+		task.m_priority = priority;
 		submitTasks(&task, 1);
 	}
 
-	/// Wait for all tasks to finish. Will block.
+	/// Wait for all tasks to finish. While waiting the calling thread will run tasks as well using the thread ID
+	/// getThreadCount() - 1. Only one thread can wait at a time and it can't be one of the hive's threads.
 	void waitAllTasks();
 
+	/// Wait for a semaphore to reach zero. Similar to waitAllTasks() but it returns as soon as the tasks that signal
+	/// the semaphore are done. It doesn't reset the scratch memory.
+	void waitSemaphore(ThreadHiveSemaphore* sem);
+
+	/// Set the time the current frame should be done. BACKGROUND tasks that haven't started when the deadline passes
+	/// are deferred instead of stretching the frame. The deferred tasks are submitted again on the next call. Use
+	/// MAX_SECOND for no deadline. It can't be called from a task.
+	void setFrameDeadline(Second deadline);
+
+	/// Get the scheduling statistics of a priority.
+	ThreadHiveStats getStats(ThreadHiveTaskPriority priority) const;
+
+	/// Reset the accumulated statistics. The current queue depth is kept.
+	void resetStats();
+
+	/// Run a functor over the range [0, elementCount) in parallel. The range is split in chunks of grainSize elements
+	/// and the threads grab chunks until there are no more left. The calling thread takes part as well, see
+	/// waitSemaphore(). The bookkeeping uses scratch memory so the same rules apply.
+	/// @param elementCount The size of the range.
+	/// @param grainSize The number of elements of every chunk. Can't be zero.
+	/// @param func A functor with signature Error(U32 threadId, PtrSize start, PtrSize end). The threadId is in
+	///             [0, getThreadCount()).
+	/// @return The error code of the first functor that failed. Once one fails the rest of the chunks are skipped.
+	template<typename TFunc>
+	ANKI_USE_RESULT Error parallelFor(PtrSize elementCount, PtrSize grainSize, TFunc func);
+
+	/// Like parallelFor() but it combines the results of the chunks.
+	/// @param elementCount The size of the range.
+	/// @param grainSize The number of elements of every chunk. Can't be zero.
+	/// @param identity The identity value of the reduction. It's the result if elementCount is zero.
+	/// @param func A functor with signature T(U32 threadId, PtrSize start, PtrSize end).
+	/// @param reduce A functor with signature T(const T& a, const T& b). The order the chunks are combined is not
+	///               defined so it should be associative and commutative.
+	template<typename T, typename TFunc, typename TReduce>
+	T parallelReduce(PtrSize elementCount, PtrSize grainSize, const T& identity, TFunc func, TReduce reduce);
+
 private:
+	friend class ThreadHiveSemaphore;
+
 	class Thread;
 
 	/// Lightweight task.
 	class Task;
 
+	/// Lock-free work-stealing deque. One per thread and priority.
+	class TaskQueue;
+
+	static const U32 PRIORITY_COUNT = U32(ThreadHiveTaskPriority::COUNT);
+
+	/// The scheduling state of a priority.
+	class alignas(ANKI_CACHE_LINE_SIZE) Priority
+	{
+	public:
+		/// @name Queue of tasks submitted by threads that don't belong to the hive
+		/// @{
+		Task* m_head = nullptr; ///< Head of the task list.
+		Task* m_tail = nullptr; ///< Tail of the task list.
+		Atomic<U32> m_globalTaskCount = {0};
+		/// @}
+
+		/// The ready tasks in all the queues. Used to skip looking for work that isn't there.
+		Atomic<U32> m_readyTaskCount = {0};
+
+		/// @name Stats
+		/// @{
+		Atomic<U32> m_maxReadyTaskCount = {0};
+		Atomic<U32> m_startedTaskCount = {0};
+		Atomic<U32> m_deferredTaskCount = {0};
+		Atomic<U64> m_waitTimeNs = {0};
+		/// @}
+	};
+
 	GenericMemoryPoolAllocator<U8> m_slowAlloc;
 	StackAllocator<U8> m_alloc;
 	Thread* m_threads = nullptr;
-	U32 m_threadCount = 0;
+	/// PRIORITY_COUNT queues for each worker thread plus PRIORITY_COUNT for the waiting thread.
+	TaskQueue* m_queues = nullptr;
+	U32 m_threadCount = 0; ///< Number of worker threads.
+
+	Array<Priority, PRIORITY_COUNT> m_priorities;
+	SpinLock m_globalQueueLock;
+
+	/// @name Frame deadline
+	/// @{
+	Atomic<Second> m_frameDeadline = {MAX_SECOND};
+	DynamicArray<ThreadHiveTask> m_deferredTasks; ///< The storage of the deferred tasks.
+	U32 m_deferredTaskCount = 0;
+	SpinLock m_deferredTasksLock;
+	/// @}
 
-	Task* m_head = nullptr; ///< Head of the task list.
-	Task* m_tail = nullptr; ///< Tail of the task list.
 	Bool m_quit = false;
-	U32 m_pendingTasks = 0;
+	Atomic<U32> m_pendingTasks = {0};
+	Atomic<U32> m_sleepingThreadCount = {0};
+	/// Threads in waitAllTasks() or waitSemaphore().
+	Atomic<U32, AtomicMemoryOrder::SEQ_CST> m_waitingThreadCount = {0};
+	Atomic<ThreadHiveSemaphore*, AtomicMemoryOrder::SEQ_CST> m_waitedSemaphore = {nullptr};
 
 	Mutex m_mtx;
-	ConditionVariable m_cvar;
+	ConditionVariable m_cvar; ///< The worker threads and the waiting thread sleep on that.
+
+	void threadRun(U32 threadId);
 
-	void threadRun(U threadId);
+	/// Run tasks in the calling thread until all tasks are done or until the semaphore reaches zero.
+	void waitInternal(ThreadHiveSemaphore* sem);
+
+	/// Check if a thread should stop asking for work.
+	/// @param waitSemaphore The semaphore the waiting thread waits on. nullptr if it waits for all tasks.
+	Bool shouldStop(U32 threadId, const ThreadHiveSemaphore* waitSemaphore) const;
 
 	/// Wait for more tasks.
-	Bool waitForWork(U threadId, Task*& task);
+	/// @return The new task or nullptr if the thread should stop.
+	Task* waitForWork(U32 threadId, const ThreadHiveSemaphore* waitSemaphore);
+
+	/// Run a task and complete it. BACKGROUND tasks might be deferred instead.
+	void runTask(U32 threadId, Task& task);
+
+	/// Get new work from the local queue, the global queue or by stealing from other threads. The priorities are
+	/// checked in order.
+	/// @param exhaustive If false the priorities with no ready tasks are skipped. That's just a hint.
+	Task* tryGetTask(U32 threadId, Bool exhaustive);
+
+	TaskQueue& getQueue(U32 threadId, ThreadHiveTaskPriority priority);
+
+	/// Push tasks that have all their dependencies resolved.
+	void pushReadyTasks(Task* head, U32 taskCount);
 
-	/// Get new work from the queue.
-	Task* getNewTask();
+	/// Wake some sleeping threads.
+	void wakeThreads(U32 taskCount);
 
 	/// Complete a task.
-	void completeTask(U taskId);
+	void completeTask(U32 threadId, Task& task);
 };
+
+/// Opaque handle that defines a ThreadHive depedency. @memberof ThreadHive
+class ThreadHiveSemaphore
+{
+	friend class ThreadHive;
+
+public:
+	/// Increase the value of the semaphore. It's easy to brake things with that.
+	/// @note It's thread-safe.
+	void increaseSemaphore(U32 increase)
+	{
+		m_atomic.fetchAdd(increase);
+	}
+
+private:
+	Atomic<U32> m_atomic;
+
+	/// Tasks that wait for the semaphore to reach zero.
+	ThreadHive::Task* m_waitingTasks = nullptr;
+	U32 m_waitingTaskCount = 0;
+	SpinLock m_waitingTasksLock;
+
+	// Only the ThreadHive can create it. No need to delete it
+	ThreadHiveSemaphore(U32 initialValue)
+		: m_atomic(initialValue)
+	{
+	}
+
+	~ThreadHiveSemaphore() = delete;
+};
+
+template<typename TFunc>
+inline Error ThreadHive::parallelFor(PtrSize elementCount, PtrSize grainSize, TFunc func)
+{
+	ANKI_ASSERT(grainSize > 0);
+	if(elementCount == 0)
+	{
+		return Error::NONE;
+	}
+
+	class Ctx
+	{
+	public:
+		ParallelForRange m_range;
+		TFunc* m_func;
+		Error m_err = Error::NONE;
+		SpinLock m_errLock;
+
+		Ctx(PtrSize elementCount, PtrSize grainSize, TFunc& func)
+			: m_range(elementCount, grainSize)
+			, m_func(&func)
+		{
+		}
+	};
+
+	Ctx ctx(elementCount, grainSize, func);
+
+	ThreadHiveTask task;
+	task.m_callback = [](void* arg, U32 threadId, ThreadHive&, ThreadHiveSemaphore*) {
+		Ctx& ctx = *static_cast<Ctx*>(arg);
+		PtrSize start, end;
+		while(ctx.m_range.next(start, end))
+		{
+			const Error err = (*ctx.m_func)(threadId, start, end);
+			if(err)
+			{
+				ctx.m_range.stop();
+				LockGuard<SpinLock> lock(ctx.m_errLock);
+				if(!ctx.m_err)
+				{
+					ctx.m_err = err;
+				}
+				break;
+			}
+		}
+	};
+	task.m_argument = &ctx;
+
+	// No need for more tasks than chunks
+	const U32 taskCount = min<PtrSize>(getThreadCount(), ctx.m_range.getChunkCount());
+	task.m_signalSemaphore = newSemaphore(taskCount);
+	ThreadHiveTask* tasks = m_alloc.newArray<ThreadHiveTask>(taskCount, task);
+	submitTasks(tasks, taskCount);
+
+	waitSemaphore(task.m_signalSemaphore);
+	return ctx.m_err;
+}
+
+template<typename T, typename TFunc, typename TReduce>
+inline T ThreadHive::parallelReduce(
+	PtrSize elementCount, PtrSize grainSize, const T& identity, TFunc func, TReduce reduce)
+{
+	ANKI_ASSERT(grainSize > 0);
+	if(elementCount == 0)
+	{
+		return identity;
+	}
+
+	class Ctx
+	{
+	public:
+		ParallelForRange m_range;
+		TFunc* m_func;
+		TReduce* m_reduce;
+		T m_result;
+		SpinLock m_resultLock;
+
+		Ctx(PtrSize elementCount, PtrSize grainSize, const T& identity, TFunc& func, TReduce& reduce)
+			: m_range(elementCount, grainSize)
+			, m_func(&func)
+			, m_reduce(&reduce)
+			, m_result(identity)
+		{
+		}
+	};
+
+	Ctx ctx(elementCount, grainSize, identity, func, reduce);
+
+	ThreadHiveTask task;
+	task.m_callback = [](void* arg, U32 threadId, ThreadHive&, ThreadHiveSemaphore*) {
+		Ctx& ctx = *static_cast<Ctx*>(arg);
+		PtrSize start, end;
+		if(!ctx.m_range.next(start, end))
+		{
+			return;
+		}
+
+		// Reduce locally and merge once per task to avoid contention
+		T partial = (*ctx.m_func)(threadId, start, end);
+		while(ctx.m_range.next(start, end))
+		{
+			partial = (*ctx.m_reduce)(partial, (*ctx.m_func)(threadId, start, end));
+		}
+
+		LockGuard<SpinLock> lock(ctx.m_resultLock);
+		ctx.m_result = (*ctx.m_reduce)(ctx.m_result, partial);
+	};
+	task.m_argument = &ctx;
+
+	const U32 taskCount = min<PtrSize>(getThreadCount(), ctx.m_range.getChunkCount());
+	task.m_signalSemaphore = newSemaphore(taskCount);
+	ThreadHiveTask* tasks = m_alloc.newArray<ThreadHiveTask>(taskCount, task);
+	submitTasks(tasks, taskCount);
+
+	waitSemaphore(task.m_signalSemaphore);
+	return ctx.m_result;
+}
 /// @}
 
 } // end namespace anki
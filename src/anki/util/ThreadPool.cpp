@@ -5,6 +5,7 @@
 
 #include <anki/util/ThreadPool.h>
 #include <anki/util/Logger.h>
+#include <anki/util/System.h>
 #include <cstdlib>
 #include <new>
 
@@ -25,14 +26,15 @@ public:
 	Bool8 m_quit = false;
 
 	/// Constructor
-	ThreadPoolThread(U32 id, ThreadPool* threadpool, Bool pinToCore)
+	/// @param pinToCore The logical CPU to pin the thread to or -1.
+	ThreadPoolThread(U32 id, ThreadPool* threadpool, I pinToCore)
 		: m_id(id)
 		, m_thread("anki_threadpool")
 		, m_task(nullptr)
 		, m_threadpool(threadpool)
 	{
 		ANKI_ASSERT(threadpool);
-		m_thread.start(this, threadCallback, (pinToCore) ? m_id : -1);
+		m_thread.start(this, threadCallback, pinToCore);
 	}
 
 private:
@@ -73,7 +75,7 @@ ThreadPool::ThreadPool(U32 threadCount, Bool pinToCores)
 	: m_barrier(threadCount + 1)
 {
 	m_threadsCount = threadCount;
-	ANKI_ASSERT(m_threadsCount <= MAX_THREADS && m_threadsCount > 0);
+	ANKI_ASSERT(m_threadsCount > 0);
 
 	m_threads = static_cast<detail::ThreadPoolThread*>(malloc(sizeof(detail::ThreadPoolThread) * m_threadsCount));
 
@@ -82,10 +84,28 @@ ThreadPool::ThreadPool(U32 threadCount, Bool pinToCores)
 		ANKI_UTIL_LOGF("Out of memory");
 	}
 
+	// Spread the threads over the CPU topology
+	U32* cpus = nullptr;
+	U32 cpuCount = 0;
+	if(pinToCores)
+	{
+		cpuCount = getCpuCoresCount();
+		cpus = static_cast<U32*>(malloc(sizeof(U32) * cpuCount));
+		if(cpus == nullptr)
+		{
+			ANKI_UTIL_LOGF("Out of memory");
+		}
+
+		getCpuPinningOrder(WeakArray<U32>(cpus, cpuCount));
+	}
+
 	while(threadCount-- != 0)
 	{
-		::new(&m_threads[threadCount]) detail::ThreadPoolThread(threadCount, this, pinToCores);
+		const I cpu = (cpus) ? I(cpus[threadCount % cpuCount]) : -1;
+		::new(&m_threads[threadCount]) detail::ThreadPoolThread(threadCount, this, cpu);
 	}
+
+	free(cpus);
 }
 
 ThreadPool::~ThreadPool()
@@ -48,9 +48,10 @@ class ThreadPool : public NonCopyable
 	friend class detail::ThreadPoolThread;
 
 public:
-	static constexpr U MAX_THREADS = 32; ///< An absolute limit
-
 	/// Constructor.
+	/// @param threadCount The number of threads. There is no upper limit.
+	/// @param pinToCores Pin the threads to CPUs. The threads are spread over the CPU topology, see
+	///                   getCpuPinningOrder().
 	ThreadPool(U32 threadCount, Bool pinToCores = false);
 
 	~ThreadPool();
@@ -77,6 +78,26 @@ public:
 		return m_threadsCount;
 	}
 
+	/// Run a functor over the range [0, elementCount) in parallel. The range is split in chunks of grainSize elements
+	/// and the threads grab chunks until there are no more left. It returns when all the chunks are done.
+	/// @param elementCount The size of the range.
+	/// @param grainSize The number of elements of every chunk. Can't be zero.
+	/// @param func A functor with signature Error(U32 threadId, PtrSize start, PtrSize end). The threadId is in
+	///             [0, getThreadCount()).
+	/// @return The error code of the first functor that failed. Once one fails the rest of the chunks are skipped.
+	template<typename TFunc>
+	ANKI_USE_RESULT Error parallelFor(PtrSize elementCount, PtrSize grainSize, TFunc func);
+
+	/// Like parallelFor() but it combines the results of the chunks.
+	/// @param elementCount The size of the range.
+	/// @param grainSize The number of elements of every chunk. Can't be zero.
+	/// @param identity The identity value of the reduction. It's the result if elementCount is zero.
+	/// @param func A functor with signature T(U32 threadId, PtrSize start, PtrSize end).
+	/// @param reduce A functor with signature T(const T& a, const T& b). The order the chunks are combined is not
+	///               defined so it should be associative and commutative.
+	template<typename T, typename TFunc, typename TReduce>
+	T parallelReduce(PtrSize elementCount, PtrSize grainSize, const T& identity, TFunc func, TReduce reduce);
+
 private:
 	/// A dummy task for a ThreadPool
 	class DummyTask : public ThreadPoolTask
@@ -93,10 +114,119 @@ private:
 	Barrier m_barrier; ///< Synchronization barrier
 	detail::ThreadPoolThread* m_threads = nullptr; ///< Threads array
 	U m_tasksAssigned = 0;
-	U8 m_threadsCount = 0;
+	U32 m_threadsCount = 0;
 	Error m_err = Error::NONE;
 	static DummyTask m_dummyTask;
 };
+
+template<typename TFunc>
+inline Error ThreadPool::parallelFor(PtrSize elementCount, PtrSize grainSize, TFunc func)
+{
+	ANKI_ASSERT(grainSize > 0);
+	if(elementCount == 0)
+	{
+		return Error::NONE;
+	}
+
+	class ForTask : public ThreadPoolTask
+	{
+	public:
+		ParallelForRange m_range;
+		TFunc* m_func;
+
+		ForTask(PtrSize elementCount, PtrSize grainSize, TFunc& func)
+			: m_range(elementCount, grainSize)
+			, m_func(&func)
+		{
+		}
+
+		Error operator()(U32 threadId, PtrSize threadsCount) override
+		{
+			(void)threadsCount;
+			PtrSize start, end;
+			while(m_range.next(start, end))
+			{
+				const Error err = (*m_func)(threadId, start, end);
+				if(err)
+				{
+					m_range.stop();
+					return err;
+				}
+			}
+
+			return Error::NONE;
+		}
+	};
+
+	ForTask task(elementCount, grainSize, func);
+	for(U32 i = 0; i < m_threadsCount; ++i)
+	{
+		assignNewTask(i, &task);
+	}
+
+	return waitForAllThreadsToFinish();
+}
+
+template<typename T, typename TFunc, typename TReduce>
+inline T ThreadPool::parallelReduce(
+	PtrSize elementCount, PtrSize grainSize, const T& identity, TFunc func, TReduce reduce)
+{
+	ANKI_ASSERT(grainSize > 0);
+	if(elementCount == 0)
+	{
+		return identity;
+	}
+
+	class ReduceTask : public ThreadPoolTask
+	{
+	public:
+		ParallelForRange m_range;
+		TFunc* m_func;
+		TReduce* m_reduce;
+		T m_result;
+		SpinLock m_resultLock;
+
+		ReduceTask(PtrSize elementCount, PtrSize grainSize, const T& identity, TFunc& func, TReduce& reduce)
+			: m_range(elementCount, grainSize)
+			, m_func(&func)
+			, m_reduce(&reduce)
+			, m_result(identity)
+		{
+		}
+
+		Error operator()(U32 threadId, PtrSize threadsCount) override
+		{
+			(void)threadsCount;
+			PtrSize start, end;
+			if(!m_range.next(start, end))
+			{
+				return Error::NONE;
+			}
+
+			// Reduce locally and merge once per thread to avoid contention
+			T partial = (*m_func)(threadId, start, end);
+			while(m_range.next(start, end))
+			{
+				partial = (*m_reduce)(partial, (*m_func)(threadId, start, end));
+			}
+
+			LockGuard<SpinLock> lock(m_resultLock);
+			m_result = (*m_reduce)(m_result, partial);
+			return Error::NONE;
+		}
+	};
+
+	ReduceTask task(elementCount, grainSize, identity, func, reduce);
+	for(U32 i = 0; i < m_threadsCount; ++i)
+	{
+		assignNewTask(i, &task);
+	}
+
+	const Error err = waitForAllThreadsToFinish();
+	(void)err;
+	ANKI_ASSERT(!err);
+	return task.m_result;
+}
 /// @}
 
 } // end namespace anki
@@ -70,14 +70,22 @@ void Thread::start(void* userData, ThreadCallback callback, I pinToCore)
 	ANKI_ASSERT(callback != nullptr);
 
 	pthread_attr_t attr;
-	cpu_set_t cpus;
 	pthread_attr_init(&attr);
 
+	// Allocate the CPU set since cpu_set_t can't hold more than CPU_SETSIZE CPUs
+	cpu_set_t* cpus = nullptr;
 	if(pinToCore >= 0)
 	{
-		CPU_ZERO(&cpus);
-		CPU_SET(pinToCore, &cpus);
-		pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpus);
+		const PtrSize cpusSize = CPU_ALLOC_SIZE(pinToCore + 1);
+		cpus = CPU_ALLOC(pinToCore + 1);
+		if(cpus == nullptr)
+		{
+			ANKI_UTIL_LOGF("Out of memory");
+		}
+
+		CPU_ZERO_S(cpusSize, cpus);
+		CPU_SET_S(pinToCore, cpusSize, cpus);
+		pthread_attr_setaffinity_np(&attr, cpusSize, cpus);
 	}
 
 	pthread_t* thread = static_cast<pthread_t*>(m_impl);
@@ -86,6 +94,13 @@ void Thread::start(void* userData, ThreadCallback callback, I pinToCore)
 	m_userData = userData;
 
 	I err = pthread_create(thread, &attr, pthreadCallback, this);
+
+	pthread_attr_destroy(&attr);
+	if(cpus)
+	{
+		CPU_FREE(cpus);
+	}
+
 	if(err)
 	{
 		ANKI_UTIL_LOGF("pthread_create() failed: %d", err);
@@ -75,6 +75,12 @@ void Thread::start(void* userData, ThreadCallback callback, I pinToCore)
 	}
 	else
 	{
+		// The affinity mask only covers the first processor group
+		if(pinToCore >= 0 && pinToCore < I(sizeof(DWORD_PTR) * 8))
+		{
+			SetThreadAffinityMask(m_impl, DWORD_PTR(1) << pinToCore);
+		}
+
 #if ANKI_EXTRA_CHECKS
 		m_started = true;
 #endif
@@ -5,54 +5,121 @@
 
 #include <anki/util/Tracer.h>
 #include <anki/util/HighRezTimer.h>
-#include <anki/util/HashMap.h>
+#include <anki/util/Common.h>
+#include <anki/util/Functions.h>
+#include <algorithm>
+#include <cstring>
 
 namespace anki
 {
 
-/// Lightweight event storage.
-class Tracer::Event
+/// The first bytes of a binary trace file.
+static const Array<char, 8> STREAM_MAGIC = {{'A', 'N', 'K', 'I', 'T', 'R', 'C', '1'}};
+
+/// Every record of the binary trace file starts with one of those. The payload of every record type is:
+/// - EVENT: U32 name ID, U32 thread index, U64 frame, F64 timestamp, U64 duration in ns
+/// - COUNTER: U32 name ID, U32 thread index, U64 frame, U64 value
+/// - FRAME: U64 frame, F64 timestamp
+/// - NAME: U32 name ID, U32 size, the characters of the name including the null terminator
+/// - THREAD: U32 thread index, U64 thread ID
+/// The values are in the native byte order.
+enum class StreamTag : U8
 {
-public:
-	const char* m_name;
-	Second m_timestamp;
-	Second m_duration;
+	EVENT,
+	COUNTER,
+	FRAME,
+	NAME,
+	THREAD
 };
 
-/// Event batch allocation.
-class Tracer::EventsChunk : public IntrusiveListEnabled<EventsChunk>
+/// Helper to serialize the records of the binary trace file.
+class StreamWriter
 {
 public:
-	Array<Event, EVENTS_PER_CHUNK> m_events;
-	U32 m_eventCount = 0;
+	Array<U8, 64> m_data;
+	U32 m_size = 0;
+
+	template<typename T>
+	StreamWriter& operator<<(const T& x)
+	{
+		ANKI_ASSERT(m_size + sizeof(T) <= m_data.getSize());
+		memcpy(&m_data[m_size], &x, sizeof(T));
+		m_size += sizeof(T);
+		return *this;
+	}
 };
 
-/// A heavyweight event with more info.
-class Tracer::GatherEvent
+/// Helper to deserialize the records of the binary trace file.
+class StreamReader
 {
 public:
-	CString m_name;
-	Second m_timestamp;
-	Second m_duration;
-	ThreadId m_tid;
+	const U8* m_data;
+	PtrSize m_size;
+	PtrSize m_offset = 0;
+	Bool m_truncated = false;
+
+	StreamReader(const U8* data, PtrSize size)
+		: m_data(data)
+		, m_size(size)
+	{
+	}
+
+	template<typename T>
+	StreamReader& operator>>(T& x)
+	{
+		const void* src = skip(sizeof(T));
+		if(src)
+		{
+			memcpy(&x, src, sizeof(T));
+		}
+		return *this;
+	}
+
+	const void* skip(PtrSize size)
+	{
+		if(m_truncated || m_offset + size > m_size)
+		{
+			m_truncated = true;
+			return nullptr;
+		}
+
+		const void* out = m_data + m_offset;
+		m_offset += size;
+		return out;
+	}
 };
 
-/// Lightweight counter storage.
-class Tracer::Counter
+/// Gives every tracer a unique ID.
+static Atomic<U64> g_nextTracerUuid = {1};
+
+/// The type of Tracer::Record.
+enum class Tracer::RecordType : U8
 {
-public:
-	const char* m_name;
-	U64 m_value;
+	EVENT = U8(StreamTag::EVENT),
+	COUNTER = U8(StreamTag::COUNTER),
+	FRAME = U8(StreamTag::FRAME)
 };
 
-/// Counter batch allocation.
-class Tracer::CountersChunk : public IntrusiveListEnabled<CountersChunk>
+/// Lightweight storage of an event, a counter or the beginning of a frame.
+class Tracer::Record
 {
 public:
+	const char* m_name; ///< nullptr for frames.
+	Second m_timestamp; ///< The start of an event or a frame.
+	U64 m_value; ///< The value of a counter or the duration of an event in ns.
 	U64 m_frame;
-	Second m_startFrameTime;
-	Array<Counter, COUNTERS_PER_CHUNK> m_counters;
-	U32 m_counterCount = 0;
+	U32 m_threadIdx; ///< Index to Tracer::m_allThreadLocal. It's set when the record is drained.
+	RecordType m_type;
+};
+
+/// A heavyweight event with more info.
+class Tracer::GatherEvent
+{
+public:
+	CString m_name;
+	Second m_timestamp;
+	Second m_duration;
+	ThreadId m_tid;
 };
 
 /// Heavyweight counter storage.
@@ -63,40 +130,46 @@ public:
 	U64 m_value;
 };
 
-/// Thread local storage.
+/// Thread local storage. It's a ring buffer with one producer, the owner thread, and one consumer, the thread that
+/// drains.
 class Tracer::ThreadLocal
 {
 public:
 	ThreadId m_tid ANKI_DBG_NULLIFY;
+	U32 m_idx ANKI_DBG_NULLIFY; ///< Index in Tracer::m_allThreadLocal.
+
+	Record* m_records = nullptr;
+	U32 m_recordMask = 0;
 
-	IntrusiveList<CountersChunk> m_counterChunks;
-	IntrusiveList<EventsChunk> m_eventChunks;
+	alignas(ANKI_CACHE_LINE_SIZE) Atomic<U32> m_head = {0}; ///< Where the producer writes.
+	alignas(ANKI_CACHE_LINE_SIZE) Atomic<U32> m_tail = {0}; ///< Where the consumer reads.
 };
 
 thread_local Tracer::ThreadLocal* Tracer::m_threadLocal = nullptr;
+thread_local U64 Tracer::m_threadLocalTracerUuid = 0;
 
 /// Storage of counters per frame.
 class Tracer::PerFrameCounters
 {
 public:
 	DynamicArrayAuto<GatherCounter> m_counters;
-	DynamicArrayAuto<GatherCounter> m_tempCounters; ///< A temp storage.
 	U64 m_frame;
 	Second m_startFrameTime;
 
 	PerFrameCounters(GenericMemoryPoolAllocator<U8> alloc)
 		: m_counters(alloc)
-		, m_tempCounters(alloc)
 	{
 	}
 };
 
-/// Context for Tracer::flush().
+/// Context for Tracer::writeFiles().
 class Tracer::FlushCtx
 {
 public:
 	GenericMemoryPoolAllocator<U8> m_alloc;
 	CString m_filename;
+	DynamicArrayAuto<Record> m_records;
+	DynamicArrayAuto<ThreadId> m_threadIds; ///< Indexed by Record::m_threadIdx.
 	DynamicArrayAuto<CString> m_counterNames;
 	DynamicArrayAuto<PerFrameCounters> m_counters;
 	DynamicArrayAuto<GatherEvent> m_events;
@@ -104,6 +177,8 @@ public:
 	FlushCtx(GenericMemoryPoolAllocator<U8> alloc, const CString& filename)
 		: m_alloc(alloc)
 		, m_filename(filename)
+		, m_records(alloc)
+		, m_threadIds(alloc)
 		, m_counterNames(alloc)
 		, m_counters(alloc)
 		, m_events(alloc)
@@ -111,224 +186,626 @@ public:
 	}
 };
 
+class Tracer::CaptureRequest
+{
+public:
+	String m_filename;
+	U64 m_lastFrame = 0;
+	U32 m_frameCount = 0;
+};
+
+Tracer::Tracer()
+	: m_drainThread("anki_tracer")
+{
+}
+
 Tracer::~Tracer()
 {
-	for(ThreadLocal* threadLocal : m_allThreadLocal)
+	if(!isInitialized())
 	{
-		while(!threadLocal->m_counterChunks.isEmpty())
-		{
-			CountersChunk& chunk = threadLocal->m_counterChunks.getFront();
-			threadLocal->m_counterChunks.popFront();
-			m_alloc.deleteInstance(&chunk);
-		}
+		return;
+	}
 
-		while(!threadLocal->m_eventChunks.isEmpty())
-		{
-			EventsChunk& chunk = threadLocal->m_eventChunks.getFront();
-			threadLocal->m_eventChunks.popFront();
-			m_alloc.deleteInstance(&chunk);
-		}
+	m_quit.store(true);
+	const Error joinErr = m_drainThread.join();
+	(void)joinErr;
 
+	if(endStreaming())
+	{
+		ANKI_UTIL_LOGE("Ignoring error while closing the trace stream");
+	}
+
+	for(ThreadLocal* threadLocal : m_allThreadLocal)
+	{
+		m_alloc.deleteArray(threadLocal->m_records, threadLocal->m_recordMask + 1);
 		m_alloc.deleteInstance(threadLocal);
 	}
 
 	m_allThreadLocal.destroy(m_alloc);
+	m_history.destroy(m_alloc);
+	ANKI_ASSERT(m_captureRequests.getSize() == 0 && "The thread should have processed them");
+	m_streamBuffer.destroy(m_alloc);
+	m_streamNameIds.destroy(m_alloc);
+}
+
+void Tracer::init(
+	GenericMemoryPoolAllocator<U8> alloc, U32 threadRecordCount, U32 historyRecordCount, Second flushPeriod)
+{
+	ANKI_ASSERT(!isInitialized());
+	ANKI_ASSERT(threadRecordCount > 0 && historyRecordCount > 0 && flushPeriod > 0.0);
+
+	m_alloc = alloc;
+	m_uuid = g_nextTracerUuid.fetchAdd(1);
+	m_threadRecordCount = nextPowerOfTwo(threadRecordCount);
+	m_history.create(m_alloc, historyRecordCount);
+	m_flushPeriod = flushPeriod;
+
+	m_drainThread.start(this, [](ThreadCallbackInfo& info) -> Error {
+		Tracer& self = *static_cast<Tracer*>(info.m_userData);
+
+		// Sleep in small steps to quit fast
+		const Second maxSleepTime = 0.01;
+		Second nextDrainTime = HighRezTimer::getCurrentTime() + self.m_flushPeriod;
+		while(!self.m_quit.load())
+		{
+			HighRezTimer::sleep(min(self.m_flushPeriod, maxSleepTime));
+
+			const Second now = HighRezTimer::getCurrentTime();
+			if(now >= nextDrainTime)
+			{
+				LockGuard<Mutex> lock(self.m_drainMtx);
+				self.drain();
+				nextDrainTime = now + self.m_flushPeriod;
+			}
+
+			self.processCaptureRequests();
+		}
+
+		// Don't lose the captures that were requested just before the destruction
+		self.processCaptureRequests();
+
+		return Error::NONE;
+	});
 }
 
 void Tracer::newFrame(U64 frame)
 {
-	ANKI_ASSERT(frame == 0 || frame > m_frame);
+	ANKI_ASSERT(frame == 0 || frame > m_frame.load());
 
-	LockGuard<SpinLock> lock(m_frameMtx);
+	m_frame.store(frame);
 
-	m_startFrameTime = HighRezTimer::getCurrentTime();
-	m_frame = frame;
+	Record record;
+	record.m_name = nullptr;
+	record.m_timestamp = HighRezTimer::getCurrentTime();
+	record.m_value = 0;
+	record.m_frame = frame;
+	record.m_type = RecordType::FRAME;
+	pushRecord(record);
 }
 
 Tracer::ThreadLocal& Tracer::getThreadLocal()
 {
 	ThreadLocal* out = m_threadLocal;
-	if(ANKI_UNLIKELY(out == nullptr))
+	if(ANKI_LIKELY(out && m_threadLocalTracerUuid == m_uuid))
+	{
+		return *out;
+	}
+
+	const ThreadId tid = Thread::getCurrentThreadId();
+	LockGuard<Mutex> lock(m_threadLocalMtx);
+
+	// The thread might have used another tracer in the meantime
+	out = nullptr;
+	for(ThreadLocal* threadLocal : m_allThreadLocal)
+	{
+		if(threadLocal->m_tid == tid)
+		{
+			out = threadLocal;
+			break;
+		}
+	}
+
+	if(out == nullptr)
 	{
 		out = m_alloc.newInstance<ThreadLocal>();
-		out->m_tid = Thread::getCurrentThreadId();
-		m_threadLocal = out;
+		out->m_tid = tid;
+		out->m_idx = m_allThreadLocal.getSize();
+		out->m_records = m_alloc.newArray<Record>(m_threadRecordCount);
+		out->m_recordMask = m_threadRecordCount - 1;
 
-		// Store it
-		LockGuard<Mutex> lock(m_threadLocalMtx);
 		m_allThreadLocal.emplaceBack(m_alloc, out);
 	}
 
+	m_threadLocal = out;
+	m_threadLocalTracerUuid = m_uuid;
 	return *out;
 }
 
-TracerEventHandle Tracer::beginEvent()
+void Tracer::pushRecord(const Record& record)
 {
 	ThreadLocal& threadLocal = getThreadLocal();
 
-	// Allocate new chunk
-	if(threadLocal.m_eventChunks.isEmpty() || threadLocal.m_eventChunks.getBack().m_eventCount >= EVENTS_PER_CHUNK)
+	const U32 head = threadLocal.m_head.load(AtomicMemoryOrder::RELAXED);
+	const U32 tail = threadLocal.m_tail.load(AtomicMemoryOrder::ACQUIRE);
+	if(ANKI_UNLIKELY(head - tail > threadLocal.m_recordMask))
 	{
-		EventsChunk* chunk = m_alloc.newInstance<EventsChunk>();
-		threadLocal.m_eventChunks.pushBack(chunk);
+		// Full, the drain thread can't keep up
+		m_droppedRecordCount.fetchAdd(1);
+		return;
 	}
 
-	EventsChunk& chunk = threadLocal.m_eventChunks.getBack();
-	Event* event = &chunk.m_events[chunk.m_eventCount++];
-	event->m_timestamp = HighRezTimer::getCurrentTime();
+	threadLocal.m_records[head & threadLocal.m_recordMask] = record;
+	threadLocal.m_head.store(head + 1, AtomicMemoryOrder::RELEASE);
+}
 
-	return event;
+TracerEventHandle Tracer::beginEvent()
+{
+	return HighRezTimer::getCurrentTime();
 }
 
-void Tracer::endEvent(const char* eventName, TracerEventHandle eventHandle)
+void Tracer::endEvent(const char* eventName, TracerEventHandle event)
 {
 	ANKI_ASSERT(eventName);
-	ANKI_ASSERT(eventHandle);
-
-	Event* event = static_cast<Event*>(eventHandle);
-	event->m_name = eventName;
-	event->m_duration = HighRezTimer::getCurrentTime() - event->m_timestamp;
-
-	// Store a counter as well. In ns
-	increaseCounter(eventName, U64(event->m_duration * 1000000000.0));
+	ANKI_ASSERT(event >= 0.0);
+
+	Record record;
+	record.m_name = eventName;
+	record.m_timestamp = event;
+	record.m_value = U64((HighRezTimer::getCurrentTime() - event) * 1000000000.0);
+	record.m_frame = m_frame.load();
+	record.m_type = RecordType::EVENT;
+	pushRecord(record);
 }
 
 void Tracer::increaseCounter(const char* counterName, U64 value)
 {
 	ANKI_ASSERT(counterName);
 
-	ThreadLocal& threadLocal = getThreadLocal();
+	Record record;
+	record.m_name = counterName;
+	record.m_timestamp = 0.0;
+	record.m_value = value;
+	record.m_frame = m_frame.load();
+	record.m_type = RecordType::COUNTER;
+	pushRecord(record);
+}
+
+void Tracer::drain()
+{
+	LockGuard<Mutex> lock(m_threadLocalMtx);
+	const Bool streaming = m_streamFile.isOpen();
 
-	// Create chunk
-	if(threadLocal.m_counterChunks.isEmpty() || threadLocal.m_counterChunks.getBack().m_frame != m_frame
-		|| threadLocal.m_counterChunks.getBack().m_counterCount >= COUNTERS_PER_CHUNK)
+	// Introduce the new threads to the stream
+	for(; streaming && m_streamedThreadCount < m_allThreadLocal.getSize(); ++m_streamedThreadCount)
 	{
-		CountersChunk* newChunk = m_alloc.newInstance<CountersChunk>();
-		threadLocal.m_counterChunks.pushBack(newChunk);
+		StreamWriter writer;
+		writer << StreamTag::THREAD << m_streamedThreadCount << m_allThreadLocal[m_streamedThreadCount]->m_tid;
+		appendToStream(&writer.m_data[0], writer.m_size);
+	}
 
+	for(ThreadLocal* threadLocal : m_allThreadLocal)
+	{
+		U32 tail = threadLocal->m_tail.load(AtomicMemoryOrder::RELAXED);
+		const U32 head = threadLocal->m_head.load(AtomicMemoryOrder::ACQUIRE);
+
+		for(; tail != head; ++tail)
 		{
-			LockGuard<SpinLock> lock(m_frameMtx);
-			newChunk->m_frame = m_frame;
-			newChunk->m_startFrameTime = m_startFrameTime;
+			Record record = threadLocal->m_records[tail & threadLocal->m_recordMask];
+			record.m_threadIdx = threadLocal->m_idx;
+
+			m_history[m_historyRecordCount % m_history.getSize()] = record;
+			++m_historyRecordCount;
+
+			if(streaming)
+			{
+				streamRecord(record);
+			}
 		}
+
+		threadLocal->m_tail.store(tail, AtomicMemoryOrder::RELEASE);
+	}
+
+	if(streaming && writeStream())
+	{
+		ANKI_UTIL_LOGE("Failed to write the trace stream. Will stop streaming");
+		m_streamFile.close();
+		m_streamBufferSize = 0;
+	}
+}
+
+void Tracer::streamRecord(const Record& record)
+{
+	StreamWriter writer;
+
+	if(record.m_type == RecordType::FRAME)
+	{
+		writer << StreamTag::FRAME << record.m_frame << record.m_timestamp;
+		appendToStream(&writer.m_data[0], writer.m_size);
+		return;
 	}
 
-	CountersChunk& chunk = threadLocal.m_counterChunks.getBack();
+	// Write the name the first time it's seen
+	const U64 nameKey = ptrToNumber(record.m_name);
+	U32 nameId;
+	auto it = m_streamNameIds.find(nameKey);
+	if(it != m_streamNameIds.getEnd())
+	{
+		nameId = *it;
+	}
+	else
+	{
+		nameId = m_streamNameIdCount++;
+		m_streamNameIds.emplace(m_alloc, nameKey, nameId);
+
+		const U32 size = U32(strlen(record.m_name) + 1);
+		writer << StreamTag::NAME << nameId << size;
+		appendToStream(&writer.m_data[0], writer.m_size);
+		appendToStream(record.m_name, size);
+		writer.m_size = 0;
+	}
 
-	Counter& counter = chunk.m_counters[chunk.m_counterCount++];
-	counter.m_name = counterName;
-	counter.m_value = value;
+	if(record.m_type == RecordType::EVENT)
+	{
+		writer << StreamTag::EVENT << nameId << record.m_threadIdx << record.m_frame << record.m_timestamp
+			   << record.m_value;
+	}
+	else
+	{
+		writer << StreamTag::COUNTER << nameId << record.m_threadIdx << record.m_frame << record.m_value;
+	}
+
+	appendToStream(&writer.m_data[0], writer.m_size);
 }
 
-void Tracer::gatherCounters(FlushCtx& ctx)
+void Tracer::appendToStream(const void* data, PtrSize size)
 {
-	// Iterate all the chunks and create the PerFrameCounters
-	for(ThreadLocal* threadLocal : m_allThreadLocal)
+	if(m_streamBufferSize + size > m_streamBuffer.getSize())
+	{
+		m_streamBuffer.resize(m_alloc, max<PtrSize>(m_streamBufferSize + size, m_streamBuffer.getSize() * 2));
+	}
+
+	memcpy(&m_streamBuffer[m_streamBufferSize], data, size);
+	m_streamBufferSize += size;
+}
+
+Error Tracer::writeStream()
+{
+	if(m_streamBufferSize > 0)
+	{
+		ANKI_CHECK(m_streamFile.write(&m_streamBuffer[0], m_streamBufferSize));
+		m_streamBufferSize = 0;
+	}
+
+	return Error::NONE;
+}
+
+Error Tracer::beginStreaming(CString filename)
+{
+	ANKI_ASSERT(isInitialized());
+	LockGuard<Mutex> lock(m_drainMtx);
+	ANKI_ASSERT(!m_streamFile.isOpen() && "Already streaming");
+
+	// Drain the old records so they won't go to the stream
+	drain();
+
+	ANKI_CHECK(m_streamFile.open(filename, FileOpenFlag::WRITE | FileOpenFlag::BINARY));
+
+	m_streamNameIds.destroy(m_alloc);
+	m_streamNameIdCount = 0;
+	m_streamedThreadCount = 0;
+	appendToStream(&STREAM_MAGIC[0], sizeof(STREAM_MAGIC));
+
+	return Error::NONE;
+}
+
+Error Tracer::endStreaming()
+{
+	LockGuard<Mutex> lock(m_drainMtx);
+
+	if(!m_streamFile.isOpen())
+	{
+		return Error::NONE;
+	}
+
+	drain();
+
+	Error err = Error::NONE;
+	if(m_streamFile.isOpen())
+	{
+		err = m_streamFile.flush();
+		m_streamFile.close();
+	}
+
+	return err;
+}
+
+Error Tracer::captureLastFrames(U32 frameCount, CString filename)
+{
+	ANKI_ASSERT(isInitialized());
+	ANKI_ASSERT(frameCount > 0);
+	return captureFrames(m_frame.load(), frameCount, filename);
+}
+
+void Tracer::requestCaptureLastFrames(U32 frameCount, CString filename)
+{
+	ANKI_ASSERT(isInitialized());
+	ANKI_ASSERT(frameCount > 0);
+
+	LockGuard<Mutex> lock(m_captureRequestsMtx);
+	m_captureRequests.emplaceBack(m_alloc);
+	CaptureRequest& request = m_captureRequests.getBack();
+	request.m_filename.create(m_alloc, filename);
+	request.m_lastFrame = m_frame.load();
+	request.m_frameCount = frameCount;
+}
+
+void Tracer::processCaptureRequests()
+{
+	// Take the requests. The writes are slow so don't hold the lock
+	DynamicArray<CaptureRequest> requests;
+	{
+		LockGuard<Mutex> lock(m_captureRequestsMtx);
+		if(m_captureRequests.getSize() == 0)
+		{
+			return;
+		}
+
+		requests = std::move(m_captureRequests);
+	}
+
+	for(CaptureRequest& request : requests)
+	{
+		if(captureFrames(request.m_lastFrame, request.m_frameCount, request.m_filename.toCString()))
+		{
+			ANKI_UTIL_LOGE("Failed to capture the trace: %s", request.m_filename.cstr());
+		}
+
+		request.m_filename.destroy(m_alloc);
+	}
+
+	requests.destroy(m_alloc);
+}
+
+Error Tracer::captureFrames(U64 lastFrame, U32 frameCount, CString filename)
+{
+	FlushCtx ctx(m_alloc, filename);
+
+	// Copy the records to keep the lock for as little as possible
+	{
+		LockGuard<Mutex> lock(m_drainMtx);
+		drain();
+
+		const U64 firstFrame = (frameCount > lastFrame) ? 0 : lastFrame - frameCount + 1;
+		const U64 recordCount = min<U64>(m_historyRecordCount, m_history.getSize());
+
+		for(U64 i = m_historyRecordCount - recordCount; i < m_historyRecordCount; ++i)
+		{
+			const Record& record = m_history[i % m_history.getSize()];
+			if(record.m_frame >= firstFrame && record.m_frame <= lastFrame)
+			{
+				ctx.m_records.emplaceBack(record);
+			}
+		}
+
+		LockGuard<Mutex> lock2(m_threadLocalMtx);
+		ctx.m_threadIds.create(m_allThreadLocal.getSize());
+		for(U i = 0; i < m_allThreadLocal.getSize(); ++i)
+		{
+			ctx.m_threadIds[i] = m_allThreadLocal[i]->m_tid;
+		}
+	}
+
+	return writeFiles(ctx);
+}
+
+Error Tracer::convertToChromeTrace(CString binaryFilename, CString filename, GenericMemoryPoolAllocator<U8> alloc)
+{
+	// Read the whole file. The names of the records will point to it
+	File file;
+	ANKI_CHECK(file.open(binaryFilename, FileOpenFlag::READ | FileOpenFlag::BINARY));
+	DynamicArrayAuto<U8> data(alloc);
+	if(file.getSize() > 0)
+	{
+		data.create(file.getSize());
+		ANKI_CHECK(file.read(&data[0], data.getSize()));
+	}
+
+	StreamReader reader(data.getBegin(), data.getSize());
+	const void* magic = reader.skip(sizeof(STREAM_MAGIC));
+	if(magic == nullptr || memcmp(magic, &STREAM_MAGIC[0], sizeof(STREAM_MAGIC)) != 0)
 	{
-		while(!threadLocal->m_counterChunks.isEmpty())
+		ANKI_UTIL_LOGE("Not a trace file: %s", binaryFilename.cstr());
+		return Error::USER_DATA;
+	}
+
+	FlushCtx ctx(alloc, filename);
+	DynamicArrayAuto<const char*> names(alloc);
+	Bool corrupted = false;
+	while(reader.m_offset < reader.m_size && !reader.m_truncated && !corrupted)
+	{
+		StreamTag tag = StreamTag::EVENT;
+		reader >> tag;
+		if(reader.m_truncated)
 		{
-			// Pop chunk
-			CountersChunk& chunk = threadLocal->m_counterChunks.getFront();
-			threadLocal->m_counterChunks.popFront();
+			break;
+		}
 
-			// Iterate the PerFrameCounters to find if the frame is present
-			PerFrameCounters* perFrame = nullptr;
-			for(PerFrameCounters& pf : ctx.m_counters)
+		Record record;
+		U32 nameId = 0;
+		switch(tag)
+		{
+		case StreamTag::NAME:
+		{
+			U32 size = 0;
+			reader >> nameId >> size;
+			const char* name = static_cast<const char*>(reader.skip(size));
+			if(name)
 			{
-				if(pf.m_frame == chunk.m_frame)
+				corrupted = size == 0 || name[size - 1] != '\0';
+				if(nameId >= names.getSize())
 				{
-					perFrame = &pf;
-					break;
+					names.resize(nameId + 1, nullptr);
 				}
+				names[nameId] = name;
 			}
-
-			if(!perFrame)
+			continue;
+		}
+		case StreamTag::THREAD:
+		{
+			U32 idx = 0;
+			ThreadId tid = 0;
+			reader >> idx >> tid;
+			if(idx >= ctx.m_threadIds.getSize())
 			{
-				ctx.m_counters.emplaceBack(m_alloc);
-
-				perFrame = &ctx.m_counters.getBack();
-				perFrame->m_frame = chunk.m_frame;
-				perFrame->m_startFrameTime = chunk.m_startFrameTime;
+				ctx.m_threadIds.resize(idx + 1, 0);
 			}
+			ctx.m_threadIds[idx] = tid;
+			continue;
+		}
+		case StreamTag::EVENT:
+			reader >> nameId >> record.m_threadIdx >> record.m_frame >> record.m_timestamp >> record.m_value;
+			record.m_type = RecordType::EVENT;
+			break;
+		case StreamTag::COUNTER:
+			reader >> nameId >> record.m_threadIdx >> record.m_frame >> record.m_value;
+			record.m_timestamp = 0.0;
+			record.m_type = RecordType::COUNTER;
+			break;
+		case StreamTag::FRAME:
+			reader >> record.m_frame >> record.m_timestamp;
+			record.m_name = nullptr;
+			record.m_value = 0;
+			record.m_threadIdx = 0;
+			record.m_type = RecordType::FRAME;
+			break;
+		default:
+			corrupted = true;
+			continue;
+		}
 
-			ANKI_ASSERT(chunk.m_frame == perFrame->m_frame);
+		if(reader.m_truncated)
+		{
+			break;
+		}
 
-			// Copy the counters
-			for(U i = 0; i < chunk.m_counterCount; ++i)
-			{
-				const Counter& inCounter = chunk.m_counters[i];
+		if(record.m_type != RecordType::FRAME)
+		{
+			corrupted = nameId >= names.getSize() || names[nameId] == nullptr
+						|| record.m_threadIdx >= ctx.m_threadIds.getSize();
+			record.m_name = (corrupted) ? nullptr : names[nameId];
+		}
+
+		if(!corrupted)
+		{
+			ctx.m_records.emplaceBack(record);
+		}
+	}
 
-				GatherCounter outCounter;
-				outCounter.m_name = inCounter.m_name;
-				outCounter.m_value = inCounter.m_value;
+	if(corrupted)
+	{
+		ANKI_UTIL_LOGE("Corrupted trace file: %s", binaryFilename.cstr());
+		return Error::USER_DATA;
+	}
 
-				perFrame->m_tempCounters.emplaceBack(outCounter);
-			}
+	// The process might have died while writing the last record
+	if(reader.m_truncated)
+	{
+		ANKI_UTIL_LOGW("The trace file is truncated: %s", binaryFilename.cstr());
+	}
 
-			// Delete chunk
-			m_alloc.deleteInstance(&chunk);
+	return writeFiles(ctx);
+}
+
+void Tracer::gatherCounters(FlushCtx& ctx)
+{
+	// Sort the counters and the events (their duration is a counter as well) by frame and name so the records of the
+	// same counter in a frame end up next to each other
+	DynamicArrayAuto<const Record*> records(ctx.m_alloc);
+	DynamicArrayAuto<const Record*> frames(ctx.m_alloc);
+	for(const Record& record : ctx.m_records)
+	{
+		if(record.m_type == RecordType::FRAME)
+		{
+			frames.emplaceBack(&record);
+		}
+		else
+		{
+			records.emplaceBack(&record);
 		}
 	}
 
-	if(ctx.m_counters.getSize() == 0)
+	if(records.getSize() == 0)
 	{
 		// Early exit
 		return;
 	}
 
-	// Compact the counters and get all counter names
-	for(PerFrameCounters& perFrame : ctx.m_counters)
-	{
-		if(perFrame.m_tempCounters.getSize() == 0)
+	std::sort(records.getBegin(), records.getEnd(), [](const Record* a, const Record* b) {
+		if(a->m_frame != b->m_frame)
 		{
-			continue;
+			return a->m_frame < b->m_frame;
 		}
 
-		// Sort counters
-		std::sort(perFrame.m_tempCounters.getBegin(),
-			perFrame.m_tempCounters.getEnd(),
-			[](const GatherCounter& a, const GatherCounter& b) { return a.m_name < b.m_name; });
+		return CString(a->m_name) < CString(b->m_name);
+	});
+
+	std::sort(frames.getBegin(), frames.getEnd(), [](const Record* a, const Record* b) {
+		return a->m_frame < b->m_frame;
+	});
 
-		// Compact counters
-		for(const GatherCounter& tmpCounter : perFrame.m_tempCounters)
+	// Merge the counters of every frame and get all counter names
+	U frameIdx = 0;
+	for(const Record* record : records)
+	{
+		if(ctx.m_counters.getSize() == 0 || ctx.m_counters.getBack().m_frame != record->m_frame)
 		{
-			if(perFrame.m_counters.getSize() == 0 || perFrame.m_counters.getBack().m_name != tmpCounter.m_name)
-			{
-				// Create new counter
-				perFrame.m_counters.emplaceBack(tmpCounter);
+			ctx.m_counters.emplaceBack(ctx.m_alloc);
+			PerFrameCounters& perFrame = ctx.m_counters.getBack();
+			perFrame.m_frame = record->m_frame;
 
-				// Update the counter names
-				Bool found = false;
-				for(const CString& counterName : ctx.m_counterNames)
-				{
-					if(counterName == tmpCounter.m_name)
-					{
-						found = true;
-						break;
-					}
-				}
+			// Find when the frame started. If its record is lost use the previous frame
+			while(frameIdx < frames.getSize() && frames[frameIdx]->m_frame < record->m_frame)
+			{
+				++frameIdx;
+			}
 
-				if(!found)
-				{
-					ctx.m_counterNames.emplaceBack(tmpCounter.m_name);
-				}
+			if(frameIdx < frames.getSize() && frames[frameIdx]->m_frame == record->m_frame)
+			{
+				perFrame.m_startFrameTime = frames[frameIdx]->m_timestamp;
+			}
+			else if(ctx.m_counters.getSize() > 1)
+			{
+				perFrame.m_startFrameTime = ctx.m_counters[ctx.m_counters.getSize() - 2].m_startFrameTime;
 			}
 			else
 			{
-				// Merge counters
-				GatherCounter& mergeTo = perFrame.m_counters.getBack();
-				ANKI_ASSERT(mergeTo.m_name == tmpCounter.m_name);
-				mergeTo.m_value += tmpCounter.m_value;
+				perFrame.m_startFrameTime = record->m_timestamp;
 			}
 		}
 
-		// Free some memory
-		perFrame.m_tempCounters.destroy();
+		PerFrameCounters& perFrame = ctx.m_counters.getBack();
+		const CString name(record->m_name);
+		if(perFrame.m_counters.getSize() == 0 || perFrame.m_counters.getBack().m_name != name)
+		{
+			// Create new counter
+			GatherCounter counter;
+			counter.m_name = name;
+			counter.m_value = record->m_value;
+			perFrame.m_counters.emplaceBack(counter);
+
+			ctx.m_counterNames.emplaceBack(name);
+		}
+		else
+		{
+			// Merge counters
+			perFrame.m_counters.getBack().m_value += record->m_value;
+		}
 	}
 
-	// Sort the counter names
-	ANKI_ASSERT(ctx.m_counterNames.getSize() > 0);
+	// Sort the counter names and remove the duplicates
 	std::sort(ctx.m_counterNames.getBegin(), ctx.m_counterNames.getEnd(), [](CString a, CString b) { return a < b; });
+	CString* newEnd = std::unique(ctx.m_counterNames.getBegin(), ctx.m_counterNames.getEnd());
+	ctx.m_counterNames.resize(newEnd - ctx.m_counterNames.getBegin());
 
 	// Fill the gaps. Some counters might have not appeared in some frames. Those counters need to have a zero value
 	// because the CSV wants all counters present on all rows
@@ -336,67 +813,46 @@ void Tracer::gatherCounters(FlushCtx& ctx)
 	{
 		ANKI_ASSERT(perFrame.m_counters.getSize() <= ctx.m_counterNames.getSize());
 
+		DynamicArrayAuto<GatherCounter> counters(ctx.m_alloc);
+		counters.create(ctx.m_counterNames.getSize());
+
+		U j = 0;
 		for(U i = 0; i < ctx.m_counterNames.getSize(); ++i)
 		{
-			const CString& counterName = ctx.m_counterNames[i];
+			counters[i].m_name = ctx.m_counterNames[i];
 
-			// Try to find the counter
-			Bool found = false;
-			for(const GatherCounter& c : perFrame.m_counters)
+			if(j < perFrame.m_counters.getSize() && perFrame.m_counters[j].m_name == ctx.m_counterNames[i])
 			{
-				if(counterName == c.m_name)
-				{
-					found = true;
-					break;
-				}
+				counters[i].m_value = perFrame.m_counters[j++].m_value;
 			}
-
-			if(!found)
+			else
 			{
 				// Counter is missing
-				GatherCounter missingCounter;
-				missingCounter.m_name = counterName;
-				missingCounter.m_value = 0;
-				perFrame.m_counters.emplaceBack(missingCounter);
+				counters[i].m_value = 0;
 			}
 		}
 
-		// Sort again
-		std::sort(perFrame.m_counters.getBegin(),
-			perFrame.m_counters.getEnd(),
-			[](const GatherCounter& a, const GatherCounter& b) { return a.m_name < b.m_name; });
-
-		ANKI_ASSERT(perFrame.m_counters.getSize() == ctx.m_counterNames.getSize());
+		ANKI_ASSERT(j == perFrame.m_counters.getSize());
+		perFrame.m_counters = std::move(counters);
 	}
 }
 
 void Tracer::gatherEvents(FlushCtx& ctx)
 {
-	for(ThreadLocal* threadLocal : m_allThreadLocal)
+	for(const Record& record : ctx.m_records)
 	{
-		while(!threadLocal->m_eventChunks.isEmpty())
+		if(record.m_type != RecordType::EVENT)
 		{
-			// Pop chunk
-			EventsChunk& chunk = threadLocal->m_eventChunks.getFront();
-			threadLocal->m_eventChunks.popFront();
-
-			// Copy
-			for(U i = 0; i < chunk.m_eventCount; ++i)
-			{
-				const Event& inEvent = chunk.m_events[i];
+			continue;
+		}
 
-				GatherEvent outEvent;
-				outEvent.m_duration = inEvent.m_duration;
-				outEvent.m_name = inEvent.m_name;
-				outEvent.m_timestamp = inEvent.m_timestamp;
-				outEvent.m_tid = threadLocal->m_tid;
+		GatherEvent event;
+		event.m_duration = Second(record.m_value) * 1e-9;
+		event.m_name = record.m_name;
+		event.m_timestamp = record.m_timestamp;
+		event.m_tid = ctx.m_threadIds[record.m_threadIdx];
 
-				ctx.m_events.emplaceBack(outEvent);
-			}
-
-			// Delete poped chunk
-			m_alloc.deleteInstance(&chunk);
-		}
+		ctx.m_events.emplaceBack(event);
 	}
 
 	// Sort them
@@ -415,10 +871,21 @@ void Tracer::gatherEvents(FlushCtx& ctx)
 	});
 }
 
+Error Tracer::writeFiles(FlushCtx& ctx)
+{
+	gatherCounters(ctx);
+	gatherEvents(ctx);
+
+	ANKI_CHECK(writeTraceJson(ctx));
+	ANKI_CHECK(writeCounterCsv(ctx));
+
+	return Error::NONE;
+}
+
 Error Tracer::writeTraceJson(const FlushCtx& ctx)
 {
 	// Open the file
-	StringAuto newFname(m_alloc);
+	StringAuto newFname(ctx.m_alloc);
 	newFname.sprintf("%s.trace.json", ctx.m_filename.cstr());
 	File file;
 	ANKI_CHECK(file.open(newFname.toCString(), FileOpenFlag::WRITE));
@@ -481,7 +948,7 @@ Error Tracer::writeTraceJson(const FlushCtx& ctx)
 Error Tracer::writeCounterCsv(const FlushCtx& ctx)
 {
 	// Open the file
-	StringAuto fname(m_alloc);
+	StringAuto fname(ctx.m_alloc);
 	fname.sprintf("%s.counters.csv", ctx.m_filename.cstr());
 	File file;
 	ANKI_CHECK(file.open(fname.toCString(), FileOpenFlag::WRITE));
@@ -536,19 +1003,6 @@ Error Tracer::writeCounterCsv(const FlushCtx& ctx)
 	return Error::NONE;
 }
 
-Error Tracer::flush(CString filename)
-{
-	FlushCtx ctx(m_alloc, filename);
-
-	gatherCounters(ctx);
-	gatherEvents(ctx);
-
-	ANKI_CHECK(writeTraceJson(ctx));
-	ANKI_CHECK(writeCounterCsv(ctx));
-
-	return Error::NONE;
-}
-
 void Tracer::getSpreadsheetColumnName(U column, Array<char, 3>& arr)
 {
 	U major = column / 26;
@@ -568,4 +1022,4 @@ void Tracer::getSpreadsheetColumnName(U column, Array<char, 3>& arr)
 	arr[2] = '\0';
 }
 
-} // end namespace anki
\ No newline at end of file
+} // end namespace anki
@@ -6,8 +6,10 @@
 #pragma once
 
 #include <anki/util/File.h>
-#include <anki/util/List.h>
-#include <anki/util/ObjectAllocator.h>
+#include <anki/util/DynamicArray.h>
+#include <anki/util/HashMap.h>
+#include <anki/util/Thread.h>
+#include <anki/util/Atomic.h>
 
 namespace anki
 {
@@ -15,23 +17,29 @@ namespace anki
 /// @addtogroup util_other
 /// @{
 
-/// @memberof Tracer
-using TracerEventHandle = void*;
+/// The start time of an event. Negative values are invalid handles. @memberof Tracer
+using TracerEventHandle = Second;
 
-/// Tracer.
+/// Tracer. Every thread writes events and counters to its own fixed-size ring buffer and a background thread drains
+/// them. The drained records are kept in a bounded history and they can be streamed to a binary file as well so the
+/// memory doesn't grow with the running time.
 class Tracer : public NonCopyable
 {
 public:
-	Tracer()
-	{
-	}
+	Tracer();
 
 	~Tracer();
 
-	void init(GenericMemoryPoolAllocator<U8> alloc)
-	{
-		m_alloc = alloc;
-	}
+	/// Initialize and start the background thread.
+	/// @param alloc The allocator.
+	/// @param threadRecordCount The size of the ring buffer of every thread. It's rounded up to a power of two. If a
+	///                          thread fills it before it's drained the new records are dropped.
+	/// @param historyRecordCount The number of records kept for captureLastFrames(). The oldest are overwritten.
+	/// @param flushPeriod How often the background thread drains the ring buffers.
+	void init(GenericMemoryPoolAllocator<U8> alloc,
+		U32 threadRecordCount = 1024 * 16,
+		U32 historyRecordCount = 1024 * 256,
+		Second flushPeriod = 0.01);
 
 	Bool isInitialized() const
 	{
@@ -50,52 +58,126 @@ public:
 	/// Begin a new frame.
 	void newFrame(U64 frame);
 
-	/// Flush all results to a file. Don't call that more than once.
-	ANKI_USE_RESULT Error flush(CString filename);
+	/// Stream all the records from now on to a binary file. See convertToChromeTrace().
+	ANKI_USE_RESULT Error beginStreaming(CString filename);
+
+	/// Stop streaming and close the file.
+	ANKI_USE_RESULT Error endStreaming();
+
+	/// Write the last frames of the history to a chrome trace file (filename.trace.json) and a CSV file with the
+	/// counters (filename.counters.csv). The first frames might be partial if the history was overwritten.
+	ANKI_USE_RESULT Error captureLastFrames(U32 frameCount, CString filename);
+
+	/// Same as captureLastFrames() but the files are written later by the background thread so the caller doesn't
+	/// wait for the disk. The frames are the ones before the call. The errors are logged.
+	void requestCaptureLastFrames(U32 frameCount, CString filename);
+
+	/// Write the whole history. See captureLastFrames().
+	ANKI_USE_RESULT Error flush(CString filename)
+	{
+		return captureLastFrames(MAX_U32, filename);
+	}
+
+	/// Get the number of records that were dropped because a ring buffer was full.
+	U64 getDroppedRecordCount() const
+	{
+		return m_droppedRecordCount.load();
+	}
+
+	/// Convert a binary file written by beginStreaming() to a chrome trace file and a CSV file. See
+	/// captureLastFrames().
+	static ANKI_USE_RESULT Error convertToChromeTrace(
+		CString binaryFilename, CString filename, GenericMemoryPoolAllocator<U8> alloc);
 
 private:
-	static const U32 EVENTS_PER_CHUNK = 256;
-	static const U32 COUNTERS_PER_CHUNK = 512;
+	enum class RecordType : U8;
+	class Record;
 
-	class Event;
-	class EventsChunk;
 	class GatherEvent;
-
-	class Counter;
-	class CountersChunk;
 	class GatherCounter;
 
 	class ThreadLocal;
 	class PerFrameCounters;
 	class FlushCtx;
+	class CaptureRequest;
 
 	GenericMemoryPoolAllocator<U8> m_alloc;
+	U64 m_uuid = 0; ///< Identifies the tracer in the thread local storage.
 
-	Second m_startFrameTime = 0.0;
-	U64 m_frame = 0;
-	SpinLock m_frameMtx; ///< Protect m_startFrameTime and m_frame.
+	Atomic<U64> m_frame = {0};
+	Atomic<U64> m_droppedRecordCount = {0};
 
 	static thread_local ThreadLocal* m_threadLocal;
+	static thread_local U64 m_threadLocalTracerUuid;
 	DynamicArray<ThreadLocal*> m_allThreadLocal; ///< The Tracer should know about all the ThreadLocal.
+	U32 m_threadRecordCount = 0;
 	Mutex m_threadLocalMtx;
 
+	/// @name Members of the thread that drains the ring buffers. Protected by m_drainMtx
+	/// @{
+	DynamicArray<Record> m_history; ///< Ring buffer.
+	U64 m_historyRecordCount = 0; ///< All the records that were pushed to m_history.
+
+	File m_streamFile;
+	DynamicArray<U8> m_streamBuffer;
+	PtrSize m_streamBufferSize = 0;
+	HashMap<U64, U32> m_streamNameIds; ///< Map the address of a name to an ID.
+	U32 m_streamNameIdCount = 0;
+	U32 m_streamedThreadCount = 0;
+
+	Mutex m_drainMtx;
+	/// @}
+
+	DynamicArray<CaptureRequest> m_captureRequests; ///< See requestCaptureLastFrames().
+	Mutex m_captureRequestsMtx;
+
+	/// @name The background thread
+	/// @{
+	Thread m_drainThread;
+	Second m_flushPeriod = 0.0;
+	Atomic<Bool> m_quit = {false};
+	/// @}
+
 	/// Get the thread local ThreadLocal structure.
 	ThreadLocal& getThreadLocal();
 
-	/// Gather all counters from all the threads.
-	void gatherCounters(FlushCtx& ctx);
+	/// Push a record to the ring buffer of the calling thread.
+	void pushRecord(const Record& record);
+
+	/// Move the records from the ring buffers to the history and the stream. Needs m_drainMtx.
+	void drain();
+
+	/// Write the frameCount frames that end with lastFrame. See captureLastFrames().
+	ANKI_USE_RESULT Error captureFrames(U64 lastFrame, U32 frameCount, CString filename);
+
+	/// Write the captures of requestCaptureLastFrames().
+	void processCaptureRequests();
+
+	/// Append a record to the stream buffer. Needs m_drainMtx.
+	void streamRecord(const Record& record);
+
+	void appendToStream(const void* data, PtrSize size);
+
+	/// Write the stream buffer to the file. Needs m_drainMtx.
+	ANKI_USE_RESULT Error writeStream();
+
+	/// Gather all counters from the records.
+	static void gatherCounters(FlushCtx& ctx);
+
+	/// Gather the events from the records.
+	static void gatherEvents(FlushCtx& ctx);
 
-	/// Gather the events from all the threads.
-	void gatherEvents(FlushCtx& ctx);
+	/// Gather and write the files.
+	static ANKI_USE_RESULT Error writeFiles(FlushCtx& ctx);
 
 	/// Dump the counters to a CSV file
-	Error writeCounterCsv(const FlushCtx& ctx);
+	static ANKI_USE_RESULT Error writeCounterCsv(const FlushCtx& ctx);
 
 	/// Dump the events and the counters to a chrome trace file.
-	Error writeTraceJson(const FlushCtx& ctx);
+	static ANKI_USE_RESULT Error writeTraceJson(const FlushCtx& ctx);
 
 	static void getSpreadsheetColumnName(U column, Array<char, 3>& arr);
 };
 /// @}
 
-} // end namespace anki
\ No newline at end of file
+} // end namespace anki
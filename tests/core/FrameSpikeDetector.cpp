@@ -0,0 +1,48 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <tests/framework/Framework.h>
+#include <anki/core/FrameSpikeDetector.h>
+
+namespace anki
+{
+
+ANKI_TEST(Core, FrameSpikeDetector)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	const U32 WINDOW_SIZE = 4;
+	FrameSpikeDetector detector(alloc, WINDOW_SIZE, 2.0);
+
+	// Warm-up: nothing is reported until the window is full, not even a slow frame
+	ANKI_TEST_EXPECT_EQ(detector.newFrame(0.01), false);
+	ANKI_TEST_EXPECT_EQ(detector.newFrame(1.0), false);
+	ANKI_TEST_EXPECT_EQ(detector.newFrame(0.01), false);
+	ANKI_TEST_EXPECT_EQ(detector.newFrame(0.01), false);
+
+	// The median ignores the slow frame of the warm-up. Push it out of the window
+	for(U32 i = 0; i < WINDOW_SIZE; ++i)
+	{
+		ANKI_TEST_EXPECT_EQ(detector.newFrame(0.01), false);
+		ANKI_TEST_EXPECT_NEAR(detector.getMedianFrameTime(), 0.01, 0.0001);
+	}
+
+	// Threshold: a spike is slower than factor times the median
+	ANKI_TEST_EXPECT_EQ(detector.newFrame(0.019), false);
+	ANKI_TEST_EXPECT_EQ(detector.newFrame(0.021), true);
+	ANKI_TEST_EXPECT_NEAR(detector.getMedianFrameTime(), 0.01, 0.0001);
+
+	// Cooldown: the next window of frames is not reported
+	for(U32 i = 0; i < WINDOW_SIZE; ++i)
+	{
+		ANKI_TEST_EXPECT_EQ(detector.newFrame(0.05), false);
+	}
+
+	// After the cooldown the spikes are reported again against the new median
+	ANKI_TEST_EXPECT_EQ(detector.newFrame(0.09), false);
+	ANKI_TEST_EXPECT_NEAR(detector.getMedianFrameTime(), 0.05, 0.0001);
+	ANKI_TEST_EXPECT_EQ(detector.newFrame(0.2), true);
+}
+
+} // end namespace anki
@@ -0,0 +1,317 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include "tests/framework/Framework.h"
+#include "anki/resource/PackArchive.h"
+#include "anki/resource/ResourceFilesystem.h"
+#include "anki/util/HighRezTimer.h"
+#include <contrib/minizip/zip.h>
+
+namespace anki
+{
+
+/// Fill with data that compress well or with random data.
+static void fillTestData(DynamicArrayAuto<U8>& data, PtrSize size, Bool compressible, U32 seed)
+{
+	data.create(size);
+	U32 state = seed * 2654435761u + 1;
+	for(PtrSize i = 0; i < size; ++i)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		data[i] = (compressible) ? U8('a' + (i / 7 + (state & 3)) % 16) : U8(state);
+	}
+}
+
+ANKI_TEST(Resource, PackArchive)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	const U32 BLOCK_SIZE = 16 * 1024;
+
+	DynamicArrayAuto<U8> text(alloc);
+	fillTestData(text, 1024 * 1024 + 123, true, 1);
+	DynamicArrayAuto<U8> random(alloc);
+	fillTestData(random, 300 * 1024, false, 2);
+	DynamicArrayAuto<U8> raw(alloc);
+	fillTestData(raw, 10000, true, 3);
+	const CString hello = "hello pack\n";
+
+	// Write
+	{
+		PackArchiveWriter writer(alloc);
+		ANKI_TEST_EXPECT_NO_ERR(writer.begin("./pack_test.ankipack", BLOCK_SIZE));
+		ANKI_TEST_EXPECT_NO_ERR(writer.addFile("hello.txt",
+			ConstWeakArray<U8>(reinterpret_cast<const U8*>(hello.cstr()), hello.getLength()),
+			PackArchiveFile::Compression::DEFLATE));
+		ANKI_TEST_EXPECT_NO_ERR(
+			writer.addFile("dir/text.bin", ConstWeakArray<U8>(text), PackArchiveFile::Compression::DEFLATE));
+		ANKI_TEST_EXPECT_NO_ERR(
+			writer.addFile("dir/random.bin", ConstWeakArray<U8>(random), PackArchiveFile::Compression::DEFLATE));
+		ANKI_TEST_EXPECT_NO_ERR(writer.addFile("raw.bin", ConstWeakArray<U8>(raw), PackArchiveFile::Compression::NONE));
+		ANKI_TEST_EXPECT_ERR(
+			writer.addFile("raw.bin", ConstWeakArray<U8>(raw), PackArchiveFile::Compression::NONE), Error::USER_DATA);
+		ANKI_TEST_EXPECT_NO_ERR(writer.end());
+	}
+
+	// The table of contents
+	{
+		PackArchive pack(alloc);
+		ANKI_TEST_EXPECT_NO_ERR(pack.open("./pack_test.ankipack"));
+		ANKI_TEST_EXPECT_EQ(pack.getEntryCount(), 4);
+		ANKI_TEST_EXPECT_EQ(pack.getBlockSize(), BLOCK_SIZE);
+
+		U32 idx;
+		ANKI_TEST_EXPECT_EQ(pack.find("dir/text.bin", idx), true);
+		ANKI_TEST_EXPECT_EQ(pack.getEntryName(idx), "dir/text.bin");
+		ANKI_TEST_EXPECT_EQ(pack.getEntry(idx).m_size, text.getSize());
+		ANKI_TEST_EXPECT_EQ(pack.getEntry(idx).m_compression, PackArchiveFile::Compression::DEFLATE);
+
+		// Random data don't compress so it's stored uncompressed and aligned
+		ANKI_TEST_EXPECT_EQ(pack.find("dir/random.bin", idx), true);
+		ANKI_TEST_EXPECT_EQ(pack.getEntry(idx).m_compression, PackArchiveFile::Compression::NONE);
+		ANKI_TEST_EXPECT_EQ(pack.getEntry(idx).m_offset % PackArchiveFile::DATA_ALIGNMENT, 0);
+
+		ANKI_TEST_EXPECT_EQ(pack.find("raw.bin", idx), true);
+		ANKI_TEST_EXPECT_EQ(pack.getEntry(idx).m_compression, PackArchiveFile::Compression::NONE);
+		ANKI_TEST_EXPECT_EQ(pack.find("hello.txt", idx), true);
+		ANKI_TEST_EXPECT_EQ(pack.find("dir", idx), false);
+		ANKI_TEST_EXPECT_EQ(pack.find("raw.bi", idx), false);
+	}
+
+	// Not a pack
+	{
+		File file;
+		ANKI_TEST_EXPECT_NO_ERR(file.open("./pack_bad.ankipack", FileOpenFlag::WRITE | FileOpenFlag::BINARY));
+		ANKI_TEST_EXPECT_NO_ERR(file.write(&raw[0], raw.getSize()));
+		file.close();
+
+		PackArchive pack(alloc);
+		ANKI_TEST_EXPECT_ERR(pack.open("./pack_bad.ankipack"), Error::USER_DATA);
+	}
+
+	// Packs of other versions are rejected
+	{
+		File file;
+		ANKI_TEST_EXPECT_NO_ERR(file.open("./pack_test.ankipack", FileOpenFlag::READ | FileOpenFlag::BINARY));
+		DynamicArrayAuto<U8> data(alloc);
+		data.create(file.getSize());
+		ANKI_TEST_EXPECT_NO_ERR(file.read(&data[0], data.getSize()));
+		file.close();
+
+		Array<PtrSize, 2> versionOffsets = {
+			{offsetof(PackArchiveFile::Header, m_version), offsetof(PackArchiveFile::Header, m_hashVersion)}};
+		for(PtrSize offset : versionOffsets)
+		{
+			DynamicArrayAuto<U8> other(alloc);
+			other.create(data.getSize());
+			memcpy(&other[0], &data[0], data.getSize());
+			const U32 version = 1000;
+			memcpy(&other[offset], &version, sizeof(version));
+
+			ANKI_TEST_EXPECT_NO_ERR(file.open("./pack_bad.ankipack", FileOpenFlag::WRITE | FileOpenFlag::BINARY));
+			ANKI_TEST_EXPECT_NO_ERR(file.write(&other[0], other.getSize()));
+			file.close();
+
+			PackArchive pack(alloc);
+			ANKI_TEST_EXPECT_ERR(pack.open("./pack_bad.ankipack"), Error::USER_DATA);
+		}
+	}
+
+	// Read through the filesystem
+	ResourceFilesystem fs(alloc);
+	ANKI_TEST_EXPECT_NO_ERR(fs.addNewPath("./pack_test.ankipack"));
+
+	{
+		ResourceFilePtr file;
+		ANKI_TEST_EXPECT_NO_ERR(fs.openFile("hello.txt", file));
+		StringAuto txt(alloc);
+		ANKI_TEST_EXPECT_NO_ERR(file->readAllText(alloc, txt));
+		ANKI_TEST_EXPECT_EQ(txt, hello);
+
+		ANKI_TEST_EXPECT_ANY_ERR(fs.openFile("nope.txt", file));
+	}
+
+	Array<const DynamicArrayAuto<U8>*, 3> datas = {{&text, &random, &raw}};
+	Array<CString, 3> names = {{"dir/text.bin", "dir/random.bin", "raw.bin"}};
+	for(U i = 0; i < datas.getSize(); ++i)
+	{
+		const DynamicArrayAuto<U8>& data = *datas[i];
+		ResourceFilePtr file;
+		ANKI_TEST_EXPECT_NO_ERR(fs.openFile(names[i], file));
+		ANKI_TEST_EXPECT_EQ(file->getSize(), data.getSize());
+
+		// Read all of it in odd pieces
+		DynamicArrayAuto<U8> out(alloc);
+		out.create(data.getSize());
+		PtrSize pos = 0;
+		while(pos < data.getSize())
+		{
+			const PtrSize size = min<PtrSize>(data.getSize() - pos, (pos % 3) ? 1000 : 40000);
+			ANKI_TEST_EXPECT_NO_ERR(file->read(&out[pos], size));
+			pos += size;
+		}
+		ANKI_TEST_EXPECT_EQ(memcmp(&out[0], &data[0], data.getSize()), 0);
+
+		// Reading past the end fails
+		U8 c;
+		ANKI_TEST_EXPECT_ANY_ERR(file->read(&c, 1));
+
+		// Seek around
+		for(U32 s = 0; s < 50; ++s)
+		{
+			const PtrSize offset = (s * 104729) % (data.getSize() - 100);
+			ANKI_TEST_EXPECT_NO_ERR(file->seek(offset, ResourceFile::SeekOrigin::BEGINNING));
+			Array<U8, 100> buff;
+			ANKI_TEST_EXPECT_NO_ERR(file->read(&buff[0], buff.getSize()));
+			ANKI_TEST_EXPECT_EQ(memcmp(&buff[0], &data[offset], buff.getSize()), 0);
+
+			// Backwards
+			ANKI_TEST_EXPECT_NO_ERR(file->seek(PtrSize(-50), ResourceFile::SeekOrigin::CURRENT));
+			ANKI_TEST_EXPECT_NO_ERR(file->read(&buff[0], 50));
+			ANKI_TEST_EXPECT_EQ(memcmp(&buff[0], &data[offset + 50], 50), 0);
+		}
+
+		ANKI_TEST_EXPECT_NO_ERR(file->seek(PtrSize(-4), ResourceFile::SeekOrigin::END));
+		U32 last;
+		ANKI_TEST_EXPECT_NO_ERR(file->readU32(last));
+		ANKI_TEST_EXPECT_EQ(memcmp(&last, &data[data.getSize() - 4], 4), 0);
+		ANKI_TEST_EXPECT_ANY_ERR(file->seek(1, ResourceFile::SeekOrigin::CURRENT));
+
+		// The uncompressed files can be mapped
+		if(i > 0)
+		{
+			if(file->isMapped())
+			{
+				ConstWeakArray<U8> view;
+				ANKI_TEST_EXPECT_NO_ERR(file->map(123, data.getSize() - 123, view));
+				ANKI_TEST_EXPECT_EQ(memcmp(&view[0], &data[123], view.getSize()), 0);
+			}
+		}
+		else
+		{
+			ANKI_TEST_EXPECT_EQ(file->isMapped(), false);
+		}
+	}
+
+	// Later paths override earlier ones
+	{
+		PackArchiveWriter writer(alloc);
+		ANKI_TEST_EXPECT_NO_ERR(writer.begin("./pack_test2.ankipack"));
+		ANKI_TEST_EXPECT_NO_ERR(writer.addFile("hello.txt",
+			ConstWeakArray<U8>(reinterpret_cast<const U8*>("bye"), 3),
+			PackArchiveFile::Compression::NONE));
+		ANKI_TEST_EXPECT_NO_ERR(writer.end());
+
+		ANKI_TEST_EXPECT_NO_ERR(fs.addNewPath("./pack_test2.ankipack"));
+		ResourceFilePtr file;
+		ANKI_TEST_EXPECT_NO_ERR(fs.openFile("hello.txt", file));
+		StringAuto txt(alloc);
+		ANKI_TEST_EXPECT_NO_ERR(file->readAllText(alloc, txt));
+		ANKI_TEST_EXPECT_EQ(txt, "bye");
+		ANKI_TEST_EXPECT_NO_ERR(fs.openFile("raw.bin", file));
+	}
+}
+
+ANKI_TEST(Resource, PackArchiveBench)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	const U32 FILE_COUNT = 64;
+	const U32 SEEK_COUNT = 16;
+	const PtrSize SEEK_READ_SIZE = 4 * 1024;
+
+	// The same asset set in a zip and in a pack. Mostly compressible data and some random
+	PackArchiveWriter writer(alloc);
+	ANKI_TEST_EXPECT_NO_ERR(writer.begin("./pack_bench.ankipack"));
+	zipFile zip = zipOpen("./pack_bench.ankizip", APPEND_STATUS_CREATE);
+	ANKI_TEST_EXPECT_NEQ(zip, nullptr);
+
+	DynamicArrayAuto<U32> sizes(alloc);
+	sizes.create(FILE_COUNT);
+	PtrSize totalSize = 0;
+	for(U32 i = 0; i < FILE_COUNT; ++i)
+	{
+		sizes[i] = 16 * 1024 + (i * 7919 * 131) % (1024 * 1024);
+		DynamicArrayAuto<U8> data(alloc);
+		fillTestData(data, sizes[i], (i % 4) != 0, i);
+		totalSize += sizes[i];
+
+		StringAuto name(alloc);
+		name.sprintf("assets/file_%u.bin", i);
+
+		ANKI_TEST_EXPECT_NO_ERR(
+			writer.addFile(name.toCString(), ConstWeakArray<U8>(data), PackArchiveFile::Compression::DEFLATE));
+
+		zip_fileinfo info = {};
+		ANKI_TEST_EXPECT_EQ(
+			zipOpenNewFileInZip(
+				zip, name.cstr(), &info, nullptr, 0, nullptr, 0, nullptr, Z_DEFLATED, Z_DEFAULT_COMPRESSION),
+			ZIP_OK);
+		ANKI_TEST_EXPECT_EQ(zipWriteInFileInZip(zip, &data[0], U32(data.getSize())), ZIP_OK);
+		ANKI_TEST_EXPECT_EQ(zipCloseFileInZip(zip), ZIP_OK);
+	}
+
+	ANKI_TEST_EXPECT_NO_ERR(writer.end());
+	ANKI_TEST_EXPECT_EQ(zipClose(zip, nullptr), ZIP_OK);
+
+	Array<CString, 2> archives = {{"./pack_bench.ankizip", "./pack_bench.ankipack"}};
+	Array<F64, 2> loadTimes;
+	Array<F64, 2> seekTimes;
+	Array<U64, 2> checksums;
+	for(U a = 0; a < 2; ++a)
+	{
+		ResourceFilesystem fs(alloc);
+		ANKI_TEST_EXPECT_NO_ERR(fs.addNewPath(archives[a]));
+		DynamicArrayAuto<U8> buff(alloc);
+		buff.create(1024 * 1024 + 16 * 1024);
+		checksums[a] = 0;
+
+		// Load all the files
+		HighRezTimer timer;
+		timer.start();
+		for(U32 i = 0; i < FILE_COUNT; ++i)
+		{
+			StringAuto name(alloc);
+			name.sprintf("assets/file_%u.bin", i);
+			ResourceFilePtr file;
+			ANKI_TEST_EXPECT_NO_ERR(fs.openFile(name.toCString(), file));
+			ANKI_TEST_EXPECT_NO_ERR(file->read(&buff[0], sizes[i]));
+			checksums[a] += buff[sizes[i] - 1];
+		}
+		timer.stop();
+		loadTimes[a] = timer.getElapsedTime();
+
+		// Streaming. Read small parts of the files at random positions
+		timer.start();
+		for(U32 i = 0; i < FILE_COUNT; ++i)
+		{
+			StringAuto name(alloc);
+			name.sprintf("assets/file_%u.bin", i);
+			ResourceFilePtr file;
+			ANKI_TEST_EXPECT_NO_ERR(fs.openFile(name.toCString(), file));
+
+			for(U32 s = 0; s < SEEK_COUNT; ++s)
+			{
+				const PtrSize offset = ((s * 7 + i) % SEEK_COUNT) * (sizes[i] - SEEK_READ_SIZE) / SEEK_COUNT;
+				ANKI_TEST_EXPECT_NO_ERR(file->seek(offset, ResourceFile::SeekOrigin::BEGINNING));
+				ANKI_TEST_EXPECT_NO_ERR(file->read(&buff[0], SEEK_READ_SIZE));
+				checksums[a] += buff[0];
+			}
+		}
+		timer.stop();
+		seekTimes[a] = timer.getElapsedTime();
+	}
+
+	ANKI_TEST_EXPECT_EQ(checksums[0], checksums[1]);
+	ANKI_TEST_LOGI("%u files of %luKB. Load all: zip %fms, pack %fms. Random reads: zip %fms, pack %fms",
+		FILE_COUNT,
+		totalSize / 1024,
+		loadTimes[0] * 1000.0,
+		loadTimes[1] * 1000.0,
+		seekTimes[0] * 1000.0,
+		seekTimes[1] * 1000.0);
+}
+
+} // end namespace anki
@@ -5,6 +5,9 @@
 
 #include "tests/framework/Framework.h"
 #include "anki/resource/ResourceFilesystem.h"
+#include "anki/util/Filesystem.h"
+#include "anki/util/HighRezTimer.h"
+#include <contrib/minizip/zip.h>
 
 namespace anki
 {
@@ -35,4 +38,215 @@ ANKI_TEST(Resource, ResourceFilesystem)
 	}
 }
 
+/// Write a zip archive with some text files.
+static void writeTestZip(CString filename, ConstWeakArray<CString> names, ConstWeakArray<CString> texts)
+{
+	zipFile zip = zipOpen(filename.cstr(), APPEND_STATUS_CREATE);
+	ANKI_TEST_EXPECT_NEQ(zip, nullptr);
+	for(U32 i = 0; i < names.getSize(); ++i)
+	{
+		zip_fileinfo info = {};
+		ANKI_TEST_EXPECT_EQ(
+			zipOpenNewFileInZip(
+				zip, names[i].cstr(), &info, nullptr, 0, nullptr, 0, nullptr, Z_DEFLATED, Z_DEFAULT_COMPRESSION),
+			ZIP_OK);
+		ANKI_TEST_EXPECT_EQ(zipWriteInFileInZip(zip, texts[i].cstr(), U32(texts[i].getLength())), ZIP_OK);
+		ANKI_TEST_EXPECT_EQ(zipCloseFileInZip(zip), ZIP_OK);
+	}
+	ANKI_TEST_EXPECT_EQ(zipClose(zip, nullptr), ZIP_OK);
+}
+
+static void writeTestFile(CString filename, CString text)
+{
+	File file;
+	ANKI_TEST_EXPECT_NO_ERR(file.open(filename, FileOpenFlag::WRITE));
+	ANKI_TEST_EXPECT_NO_ERR(file.writeText("%s", text.cstr()));
+}
+
+static void expectFileText(HeapAllocator<U8> alloc, ResourceFilesystem& fs, CString filename, CString text)
+{
+	ResourceFilePtr file;
+	ANKI_TEST_EXPECT_NO_ERR(fs.openFile(filename, file));
+	ANKI_TEST_EXPECT_EQ(file->getSize(), text.getLength());
+	StringAuto txt(alloc);
+	ANKI_TEST_EXPECT_NO_ERR(file->readAllText(alloc, txt));
+	ANKI_TEST_EXPECT_EQ(txt, text);
+}
+
+ANKI_TEST(Resource, ResourceFilesystemIndex)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	// A directory and a zip with a common file
+	if(directoryExists("./rsrc_index_dir"))
+	{
+		ANKI_TEST_EXPECT_NO_ERR(removeDirectory("./rsrc_index_dir"));
+	}
+	ANKI_TEST_EXPECT_NO_ERR(createDirectory("./rsrc_index_dir"));
+	ANKI_TEST_EXPECT_NO_ERR(createDirectory("./rsrc_index_dir/sub"));
+	writeTestFile("./rsrc_index_dir/a.txt", "dir a");
+	writeTestFile("./rsrc_index_dir/sub/b.txt", "dir b");
+
+	Array<CString, 2> zipNames = {{"a.txt", "c.txt"}};
+	Array<CString, 2> zipTexts = {{"zip a", "zip c"}};
+	writeTestZip("./rsrc_index.ankizip", ConstWeakArray<CString>(zipNames), ConstWeakArray<CString>(zipTexts));
+
+	// The later paths override the earlier
+	{
+		ResourceFilesystem fs(alloc);
+		ANKI_TEST_EXPECT_NO_ERR(fs.addNewPath("./rsrc_index_dir"));
+		ANKI_TEST_EXPECT_NO_ERR(fs.addNewPath("./rsrc_index.ankizip"));
+		ANKI_TEST_EXPECT_EQ(fs.m_index.getSize(), 3);
+
+		expectFileText(alloc, fs, "a.txt", "zip a");
+		expectFileText(alloc, fs, "sub/b.txt", "dir b");
+		expectFileText(alloc, fs, "c.txt", "zip c");
+
+		ResourceFilePtr file;
+		ANKI_TEST_EXPECT_ERR(fs.openFile("b.txt", file), Error::USER_DATA);
+		ANKI_TEST_EXPECT_ERR(fs.openFile("sub", file), Error::USER_DATA);
+	}
+
+	{
+		ResourceFilesystem fs(alloc);
+		ANKI_TEST_EXPECT_NO_ERR(fs.addNewPath("./rsrc_index.ankizip"));
+		ANKI_TEST_EXPECT_NO_ERR(fs.addNewPath("./rsrc_index_dir"));
+		expectFileText(alloc, fs, "a.txt", "dir a");
+		expectFileText(alloc, fs, "c.txt", "zip c");
+	}
+
+	// The index cache
+	const CString cacheFilename = "./rsrc_index.ankicache";
+	writeTestFile(cacheFilename, "");
+
+	{
+		// Missing or empty, the zip is listed and the cache is written
+		ResourceFilesystem fs(alloc);
+		fs.loadIndexCache(cacheFilename);
+		ANKI_TEST_EXPECT_NO_ERR(fs.addNewPath("./rsrc_index.ankizip"));
+		ANKI_TEST_EXPECT_EQ(fs.m_indexCacheDirty, true);
+		fs.storeIndexCache();
+		ANKI_TEST_EXPECT_EQ(fileExists(cacheFilename), true);
+		expectFileText(alloc, fs, "c.txt", "zip c");
+	}
+
+	{
+		// Up to date, the zip is not listed
+		ResourceFilesystem fs(alloc);
+		fs.loadIndexCache(cacheFilename);
+		ANKI_TEST_EXPECT_NO_ERR(fs.addNewPath("./rsrc_index_dir"));
+		ANKI_TEST_EXPECT_NO_ERR(fs.addNewPath("./rsrc_index.ankizip"));
+		ANKI_TEST_EXPECT_EQ(fs.m_indexCacheDirty, false);
+		fs.storeIndexCache();
+
+		expectFileText(alloc, fs, "a.txt", "zip a");
+		expectFileText(alloc, fs, "c.txt", "zip c");
+		expectFileText(alloc, fs, "sub/b.txt", "dir b");
+	}
+
+	{
+		// The zip changed
+		Array<CString, 2> newNames = {{"a.txt", "d.txt"}};
+		Array<CString, 2> newTexts = {{"new zip a", "zip d"}};
+		writeTestZip("./rsrc_index.ankizip", ConstWeakArray<CString>(newNames), ConstWeakArray<CString>(newTexts));
+
+		ResourceFilesystem fs(alloc);
+		fs.loadIndexCache(cacheFilename);
+		ANKI_TEST_EXPECT_NO_ERR(fs.addNewPath("./rsrc_index.ankizip"));
+		ANKI_TEST_EXPECT_EQ(fs.m_indexCacheDirty, true);
+		fs.storeIndexCache();
+
+		expectFileText(alloc, fs, "a.txt", "new zip a");
+		expectFileText(alloc, fs, "d.txt", "zip d");
+		ResourceFilePtr file;
+		ANKI_TEST_EXPECT_ERR(fs.openFile("c.txt", file), Error::USER_DATA);
+	}
+
+	{
+		// Corrupt, it's ignored
+		writeTestFile(cacheFilename, "ANKIIDX1 not really");
+
+		ResourceFilesystem fs(alloc);
+		fs.loadIndexCache(cacheFilename);
+		ANKI_TEST_EXPECT_NO_ERR(fs.addNewPath("./rsrc_index.ankizip"));
+		ANKI_TEST_EXPECT_EQ(fs.m_indexCacheDirty, true);
+		fs.storeIndexCache();
+		expectFileText(alloc, fs, "d.txt", "zip d");
+	}
+}
+
+ANKI_TEST(Resource, ResourceFilesystemIndexBench)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	const U32 ARCHIVE_COUNT = 16;
+	const U32 FILES_PER_ARCHIVE = 2000;
+
+	// Many archives with many small files. Every archive overrides some of the files of the previous
+	for(U32 a = 0; a < ARCHIVE_COUNT; ++a)
+	{
+		StringAuto filename(alloc);
+		filename.sprintf("./rsrc_index_bench_%u.ankizip", a);
+		zipFile zip = zipOpen(filename.cstr(), APPEND_STATUS_CREATE);
+		ANKI_TEST_EXPECT_NEQ(zip, nullptr);
+
+		for(U32 f = 0; f < FILES_PER_ARCHIVE; ++f)
+		{
+			StringAuto name(alloc);
+			name.sprintf("models/archive_%u/mesh_%u.ankimesh", (f % 10) ? a : 0, f);
+
+			zip_fileinfo info = {};
+			ANKI_TEST_EXPECT_EQ(
+				zipOpenNewFileInZip(
+					zip, name.cstr(), &info, nullptr, 0, nullptr, 0, nullptr, Z_DEFLATED, Z_DEFAULT_COMPRESSION),
+				ZIP_OK);
+			ANKI_TEST_EXPECT_EQ(zipWriteInFileInZip(zip, "text", 4), ZIP_OK);
+			ANKI_TEST_EXPECT_EQ(zipCloseFileInZip(zip), ZIP_OK);
+		}
+
+		ANKI_TEST_EXPECT_EQ(zipClose(zip, nullptr), ZIP_OK);
+	}
+
+	const CString cacheFilename = "./rsrc_index_bench.ankicache";
+	writeTestFile(cacheFilename, "");
+
+	// Without the cache, building the cache and using the cache
+	Array<F64, 3> times;
+	for(U32 run = 0; run < 3; ++run)
+	{
+		HighRezTimer timer;
+		timer.start();
+
+		ResourceFilesystem fs(alloc);
+		if(run > 0)
+		{
+			fs.loadIndexCache(cacheFilename);
+		}
+
+		for(U32 a = 0; a < ARCHIVE_COUNT; ++a)
+		{
+			StringAuto filename(alloc);
+			filename.sprintf("./rsrc_index_bench_%u.ankizip", a);
+			ANKI_TEST_EXPECT_NO_ERR(fs.addNewPath(filename.toCString()));
+		}
+
+		fs.storeIndexCache();
+		timer.stop();
+		times[run] = timer.getElapsedTime();
+
+		const U32 sharedCount = FILES_PER_ARCHIVE / 10;
+		ANKI_TEST_EXPECT_EQ(fs.m_index.getSize(), sharedCount + (FILES_PER_ARCHIVE - sharedCount) * ARCHIVE_COUNT);
+		ResourceFilePtr file;
+		ANKI_TEST_EXPECT_NO_ERR(fs.openFile("models/archive_0/mesh_0.ankimesh", file));
+		ANKI_TEST_EXPECT_NO_ERR(fs.openFile("models/archive_15/mesh_1.ankimesh", file));
+	}
+
+	ANKI_TEST_LOGI("Adding %u archives of %u files: without the index cache %fms, writing the cache %fms, "
+				   "with the cache %fms",
+		ARCHIVE_COUNT,
+		FILES_PER_ARCHIVE,
+		times[0] * 1000.0,
+		times[1] * 1000.0,
+		times[2] * 1000.0);
+}
+
 } // end namespace anki
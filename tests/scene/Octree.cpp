@@ -5,7 +5,10 @@
 
 #include <tests/framework/Framework.h>
 #include <anki/scene/Octree.h>
+#include <anki/scene/Bvh.h>
 #include <anki/collision/Frustum.h>
+#include <anki/util/HighRezTimer.h>
+#include <algorithm>
 
 namespace anki
 {
@@ -48,15 +51,9 @@ ANKI_TEST(Scene, Octree)
 			else if(placed.size() > 0)
 			{
 				// Gather
-
-				// Reset the placed
-				for(U32 idx : placed)
-				{
-					placeables[idx].reset();
-				}
-
+				OctreeVisitedSet visited(alloc, octree);
 				DynamicArrayAuto<void*> arr(alloc);
-				octree.gatherVisible(frustum, 0, nullptr, nullptr, arr);
+				octree.gatherVisible(frustum, visited, nullptr, nullptr, arr);
 
 				ANKI_TEST_EXPECT_EQ(arr.getSize(), placed.size());
 				for(U32 idx : placed)
@@ -83,6 +80,278 @@ ANKI_TEST(Scene, Octree)
 			placed.pop_back();
 		}
 	}
+
+	// Many tests in a frame. The boxes span many leafs
+	{
+		Octree octree(alloc);
+		octree.init(Vec3(-100.0f), Vec3(100.0f), 4);
+
+		OrthographicFrustum frustum(-200.0f, 200.0f, -200.0f, 200.0f, 200.0f, -200.0f);
+		frustum.resetTransform(Transform::getIdentity());
+
+		const U PLACEABLE_COUNT = 100;
+		Array<OctreePlaceable, PLACEABLE_COUNT> placeables;
+		for(U i = 0; i < PLACEABLE_COUNT; ++i)
+		{
+			placeables[i].m_userData = &placeables[i];
+			const F32 min = randRange(-100.0f, -1.0f);
+			const F32 max = randRange(1.0f, 100.0f);
+			octree.place(Aabb(Vec3(min), Vec3(max)), &placeables[i]);
+		}
+
+		// Remove and re-place some to reuse their indices
+		for(U i = 0; i < PLACEABLE_COUNT; i += 3)
+		{
+			octree.remove(placeables[i]);
+		}
+
+		for(U i = 0; i < PLACEABLE_COUNT; i += 3)
+		{
+			octree.place(Aabb(Vec3(-10.0f), Vec3(10.0f)), &placeables[i]);
+		}
+
+		const U TEST_COUNT = 300;
+		for(U t = 0; t < TEST_COUNT; ++t)
+		{
+			Array<U32, PLACEABLE_COUNT> visitCounts = {};
+			OctreeVisitedSet visited(alloc, octree);
+			octree.walkTree(visited,
+				[&](const Aabb& box) { return frustum.insideFrustum(box); },
+				[&](void* placeableUserData) {
+					++visitCounts[static_cast<OctreePlaceable*>(placeableUserData) - &placeables[0]];
+				});
+
+			for(U32 count : visitCounts)
+			{
+				ANKI_TEST_EXPECT_EQ(count, 1);
+			}
+		}
+
+		for(OctreePlaceable& placeable : placeables)
+		{
+			octree.remove(placeable);
+		}
+	}
+}
+
+/// Move a box a little. The same frame and index give the same box.
+static Aabb movedBox(const Aabb& box, U frame)
+{
+	const Vec4 offset(F32(frame % 4) - 1.5f, 0.0f, F32(frame % 3) - 1.0f, 0.0f);
+	return Aabb(box.getMin() + offset, box.getMax() + offset);
+}
+
+static Aabb randomBox(F32 sceneSize, F32 maxBoxSize)
+{
+	const Vec3 min(randRange(-sceneSize, sceneSize - maxBoxSize),
+		randRange(-sceneSize, sceneSize - maxBoxSize),
+		randRange(-sceneSize, sceneSize - maxBoxSize));
+	const Vec3 size(randRange(0.1f, maxBoxSize), randRange(0.1f, maxBoxSize), randRange(0.1f, maxBoxSize));
+	return Aabb(min, min + size);
+}
+
+ANKI_TEST(Scene, Bvh)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	// Fuzzy
+	{
+		Bvh bvh(alloc);
+
+		OrthographicFrustum bigFrustum(-200.0f, 200.0f, -200.0f, 200.0f, 200.0f, -200.0f);
+		bigFrustum.resetTransform(Transform::getIdentity());
+		PerspectiveFrustum frustum(toRad(60.0f), toRad(60.0f), 0.1f, 80.0f);
+		frustum.resetTransform(Transform::getIdentity());
+
+		const U ITERATION_COUNT = 2000;
+		Array<BvhPlaceable, ITERATION_COUNT> placeables;
+		Array<Aabb, ITERATION_COUNT> boxes;
+		std::vector<U32> placed;
+		for(U i = 0; i < ITERATION_COUNT; ++i)
+		{
+			I mode = rand() % 4;
+			if(mode == 0 || placed.size() < 10)
+			{
+				// Place
+				boxes[i] = randomBox(100.0f, 10.0f);
+				placeables[i].m_userData = &placeables[i];
+				bvh.place(boxes[i], &placeables[i]);
+				placed.push_back(i);
+			}
+			else if(mode == 1)
+			{
+				// Remove a random one
+				const U idx = rand() % placed.size();
+				bvh.remove(placeables[placed[idx]]);
+				placed[idx] = placed.back();
+				placed.pop_back();
+			}
+			else if(mode == 2)
+			{
+				// Move a few
+				for(U j = 0; j < 5; ++j)
+				{
+					const U32 idx = placed[rand() % placed.size()];
+					boxes[idx] = randomBox(100.0f, 10.0f);
+					bvh.place(boxes[idx], &placeables[idx]);
+				}
+			}
+			else
+			{
+				bvh.update();
+
+				// Everything is inside the big frustum and it's visited once
+				std::vector<void*> visible;
+				bvh.walkTree(bigFrustum, [](const Aabb&) { return true; }, [&](void* ud) { visible.push_back(ud); });
+				ANKI_TEST_EXPECT_EQ(visible.size(), placed.size());
+
+				std::sort(visible.begin(), visible.end());
+				ANKI_TEST_EXPECT_EQ(std::unique(visible.begin(), visible.end()) == visible.end(), true);
+
+				// The visible of a smaller frustum should contain all that are inside it
+				visible.clear();
+				bvh.walkTree(frustum, [](const Aabb&) { return true; }, [&](void* ud) { visible.push_back(ud); });
+				std::sort(visible.begin(), visible.end());
+				for(U32 idx : placed)
+				{
+					if(frustum.insideFrustum(boxes[idx]))
+					{
+						ANKI_TEST_EXPECT_EQ(std::binary_search(visible.begin(), visible.end(), &placeables[idx]), true);
+					}
+				}
+			}
+		}
+
+		// Remove all
+		while(!placed.empty())
+		{
+			bvh.remove(placeables[placed.back()]);
+			placed.pop_back();
+		}
+		bvh.update();
+		ANKI_TEST_EXPECT_EQ(bvh.getNodeCount(), 0);
+	}
+}
+
+ANKI_TEST(Scene, OctreeBvhBench)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	const U PLACEABLE_COUNT = 20000;
+	const U FRAME_COUNT = 20;
+	const U MOVING_COUNT = PLACEABLE_COUNT / 20;
+	const F32 SCENE_SIZE = 1000.0f;
+
+	std::vector<Aabb> boxes(PLACEABLE_COUNT);
+	for(Aabb& box : boxes)
+	{
+		box = randomBox(SCENE_SIZE, 20.0f);
+	}
+
+	PerspectiveFrustum frustum(toRad(60.0f), toRad(60.0f), 0.1f, 500.0f);
+	frustum.resetTransform(Transform::getIdentity());
+
+	HighRezTimer timer;
+	Array<Second, 2> placeTimes = {{0.0, 0.0}};
+	Array<Second, 2> moveTimes = {{0.0, 0.0}};
+	Array<Second, 2> gatherTimes = {{0.0, 0.0}};
+	Array<U32, 2> visibleCounts = {{0, 0}};
+
+	// Octree
+	{
+		Octree octree(alloc);
+		octree.init(Vec3(-SCENE_SIZE), Vec3(SCENE_SIZE), 5);
+		std::vector<OctreePlaceable> placeables(PLACEABLE_COUNT);
+
+		timer.start();
+		for(U i = 0; i < PLACEABLE_COUNT; ++i)
+		{
+			placeables[i].m_userData = &placeables[i];
+			octree.place(boxes[i], &placeables[i]);
+		}
+		timer.stop();
+		placeTimes[0] = timer.getElapsedTime();
+
+		for(U f = 0; f < FRAME_COUNT; ++f)
+		{
+			timer.start();
+			for(U i = 0; i < MOVING_COUNT; ++i)
+			{
+				const U idx = (f * MOVING_COUNT + i) % PLACEABLE_COUNT;
+				octree.place(movedBox(boxes[idx], f), &placeables[idx]);
+			}
+			timer.stop();
+			moveTimes[0] += timer.getElapsedTime();
+
+			U32 visibleCount = 0;
+			timer.start();
+			OctreeVisitedSet visited(alloc, octree);
+			octree.walkTree(visited,
+				[&](const Aabb& box) { return frustum.insideFrustum(box); },
+				[&](void* placeableUserData) { ++visibleCount; });
+			timer.stop();
+			gatherTimes[0] += timer.getElapsedTime();
+			visibleCounts[0] = visibleCount;
+		}
+
+		for(OctreePlaceable& placeable : placeables)
+		{
+			octree.remove(placeable);
+		}
+	}
+
+	// BVH
+	{
+		Bvh bvh(alloc);
+		std::vector<BvhPlaceable> placeables(PLACEABLE_COUNT);
+
+		timer.start();
+		for(U i = 0; i < PLACEABLE_COUNT; ++i)
+		{
+			placeables[i].m_userData = &placeables[i];
+			bvh.place(boxes[i], &placeables[i]);
+		}
+		bvh.update();
+		timer.stop();
+		placeTimes[1] = timer.getElapsedTime();
+
+		for(U f = 0; f < FRAME_COUNT; ++f)
+		{
+			timer.start();
+			for(U i = 0; i < MOVING_COUNT; ++i)
+			{
+				const U idx = (f * MOVING_COUNT + i) % PLACEABLE_COUNT;
+				bvh.place(movedBox(boxes[idx], f), &placeables[idx]);
+			}
+			bvh.update();
+			timer.stop();
+			moveTimes[1] += timer.getElapsedTime();
+
+			U32 visibleCount = 0;
+			timer.start();
+			bvh.walkTree(frustum, [](const Aabb&) { return true; }, [&](void* placeableUserData) { ++visibleCount; });
+			timer.stop();
+			gatherTimes[1] += timer.getElapsedTime();
+			visibleCounts[1] = visibleCount;
+		}
+
+		for(BvhPlaceable& placeable : placeables)
+		{
+			bvh.remove(placeable);
+		}
+	}
+
+	const Array<CString, 2> names = {{"Octree", "BVH"}};
+	for(U i = 0; i < 2; ++i)
+	{
+		ANKI_TEST_LOGI("%s: place %fms, move %u per frame %fms, gather %fms (%u visible)",
+			names[i].cstr(),
+			placeTimes[i] * 1000.0,
+			U32(MOVING_COUNT),
+			moveTimes[i] / FRAME_COUNT * 1000.0,
+			gatherTimes[i] / FRAME_COUNT * 1000.0,
+			visibleCounts[i]);
+	}
 }
 
 } // end namespace anki
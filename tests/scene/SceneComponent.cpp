@@ -0,0 +1,221 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <tests/framework/Framework.h>
+#include <anki/Scene.h>
+#include <anki/Gr.h>
+#include <anki/Input.h>
+#include <anki/core/Config.h>
+#include <anki/resource/ResourceManager.h>
+#include <anki/resource/ResourceFilesystem.h>
+#include <anki/physics/PhysicsWorld.h>
+#include <anki/script/ScriptManager.h>
+#include <anki/util/ThreadPool.h>
+#include <anki/util/ThreadHive.h>
+
+namespace anki
+{
+
+/// Borrows the type of the triggers. There are no triggers in the test scene.
+class TestComponentA : public SceneComponent
+{
+public:
+	static const SceneComponentType CLASS_TYPE = SceneComponentType::TRIGGER;
+
+	U32 m_value;
+
+	TestComponentA(SceneNode* node, U32 value)
+		: SceneComponent(CLASS_TYPE, node)
+		, m_value(value)
+	{
+	}
+};
+
+/// Same type as TestComponentA but it's in another size class.
+class BigTestComponentA : public TestComponentA
+{
+public:
+	Array<U8, 200> m_padding;
+
+	BigTestComponentA(SceneNode* node, U32 value)
+		: TestComponentA(node, value)
+	{
+	}
+};
+
+/// Borrows the type of the occluders. There are no occluders in the test scene.
+class TestComponentB : public SceneComponent
+{
+public:
+	static const SceneComponentType CLASS_TYPE = SceneComponentType::OCCLUDER;
+
+	U32 m_value;
+
+	TestComponentB(SceneNode* node, U32 value)
+		: SceneComponent(CLASS_TYPE, node)
+		, m_value(value)
+	{
+	}
+};
+
+/// Creates a component for every letter of the layout. 'a' is TestComponentA, 'A' is BigTestComponentA and 'b' is
+/// TestComponentB. The value of a component is its position in the layout.
+class ComponentsTestNode : public SceneNode
+{
+public:
+	ComponentsTestNode(SceneGraph* scene, CString name)
+		: SceneNode(scene, name)
+	{
+	}
+
+	ANKI_USE_RESULT Error init(const char* layout)
+	{
+		for(U32 i = 0; layout[i] != '\0'; ++i)
+		{
+			if(layout[i] == 'a')
+			{
+				newComponent<TestComponentA>(i);
+			}
+			else if(layout[i] == 'A')
+			{
+				newComponent<BigTestComponentA>(i);
+			}
+			else
+			{
+				ANKI_ASSERT(layout[i] == 'b');
+				newComponent<TestComponentB>(i);
+			}
+		}
+
+		return Error::NONE;
+	}
+};
+
+ANKI_TEST(Scene, SceneComponentPools)
+{
+	Config cfg;
+	initConfig(cfg);
+
+	NativeWindow* win = createWindow(cfg);
+	Input* in = new Input();
+	ANKI_TEST_EXPECT_NO_ERR(in->init(win));
+	GrManager* gr = createGrManager(cfg, win);
+	PhysicsWorld* physics;
+	ResourceFilesystem* fs;
+	ResourceManager* resources = createResourceManager(cfg, gr, physics, fs);
+
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	ThreadPool threadPool(2);
+	ThreadHive threadHive(2, alloc);
+	ScriptManager* script = new ScriptManager();
+	ANKI_TEST_EXPECT_NO_ERR(script->init(allocAligned, nullptr));
+
+	Timestamp globalTimestamp = 1;
+	SceneGraph* scene = new SceneGraph();
+	ANKI_TEST_EXPECT_NO_ERR(
+		scene->init(allocAligned, nullptr, &threadPool, &threadHive, resources, in, script, &globalTimestamp, cfg));
+
+	SceneComponentPools& pools = scene->getSceneComponentPools();
+	ANKI_TEST_EXPECT_EQ(pools.getComponentCount(SceneComponentType::TRIGGER), 0);
+	ANKI_TEST_EXPECT_EQ(pools.getComponentCount(SceneComponentType::OCCLUDER), 0);
+
+	{
+		// The components of a node and their ranges
+		ComponentsTestNode* node1;
+		ANKI_TEST_EXPECT_NO_ERR(scene->newSceneNode("node1", node1, "abaAb"));
+		ANKI_TEST_EXPECT_EQ(node1->getComponentCount(), 5);
+		ANKI_TEST_EXPECT_EQ(node1->hasComponent(SceneComponentType::TRIGGER), true);
+		ANKI_TEST_EXPECT_EQ(node1->hasComponent(SceneComponentType::MOVE), false);
+		ANKI_TEST_EXPECT_EQ(node1->tryGetComponent<MoveComponent>(), nullptr);
+
+		// tryGetComponent returns the last of the type
+		ANKI_TEST_EXPECT_EQ(node1->tryGetComponent<TestComponentA>()->m_value, 3);
+		ANKI_TEST_EXPECT_EQ(node1->tryGetComponent<TestComponentB>()->m_value, 4);
+
+		// The range of a type may have components of other types in it
+		Array<U32, 3> values;
+		U32 count = 0;
+		ANKI_TEST_EXPECT_NO_ERR(node1->iterateComponentsOfType<TestComponentA>([&](TestComponentA& comp) -> Error {
+			values[count++] = comp.m_value;
+			return Error::NONE;
+		}));
+		ANKI_TEST_EXPECT_EQ(count, 3);
+		ANKI_TEST_EXPECT_EQ(values[0], 0);
+		ANKI_TEST_EXPECT_EQ(values[1], 2);
+		ANKI_TEST_EXPECT_EQ(values[2], 3);
+
+		count = 0;
+		ANKI_TEST_EXPECT_NO_ERR(node1->iterateComponentsOfType<TestComponentB>([&](TestComponentB& comp) -> Error {
+			values[count++] = comp.m_value;
+			return Error::NONE;
+		}));
+		ANKI_TEST_EXPECT_EQ(count, 2);
+		ANKI_TEST_EXPECT_EQ(values[0], 1);
+		ANKI_TEST_EXPECT_EQ(values[1], 4);
+
+		ComponentsTestNode* node2;
+		ANKI_TEST_EXPECT_NO_ERR(scene->newSceneNode("node2", node2, "aa"));
+		ANKI_TEST_EXPECT_EQ(pools.getComponentCount(SceneComponentType::TRIGGER), 5);
+		ANKI_TEST_EXPECT_EQ(pools.getComponentCount(SceneComponentType::OCCLUDER), 2);
+
+		// Remember the memory of the components of the first node
+		const void* smallMemory0 = &node1->getComponentAt<TestComponentA>(0);
+		const void* smallMemory1 = &node1->getComponentAt<TestComponentA>(2);
+		const void* bigMemory = &node1->getComponentAt<TestComponentA>(3);
+		ANKI_TEST_EXPECT_EQ(bigMemory == smallMemory0 || bigMemory == smallMemory1, false);
+
+		// Delete the first node. The components of the second stay where they are
+		scene->deleteSceneNode(node1);
+		ANKI_TEST_EXPECT_NO_ERR(scene->update(0.0, 0.1));
+		++globalTimestamp;
+
+		ANKI_TEST_EXPECT_EQ(pools.getComponentCount(SceneComponentType::TRIGGER), 2);
+		ANKI_TEST_EXPECT_EQ(pools.getComponentCount(SceneComponentType::OCCLUDER), 0);
+
+		U32 mask = 0;
+		scene->iterateComponents<TestComponentA>([&](TestComponentA& comp) {
+			ANKI_TEST_EXPECT_EQ(&comp.getSceneNode(), node2);
+			mask |= 1u << comp.m_value;
+		});
+		ANKI_TEST_EXPECT_EQ(mask, 3);
+
+		count = 0;
+		scene->iterateComponents<TestComponentB>([&](TestComponentB& comp) { ++count; });
+		ANKI_TEST_EXPECT_EQ(count, 0);
+
+		// New components reuse the memory of the deleted ones of the same size class
+		ComponentsTestNode* node3;
+		ANKI_TEST_EXPECT_NO_ERR(scene->newSceneNode("node3", node3, "Aa"));
+		const void* newBigMemory = &node3->getComponentAt<TestComponentA>(0);
+		const void* newSmallMemory = &node3->getComponentAt<TestComponentA>(1);
+		ANKI_TEST_EXPECT_EQ(newBigMemory, bigMemory);
+		ANKI_TEST_EXPECT_EQ(newSmallMemory == smallMemory0 || newSmallMemory == smallMemory1, true);
+		ANKI_TEST_EXPECT_EQ(pools.getComponentCount(SceneComponentType::TRIGGER), 4);
+
+		// The components of a size class are visited in the order they are in memory
+		ComponentsTestNode* node4;
+		ANKI_TEST_EXPECT_NO_ERR(scene->newSceneNode("node4", node4, "bbb"));
+		const U8* prevMemory = nullptr;
+		count = 0;
+		scene->iterateComponents<TestComponentB>([&](TestComponentB& comp) {
+			const U8* memory = reinterpret_cast<const U8*>(&comp);
+			ANKI_TEST_EXPECT_GT(memory, prevMemory);
+			prevMemory = memory;
+			++count;
+		});
+		ANKI_TEST_EXPECT_EQ(count, 3);
+	}
+
+	delete scene;
+	delete script;
+	delete resources;
+	delete physics;
+	delete fs;
+	GrManager::deleteInstance(gr);
+	delete in;
+	delete win;
+}
+
+} // end namespace anki
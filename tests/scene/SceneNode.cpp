@@ -0,0 +1,152 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <tests/framework/Framework.h>
+#include <anki/Scene.h>
+#include <anki/Gr.h>
+#include <anki/Input.h>
+#include <anki/core/Config.h>
+#include <anki/resource/ResourceManager.h>
+#include <anki/resource/ResourceFilesystem.h>
+#include <anki/physics/PhysicsWorld.h>
+#include <anki/script/ScriptManager.h>
+#include <anki/util/ThreadPool.h>
+#include <anki/util/ThreadHive.h>
+
+namespace anki
+{
+
+/// Counts its updates. Borrows the type of the triggers. There are no triggers in the test scene.
+class UpdateCountComponent : public SceneComponent
+{
+public:
+	static const SceneComponentType CLASS_TYPE = SceneComponentType::TRIGGER;
+
+	U32 m_updateCount = 0;
+
+	UpdateCountComponent(SceneNode* node)
+		: SceneComponent(CLASS_TYPE, node)
+	{
+	}
+
+	void change()
+	{
+		markNodeForUpdate();
+	}
+
+	ANKI_USE_RESULT Error update(Second, Second, Bool& updated) override
+	{
+		++m_updateCount;
+		updated = false;
+		return Error::NONE;
+	}
+};
+
+/// Counts its frame updates.
+class UpdateCountNode : public SceneNode
+{
+public:
+	U32 m_frameUpdateCount = 0;
+
+	UpdateCountNode(SceneGraph* scene, CString name)
+		: SceneNode(scene, name)
+	{
+	}
+
+	ANKI_USE_RESULT Error init(Bool updatedEveryFrame)
+	{
+		newComponent<UpdateCountComponent>();
+		if(updatedEveryFrame)
+		{
+			setUpdatedEveryFrame();
+		}
+
+		return Error::NONE;
+	}
+
+	ANKI_USE_RESULT Error frameUpdate(Second, Second) override
+	{
+		++m_frameUpdateCount;
+		return Error::NONE;
+	}
+};
+
+ANKI_TEST(Scene, SceneNodeUpdate)
+{
+	Config cfg;
+	initConfig(cfg);
+
+	NativeWindow* win = createWindow(cfg);
+	Input* in = new Input();
+	ANKI_TEST_EXPECT_NO_ERR(in->init(win));
+	GrManager* gr = createGrManager(cfg, win);
+	PhysicsWorld* physics;
+	ResourceFilesystem* fs;
+	ResourceManager* resources = createResourceManager(cfg, gr, physics, fs);
+
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	ThreadPool threadPool(2);
+	ThreadHive threadHive(2, alloc);
+	ScriptManager* script = new ScriptManager();
+	ANKI_TEST_EXPECT_NO_ERR(script->init(allocAligned, nullptr));
+
+	Timestamp globalTimestamp = 1;
+	SceneGraph* scene = new SceneGraph();
+	ANKI_TEST_EXPECT_NO_ERR(
+		scene->init(allocAligned, nullptr, &threadPool, &threadHive, resources, in, script, &globalTimestamp, cfg));
+
+	{
+		UpdateCountNode* staticNode;
+		ANKI_TEST_EXPECT_NO_ERR(scene->newSceneNode("static", staticNode, false));
+		UpdateCountComponent& staticComp = staticNode->getComponent<UpdateCountComponent>();
+
+		UpdateCountNode* everyFrameNode;
+		ANKI_TEST_EXPECT_NO_ERR(scene->newSceneNode("everyFrame", everyFrameNode, true));
+		ANKI_TEST_EXPECT_EQ(everyFrameNode->getUpdatedEveryFrame(), true);
+
+		auto update = [&]() {
+			ANKI_TEST_EXPECT_NO_ERR(scene->update(0.0, 0.1));
+			++globalTimestamp;
+		};
+
+		// New nodes are updated once
+		update();
+		ANKI_TEST_EXPECT_EQ(staticNode->m_frameUpdateCount, 1);
+		ANKI_TEST_EXPECT_EQ(staticComp.m_updateCount, 1);
+		ANKI_TEST_EXPECT_EQ(staticNode->getMarkedForUpdate(), false);
+		ANKI_TEST_EXPECT_EQ(everyFrameNode->m_frameUpdateCount, 1);
+
+		// The static node is not updated again
+		update();
+		update();
+		ANKI_TEST_EXPECT_EQ(staticNode->m_frameUpdateCount, 1);
+		ANKI_TEST_EXPECT_EQ(staticComp.m_updateCount, 1);
+		ANKI_TEST_EXPECT_EQ(everyFrameNode->m_frameUpdateCount, 3);
+
+		// A change re-queues it for one update
+		staticComp.change();
+		ANKI_TEST_EXPECT_EQ(staticNode->getMarkedForUpdate(), true);
+		update();
+		ANKI_TEST_EXPECT_EQ(staticNode->m_frameUpdateCount, 2);
+		ANKI_TEST_EXPECT_EQ(staticComp.m_updateCount, 2);
+		ANKI_TEST_EXPECT_EQ(everyFrameNode->m_frameUpdateCount, 4);
+
+		update();
+		ANKI_TEST_EXPECT_EQ(staticNode->m_frameUpdateCount, 2);
+		ANKI_TEST_EXPECT_EQ(everyFrameNode->m_frameUpdateCount, 5);
+		ANKI_TEST_EXPECT_EQ(everyFrameNode->getComponent<UpdateCountComponent>().m_updateCount, 5);
+	}
+
+	delete scene;
+	delete script;
+	delete resources;
+	delete physics;
+	delete fs;
+	GrManager::deleteInstance(gr);
+	delete in;
+	delete win;
+}
+
+} // end namespace anki
@@ -0,0 +1,251 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <tests/framework/Framework.h>
+#include <anki/scene/TransformHierarchy.h>
+#include <anki/util/ThreadPool.h>
+#include <anki/util/HighRezTimer.h>
+#include <anki/util/System.h>
+
+namespace anki
+{
+
+static Transform randomTransform()
+{
+	const Vec4 origin(randRange(-10.0f, 10.0f), randRange(-10.0f, 10.0f), randRange(-10.0f, 10.0f), 0.0f);
+	const Mat3x4 rot(Mat3(Euler(randRange(-PI, PI), randRange(-PI, PI), randRange(-PI, PI))));
+	return Transform(origin, rot, randRange(0.5f, 2.0f));
+}
+
+static Bool transformsEqual(const Transform& a, const Transform& b)
+{
+	const F32 EPSILON = 0.001f;
+	if(absolute(a.getScale() - b.getScale()) > EPSILON)
+	{
+		return false;
+	}
+
+	for(U i = 0; i < 3; ++i)
+	{
+		if(absolute(a.getOrigin()[i] - b.getOrigin()[i]) > EPSILON * 100.0f)
+		{
+			return false;
+		}
+
+		for(U j = 0; j < 4; ++j)
+		{
+			if(absolute(a.getRotation()(i, j) - b.getRotation()(i, j)) > EPSILON)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/// Compute the world transform the slow way.
+static Transform referenceWorldTransform(const TransformHierarchy& h, U32 id)
+{
+	const U32 parent = h.getParent(id);
+	if(parent == TransformHierarchy::NO_PARENT)
+	{
+		return h.getLocalTransform(id);
+	}
+
+	return referenceWorldTransform(h, parent).combineTransformations(h.getLocalTransform(id));
+}
+
+/// Build many trees. Every tree has a root and every node has branchCount children until the maxDepth.
+static void buildTrees(TransformHierarchy& h, DynamicArrayAuto<U32>& ids, U32 treeCount, U32 branchCount, U32 maxDepth)
+{
+	for(U32 t = 0; t < treeCount; ++t)
+	{
+		U32 levelBegin = U32(ids.getSize());
+		ids.emplaceBack(h.newTransform(TransformHierarchyFlag::NONE, nullptr));
+		h.setLocalTransform(ids.getBack(), randomTransform());
+
+		for(U32 d = 1; d < maxDepth; ++d)
+		{
+			const U32 levelEnd = U32(ids.getSize());
+			for(U32 p = levelBegin; p < levelEnd; ++p)
+			{
+				for(U32 c = 0; c < branchCount; ++c)
+				{
+					const U32 id = h.newTransform(TransformHierarchyFlag::NONE, nullptr);
+					h.setParent(id, ids[p]);
+					h.setLocalTransform(id, randomTransform());
+					ids.emplaceBack(id);
+				}
+			}
+			levelBegin = levelEnd;
+		}
+	}
+}
+
+static void updatedCallback(void* userData, void* transformUserData)
+{
+	static_cast<Atomic<U32>*>(userData)->fetchAdd(1);
+}
+
+ANKI_TEST(Scene, TransformHierarchy)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	ThreadPool threadPool(4);
+	Timestamp timestamp = 1;
+
+	TransformHierarchy h(alloc);
+	DynamicArrayAuto<U32> ids(alloc);
+	buildTrees(h, ids, 4, 2, 10);
+	ANKI_TEST_EXPECT_EQ(h.getTransformCount(), ids.getSize());
+
+	// All are new so all are updated
+	Atomic<U32> updatedCount = {0};
+	h.update(&threadPool, timestamp, updatedCallback, &updatedCount);
+	ANKI_TEST_EXPECT_EQ(updatedCount.load(), ids.getSize());
+	ANKI_TEST_EXPECT_EQ(h.getLevelCount(), 10);
+	for(U32 id : ids)
+	{
+		ANKI_TEST_EXPECT_EQ(transformsEqual(h.getWorldTransform(id), referenceWorldTransform(h, id)), true);
+		ANKI_TEST_EXPECT_EQ(h.isDirty(id), false);
+	}
+
+	// Nothing changed
+	updatedCount.store(0);
+	h.update(&threadPool, ++timestamp, updatedCallback, &updatedCount);
+	ANKI_TEST_EXPECT_EQ(updatedCount.load(), 0);
+
+	// Move the root of the first tree. Only the first tree is updated
+	const U32 treeSize = U32(ids.getSize() / 4);
+	const Transform oldWorld = h.getWorldTransform(ids[1]);
+	h.setLocalTransform(ids[0], randomTransform());
+	h.update(&threadPool, ++timestamp, updatedCallback, &updatedCount);
+	ANKI_TEST_EXPECT_EQ(updatedCount.load(), treeSize);
+	ANKI_TEST_EXPECT_EQ(h.getWorldTransformTimestamp(ids[treeSize - 1]), timestamp);
+	ANKI_TEST_EXPECT_EQ(h.getWorldTransformTimestamp(ids[treeSize]), timestamp - 2);
+	ANKI_TEST_EXPECT_EQ(transformsEqual(h.getPreviousWorldTransform(ids[1]), oldWorld), true);
+	for(U32 id : ids)
+	{
+		ANKI_TEST_EXPECT_EQ(transformsEqual(h.getWorldTransform(id), referenceWorldTransform(h, id)), true);
+	}
+
+	// Move a leaf of the first tree and a child of the root of the second. Only their subtrees are updated
+	updatedCount.store(0);
+	h.setLocalTransform(ids[treeSize - 1], randomTransform());
+	h.setLocalTransform(ids[treeSize + 1], randomTransform());
+	h.update(&threadPool, ++timestamp, updatedCallback, &updatedCount);
+	ANKI_TEST_EXPECT_EQ(updatedCount.load(), 1 + (treeSize - 1) / 2);
+	ANKI_TEST_EXPECT_EQ(h.getWorldTransformTimestamp(ids[treeSize + 2]), timestamp - 3);
+	for(U32 id : ids)
+	{
+		ANKI_TEST_EXPECT_EQ(transformsEqual(h.getWorldTransform(id), referenceWorldTransform(h, id)), true);
+	}
+
+	// Re-parent a subtree under another tree and delete a few
+	h.setParent(ids[1], ids[treeSize + 5]);
+	h.setParent(ids[treeSize * 2 + 1], TransformHierarchy::NO_PARENT);
+	for(U32 i = treeSize * 3 + 1; i < treeSize * 4; ++i)
+	{
+		h.deleteTransform(ids[i]);
+	}
+	ids.resize(treeSize * 3 + 1);
+
+	const U32 newId = h.newTransform(TransformHierarchyFlag::IGNORE_PARENT_TRANSFORM, nullptr);
+	h.setParent(newId, ids[3]);
+	h.setLocalTransform(newId, randomTransform());
+
+	const U32 newId2 = h.newTransform(TransformHierarchyFlag::IGNORE_LOCAL_TRANSFORM, nullptr);
+	h.setParent(newId2, ids[3]);
+
+	h.update(nullptr, ++timestamp);
+	ANKI_TEST_EXPECT_EQ(h.getTransformCount(), ids.getSize() + 2);
+	ANKI_TEST_EXPECT_EQ(h.getLevelCount(), 2 + 1 + 9);
+	for(U32 id : ids)
+	{
+		ANKI_TEST_EXPECT_EQ(transformsEqual(h.getWorldTransform(id), referenceWorldTransform(h, id)), true);
+	}
+	ANKI_TEST_EXPECT_EQ(transformsEqual(h.getWorldTransform(newId), h.getLocalTransform(newId)), true);
+	ANKI_TEST_EXPECT_EQ(transformsEqual(h.getWorldTransform(newId2), h.getWorldTransform(ids[3])), true);
+
+	// A single update after the update
+	h.setLocalTransform(ids[1], randomTransform());
+	h.updateWorldTransform(ids[1], timestamp);
+	ANKI_TEST_EXPECT_EQ(h.isDirty(ids[1]), false);
+	ANKI_TEST_EXPECT_EQ(transformsEqual(h.getWorldTransform(ids[1]), referenceWorldTransform(h, ids[1])), true);
+}
+
+ANKI_TEST(Scene, TransformHierarchyBench)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	ThreadPool threadPool(getCpuCoresCount());
+	const U32 ITERATION_COUNT = 20;
+
+	class Case
+	{
+	public:
+		CString m_name;
+		U32 m_treeCount;
+		U32 m_branchCount;
+		U32 m_depth;
+	};
+
+	// A wide hierarchy with few levels and deep ones like vehicles with many attached parts
+	const Array<Case, 3> cases = {{{"wide", 64, 40, 3}, {"deep", 4, 2, 14}, {"chains", 8192, 1, 16}}};
+
+	for(const Case& c : cases)
+	{
+		TransformHierarchy h(alloc);
+		DynamicArrayAuto<U32> ids(alloc);
+		buildTrees(h, ids, c.m_treeCount, c.m_branchCount, c.m_depth);
+
+		Timestamp timestamp = 1;
+		h.update(nullptr, timestamp);
+
+		// Move all the roots every iteration so the whole hierarchy is updated
+		Array<Second, 2> times = {{0.0, 0.0}};
+		for(U32 parallel = 0; parallel < 2; ++parallel)
+		{
+			for(U32 i = 0; i < ITERATION_COUNT; ++i)
+			{
+				for(U32 id : ids)
+				{
+					if(h.getParent(id) == TransformHierarchy::NO_PARENT)
+					{
+						h.setLocalTransform(id, randomTransform());
+					}
+				}
+
+				HighRezTimer timer;
+				timer.start();
+				h.update((parallel) ? &threadPool : nullptr, ++timestamp);
+				timer.stop();
+				times[parallel] += timer.getElapsedTime();
+			}
+		}
+
+		// Move a single leaf. Only the leaf is visited
+		Second leafTime = 0.0;
+		for(U32 i = 0; i < ITERATION_COUNT; ++i)
+		{
+			h.setLocalTransform(ids.getBack(), randomTransform());
+
+			HighRezTimer timer;
+			timer.start();
+			h.update(&threadPool, ++timestamp);
+			timer.stop();
+			leafTime += timer.getElapsedTime();
+		}
+
+		ANKI_TEST_LOGI("%s: %u transforms in %u levels. Serial %fms, parallel %fms, one leaf %fms",
+			c.m_name.cstr(),
+			h.getTransformCount(),
+			h.getLevelCount(),
+			times[0] / ITERATION_COUNT * 1000.0,
+			times[1] / ITERATION_COUNT * 1000.0,
+			leafTime / ITERATION_COUNT * 1000.0);
+	}
+}
+
+} // end namespace anki
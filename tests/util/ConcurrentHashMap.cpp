@@ -0,0 +1,186 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <tests/framework/Framework.h>
+#include <anki/util/ConcurrentHashMap.h>
+#include <anki/util/ThreadPool.h>
+#include <anki/util/HighRezTimer.h>
+#include <anki/util/System.h>
+
+ANKI_TEST(Util, ConcurrentHashMap)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	// Simple
+	{
+		ConcurrentHashMap<U64, U32> map;
+		ANKI_TEST_EXPECT_EQ(map.find(U64(1)), nullptr);
+
+		map.emplace(alloc, 1, 10u);
+		U32& b = map.emplace(alloc, 2, 20u);
+		ANKI_TEST_EXPECT_EQ(*map.find(U64(1)), 10);
+		ANKI_TEST_EXPECT_EQ(map.find(U64(2)), &b);
+
+		// Emplace doesn't overwrite
+		map.emplace(alloc, 1, 30u);
+		ANKI_TEST_EXPECT_EQ(*map.find(U64(1)), 10);
+		ANKI_TEST_EXPECT_EQ(map.getSize(), 2);
+
+		// The values don't move when the map grows
+		for(U64 i = 3; i < 1000; ++i)
+		{
+			map.getOrCreate(alloc, i, [i](U32& value) { value = U32(i * 10); });
+		}
+		ANKI_TEST_EXPECT_EQ(map.find(U64(2)), &b);
+		ANKI_TEST_EXPECT_EQ(map.getSize(), 999);
+
+		U32 count = 0;
+		map.iterate([&](U64 key, U32& value) {
+			ANKI_TEST_EXPECT_EQ(value, key * 10);
+			++count;
+		});
+		ANKI_TEST_EXPECT_EQ(count, 999);
+
+		map.destroy(alloc);
+	}
+
+	// Read while other threads insert
+	{
+		ConcurrentHashMap<U64, U64> map;
+		const U THREAD_COUNT = 8;
+		const U64 KEY_COUNT = 10000;
+		ThreadPool threadPool(THREAD_COUNT);
+		Atomic<U32> createdCount = {0};
+
+		class Task : public ThreadPoolTask
+		{
+		public:
+			ConcurrentHashMap<U64, U64>* m_map = nullptr;
+			HeapAllocator<U8> m_alloc;
+			Atomic<U32>* m_createdCount = nullptr;
+			Bool m_fail = false;
+
+			Error operator()(U32 taskId, PtrSize threadsCount)
+			{
+				// All threads race to create the same keys in different orders
+				for(U64 i = 0; i < KEY_COUNT; ++i)
+				{
+					const U64 key = (taskId & 1) ? i : (KEY_COUNT - i - 1);
+					const U64& value = m_map->getOrCreate(m_alloc, key, [&](U64& value) {
+						value = key * 3;
+						m_createdCount->fetchAdd(1);
+					});
+					m_fail = m_fail || value != key * 3;
+
+					const U64* other = m_map->find((key * 7) % KEY_COUNT);
+					m_fail = m_fail || (other && *other != ((key * 7) % KEY_COUNT) * 3);
+				}
+
+				return Error::NONE;
+			}
+		};
+
+		Array<Task, THREAD_COUNT> tasks;
+		for(U i = 0; i < THREAD_COUNT; ++i)
+		{
+			tasks[i].m_map = &map;
+			tasks[i].m_alloc = alloc;
+			tasks[i].m_createdCount = &createdCount;
+			threadPool.assignNewTask(i, &tasks[i]);
+		}
+		ANKI_TEST_EXPECT_NO_ERR(threadPool.waitForAllThreadsToFinish());
+
+		for(const Task& task : tasks)
+		{
+			ANKI_TEST_EXPECT_EQ(task.m_fail, false);
+		}
+		ANKI_TEST_EXPECT_EQ(createdCount.load(), KEY_COUNT);
+		ANKI_TEST_EXPECT_EQ(map.getSize(), KEY_COUNT);
+
+		map.destroy(alloc);
+	}
+}
+
+ANKI_TEST(Util, ConcurrentHashMapBench)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	const U threadCount = max<U>(2, getCpuCoresCount());
+	const U ITERATIONS = 1000000;
+	const U KEY_COUNT = 256;
+	ThreadPool threadPool(threadCount);
+
+	// What the caches used to do. A lock and a hash map
+	FlatHashMap<U64, U64> lockedMap;
+	Mutex mtx;
+	ConcurrentHashMap<U64, U64> concurrentMap;
+	for(U64 i = 0; i < KEY_COUNT; ++i)
+	{
+		lockedMap.emplace(alloc, i, i);
+		concurrentMap.emplace(alloc, i, i);
+	}
+
+	// Every thread looks up the same few keys like the render threads do with the variants
+	class Task : public ThreadPoolTask
+	{
+	public:
+		FlatHashMap<U64, U64>* m_lockedMap = nullptr;
+		Mutex* m_mtx = nullptr;
+		ConcurrentHashMap<U64, U64>* m_concurrentMap = nullptr;
+		U64 m_sum = 0;
+
+		Error operator()(U32 taskId, PtrSize threadsCount)
+		{
+			for(U i = 0; i < ITERATIONS; ++i)
+			{
+				const U64 key = (i * 13 + taskId) % KEY_COUNT;
+				if(m_concurrentMap)
+				{
+					m_sum += *m_concurrentMap->find(key);
+				}
+				else
+				{
+					LockGuard<Mutex> lock(*m_mtx);
+					m_sum += *m_lockedMap->find(key);
+				}
+			}
+
+			return Error::NONE;
+		}
+	};
+
+	DynamicArrayAuto<Task> tasks(alloc);
+	tasks.create(threadCount);
+
+	auto run = [&](Bool concurrent) -> Second {
+		const Second begin = HighRezTimer::getCurrentTime();
+		for(U i = 0; i < threadCount; ++i)
+		{
+			tasks[i].m_lockedMap = &lockedMap;
+			tasks[i].m_mtx = &mtx;
+			tasks[i].m_concurrentMap = (concurrent) ? &concurrentMap : nullptr;
+			threadPool.assignNewTask(i, &tasks[i]);
+		}
+		ANKI_TEST_EXPECT_NO_ERR(threadPool.waitForAllThreadsToFinish());
+		return (HighRezTimer::getCurrentTime() - begin) / ITERATIONS * 1000000000.0;
+	};
+
+	const Second lockedTime = run(false);
+	const Second concurrentTime = run(true);
+
+	U64 sum = 0;
+	for(const Task& task : tasks)
+	{
+		sum += task.m_sum;
+	}
+
+	ANKI_TEST_LOGI("%u threads, lookup: Mutex and FlatHashMap %fns, ConcurrentHashMap %fns (%llu)",
+		threadCount,
+		lockedTime,
+		concurrentTime,
+		sum);
+
+	lockedMap.destroy(alloc);
+	concurrentMap.destroy(alloc);
+}
@@ -0,0 +1,136 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <tests/framework/Framework.h>
+#include <anki/util/CpuProfiler.h>
+#include <anki/util/HighRezTimer.h>
+
+ANKI_TEST(Util, CpuProfiler)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	CpuProfiler profiler;
+	profiler.init(alloc);
+	profiler.newFrame(1);
+
+	// A root with a child that runs twice and a grandchild
+	profiler.beginZone("root");
+	for(U i = 0; i < 2; ++i)
+	{
+		profiler.beginZone("child");
+		HighRezTimer::sleep(0.01);
+		profiler.beginZone("grandchild");
+		HighRezTimer::sleep(0.01);
+		profiler.endZone();
+		profiler.endZone();
+	}
+	HighRezTimer::sleep(0.01);
+	profiler.endZone();
+
+	// And a zone in another thread
+	Thread thread("profiler");
+	thread.start(&profiler, [](ThreadCallbackInfo& info) -> Error {
+		CpuProfiler& profiler = *static_cast<CpuProfiler*>(info.m_userData);
+		profiler.beginZone("worker");
+		HighRezTimer::sleep(0.01);
+		profiler.endZone();
+		return Error::NONE;
+	});
+	ANKI_TEST_EXPECT_NO_ERR(thread.join());
+
+	profiler.newFrame(2);
+
+	{
+		CpuProfilerFrame frame(alloc);
+		profiler.getLastFrame(frame);
+
+		ANKI_TEST_EXPECT_EQ(frame.m_frame, 1);
+		ANKI_TEST_EXPECT_EQ(frame.m_threads.getSize(), 2);
+		ANKI_TEST_EXPECT_EQ(frame.m_zones.getSize(), 4);
+		ANKI_TEST_EXPECT_NEQ(frame.m_mainThread, MAX_U32);
+
+		const CpuProfilerThread& mainThread = frame.m_threads[frame.m_mainThread];
+		ANKI_TEST_EXPECT_EQ(mainThread.m_zoneCount, 3);
+
+		const CpuProfilerZone& root = frame.m_zones[mainThread.m_firstZone];
+		const CpuProfilerZone& child = frame.m_zones[mainThread.m_firstZone + 1];
+		const CpuProfilerZone& grandchild = frame.m_zones[mainThread.m_firstZone + 2];
+
+		ANKI_TEST_EXPECT_EQ(CString(root.m_name), "root");
+		ANKI_TEST_EXPECT_EQ(root.m_parent, MAX_U32);
+		ANKI_TEST_EXPECT_EQ(root.m_depth, 0);
+		ANKI_TEST_EXPECT_EQ(root.m_callCount, 1);
+
+		ANKI_TEST_EXPECT_EQ(CString(child.m_name), "child");
+		ANKI_TEST_EXPECT_EQ(child.m_parent, mainThread.m_firstZone);
+		ANKI_TEST_EXPECT_EQ(child.m_depth, 1);
+		ANKI_TEST_EXPECT_EQ(child.m_callCount, 2);
+
+		ANKI_TEST_EXPECT_EQ(CString(grandchild.m_name), "grandchild");
+		ANKI_TEST_EXPECT_EQ(grandchild.m_parent, mainThread.m_firstZone + 1);
+		ANKI_TEST_EXPECT_EQ(grandchild.m_depth, 2);
+		ANKI_TEST_EXPECT_EQ(grandchild.m_callCount, 2);
+
+		// Inclusive contains the children, exclusive doesn't
+		ANKI_TEST_EXPECT_GEQ(root.m_inclusiveTime, 0.05);
+		ANKI_TEST_EXPECT_GEQ(root.m_exclusiveTime, 0.01);
+		ANKI_TEST_EXPECT_LEQ(root.m_exclusiveTime, root.m_inclusiveTime - child.m_inclusiveTime + 0.0001);
+		ANKI_TEST_EXPECT_GEQ(child.m_inclusiveTime, 0.04);
+		ANKI_TEST_EXPECT_GEQ(child.m_exclusiveTime, 0.02);
+		ANKI_TEST_EXPECT_LEQ(child.m_exclusiveTime, child.m_inclusiveTime - grandchild.m_inclusiveTime + 0.0001);
+		ANKI_TEST_EXPECT_EQ(grandchild.m_inclusiveTime, grandchild.m_exclusiveTime);
+
+		ANKI_TEST_EXPECT_EQ(profiler.getLastFrameZoneCallCount("worker"), 1);
+		ANKI_TEST_EXPECT_GEQ(profiler.getLastFrameZoneTime("worker"), 0.01);
+		ANKI_TEST_EXPECT_EQ(profiler.getLastFrameZoneTime("root"), root.m_inclusiveTime);
+	}
+
+	// Only a zone that spans the frame boundary
+	profiler.beginZone("root");
+	profiler.beginZone("child");
+	profiler.endZone();
+	profiler.newFrame(3);
+
+	{
+		CpuProfilerFrame frame(alloc);
+		profiler.getLastFrame(frame);
+
+		// The root is still open so it's there only because of the child
+		ANKI_TEST_EXPECT_EQ(frame.m_frame, 2);
+		ANKI_TEST_EXPECT_EQ(frame.m_threads.getSize(), 1);
+		ANKI_TEST_EXPECT_EQ(frame.m_zones.getSize(), 2);
+		ANKI_TEST_EXPECT_EQ(frame.m_zones[0].m_callCount, 0);
+		ANKI_TEST_EXPECT_EQ(frame.m_zones[1].m_callCount, 1);
+		ANKI_TEST_EXPECT_EQ(profiler.getLastFrameZoneCallCount("grandchild"), 0);
+		ANKI_TEST_EXPECT_EQ(profiler.getLastFrameZoneCallCount("worker"), 0);
+	}
+
+	// The root ends
+	profiler.endZone();
+	profiler.newFrame(4);
+	ANKI_TEST_EXPECT_EQ(profiler.getLastFrameZoneCallCount("root"), 1);
+	ANKI_TEST_EXPECT_EQ(profiler.getLastFrameZoneCallCount("child"), 0);
+}
+
+ANKI_TEST(Util, CpuProfilerBench)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	CpuProfiler profiler;
+	profiler.init(alloc);
+
+	const U ITERATIONS = 1000000;
+	const Second begin = HighRezTimer::getCurrentTime();
+	for(U i = 0; i < ITERATIONS; ++i)
+	{
+		profiler.beginZone("outer");
+		profiler.beginZone("inner");
+		profiler.endZone();
+		profiler.endZone();
+	}
+	const Second time = HighRezTimer::getCurrentTime() - begin;
+	profiler.newFrame(1);
+
+	ANKI_TEST_EXPECT_EQ(profiler.getLastFrameZoneCallCount("inner"), ITERATIONS);
+	ANKI_TEST_LOGI("Begin and end a zone: %fns", time / (ITERATIONS * 2) * 1000000000.0);
+}
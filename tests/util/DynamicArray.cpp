@@ -255,3 +255,100 @@ ANKI_TEST(Util, DynamicArrayEmplaceAt)
 			constructor0Count + constructor1Count + constructor2Count + constructor3Count, destructorCount);
 	}
 }
+
+/// Count the allocations that go through an allocator.
+static void* countingAllocAligned(void* userData, void* ptr, PtrSize size, PtrSize alignment)
+{
+	if(ptr == nullptr)
+	{
+		++*static_cast<U32*>(userData);
+	}
+
+	return allocAligned(nullptr, ptr, size, alignment);
+}
+
+ANKI_TEST(Util, DynamicArrayInline)
+{
+	U32 allocCount = 0;
+	HeapAllocator<U8> alloc(countingAllocAligned, &allocCount);
+	allocCount = 0; // Ignore the pool
+
+	// Stays inline
+	{
+		DynamicArrayInline<DynamicArrayFoo, 4> arr(alloc);
+		arr.create(2, DynamicArrayFoo(1));
+		arr.emplaceBack(2);
+		arr.emplaceBack(3);
+		ANKI_TEST_EXPECT_EQ(arr.getSize(), 4);
+		ANKI_TEST_EXPECT_EQ(arr.isInline(), true);
+		ANKI_TEST_EXPECT_EQ(arr[0].m_x, 1);
+		ANKI_TEST_EXPECT_EQ(arr[1].m_x, 1);
+		ANKI_TEST_EXPECT_EQ(arr.getBack().m_x, 3);
+		ANKI_TEST_EXPECT_EQ(allocCount, 0);
+
+		arr.resize(1);
+		ANKI_TEST_EXPECT_EQ(arr.getSize(), 1);
+		ANKI_TEST_EXPECT_EQ(arr.getFront().m_x, 1);
+	}
+
+	// Spills and keeps the elements
+	{
+		DynamicArrayInline<DynamicArrayFoo, 4> arr(alloc);
+		std::vector<DynamicArrayFoo> vec;
+		for(I i = 0; i < 100; ++i)
+		{
+			arr.emplaceBack(i);
+			vec.emplace_back(i);
+		}
+
+		ANKI_TEST_EXPECT_EQ(arr.isInline(), false);
+		ANKI_TEST_EXPECT_EQ(arr.getSize(), vec.size());
+		for(PtrSize i = 0; i < arr.getSize(); ++i)
+		{
+			ANKI_TEST_EXPECT_EQ(arr[i].m_x, vec[i].m_x);
+		}
+
+		// Doubles the capacity: 8, 16, 32, 64, 128
+		ANKI_TEST_EXPECT_EQ(allocCount, 5);
+
+		arr.destroy();
+		ANKI_TEST_EXPECT_EQ(arr.isInline(), true);
+		ANKI_TEST_EXPECT_EQ(arr.isEmpty(), true);
+	}
+
+	ANKI_TEST_EXPECT_EQ(constructor0Count + constructor1Count + constructor2Count + constructor3Count, destructorCount);
+
+	// Compare the allocations with DynamicArrayAuto for small temp arrays
+	{
+		const U ITERATIONS = 1000;
+
+		allocCount = 0;
+		for(U i = 0; i < ITERATIONS; ++i)
+		{
+			DynamicArrayAuto<F32> arr(alloc);
+			for(U j = 0; j < 16; ++j)
+			{
+				arr.emplaceBack(F32(j));
+			}
+		}
+		const U32 autoAllocCount = allocCount;
+
+		allocCount = 0;
+		for(U i = 0; i < ITERATIONS; ++i)
+		{
+			DynamicArrayInline<F32, 16> arr(alloc);
+			for(U j = 0; j < 16; ++j)
+			{
+				arr.emplaceBack(F32(j));
+			}
+		}
+		const U32 inlineAllocCount = allocCount;
+
+		ANKI_TEST_LOGI("%u arrays of 16 floats: DynamicArrayAuto %u allocations, DynamicArrayInline %u allocations",
+			ITERATIONS,
+			autoAllocCount,
+			inlineAllocCount);
+		ANKI_TEST_EXPECT_EQ(autoAllocCount, ITERATIONS * 5);
+		ANKI_TEST_EXPECT_EQ(inlineAllocCount, 0);
+	}
+}
@@ -6,6 +6,7 @@
 #include "tests/framework/Framework.h"
 #include "anki/util/Filesystem.h"
 #include "anki/util/File.h"
+#include "anki/util/HighRezTimer.h"
 
 ANKI_TEST(Util, FileExists)
 {
@@ -18,6 +19,128 @@ ANKI_TEST(Util, FileExists)
 	ANKI_TEST_EXPECT_EQ(fileExists("./tmp"), true);
 }
 
+ANKI_TEST(Util, FileMmap)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	// Write a file that spans a few pages
+	const U32 COUNT = 100000;
+	{
+		File file;
+		ANKI_TEST_EXPECT_NO_ERR(file.open("./mapped.bin", FileOpenFlag::WRITE | FileOpenFlag::BINARY));
+		for(U32 i = 0; i < COUNT; ++i)
+		{
+			ANKI_TEST_EXPECT_NO_ERR(file.write(&i, sizeof(i)));
+		}
+	}
+
+	File file;
+	ANKI_TEST_EXPECT_NO_ERR(file.open("./mapped.bin", FileOpenFlag::READ | FileOpenFlag::MMAP | FileOpenFlag::BINARY));
+	ANKI_TEST_EXPECT_EQ(file.isMapped(), ANKI_POSIX);
+	ANKI_TEST_EXPECT_EQ(file.getSize(), COUNT * sizeof(U32));
+
+	// Read and seek
+	U32 u;
+	ANKI_TEST_EXPECT_NO_ERR(file.readU32(u));
+	ANKI_TEST_EXPECT_EQ(u, 0);
+	ANKI_TEST_EXPECT_NO_ERR(file.seek(sizeof(U32) * 10, File::SeekOrigin::CURRENT));
+	ANKI_TEST_EXPECT_NO_ERR(file.readU32(u));
+	ANKI_TEST_EXPECT_EQ(u, 11);
+	ANKI_TEST_EXPECT_NO_ERR(file.seek(-PtrSize(sizeof(U32)), File::SeekOrigin::END));
+	ANKI_TEST_EXPECT_NO_ERR(file.readU32(u));
+	ANKI_TEST_EXPECT_EQ(u, COUNT - 1);
+	ANKI_TEST_EXPECT_ERR(file.read(&u, sizeof(u)), Error::FILE_ACCESS);
+	ANKI_TEST_EXPECT_NO_ERR(file.seek(0, File::SeekOrigin::BEGINNING));
+
+	DynamicArrayAuto<U32> all(alloc);
+	all.create(COUNT);
+	ANKI_TEST_EXPECT_NO_ERR(file.read(&all[0], all.getSizeInBytes()));
+	ANKI_TEST_EXPECT_EQ(all[COUNT / 2], COUNT / 2);
+
+	if(file.isMapped())
+	{
+		// Views don't move the position
+		ConstWeakArray<U8> view;
+		ANKI_TEST_EXPECT_NO_ERR(file.map(sizeof(U32) * 5000, sizeof(U32) * 1000, view));
+		ANKI_TEST_EXPECT_EQ(view.getSize(), sizeof(U32) * 1000);
+		for(U32 i = 0; i < 1000; ++i)
+		{
+			memcpy(&u, &view[i * sizeof(U32)], sizeof(u));
+			ANKI_TEST_EXPECT_EQ(u, i + 5000);
+		}
+
+		ANKI_TEST_EXPECT_ERR(file.map(sizeof(U32) * COUNT - 1, 2, view), Error::FUNCTION_FAILED);
+
+		file.adviseAccess(sizeof(U32) * 5000, sizeof(U32) * 1000, FileAccessHint::WILL_NEED);
+		file.adviseAccess(1, MAX_PTR_SIZE, FileAccessHint::RANDOM);
+	}
+
+	// Empty files open as regular files
+	{
+		File empty;
+		ANKI_TEST_EXPECT_NO_ERR(empty.open("./mapped_empty.bin", FileOpenFlag::WRITE | FileOpenFlag::BINARY));
+	}
+
+	File empty;
+	ANKI_TEST_EXPECT_NO_ERR(
+		empty.open("./mapped_empty.bin", FileOpenFlag::READ | FileOpenFlag::MMAP | FileOpenFlag::BINARY));
+	ANKI_TEST_EXPECT_EQ(empty.isMapped(), false);
+	ANKI_TEST_EXPECT_EQ(empty.getSize(), 0);
+	ANKI_TEST_EXPECT_ANY_ERR(empty.read(&u, sizeof(u)));
+}
+
+ANKI_TEST(Util, FileMmapBench)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	const PtrSize SIZE = 64_MB;
+
+	{
+		DynamicArrayAuto<U8> data(alloc);
+		data.create(SIZE, 0xAB);
+		File file;
+		ANKI_TEST_EXPECT_NO_ERR(file.open("./mapped_bench.bin", FileOpenFlag::WRITE | FileOpenFlag::BINARY));
+		ANKI_TEST_EXPECT_NO_ERR(file.write(&data[0], SIZE));
+	}
+
+	// What the loaders do. Read the file to a buffer and copy it to the upload memory
+	DynamicArrayAuto<U8> upload(alloc);
+	upload.create(SIZE);
+	HighRezTimer timer;
+	timer.start();
+	{
+		File file;
+		ANKI_TEST_EXPECT_NO_ERR(file.open("./mapped_bench.bin", FileOpenFlag::READ | FileOpenFlag::BINARY));
+		DynamicArrayAuto<U8> buff(alloc);
+		buff.create(SIZE);
+		ANKI_TEST_EXPECT_NO_ERR(file.read(&buff[0], SIZE));
+		memcpy(&upload[0], &buff[0], SIZE);
+	}
+	timer.stop();
+	const F64 readTime = timer.getElapsedTime();
+
+	// Copy from the mapping to the upload memory
+	timer.start();
+	{
+		File file;
+		ANKI_TEST_EXPECT_NO_ERR(
+			file.open("./mapped_bench.bin", FileOpenFlag::READ | FileOpenFlag::MMAP | FileOpenFlag::BINARY));
+		if(file.isMapped())
+		{
+			ConstWeakArray<U8> view;
+			ANKI_TEST_EXPECT_NO_ERR(file.map(0, SIZE, view));
+			memcpy(&upload[0], &view[0], SIZE);
+		}
+	}
+	timer.stop();
+	const F64 mapTime = timer.getElapsedTime();
+
+	ANKI_TEST_EXPECT_EQ(upload[SIZE - 1], 0xAB);
+	ANKI_TEST_LOGI("Loading %uMB: read() and copy %fms, map() and copy %fms",
+		U32(SIZE / 1_MB),
+		readTime * 1000.0,
+		mapTime * 1000.0);
+}
+
 ANKI_TEST(Util, Directory)
 {
 	// Destroy previous
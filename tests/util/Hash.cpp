@@ -0,0 +1,158 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <tests/framework/Framework.h>
+#include <anki/util/Hash.h>
+#include <anki/util/HighRezTimer.h>
+#include <anki/util/FlatHashMap.h>
+#include <random>
+
+ANKI_TEST(Util, Hash)
+{
+	// It's a compile time hash
+	static_assert(computeStringHash("") == 0xcbf29ce484222325ull, "Wrong");
+	static_assert(computeStringHash("a") == 0xaf63dc4c8601ec8cull, "Wrong");
+	static_assert(computeStringHash("abc") != computeStringHash("abd"), "Wrong");
+	ANKI_TEST_EXPECT_EQ(computeStringHash(CString("abc").cstr()), computeStringHash("abc"));
+
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	const PtrSize MAX_SIZE = 3000;
+	DynamicArrayAuto<U8> buff(alloc);
+	buff.create(MAX_SIZE + 1);
+	std::mt19937_64 gen(0);
+	for(U8& b : buff)
+	{
+		b = U8(gen());
+	}
+
+	// Every size takes a different path. Hash all the prefixes of the buffer and expect no collisions
+	{
+		FlatHashMap<U64, PtrSize> hashes;
+		FlatHashMap<U64, PtrSize> hashes128;
+		for(PtrSize size = 0; size <= MAX_SIZE; ++size)
+		{
+			const U64 h = computeHash(&buff[0], size);
+			ANKI_TEST_EXPECT_NEQ(h, 0);
+			ANKI_TEST_EXPECT_EQ(h, computeHash(&buff[0], size));
+			ANKI_TEST_EXPECT_EQ(hashes.find(h) == hashes.getEnd(), true);
+			hashes.emplace(alloc, h, size);
+
+			const Hash128 h128 = computeHash128(&buff[0], size);
+			ANKI_TEST_EXPECT_NEQ(h128.m_low, h128.m_high);
+			ANKI_TEST_EXPECT_EQ(h128 == computeHash128(&buff[0], size), true);
+			ANKI_TEST_EXPECT_EQ(hashes128.find(h128.m_high) == hashes128.getEnd(), true);
+			hashes128.emplace(alloc, h128.m_high, size);
+		}
+
+		hashes.destroy(alloc);
+		hashes128.destroy(alloc);
+	}
+
+	// The alignment of the buffer doesn't matter
+	for(PtrSize size : {0, 3, 7, 15, 16, 100, 240, 241, 1024, 2000})
+	{
+		memmove(&buff[1], &buff[0], size);
+		const U64 unaligned = computeHash(&buff[1], size);
+		const Hash128 unaligned128 = computeHash128(&buff[1], size);
+		memmove(&buff[0], &buff[1], size);
+		ANKI_TEST_EXPECT_EQ(computeHash(&buff[0], size), unaligned);
+		ANKI_TEST_EXPECT_EQ(computeHash128(&buff[0], size) == unaligned128, true);
+	}
+
+	// The seed and every byte change the hash
+	for(PtrSize size : {1, 4, 9, 17, 129, 241, 1025, 2000})
+	{
+		const U64 h = computeHash(&buff[0], size);
+		const Hash128 h128 = computeHash128(&buff[0], size);
+		ANKI_TEST_EXPECT_NEQ(computeHash(&buff[0], size, 1), h);
+		ANKI_TEST_EXPECT_NEQ(appendHash(&buff[0], size, h), h);
+		ANKI_TEST_EXPECT_EQ(computeHash128(&buff[0], size, 1) != h128, true);
+
+		for(PtrSize i = 0; i < size; ++i)
+		{
+			buff[i] ^= 1;
+			ANKI_TEST_EXPECT_NEQ(computeHash(&buff[0], size), h);
+			ANKI_TEST_EXPECT_EQ(computeHash128(&buff[0], size) != h128, true);
+			buff[i] ^= 1;
+		}
+	}
+}
+
+/// The MurmurHash2 the engine used to have. Not inlined so it compares fairly with computeHash.
+static ANKI_DONT_INLINE U64 murmurHash(const void* buffer, PtrSize bufferSize, U64 seed)
+{
+	const U64 m = 0xc6a4a7935bd1e995;
+	const U64 r = 47;
+	U64 h = seed ^ (bufferSize * m);
+
+	const U8* data = static_cast<const U8*>(buffer);
+	const U8* end = data + (bufferSize & ~PtrSize(7));
+	for(; data != end; data += 8)
+	{
+		U64 k;
+		memcpy(&k, data, sizeof(k));
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+		h ^= k;
+		h *= m;
+	}
+
+	const PtrSize rem = bufferSize & 7;
+	if(rem)
+	{
+		for(PtrSize i = 0; i < rem; ++i)
+		{
+			h ^= U64(data[i]) << (8 * i);
+		}
+		h *= m;
+	}
+
+	h ^= h >> r;
+	h *= m;
+	h ^= h >> r;
+	return h;
+}
+
+ANKI_TEST(Util, HashBench)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	const PtrSize BIG_SIZE = 16_MB;
+	DynamicArrayAuto<U8> buff(alloc);
+	buff.create(BIG_SIZE);
+	std::mt19937_64 gen(0);
+	for(U8& b : buff)
+	{
+		b = U8(gen());
+	}
+
+	U64 sum = 0;
+	auto bench = [&](PtrSize size, auto func) -> F64 {
+		const PtrSize iterations = max<PtrSize>(4, 256_MB / max<PtrSize>(size, 64));
+		const PtrSize offsetMask = (size < 1_KB) ? 1_KB - 1 : 0;
+		const Second begin = HighRezTimer::getCurrentTime();
+		for(PtrSize i = 0; i < iterations; ++i)
+		{
+			// Change the input a bit so the loop can't be hoisted
+			sum += func(&buff[i & offsetMask], size);
+		}
+		const Second time = HighRezTimer::getCurrentTime() - begin;
+		return F64(size * iterations) / time / 1_MB;
+	};
+
+	for(PtrSize size : {4, 8, 16, 32, 64, 128, 256, 1024, 64 * 1024, 16 * 1024 * 1024})
+	{
+		const F64 murmur = bench(size, [](const void* p, PtrSize s) { return murmurHash(p, s, 123); });
+		const F64 hash = bench(size, [](const void* p, PtrSize s) { return computeHash(p, s); });
+		const F64 hash128 = bench(size, [](const void* p, PtrSize s) { return computeHash128(p, s).m_low; });
+		ANKI_TEST_LOGI("%8u bytes: MurmurHash2 %9.1fMB/s, computeHash %9.1fMB/s, computeHash128 %9.1fMB/s",
+			U32(size),
+			murmur,
+			hash,
+			hash128);
+	}
+
+	ANKI_TEST_LOGI("(%llu)", sum);
+}
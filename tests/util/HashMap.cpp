@@ -6,6 +6,8 @@
 #include "tests/framework/Framework.h"
 #include "tests/util/Foo.h"
 #include "anki/util/HashMap.h"
+#include "anki/util/FlatHashMap.h"
+#include "anki/util/String.h"
 #include "anki/util/DynamicArray.h"
 #include "anki/util/HighRezTimer.h"
 #include <unordered_map>
@@ -255,3 +257,267 @@ ANKI_TEST(Util, HashMap)
 		akMap.destroy(alloc);
 	}
 }
+
+ANKI_TEST(Util, FlatHashMap)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	// Simple
+	{
+		FlatHashMap<U64, int> map;
+		map.emplace(alloc, 20, 1);
+		map.emplace(alloc, 21, 2);
+		ANKI_TEST_EXPECT_EQ(map.getSize(), 2);
+		ANKI_TEST_EXPECT_EQ(*map.find(U64(20)), 1);
+		ANKI_TEST_EXPECT_EQ(*map.find(U64(21)), 2);
+		ANKI_TEST_EXPECT_EQ(map.find(U64(22)), map.getEnd());
+
+		// Emplacing an existing key doesn't change it
+		auto it = map.emplace(alloc, 20, 123);
+		ANKI_TEST_EXPECT_EQ(*it, 1);
+		ANKI_TEST_EXPECT_EQ(it.getKey(), 20);
+		ANKI_TEST_EXPECT_EQ(map.getSize(), 2);
+
+		map.destroy(alloc);
+		ANKI_TEST_EXPECT_EQ(map.isEmpty(), true);
+	}
+
+	// Keys with the same hash are different keys
+	{
+		class BadHasher
+		{
+		public:
+			U64 operator()(int x) const
+			{
+				return x & 1;
+			}
+		};
+
+		FlatHashMap<int, int, BadHasher> badMap;
+		for(int i = 0; i < 100; ++i)
+		{
+			badMap.emplace(alloc, i, i * 10);
+		}
+
+		for(int i = 0; i < 100; ++i)
+		{
+			ANKI_TEST_EXPECT_EQ(*badMap.find(i), i * 10);
+		}
+		ANKI_TEST_EXPECT_EQ(badMap.find(100), badMap.getEnd());
+
+		for(int i = 0; i < 100; i += 2)
+		{
+			badMap.erase(alloc, badMap.find(i));
+		}
+
+		for(int i = 0; i < 100; ++i)
+		{
+			ANKI_TEST_EXPECT_EQ(badMap.find(i) == badMap.getEnd(), (i % 2) == 0);
+		}
+
+		badMap.destroy(alloc);
+	}
+
+	// Look up String keys with CString
+	{
+		FlatHashMap<StringAuto, int> map;
+		StringAuto a(alloc);
+		a.create("hello");
+		StringAuto b(alloc);
+		b.create("world");
+
+		map.emplace(alloc, a, 1);
+		map.emplace(alloc, b, 2);
+
+		ANKI_TEST_EXPECT_EQ(*map.find(CString("hello")), 1);
+		ANKI_TEST_EXPECT_EQ(*map.find(CString("world")), 2);
+		ANKI_TEST_EXPECT_EQ(map.find(CString("hell")), map.getEnd());
+
+		map.destroy(alloc);
+	}
+
+	// Fuzzy test against the STL
+	{
+		FlatHashMap<U64, U64> map;
+		std::unordered_map<U64, U64> stdMap;
+
+		for(U i = 0; i < 100000; ++i)
+		{
+			const U64 key = rand() % 5000;
+			const U op = rand() % 3;
+			if(op == 0)
+			{
+				map.emplace(alloc, key, key * 2);
+				stdMap.emplace(key, key * 2);
+			}
+			else if(op == 1)
+			{
+				auto it = map.find(key);
+				if(it != map.getEnd())
+				{
+					map.erase(alloc, it);
+				}
+				stdMap.erase(key);
+			}
+			else
+			{
+				auto it = map.find(key);
+				ANKI_TEST_EXPECT_EQ(it != map.getEnd(), stdMap.find(key) != stdMap.end());
+			}
+
+			ANKI_TEST_EXPECT_EQ(map.getSize(), stdMap.size());
+		}
+
+		// Iterate
+		U count = 0;
+		for(auto it = map.getBegin(); it != map.getEnd(); ++it)
+		{
+			ANKI_TEST_EXPECT_EQ(*it, it.getKey() * 2);
+			ANKI_TEST_EXPECT_NEQ(stdMap.find(it.getKey()), stdMap.end());
+			++count;
+		}
+		ANKI_TEST_EXPECT_EQ(count, stdMap.size());
+
+		map.destroy(alloc);
+	}
+}
+
+ANKI_TEST(Util, FlatHashMapBench)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	HighRezTimer timer;
+
+	// Random unique keys. The second half is only used for misses
+	const U COUNT = 1024 * 1024;
+	DynamicArrayAuto<U64> keys(alloc);
+	keys.create(COUNT * 2);
+	{
+		std::unordered_map<U64, int> unique;
+		U64 seed = 0x12345678;
+		for(U i = 0; i < COUNT * 2; ++i)
+		{
+			U64 key;
+			do
+			{
+				seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+				key = seed >> 16;
+			} while(!unique.emplace(key, 0).second);
+
+			keys[i] = key;
+		}
+	}
+
+	SparseArray<U64, U64> sparse;
+	FlatHashMap<U64, U64> flat;
+	std::unordered_map<U64, U64> stl;
+	U64 sum = 0; // To avoid compiler opts
+
+	auto bench = [&](const char* name, auto sparseFunc, auto flatFunc, auto stlFunc) {
+		timer.start();
+		sparseFunc();
+		timer.stop();
+		const Second sparseTime = timer.getElapsedTime();
+
+		timer.start();
+		flatFunc();
+		timer.stop();
+		const Second flatTime = timer.getElapsedTime();
+
+		timer.start();
+		stlFunc();
+		timer.stop();
+		const Second stlTime = timer.getElapsedTime();
+
+		ANKI_TEST_LOGI("%s bench: SparseArray %fns, FlatHashMap %fns, STL %fns",
+			name,
+			sparseTime / COUNT * 1000000000.0,
+			flatTime / COUNT * 1000000000.0,
+			stlTime / COUNT * 1000000000.0);
+	};
+
+	bench("Insert",
+		[&]() {
+			for(U i = 0; i < COUNT; ++i)
+			{
+				sparse.emplace(alloc, keys[i], keys[i]);
+			}
+		},
+		[&]() {
+			for(U i = 0; i < COUNT; ++i)
+			{
+				flat.emplace(alloc, keys[i], keys[i]);
+			}
+		},
+		[&]() {
+			for(U i = 0; i < COUNT; ++i)
+			{
+				stl.emplace(keys[i], keys[i]);
+			}
+		});
+
+	bench("Hit",
+		[&]() {
+			for(U i = 0; i < COUNT; ++i)
+			{
+				sum += *sparse.find(keys[i]);
+			}
+		},
+		[&]() {
+			for(U i = 0; i < COUNT; ++i)
+			{
+				sum += *flat.find(keys[i]);
+			}
+		},
+		[&]() {
+			for(U i = 0; i < COUNT; ++i)
+			{
+				sum += stl.find(keys[i])->second;
+			}
+		});
+
+	bench("Miss",
+		[&]() {
+			for(U i = COUNT; i < COUNT * 2; ++i)
+			{
+				sum += sparse.find(keys[i]) == sparse.getEnd();
+			}
+		},
+		[&]() {
+			for(U i = COUNT; i < COUNT * 2; ++i)
+			{
+				sum += flat.find(keys[i]) == flat.getEnd();
+			}
+		},
+		[&]() {
+			for(U i = COUNT; i < COUNT * 2; ++i)
+			{
+				sum += stl.find(keys[i]) == stl.end();
+			}
+		});
+
+	bench("Erase",
+		[&]() {
+			for(U i = 0; i < COUNT; ++i)
+			{
+				sparse.erase(alloc, sparse.find(keys[i]));
+			}
+		},
+		[&]() {
+			for(U i = 0; i < COUNT; ++i)
+			{
+				flat.erase(alloc, flat.find(keys[i]));
+			}
+		},
+		[&]() {
+			for(U i = 0; i < COUNT; ++i)
+			{
+				stl.erase(stl.find(keys[i]));
+			}
+		});
+
+	ANKI_TEST_EXPECT_EQ(flat.getSize(), 0);
+	ANKI_TEST_LOGI("Checksum %llu", sum);
+
+	sparse.destroy(alloc);
+	flat.destroy(alloc);
+}
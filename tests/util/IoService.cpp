@@ -0,0 +1,297 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <tests/framework/Framework.h>
+#include <anki/util/IoService.h>
+#include <anki/util/HighRezTimer.h>
+#include <anki/util/Hash.h>
+#if ANKI_POSIX
+#	include <fcntl.h>
+#	include <unistd.h>
+#endif
+
+namespace anki
+{
+
+static void writeTestFile(HeapAllocator<U8> alloc, CString filename, U32 wordCount)
+{
+	DynamicArrayAuto<U32> data(alloc);
+	data.create(wordCount);
+	for(U32 i = 0; i < wordCount; ++i)
+	{
+		data[i] = i;
+	}
+
+	File file;
+	ANKI_TEST_EXPECT_NO_ERR(file.open(filename, FileOpenFlag::WRITE | FileOpenFlag::BINARY));
+	ANKI_TEST_EXPECT_NO_ERR(file.write(&data[0], data.getSizeInBytes()));
+}
+
+/// Drop the file from the page cache so the reads hit the disk.
+static void dropFileCache(CString filename)
+{
+#if ANKI_POSIX
+	const int fd = open(filename.cstr(), O_RDONLY);
+	if(fd >= 0)
+	{
+		fdatasync(fd);
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+	}
+#endif
+}
+
+static void ioBatchCallback(void* userData, Error err)
+{
+	static_cast<Atomic<U32>*>(userData)->fetchAdd((err) ? 100 : 1);
+}
+
+ANKI_TEST(Util, IoService)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	const U32 WORD_COUNT = 1024 * 1024;
+	writeTestFile(alloc, "./io_service.bin", WORD_COUNT);
+
+	// Test both io_uring (where available) and the threads
+	for(U forceThreads = 0; forceThreads < 2; ++forceThreads)
+	{
+		IoService io;
+		ANKI_TEST_EXPECT_NO_ERR(io.init(alloc, 3, forceThreads));
+		ANKI_TEST_LOGI("IoService uses io_uring: %u", U32(io.isUsingIoUring()));
+		if(forceThreads)
+		{
+			ANKI_TEST_EXPECT_EQ(io.isUsingIoUring(), false);
+		}
+
+		File cfile;
+		ANKI_TEST_EXPECT_NO_ERR(cfile.open("./io_service.bin", FileOpenFlag::READ | FileOpenFlag::BINARY));
+		File mfile;
+		ANKI_TEST_EXPECT_NO_ERR(
+			mfile.open("./io_service.bin", FileOpenFlag::READ | FileOpenFlag::BINARY | FileOpenFlag::MMAP));
+
+		// Many reads of random parts of both files in a few batches
+		const U32 BATCH_COUNT = 4;
+		const U32 REQUEST_COUNT = 200;
+		DynamicArrayAuto<U32> out(alloc);
+		out.create(BATCH_COUNT * REQUEST_COUNT * 256, 0);
+		DynamicArrayAuto<IoReadRequest> requests(alloc);
+		requests.create(BATCH_COUNT * REQUEST_COUNT);
+		DynamicArrayAuto<U32> firstWords(alloc);
+		firstWords.create(BATCH_COUNT * REQUEST_COUNT);
+
+		for(U32 i = 0; i < requests.getSize(); ++i)
+		{
+			const U32 wordCount = 1 + (i * 7919) % 256;
+			firstWords[i] = (i * 104729) % (WORD_COUNT - wordCount);
+
+			IoReadRequest& req = requests[i];
+			req.m_file = (i % 3) ? &cfile : &mfile;
+			req.m_offset = firstWords[i] * sizeof(U32);
+			req.m_size = wordCount * sizeof(U32);
+			req.m_buffer = &out[i * 256];
+		}
+
+		Array<IoBatch, BATCH_COUNT> batches;
+		Atomic<U32> callbackCount = {0};
+		for(U32 b = 0; b < BATCH_COUNT; ++b)
+		{
+			batches[b].setCallback(ioBatchCallback, &callbackCount);
+			io.submit(ConstWeakArray<IoReadRequest>(&requests[b * REQUEST_COUNT], REQUEST_COUNT), batches[b]);
+		}
+
+		for(IoBatch& batch : batches)
+		{
+			ANKI_TEST_EXPECT_NO_ERR(batch.wait());
+			ANKI_TEST_EXPECT_EQ(batch.isComplete(), true);
+		}
+		ANKI_TEST_EXPECT_EQ(callbackCount.load(), BATCH_COUNT);
+
+		for(U32 i = 0; i < requests.getSize(); ++i)
+		{
+			const U32 wordCount = U32(requests[i].m_size / sizeof(U32));
+			for(U32 w = 0; w < wordCount; ++w)
+			{
+				ANKI_TEST_EXPECT_EQ(out[i * 256 + w], firstWords[i] + w);
+			}
+
+			// The rest is untouched
+			if(wordCount < 256)
+			{
+				ANKI_TEST_EXPECT_EQ(out[i * 256 + wordCount], 0);
+			}
+		}
+
+		// A big read of the whole file. The batch is reused
+		{
+			DynamicArrayAuto<U32> all(alloc);
+			all.create(WORD_COUNT);
+			IoReadRequest req;
+			req.m_file = &cfile;
+			req.m_size = all.getSizeInBytes();
+			req.m_buffer = &all[0];
+			callbackCount.store(0);
+			io.submit(ConstWeakArray<IoReadRequest>(&req, 1), batches[0]);
+			ANKI_TEST_EXPECT_NO_ERR(batches[0].wait());
+			ANKI_TEST_EXPECT_EQ(callbackCount.load(), 1);
+			ANKI_TEST_EXPECT_EQ(all[0], 0);
+			ANKI_TEST_EXPECT_EQ(all[WORD_COUNT - 1], WORD_COUNT - 1);
+		}
+
+		// An empty batch completes at once
+		{
+			IoBatch batch;
+			io.submit(ConstWeakArray<IoReadRequest>(), batch);
+			ANKI_TEST_EXPECT_EQ(batch.isComplete(), true);
+			ANKI_TEST_EXPECT_NO_ERR(batch.wait());
+		}
+
+		// Reads past the end of the files fail and the rest of the batch completes
+		{
+			Array<U32, 16> buff;
+			Array<IoReadRequest, 3> reqs;
+			reqs[0].m_file = &cfile;
+			reqs[0].m_offset = (WORD_COUNT - 8) * sizeof(U32);
+			reqs[0].m_size = sizeof(buff);
+			reqs[0].m_buffer = &buff[0];
+			reqs[1] = reqs[0];
+			reqs[1].m_file = &mfile;
+			reqs[2].m_file = &cfile;
+			reqs[2].m_size = sizeof(U32);
+			reqs[2].m_buffer = &buff[0];
+
+			IoBatch batch;
+			io.submit(ConstWeakArray<IoReadRequest>(&reqs[0], 3), batch);
+			ANKI_TEST_EXPECT_ERR(batch.wait(), Error::FILE_ACCESS);
+			ANKI_TEST_EXPECT_EQ(batch.isComplete(), true);
+		}
+
+		// Submit from many threads while reading
+		{
+			const U32 THREAD_COUNT = 4;
+			class Ctx
+			{
+			public:
+				IoService* m_io;
+				File* m_file;
+				Bool m_fail = false;
+			};
+
+			Array<Ctx, THREAD_COUNT> ctxs;
+			Array<Thread*, THREAD_COUNT> threads;
+			for(U32 t = 0; t < THREAD_COUNT; ++t)
+			{
+				ctxs[t].m_io = &io;
+				ctxs[t].m_file = (t & 1) ? &cfile : &mfile;
+				threads[t] = alloc.newInstance<Thread>("test_io");
+				threads[t]->start(&ctxs[t], [](ThreadCallbackInfo& info) -> Error {
+					Ctx& ctx = *static_cast<Ctx*>(info.m_userData);
+					for(U32 i = 0; i < 100; ++i)
+					{
+						Array<U32, 64> buff;
+						IoReadRequest req;
+						req.m_file = ctx.m_file;
+						req.m_offset = (i * 1000) * sizeof(U32);
+						req.m_size = sizeof(buff);
+						req.m_buffer = &buff[0];
+
+						IoBatch batch;
+						ctx.m_io->submit(ConstWeakArray<IoReadRequest>(&req, 1), batch);
+						ctx.m_fail = ctx.m_fail || batch.wait() || buff[63] != i * 1000 + 63;
+					}
+					return Error::NONE;
+				});
+			}
+
+			for(U32 t = 0; t < THREAD_COUNT; ++t)
+			{
+				ANKI_TEST_EXPECT_NO_ERR(threads[t]->join());
+				alloc.deleteInstance(threads[t]);
+				ANKI_TEST_EXPECT_EQ(ctxs[t].m_fail, false);
+			}
+		}
+	}
+}
+
+ANKI_TEST(Util, IoServiceBench)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	const U32 WORD_COUNT = U32(64_MB / sizeof(U32));
+	const U32 CHUNK_COUNT = 256;
+	const PtrSize CHUNK_SIZE = 64_MB / CHUNK_COUNT;
+	const U32 CHUNKS_PER_BATCH = 16;
+	writeTestFile(alloc, "./io_service_bench.bin", WORD_COUNT);
+
+	DynamicArrayAuto<U8> buff(alloc);
+	buff.create(64_MB);
+	HighRezTimer timer;
+
+	// What the loaders do. Read a chunk and then decode it (here hash it)
+	U64 seqHash = 0;
+	dropFileCache("./io_service_bench.bin");
+	timer.start();
+	{
+		File file;
+		ANKI_TEST_EXPECT_NO_ERR(file.open("./io_service_bench.bin", FileOpenFlag::READ | FileOpenFlag::BINARY));
+		for(U32 i = 0; i < CHUNK_COUNT; ++i)
+		{
+			ANKI_TEST_EXPECT_NO_ERR(file.read(&buff[i * CHUNK_SIZE], CHUNK_SIZE));
+			seqHash ^= computeHash(&buff[i * CHUNK_SIZE], CHUNK_SIZE);
+		}
+	}
+	timer.stop();
+	const F64 seqTime = timer.getElapsedTime();
+
+	// Issue all the reads up front and decode the batches as they complete
+	for(U forceThreads = 0; forceThreads < 2; ++forceThreads)
+	{
+		memset(&buff[0], 0, buff.getSizeInBytes());
+		IoService io;
+		ANKI_TEST_EXPECT_NO_ERR(io.init(alloc, 4, forceThreads));
+
+		U64 ioHash = 0;
+		dropFileCache("./io_service_bench.bin");
+		timer.start();
+		{
+			File file;
+			ANKI_TEST_EXPECT_NO_ERR(file.open("./io_service_bench.bin", FileOpenFlag::READ | FileOpenFlag::BINARY));
+
+			Array<IoReadRequest, CHUNK_COUNT> requests;
+			for(U32 i = 0; i < CHUNK_COUNT; ++i)
+			{
+				requests[i].m_file = &file;
+				requests[i].m_offset = i * CHUNK_SIZE;
+				requests[i].m_size = CHUNK_SIZE;
+				requests[i].m_buffer = &buff[i * CHUNK_SIZE];
+			}
+
+			Array<IoBatch, CHUNK_COUNT / CHUNKS_PER_BATCH> batches;
+			for(U32 b = 0; b < batches.getSize(); ++b)
+			{
+				io.submit(
+					ConstWeakArray<IoReadRequest>(&requests[b * CHUNKS_PER_BATCH], CHUNKS_PER_BATCH), batches[b]);
+			}
+
+			for(U32 b = 0; b < batches.getSize(); ++b)
+			{
+				ANKI_TEST_EXPECT_NO_ERR(batches[b].wait());
+				for(U32 i = b * CHUNKS_PER_BATCH; i < (b + 1) * CHUNKS_PER_BATCH; ++i)
+				{
+					ioHash ^= computeHash(&buff[i * CHUNK_SIZE], CHUNK_SIZE);
+				}
+			}
+		}
+		timer.stop();
+
+		ANKI_TEST_EXPECT_EQ(ioHash, seqHash);
+		ANKI_TEST_LOGI("Loading %u chunks of %uKB: read() and decode %fms, IoService (%s) and decode %fms",
+			CHUNK_COUNT,
+			U32(CHUNK_SIZE / 1_KB),
+			seqTime * 1000.0,
+			(io.isUsingIoUring()) ? "io_uring" : "threads",
+			timer.getElapsedTime() * 1000.0);
+	}
+}
+
+} // end namespace anki
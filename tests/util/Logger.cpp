@@ -0,0 +1,284 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <tests/framework/Framework.h>
+#include <anki/util/Logger.h>
+#include <anki/util/File.h>
+#include <anki/util/HighRezTimer.h>
+#include <anki/util/StringList.h>
+#include <cstdio>
+
+namespace anki
+{
+
+/// Keeps the messages that reach the handlers.
+class LoggerTestSink
+{
+public:
+	Mutex m_mtx;
+	StringListAuto m_messages;
+	Atomic<U32> m_count = {0};
+	Second m_delay = 0.0;
+
+	LoggerTestSink(HeapAllocator<U8> alloc)
+		: m_messages(alloc)
+	{
+	}
+
+	static void handler(void* ud, const Logger::Info& info)
+	{
+		LoggerTestSink& self = *static_cast<LoggerTestSink*>(ud);
+		if(self.m_delay > 0.0)
+		{
+			HighRezTimer::sleep(self.m_delay);
+		}
+
+		LockGuard<Mutex> lock(self.m_mtx);
+		self.m_messages.pushBackSprintf("%s", info.m_msg);
+		self.m_count.fetchAdd(1);
+	}
+
+	void reset()
+	{
+		LockGuard<Mutex> lock(m_mtx);
+		m_messages.destroy();
+		m_count.store(0);
+	}
+
+	Bool contains(CString msg)
+	{
+		LockGuard<Mutex> lock(m_mtx);
+		for(const String& s : m_messages)
+		{
+			if(s == msg)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+#define LOGGER_TEST_WRITE(logger_, type_, ...) \
+	(logger_).writeFormated(ANKI_FILE, __LINE__, ANKI_FUNC, "TEST", Logger::MessageType::type_, __VA_ARGS__)
+
+/// Log from many threads.
+class LoggerTestThread
+{
+public:
+	Logger* m_logger;
+	U32 m_index;
+	U32 m_messageCount;
+	Logger::MessageType m_type;
+};
+
+static Error loggerTestThreadCallback(ThreadCallbackInfo& info)
+{
+	const LoggerTestThread& ctx = *static_cast<const LoggerTestThread*>(info.m_userData);
+	for(U32 i = 0; i < ctx.m_messageCount; ++i)
+	{
+		ctx.m_logger->writeFormated(
+			ANKI_FILE, __LINE__, ANKI_FUNC, "TEST", ctx.m_type, "thread %u message %u", ctx.m_index, i);
+	}
+	return Error::NONE;
+}
+
+static void logFromThreads(HeapAllocator<U8> alloc,
+	Logger& logger,
+	U32 threadCount,
+	U32 messageCount,
+	Logger::MessageType type = Logger::MessageType::ERROR)
+{
+	DynamicArrayAuto<LoggerTestThread> ctxs(alloc);
+	ctxs.create(threadCount);
+	DynamicArrayAuto<Thread*> threads(alloc);
+	threads.create(threadCount);
+	for(U32 t = 0; t < threadCount; ++t)
+	{
+		ctxs[t] = {&logger, t, messageCount, type};
+		threads[t] = alloc.newInstance<Thread>("test_log");
+		threads[t]->start(&ctxs[t], loggerTestThreadCallback);
+	}
+
+	for(U32 t = 0; t < threadCount; ++t)
+	{
+		ANKI_TEST_EXPECT_NO_ERR(threads[t]->join());
+		alloc.deleteInstance(threads[t]);
+	}
+}
+
+ANKI_TEST(Util, Logger)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	LoggerTestSink sink(alloc);
+	Logger logger;
+	logger.removeDefaultMessageHandler();
+	logger.addMessageHandler(&sink, &LoggerTestSink::handler);
+
+	// Synchronous, the handlers run before the write returns
+	LOGGER_TEST_WRITE(logger, NORMAL, "sync %u", 1);
+	ANKI_TEST_EXPECT_EQ(sink.m_count.load(), 1);
+	ANKI_TEST_EXPECT_EQ(sink.contains("sync 1"), true);
+	sink.reset();
+
+	// Async from many threads. The errors are not dropped even if the ring buffer is small and the messages of a
+	// thread keep their order
+	{
+		logger.startAsync(64, 0);
+		ANKI_TEST_EXPECT_EQ(logger.isAsync(), true);
+
+		const U32 THREAD_COUNT = 4;
+		const U32 MESSAGE_COUNT = 2000;
+		logFromThreads(alloc, logger, THREAD_COUNT, MESSAGE_COUNT);
+		logger.flush();
+		ANKI_TEST_EXPECT_EQ(sink.m_count.load(), THREAD_COUNT * MESSAGE_COUNT);
+
+		Array<I32, THREAD_COUNT> lastMessage;
+		for(I32& i : lastMessage)
+		{
+			i = -1;
+		}
+		for(const String& msg : sink.m_messages)
+		{
+			U32 t, i;
+			ANKI_TEST_EXPECT_EQ(sscanf(msg.cstr(), "thread %u message %u", &t, &i), 2);
+			ANKI_TEST_EXPECT_EQ(I32(i), lastMessage[t] + 1);
+			lastMessage[t] = I32(i);
+		}
+		sink.reset();
+
+		// Long messages don't fit in the ring buffer but they arrive whole
+		StringAuto longMsg(alloc);
+		longMsg.create('x', 3000);
+		LOGGER_TEST_WRITE(logger, NORMAL, "%s", longMsg.cstr());
+		logger.write(ANKI_FILE, __LINE__, ANKI_FUNC, "TEST", Logger::MessageType::NORMAL, longMsg.cstr());
+		logger.flush();
+		ANKI_TEST_EXPECT_EQ(sink.m_count.load(), 2);
+		ANKI_TEST_EXPECT_EQ(sink.contains(longMsg.toCString()), true);
+		sink.reset();
+
+		// Repeated messages are written once with a count
+		for(U32 i = 0; i < 100; ++i)
+		{
+			LOGGER_TEST_WRITE(logger, ERROR, "Not enough space");
+		}
+		LOGGER_TEST_WRITE(logger, ERROR, "Something else");
+		logger.flush();
+		ANKI_TEST_EXPECT_EQ(sink.m_count.load(), 3);
+		ANKI_TEST_EXPECT_EQ(sink.contains("Not enough space"), true);
+		ANKI_TEST_EXPECT_EQ(sink.contains("The previous message was repeated 99 times"), true);
+		ANKI_TEST_EXPECT_EQ(sink.contains("Something else"), true);
+		sink.reset();
+
+		// The flush writes the pending repeats
+		for(U32 i = 0; i < 2; ++i)
+		{
+			LOGGER_TEST_WRITE(logger, WARNING, "Again");
+		}
+		logger.flush();
+		ANKI_TEST_EXPECT_EQ(sink.m_count.load(), 2);
+		ANKI_TEST_EXPECT_EQ(sink.contains("The previous message was repeated 1 times"), true);
+		sink.reset();
+
+		logger.stopAsync();
+		ANKI_TEST_EXPECT_EQ(logger.isAsync(), false);
+	}
+
+	// Rate limiting
+	{
+		logger.startAsync(1024, 10);
+		const Second begin = HighRezTimer::getCurrentTime();
+		for(U32 i = 0; i < 100; ++i)
+		{
+			LOGGER_TEST_WRITE(logger, NORMAL, "rate %u", i);
+		}
+		const Bool sameSecond = U32(begin) == U32(HighRezTimer::getCurrentTime());
+		logger.flush();
+		ANKI_TEST_EXPECT_LEQ(sink.m_count.load(), 20);
+		ANKI_TEST_EXPECT_GEQ(sink.m_count.load(), 10);
+		if(sameSecond)
+		{
+			ANKI_TEST_EXPECT_EQ(sink.m_count.load(), 10);
+		}
+		sink.reset();
+
+		// Other lines are not affected
+		LOGGER_TEST_WRITE(logger, NORMAL, "other line");
+		logger.flush();
+		ANKI_TEST_EXPECT_EQ(sink.contains("other line"), true);
+		sink.reset();
+
+		logger.stopAsync();
+	}
+
+	// Messages are dropped if the ring buffer is full and the handlers are slow
+	{
+		logger.startAsync(4, 0);
+		sink.m_delay = 0.001;
+		logFromThreads(alloc, logger, 2, 100, Logger::MessageType::NORMAL);
+		logger.flush();
+		sink.m_delay = 0.0;
+
+		ANKI_TEST_EXPECT_LT(sink.m_count.load(), 200);
+		Bool foundDropped = false;
+		for(const String& msg : sink.m_messages)
+		{
+			foundDropped = foundDropped || msg.find("messages were dropped") != String::NPOS;
+		}
+		ANKI_TEST_EXPECT_EQ(foundDropped, true);
+		sink.reset();
+
+		logger.stopAsync();
+	}
+
+	// Stopping writes the rest
+	{
+		logger.startAsync(1024, 0);
+		sink.m_delay = 0.0001;
+		logFromThreads(alloc, logger, 2, 100);
+		logger.stopAsync();
+		sink.m_delay = 0.0;
+		ANKI_TEST_EXPECT_EQ(sink.m_count.load(), 200);
+	}
+}
+
+ANKI_TEST(Util, LoggerBench)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	const U32 THREAD_COUNT = 8;
+	const U32 MESSAGE_COUNT = 5000;
+
+	// The threads log to a file while they work. Compare the time they spend logging
+	Array<Second, 2> times;
+	for(U32 async = 0; async < 2; ++async)
+	{
+		File file;
+		ANKI_TEST_EXPECT_NO_ERR(file.open("./logger_bench.txt", FileOpenFlag::WRITE));
+
+		Logger logger;
+		logger.removeDefaultMessageHandler();
+		logger.addFileMessageHandler(&file);
+		if(async)
+		{
+			logger.startAsync(16 * 1024, 0);
+		}
+
+		HighRezTimer timer;
+		timer.start();
+		logFromThreads(alloc, logger, THREAD_COUNT, MESSAGE_COUNT, Logger::MessageType::WARNING);
+		timer.stop();
+		times[async] = timer.getElapsedTime();
+
+		logger.stopAsync();
+	}
+
+	ANKI_TEST_LOGI("%u threads logging %u messages each to a file: sync %fms, async %fms",
+		THREAD_COUNT,
+		MESSAGE_COUNT,
+		times[0] * 1000.0,
+		times[1] * 1000.0);
+}
+
+} // end namespace anki
@@ -7,6 +7,9 @@
 #include "tests/util/Foo.h"
 #include "anki/util/Memory.h"
 #include "anki/util/ThreadPool.h"
+#include "anki/util/HighRezTimer.h"
+#include "anki/util/System.h"
+#include "anki/util/DynamicArray.h"
 #include <type_traits>
 #include <cstring>
 
@@ -218,3 +221,225 @@ ANKI_TEST(Util, ChainMemoryPool)
 		ANKI_TEST_EXPECT_EQ(pool.getChunksCount(), 0);
 	}
 }
+
+ANKI_TEST(Util, ThreadCachingMemoryPool)
+{
+	// Sizes and alignments
+	{
+		ThreadCachingMemoryPool pool;
+		pool.create(allocAligned, nullptr);
+
+		Array<PtrSize, 8> sizes = {{1, 16, 17, 100, 129, 1000, 8_KB, 100_KB}};
+		Array<PtrSize, 4> alignments = {{1, 16, 64, 256}};
+		Array<void*, sizes.getSize() * alignments.getSize()> ptrs;
+
+		U count = 0;
+		for(PtrSize size : sizes)
+		{
+			for(PtrSize alignment : alignments)
+			{
+				void* ptr = pool.allocate(size, alignment);
+				ANKI_TEST_EXPECT_NEQ(ptr, nullptr);
+				ANKI_TEST_EXPECT_EQ(isAligned(alignment, ptr), true);
+				memset(ptr, U8(count), size);
+				ptrs[count++] = ptr;
+			}
+		}
+
+		ANKI_TEST_EXPECT_EQ(pool.getAllocationsCount(), ptrs.getSize());
+
+		// Check that they don't overlap
+		count = 0;
+		for(PtrSize size : sizes)
+		{
+			for(U i = 0; i < alignments.getSize(); ++i)
+			{
+				const U8* ptr = static_cast<const U8*>(ptrs[count]);
+				ANKI_TEST_EXPECT_EQ(ptr[0], U8(count));
+				ANKI_TEST_EXPECT_EQ(ptr[size - 1], U8(count));
+				++count;
+			}
+		}
+
+		for(void* ptr : ptrs)
+		{
+			pool.free(ptr);
+		}
+
+		ANKI_TEST_EXPECT_EQ(pool.getAllocationsCount(), 0);
+	}
+
+	// The freed chunks are reused
+	{
+		ThreadCachingMemoryPool pool;
+		pool.create(allocAligned, nullptr);
+
+		for(U i = 0; i < 10000; ++i)
+		{
+			void* a = pool.allocate(48, 16);
+			void* b = pool.allocate(48, 16);
+			pool.free(a);
+			pool.free(b);
+		}
+
+		ANKI_TEST_EXPECT_EQ(pool.getSlabMemorySize(), 64_KB);
+	}
+
+	// Allocate in some threads and free in others
+	{
+		ThreadCachingMemoryPool pool;
+		pool.create(allocAligned, nullptr);
+
+		const U THREAD_COUNT = 8;
+		const U ALLOCATION_COUNT = 2000;
+		ThreadPool threadPool(THREAD_COUNT);
+
+		class Task : public ThreadPoolTask
+		{
+		public:
+			ThreadCachingMemoryPool* m_pool = nullptr;
+			Array<void*, ALLOCATION_COUNT> m_ptrs;
+			Array<void*, ALLOCATION_COUNT>* m_ptrsToFree = nullptr;
+
+			Error operator()(U32 taskId, PtrSize threadsCount)
+			{
+				if(m_ptrsToFree)
+				{
+					for(void* ptr : *m_ptrsToFree)
+					{
+						if(*static_cast<U32*>(ptr) != ptrToNumber(ptr) % MAX_U32)
+						{
+							return Error::FUNCTION_FAILED;
+						}
+						m_pool->free(ptr);
+					}
+				}
+
+				for(U i = 0; i < ALLOCATION_COUNT; ++i)
+				{
+					void* ptr = m_pool->allocate(4 + (i * 7) % 300, 4);
+					*static_cast<U32*>(ptr) = ptrToNumber(ptr) % MAX_U32;
+					m_ptrs[i] = ptr;
+				}
+
+				return Error::NONE;
+			}
+		};
+
+		Array<Task, THREAD_COUNT> tasks;
+		for(U i = 0; i < THREAD_COUNT; ++i)
+		{
+			tasks[i].m_pool = &pool;
+			threadPool.assignNewTask(i, &tasks[i]);
+		}
+		ANKI_TEST_EXPECT_NO_ERR(threadPool.waitForAllThreadsToFinish());
+		ANKI_TEST_EXPECT_EQ(pool.getAllocationsCount(), THREAD_COUNT * ALLOCATION_COUNT);
+
+		// Every thread frees the allocations of its neighbour
+		Array<Array<void*, ALLOCATION_COUNT>, THREAD_COUNT> ptrs;
+		for(U i = 0; i < THREAD_COUNT; ++i)
+		{
+			ptrs[i] = tasks[(i + 1) % THREAD_COUNT].m_ptrs;
+		}
+
+		for(U i = 0; i < THREAD_COUNT; ++i)
+		{
+			tasks[i].m_ptrsToFree = &ptrs[i];
+			threadPool.assignNewTask(i, &tasks[i]);
+		}
+		ANKI_TEST_EXPECT_NO_ERR(threadPool.waitForAllThreadsToFinish());
+		ANKI_TEST_EXPECT_EQ(pool.getAllocationsCount(), THREAD_COUNT * ALLOCATION_COUNT);
+
+		for(Task& task : tasks)
+		{
+			for(void* ptr : task.m_ptrs)
+			{
+				pool.free(ptr);
+			}
+		}
+		ANKI_TEST_EXPECT_EQ(pool.getAllocationsCount(), 0);
+	}
+}
+
+template<typename TPool>
+static Second benchmarkMemoryPool(TPool& pool, U threadCount)
+{
+	const U ITERATIONS = 200000;
+	const U LIVE_ALLOCATION_COUNT = 256;
+	ThreadPool threadPool(threadCount);
+
+	class Task : public ThreadPoolTask
+	{
+	public:
+		TPool* m_pool = nullptr;
+
+		Error operator()(U32 taskId, PtrSize threadsCount)
+		{
+			// Keep a window of live allocations of mixed sizes and replace one every iteration
+			Array<void*, LIVE_ALLOCATION_COUNT> ptrs;
+			for(void*& ptr : ptrs)
+			{
+				ptr = nullptr;
+			}
+
+			U32 seed = taskId + 1;
+			for(U i = 0; i < ITERATIONS; ++i)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				void*& ptr = ptrs[(seed >> 8) % LIVE_ALLOCATION_COUNT];
+				if(ptr)
+				{
+					m_pool->free(ptr);
+				}
+
+				const PtrSize size = ((seed >> 20) & 3) ? 8 + (seed >> 24) : 256 + (seed >> 16) % 2048;
+				ptr = m_pool->allocate(size, 16);
+				*static_cast<U8*>(ptr) = 1;
+			}
+
+			for(void* ptr : ptrs)
+			{
+				if(ptr)
+				{
+					m_pool->free(ptr);
+				}
+			}
+
+			return Error::NONE;
+		}
+	};
+
+	DynamicArrayAuto<Task> tasks(HeapAllocator<U8>(allocAligned, nullptr));
+	tasks.create(threadCount);
+
+	const Second begin = HighRezTimer::getCurrentTime();
+	for(U i = 0; i < threadCount; ++i)
+	{
+		tasks[i].m_pool = &pool;
+		threadPool.assignNewTask(i, &tasks[i]);
+	}
+	ANKI_TEST_EXPECT_NO_ERR(threadPool.waitForAllThreadsToFinish());
+
+	return (HighRezTimer::getCurrentTime() - begin) / (ITERATIONS * threadCount) * 1000000000.0;
+}
+
+ANKI_TEST(Util, MemoryPoolBench)
+{
+	const Array<U, 2> threadCounts = {{1, max<U>(2, getCpuCoresCount())}};
+
+	for(U threads : threadCounts)
+	{
+		HeapMemoryPool heapPool;
+		heapPool.create(allocAligned, nullptr);
+		const Second heapTime = benchmarkMemoryPool(heapPool, threads);
+
+		ThreadCachingMemoryPool threadCachingPool;
+		threadCachingPool.create(allocAligned, nullptr);
+		const Second threadCachingTime = benchmarkMemoryPool(threadCachingPool, threads);
+
+		ANKI_TEST_LOGI("%u threads: HeapMemoryPool %fns, ThreadCachingMemoryPool %fns per allocation and free",
+			threads,
+			heapTime,
+			threadCachingTime);
+	}
+}
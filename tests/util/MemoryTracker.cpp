@@ -0,0 +1,123 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <tests/framework/Framework.h>
+#include <anki/util/MemoryTracker.h>
+#include <anki/util/File.h>
+
+ANKI_TEST(Util, MemoryTracker)
+{
+	MemoryTracker tracker;
+	tracker.init("test", allocAligned, nullptr);
+
+	const AllocAlignedCallback allocCb = tracker.getAllocationCallback();
+	void* allocCbUserData = tracker.getAllocationCallbackUserData();
+
+	// Allocate and check the alignment
+	void* a = allocCb(allocCbUserData, nullptr, 100, 8);
+	void* b = allocCb(allocCbUserData, nullptr, 128, 16);
+	void* c = allocCb(allocCbUserData, nullptr, 1000, 64);
+	ANKI_TEST_EXPECT_EQ(isAligned(8, a), true);
+	ANKI_TEST_EXPECT_EQ(isAligned(16, b), true);
+	ANKI_TEST_EXPECT_EQ(isAligned(64, c), true);
+	memset(c, 0xFF, 1000);
+
+	MemoryTrackerStats stats = tracker.getStats();
+	ANKI_TEST_EXPECT_EQ(stats.m_liveBytes, 100 + 128 + 1000);
+	ANKI_TEST_EXPECT_EQ(stats.m_peakBytes, 100 + 128 + 1000);
+	ANKI_TEST_EXPECT_EQ(stats.m_allocationCount, 3);
+
+	tracker.newFrame();
+	stats = tracker.getStats();
+	ANKI_TEST_EXPECT_EQ(stats.m_frameAllocationCount, 3);
+	ANKI_TEST_EXPECT_EQ(stats.m_frameAllocatedBytes, 100 + 128 + 1000);
+
+	// Free some, the peak stays
+	allocCb(allocCbUserData, c, 0, 0);
+	allocCb(allocCbUserData, b, 0, 0);
+	stats = tracker.getStats();
+	ANKI_TEST_EXPECT_EQ(stats.m_peakBytes, 100 + 128 + 1000);
+	ANKI_TEST_EXPECT_EQ(stats.m_liveBytes, 100);
+	ANKI_TEST_EXPECT_EQ(stats.m_freeCount, 2);
+
+	// Nothing allocated in that frame
+	tracker.newFrame();
+	stats = tracker.getStats();
+	ANKI_TEST_EXPECT_EQ(stats.m_frameAllocationCount, 0);
+	ANKI_TEST_EXPECT_EQ(stats.m_frameAllocatedBytes, 0);
+
+	// Use it with a pool
+	{
+		HeapAllocator<U8> alloc(allocCb, allocCbUserData);
+		DynamicArrayAuto<U32> arr(alloc);
+		arr.create(1000);
+		ANKI_TEST_EXPECT_GEQ(tracker.getStats().m_liveBytes, 100 + 1000 * sizeof(U32));
+	}
+
+	allocCb(allocCbUserData, a, 0, 0);
+	stats = tracker.getStats();
+	ANKI_TEST_EXPECT_EQ(stats.m_liveBytes, 0);
+	ANKI_TEST_EXPECT_EQ(stats.m_allocationCount, stats.m_freeCount);
+}
+
+ANKI_TEST(Util, MemoryTrackerAllocationLog)
+{
+	MemoryTracker tracker;
+	tracker.init("test", allocAligned, nullptr);
+	tracker.enableAllocationLog(1);
+
+	const AllocAlignedCallback allocCb = tracker.getAllocationCallback();
+	void* allocCbUserData = tracker.getAllocationCallbackUserData();
+
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	auto readFile = [&](CString fname, StringAuto& txt) {
+		File file;
+		ANKI_TEST_EXPECT_NO_ERR(file.open(fname, FileOpenFlag::READ));
+		ANKI_TEST_EXPECT_NO_ERR(file.readAllText(txt));
+	};
+
+	// Allocate from the same place twice and then from another place. Don't let the compiler unroll the loop
+	Array<void*, 3> ptrs;
+	volatile U count = 2;
+	for(U i = 0; i < count; ++i)
+	{
+		ptrs[i] = allocCb(allocCbUserData, nullptr, 64, 16);
+	}
+
+	tracker.newFrame();
+	ptrs[2] = allocCb(allocCbUserData, nullptr, 32, 16);
+
+	ANKI_TEST_EXPECT_NO_ERR(tracker.dumpAllocationLog("./memory.log"));
+	{
+		StringAuto txt(alloc);
+		readFile("./memory.log", txt);
+		ANKI_TEST_EXPECT_NEQ(txt.find("2 allocations, 128 bytes, oldest in frame 0"), String::NPOS);
+		ANKI_TEST_EXPECT_NEQ(txt.find("1 allocations, 32 bytes, oldest in frame 1"), String::NPOS);
+	}
+
+	// Only the allocations after a frame
+	ANKI_TEST_EXPECT_NO_ERR(tracker.dumpAllocationLog("./memory.log", 1));
+	{
+		StringAuto txt(alloc);
+		readFile("./memory.log", txt);
+		ANKI_TEST_EXPECT_EQ(txt.find("2 allocations"), String::NPOS);
+		ANKI_TEST_EXPECT_NEQ(txt.find("1 allocations, 32 bytes"), String::NPOS);
+	}
+
+	// The freed allocations disappear from the log
+	for(void* ptr : ptrs)
+	{
+		allocCb(allocCbUserData, ptr, 0, 0);
+	}
+
+	ANKI_TEST_EXPECT_NO_ERR(tracker.dumpAllocationLog("./memory.log"));
+	{
+		StringAuto txt(alloc);
+		readFile("./memory.log", txt);
+		ANKI_TEST_EXPECT_EQ(txt.find("stack"), String::NPOS);
+	}
+
+	ANKI_TEST_EXPECT_EQ(tracker.getStats().m_liveBytes, 0);
+}
@@ -5,6 +5,7 @@
 
 #include "tests/framework/Framework.h"
 #include "anki/util/String.h"
+#include "anki/util/StringList.h"
 #include <string>
 
 namespace anki
@@ -209,4 +210,122 @@ ANKI_TEST(Util, String)
 	}
 }
 
+/// Count the allocations that go through an allocator.
+static void* countingAllocAligned(void* userData, void* ptr, PtrSize size, PtrSize alignment)
+{
+	if(ptr == nullptr)
+	{
+		++*static_cast<U32*>(userData);
+	}
+
+	return allocAligned(nullptr, ptr, size, alignment);
+}
+
+ANKI_TEST(Util, StringInline)
+{
+	U32 allocCount = 0;
+	HeapAllocator<U8> alloc(countingAllocAligned, &allocCount);
+	allocCount = 0; // Ignore the pool
+
+	// Basics
+	{
+		StringInline<16> a(alloc);
+		ANKI_TEST_EXPECT_EQ(a.isEmpty(), true);
+		ANKI_TEST_EXPECT_EQ(a.toCString(), "");
+
+		a.create("123");
+		ANKI_TEST_EXPECT_EQ(a, "123");
+		ANKI_TEST_EXPECT_EQ(a.getLength(), 3);
+		ANKI_TEST_EXPECT_EQ(a.end() - a.begin(), 3);
+
+		a.append("456");
+		ANKI_TEST_EXPECT_EQ(a, "123456");
+		ANKI_TEST_EXPECT_EQ(a.find("45"), 3);
+		ANKI_TEST_EXPECT_EQ(a.computeHash(), CString("123456").computeHash());
+
+		U32 n;
+		ANKI_TEST_EXPECT_NO_ERR(a.toNumber(n));
+		ANKI_TEST_EXPECT_EQ(n, 123456);
+
+		a.destroy();
+		a.sprintf("%s-%d", "abc", 12);
+		ANKI_TEST_EXPECT_EQ(a, "abc-12");
+
+		a.destroy();
+		a.create('x', 3);
+		ANKI_TEST_EXPECT_EQ(a, "xxx");
+		ANKI_TEST_EXPECT_EQ(a.isInline(), true);
+		ANKI_TEST_EXPECT_EQ(allocCount, 0);
+	}
+
+	// Spill
+	{
+		StringInline<8> a(alloc, "1234567");
+		ANKI_TEST_EXPECT_EQ(a.isInline(), true);
+		a.append("8");
+		ANKI_TEST_EXPECT_EQ(a.isInline(), false);
+		ANKI_TEST_EXPECT_EQ(a, "12345678");
+		ANKI_TEST_EXPECT_EQ(allocCount, 1);
+
+		a.append("9abcdefghijklmnopqrstuvwxyz");
+		ANKI_TEST_EXPECT_EQ(a, "123456789abcdefghijklmnopqrstuvwxyz");
+
+		a.destroy();
+		ANKI_TEST_EXPECT_EQ(a.isInline(), true);
+		a.sprintf("%s%s", "0123456789", "0123456789");
+		ANKI_TEST_EXPECT_EQ(a, "01234567890123456789");
+		ANKI_TEST_EXPECT_EQ(a.getLength(), 20);
+	}
+
+	// Compare the allocations with StringAuto for lines like the ones of the shaders
+	{
+		const Array<CString, 4> lines = {{"#pragma anki mutator INSTANCE_COUNT 1 2 4 8 16 32 64",
+			"#pragma anki input const Vec3 diffColor \"DIFFUSE_TEX == 0\"",
+			"#include <shaders/MaterialCommon.glsl>",
+			"#pragma anki start frag"}};
+		const U ITERATIONS = 100;
+
+		allocCount = 0;
+		for(U i = 0; i < ITERATIONS; ++i)
+		{
+			for(CString line : lines)
+			{
+				StringAuto copy(alloc, line);
+				StringListAuto tokens(alloc);
+				tokens.splitString(copy.toCString(), ' ');
+			}
+		}
+		const U32 autoAllocCount = allocCount;
+
+		allocCount = 0;
+		for(U i = 0; i < ITERATIONS; ++i)
+		{
+			for(CString line : lines)
+			{
+				StringInline<256> copy(alloc, line);
+				DynamicArrayInline<CString, 16> tokens(alloc);
+				for(char& c : copy)
+				{
+					if(c == ' ')
+					{
+						c = '\0';
+					}
+					else if(&c == copy.begin() || (&c)[-1] == '\0')
+					{
+						tokens.emplaceBack(&c);
+					}
+				}
+			}
+		}
+		const U32 inlineAllocCount = allocCount;
+
+		ANKI_TEST_LOGI("Tokenizing %u lines: StringAuto %u allocations, StringInline %u allocations",
+			U32(ITERATIONS * lines.getSize()),
+			autoAllocCount,
+			inlineAllocCount);
+		ANKI_TEST_EXPECT_GT(autoAllocCount, U32(ITERATIONS * lines.getSize()));
+		ANKI_TEST_EXPECT_EQ(inlineAllocCount, 0);
+	}
+}
+
 } // end namespace anki
@@ -0,0 +1,227 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <tests/framework/Framework.h>
+#include <anki/util/StringTable.h>
+#include <anki/util/ThreadPool.h>
+#include <anki/util/HighRezTimer.h>
+#include <anki/util/FlatHashMap.h>
+#include <string>
+#include <unordered_map>
+
+ANKI_TEST(Util, StringTable)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	// Simple
+	{
+		StringTable table;
+		ANKI_TEST_EXPECT_EQ(table.getSize(), 1);
+
+		const StringId a = table.intern("a");
+		const StringId b = table.intern("bbbb");
+		ANKI_TEST_EXPECT_NEQ(a, b);
+		ANKI_TEST_EXPECT_EQ(table.intern("a"), a);
+		StringAuto bCopy(alloc);
+		bCopy.create("bbbb");
+		ANKI_TEST_EXPECT_EQ(table.intern(bCopy.toCString()), b);
+		ANKI_TEST_EXPECT_EQ(table.getString(a), "a");
+		ANKI_TEST_EXPECT_EQ(table.getString(b), "bbbb");
+		ANKI_TEST_EXPECT_EQ(table.getLength(b), 4);
+		ANKI_TEST_EXPECT_EQ(table.getHash(b), computeHash("bbbb", 4));
+		ANKI_TEST_EXPECT_EQ(table.getSize(), 3);
+
+		// The empty string is the default handle
+		ANKI_TEST_EXPECT_EQ(table.intern(""), StringId());
+		ANKI_TEST_EXPECT_EQ(table.intern(CString()), StringId());
+		ANKI_TEST_EXPECT_EQ(table.getString(StringId()).isEmpty(), true);
+		ANKI_TEST_EXPECT_EQ(table.getLength(StringId()), 0);
+
+		StringId id;
+		ANKI_TEST_EXPECT_EQ(table.find("a", id), true);
+		ANKI_TEST_EXPECT_EQ(id, a);
+		ANKI_TEST_EXPECT_EQ(table.find("c", id), false);
+
+		// Many strings, short and long. The strings don't move
+		const char* aStr = table.getString(a).cstr();
+		for(U i = 0; i < 20000; ++i)
+		{
+			StringAuto str(alloc);
+			str.sprintf("string_%u", i);
+			if(i % 1000 == 0)
+			{
+				// Bigger than a chunk
+				StringAuto big(alloc);
+				big.create('x', 100000);
+				str.append(big);
+			}
+
+			const StringId newId = table.intern(str.toCString());
+			ANKI_TEST_EXPECT_EQ(newId.getIndex(), i + 3);
+			ANKI_TEST_EXPECT_EQ(table.getString(newId), str.toCString());
+		}
+		ANKI_TEST_EXPECT_EQ(table.getString(a).cstr(), aStr);
+		ANKI_TEST_EXPECT_EQ(table.find("string_19999", id), true);
+		ANKI_TEST_EXPECT_EQ(table.getString(id), "string_19999");
+	}
+
+	// Intern from many threads
+	{
+		StringTable table;
+		const U THREAD_COUNT = 8;
+		const U STRING_COUNT = 10000;
+		ThreadPool threadPool(THREAD_COUNT);
+
+		class Task : public ThreadPoolTask
+		{
+		public:
+			StringTable* m_table = nullptr;
+			HeapAllocator<U8> m_alloc;
+			DynamicArray<StringId> m_ids;
+			Bool m_fail = false;
+
+			Error operator()(U32 taskId, PtrSize threadsCount)
+			{
+				m_ids.create(m_alloc, STRING_COUNT);
+
+				// All threads race to add the same strings in different orders
+				for(U i = 0; i < STRING_COUNT; ++i)
+				{
+					const U idx = (taskId & 1) ? i : (STRING_COUNT - i - 1);
+					StringAuto str(m_alloc);
+					str.sprintf("name_%u", idx);
+					m_ids[idx] = m_table->intern(str.toCString());
+					m_fail = m_fail || m_table->getString(m_ids[idx]) != str.toCString();
+				}
+
+				return Error::NONE;
+			}
+		};
+
+		Array<Task, THREAD_COUNT> tasks;
+		for(U i = 0; i < THREAD_COUNT; ++i)
+		{
+			tasks[i].m_table = &table;
+			tasks[i].m_alloc = alloc;
+			threadPool.assignNewTask(i, &tasks[i]);
+		}
+		ANKI_TEST_EXPECT_NO_ERR(threadPool.waitForAllThreadsToFinish());
+
+		ANKI_TEST_EXPECT_EQ(table.getSize(), STRING_COUNT + 1);
+		for(Task& task : tasks)
+		{
+			ANKI_TEST_EXPECT_EQ(task.m_fail, false);
+			for(U i = 0; i < STRING_COUNT; ++i)
+			{
+				ANKI_TEST_EXPECT_EQ(task.m_ids[i], tasks[0].m_ids[i]);
+			}
+		}
+
+		for(Task& task : tasks)
+		{
+			task.m_ids.destroy(alloc);
+		}
+	}
+}
+
+ANKI_TEST(Util, StringTableBench)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	const U NAME_COUNT = 100000;
+
+	// Names that look like resource filenames
+	DynamicArrayAuto<String> names(alloc);
+	names.create(NAME_COUNT);
+	for(U i = 0; i < NAME_COUNT; ++i)
+	{
+		names[i].sprintf(alloc, "assets/models/level_%u/mesh_%u_lod0.ankimesh", i % 97, i);
+	}
+
+	HighRezTimer timer;
+	StringTable table;
+	std::unordered_map<std::string, U32> stlMap;
+	DynamicArrayAuto<StringId> ids(alloc);
+	ids.create(NAME_COUNT);
+
+	// Insert
+	timer.start();
+	for(U i = 0; i < NAME_COUNT; ++i)
+	{
+		ids[i] = table.intern(names[i].toCString());
+	}
+	timer.stop();
+	const F64 internInsertTime = timer.getElapsedTime() / NAME_COUNT * 1000000000.0;
+
+	timer.start();
+	for(U i = 0; i < NAME_COUNT; ++i)
+	{
+		stlMap.emplace(names[i].cstr(), i);
+	}
+	timer.stop();
+	const F64 stlInsertTime = timer.getElapsedTime() / NAME_COUNT * 1000000000.0;
+
+	// Lookup by string
+	U64 sum = 0;
+	timer.start();
+	for(U i = 0; i < NAME_COUNT; ++i)
+	{
+		StringId id;
+		sum += table.find(names[(i * 7919) % NAME_COUNT].toCString(), id);
+		sum += id.getIndex();
+	}
+	timer.stop();
+	const F64 internLookupTime = timer.getElapsedTime() / NAME_COUNT * 1000000000.0;
+
+	timer.start();
+	for(U i = 0; i < NAME_COUNT; ++i)
+	{
+		sum += stlMap.find(names[(i * 7919) % NAME_COUNT].cstr())->second;
+	}
+	timer.stop();
+	const F64 stlLookupTime = timer.getElapsedTime() / NAME_COUNT * 1000000000.0;
+
+	// What the resource managers and the scene do. Find an object by its name
+	FlatHashMap<CString, U32> stringMap;
+	FlatHashMap<StringId, U32> idMap;
+	for(U i = 0; i < NAME_COUNT; ++i)
+	{
+		stringMap.emplace(alloc, names[i].toCString(), i);
+		idMap.emplace(alloc, ids[i], i);
+	}
+
+	timer.start();
+	for(U i = 0; i < NAME_COUNT; ++i)
+	{
+		sum += *stringMap.find(names[(i * 7919) % NAME_COUNT].toCString());
+	}
+	timer.stop();
+	const F64 stringMapTime = timer.getElapsedTime() / NAME_COUNT * 1000000000.0;
+
+	timer.start();
+	for(U i = 0; i < NAME_COUNT; ++i)
+	{
+		sum += *idMap.find(ids[(i * 7919) % NAME_COUNT]);
+	}
+	timer.stop();
+	const F64 idMapTime = timer.getElapsedTime() / NAME_COUNT * 1000000000.0;
+
+	ANKI_TEST_LOGI("%u names. Insert: StringTable %fns, STL %fns. Lookup: StringTable %fns, STL %fns",
+		NAME_COUNT,
+		internInsertTime,
+		stlInsertTime,
+		internLookupTime,
+		stlLookupTime);
+	ANKI_TEST_LOGI("Object by name: FlatHashMap<CString> %fns, FlatHashMap<StringId> %fns (%llu)",
+		stringMapTime,
+		idMapTime,
+		sum);
+
+	stringMap.destroy(alloc);
+	idMap.destroy(alloc);
+	for(String& name : names)
+	{
+		name.destroy(alloc);
+	}
+}
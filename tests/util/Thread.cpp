@@ -8,7 +8,10 @@
 #include "anki/util/StdTypes.h"
 #include "anki/util/HighRezTimer.h"
 #include "anki/util/ThreadPool.h"
+#include "anki/util/ThreadHive.h"
+#include "anki/util/System.h"
 #include <cstring>
+#include <memory>
 
 namespace anki
 {
@@ -196,3 +199,272 @@ ANKI_TEST(Util, Barrier)
 		ANKI_TEST_EXPECT_NO_ERR(t.join());
 	}
 }
+
+namespace anki
+{
+
+/// Check that parallelFor() and parallelReduce() visit every element once.
+template<typename TScheduler>
+static void testParallelFor(TScheduler& scheduler)
+{
+	const U ELEMENT_COUNT = 10007;
+	std::unique_ptr<Atomic<U32>[]> visits(new Atomic<U32>[ELEMENT_COUNT]);
+
+	for(PtrSize grainSize : {PtrSize(1), PtrSize(7), PtrSize(64), PtrSize(ELEMENT_COUNT * 2)})
+	{
+		for(U i = 0; i < ELEMENT_COUNT; ++i)
+		{
+			visits[i].set(0);
+		}
+
+		Atomic<U32> badThreadId = {0};
+		Error err =
+			scheduler.parallelFor(ELEMENT_COUNT, grainSize, [&](U32 threadId, PtrSize start, PtrSize end) -> Error {
+				if(threadId >= scheduler.getThreadCount() || start >= end || end - start > grainSize)
+				{
+					badThreadId.fetchAdd(1);
+				}
+
+				for(PtrSize i = start; i < end; ++i)
+				{
+					visits[i].fetchAdd(1);
+				}
+
+				return Error::NONE;
+			});
+
+		ANKI_TEST_EXPECT_NO_ERR(err);
+		ANKI_TEST_EXPECT_EQ(badThreadId.load(), 0);
+		U32 wrongVisits = 0;
+		for(U i = 0; i < ELEMENT_COUNT; ++i)
+		{
+			wrongVisits += visits[i].load() != 1;
+		}
+		ANKI_TEST_EXPECT_EQ(wrongVisits, 0);
+
+		const U64 sum = scheduler.parallelReduce(ELEMENT_COUNT,
+			grainSize,
+			U64(0),
+			[](U32 threadId, PtrSize start, PtrSize end) {
+				U64 sum = 0;
+				for(PtrSize i = start; i < end; ++i)
+				{
+					sum += i;
+				}
+				return sum;
+			},
+			[](U64 a, U64 b) { return a + b; });
+
+		ANKI_TEST_EXPECT_EQ(sum, U64(ELEMENT_COUNT) * (ELEMENT_COUNT - 1) / 2);
+	}
+
+	// Empty range
+	Error err = scheduler.parallelFor(
+		0, 1, [&](U32 threadId, PtrSize start, PtrSize end) -> Error { return Error::FUNCTION_FAILED; });
+	ANKI_TEST_EXPECT_NO_ERR(err);
+	ANKI_TEST_EXPECT_EQ(scheduler.parallelReduce(0, 1, 123, [](U32, PtrSize, PtrSize) { return 1; }, [](I a, I b) {
+		return a + b;
+	}),
+		123);
+
+	// Errors should propagate
+	err = scheduler.parallelFor(ELEMENT_COUNT, 16, [&](U32 threadId, PtrSize start, PtrSize end) -> Error {
+		return (start <= 5000 && end > 5000) ? Error::FUNCTION_FAILED : Error::NONE;
+	});
+	ANKI_TEST_EXPECT_EQ(err, Error::FUNCTION_FAILED);
+}
+
+/// Work with a cost that grows with the index. Splitting such a range in equal parts leaves the threads that got the
+/// first parts idle.
+static U64 parallelForBenchWork(PtrSize i)
+{
+	U64 x = i;
+	const PtrSize cost = i / 8;
+	for(PtrSize j = 0; j < cost; ++j)
+	{
+		x = x * 6364136223846793005u + 1442695040888963407u;
+	}
+	return x;
+}
+
+class ParallelForBenchStaticTask : public ThreadPoolTask
+{
+public:
+	U64* m_out = nullptr;
+	PtrSize m_elementCount = 0;
+
+	Error operator()(U32 threadId, PtrSize threadsCount)
+	{
+		PtrSize start, end;
+		choseStartEnd(threadId, threadsCount, m_elementCount, start, end);
+		for(PtrSize i = start; i < end; ++i)
+		{
+			m_out[i] = parallelForBenchWork(i);
+		}
+		return Error::NONE;
+	}
+};
+
+} // end namespace anki
+
+ANKI_TEST(Util, ParallelFor)
+{
+	{
+		ThreadPool pool(4);
+		testParallelFor(pool);
+	}
+
+	{
+		HeapAllocator<U8> alloc(allocAligned, nullptr);
+		ThreadHive hive(4, alloc);
+		testParallelFor(hive);
+	}
+}
+
+ANKI_TEST(Util, ThreadPoolManyThreads)
+{
+	// More threads than the old limit of 32 and probably more than the CPUs
+	const U32 THREAD_COUNT = 300;
+	const U ELEMENT_COUNT = 100000;
+
+	{
+		ThreadPool pool(THREAD_COUNT, true);
+		ANKI_TEST_EXPECT_EQ(pool.getThreadCount(), THREAD_COUNT);
+
+		const U64 sum = pool.parallelReduce(ELEMENT_COUNT,
+			16,
+			U64(0),
+			[](U32, PtrSize start, PtrSize end) { return U64(end - start); },
+			[](U64 a, U64 b) { return a + b; });
+		ANKI_TEST_EXPECT_EQ(sum, ELEMENT_COUNT);
+	}
+
+	{
+		HeapAllocator<U8> alloc(allocAligned, nullptr);
+		ThreadHive hive(THREAD_COUNT, alloc, true);
+		ANKI_TEST_EXPECT_EQ(hive.getThreadCount(), THREAD_COUNT + 1);
+
+		const U64 sum = hive.parallelReduce(ELEMENT_COUNT,
+			16,
+			U64(0),
+			[](U32, PtrSize start, PtrSize end) { return U64(end - start); },
+			[](U64 a, U64 b) { return a + b; });
+		ANKI_TEST_EXPECT_EQ(sum, ELEMENT_COUNT);
+		hive.waitAllTasks();
+	}
+}
+
+ANKI_TEST(Util, CpuPinningOrder)
+{
+	const U32 cpuCount = getCpuCoresCount();
+	std::unique_ptr<U32[]> cpus(new U32[cpuCount]);
+	getCpuPinningOrder(WeakArray<U32>(&cpus[0], cpuCount));
+
+	// It should be a permutation
+	std::unique_ptr<U32[]> seen(new U32[cpuCount]);
+	for(U32 i = 0; i < cpuCount; ++i)
+	{
+		seen[i] = 0;
+	}
+
+	for(U32 i = 0; i < cpuCount; ++i)
+	{
+		ANKI_TEST_EXPECT_LT(cpus[i], cpuCount);
+		++seen[cpus[i]];
+		ANKI_TEST_LOGI("Thread %u -> CPU %u", i, cpus[i]);
+	}
+
+	for(U32 i = 0; i < cpuCount; ++i)
+	{
+		ANKI_TEST_EXPECT_EQ(seen[i], 1);
+	}
+}
+
+ANKI_TEST(Util, ParallelForBench)
+{
+	const U ELEMENT_COUNT = 16 * 1024;
+	const U GRAIN_SIZE = 64;
+	const U ITERATIONS = 4;
+	std::unique_ptr<U64[]> out(new U64[ELEMENT_COUNT]);
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	// Serial time is the baseline of the speedups
+	Second serialTime = HighRezTimer::getCurrentTime();
+	for(U it = 0; it < ITERATIONS; ++it)
+	{
+		for(U i = 0; i < ELEMENT_COUNT; ++i)
+		{
+			out[i] = parallelForBenchWork(i);
+		}
+	}
+	serialTime = (HighRezTimer::getCurrentTime() - serialTime) / ITERATIONS;
+	ANKI_TEST_LOGI("Serial: %fms", serialTime * 1000.0);
+
+	for(U32 threadCount = 1; threadCount <= 32; threadCount *= 2)
+	{
+		Second staticTime, dynamicTime, hiveTime;
+
+		{
+			ThreadPool pool(threadCount);
+
+			ParallelForBenchStaticTask task;
+			task.m_out = &out[0];
+			task.m_elementCount = ELEMENT_COUNT;
+
+			staticTime = HighRezTimer::getCurrentTime();
+			for(U it = 0; it < ITERATIONS; ++it)
+			{
+				for(U32 i = 0; i < threadCount; ++i)
+				{
+					pool.assignNewTask(i, &task);
+				}
+				ANKI_TEST_EXPECT_NO_ERR(pool.waitForAllThreadsToFinish());
+			}
+			staticTime = (HighRezTimer::getCurrentTime() - staticTime) / ITERATIONS;
+
+			dynamicTime = HighRezTimer::getCurrentTime();
+			for(U it = 0; it < ITERATIONS; ++it)
+			{
+				Error err = pool.parallelFor(ELEMENT_COUNT, GRAIN_SIZE, [&](U32, PtrSize start, PtrSize end) -> Error {
+					for(PtrSize i = start; i < end; ++i)
+					{
+						out[i] = parallelForBenchWork(i);
+					}
+					return Error::NONE;
+				});
+				ANKI_TEST_EXPECT_NO_ERR(err);
+			}
+			dynamicTime = (HighRezTimer::getCurrentTime() - dynamicTime) / ITERATIONS;
+		}
+
+		{
+			// The waiting thread works as well so create one thread less
+			ThreadHive hive(threadCount - 1, alloc);
+
+			hiveTime = HighRezTimer::getCurrentTime();
+			for(U it = 0; it < ITERATIONS; ++it)
+			{
+				Error err = hive.parallelFor(ELEMENT_COUNT, GRAIN_SIZE, [&](U32, PtrSize start, PtrSize end) -> Error {
+					for(PtrSize i = start; i < end; ++i)
+					{
+						out[i] = parallelForBenchWork(i);
+					}
+					return Error::NONE;
+				});
+				ANKI_TEST_EXPECT_NO_ERR(err);
+				hive.waitAllTasks();
+			}
+			hiveTime = (HighRezTimer::getCurrentTime() - hiveTime) / ITERATIONS;
+		}
+
+		ANKI_TEST_LOGI("%2u threads: ThreadPool static %fms (%.2fx), ThreadPool parallelFor %fms (%.2fx), "
+					   "ThreadHive parallelFor %fms (%.2fx)",
+			threadCount,
+			staticTime * 1000.0,
+			serialTime / staticTime,
+			dynamicTime * 1000.0,
+			serialTime / dynamicTime,
+			hiveTime * 1000.0,
+			serialTime / hiveTime);
+	}
+}
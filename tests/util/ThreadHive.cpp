@@ -7,6 +7,10 @@
 #include <anki/util/ThreadHive.h>
 #include <anki/util/HighRezTimer.h>
 #include <anki/util/System.h>
+#include <anki/util/Thread.h>
+#include <algorithm>
+#include <vector>
+#include <deque>
 
 namespace anki
 {
@@ -58,6 +62,14 @@ static void taskToWait(void* arg, U32 threadId, ThreadHive& hive, ThreadHiveSema
 	ANKI_TEST_EXPECT_GEQ(prev, 10);
 }
 
+static void checkThreadId(void* arg, U32 threadId, ThreadHive& hive, ThreadHiveSemaphore* sem)
+{
+	ThreadHiveTestContext* ctx = static_cast<ThreadHiveTestContext*>(arg);
+	ANKI_TEST_EXPECT_LT(threadId, hive.getThreadCount());
+	HighRezTimer::sleep(0.001);
+	ctx->m_countAtomic.fetchAdd(1);
+}
+
 ANKI_TEST(Util, ThreadHive)
 {
 	const U32 threadCount = 4;
@@ -124,6 +136,48 @@ ANKI_TEST(Util, ThreadHive)
 		ANKI_TEST_EXPECT_EQ(ctx.m_countAtomic.get(), DEP_TASKS * 2 + 10);
 	}
 
+	// Wait semaphore test
+	if(1)
+	{
+		ThreadHiveTestContext ctx;
+		ctx.m_count = 0;
+
+		// A task that will stay pending while waiting on the semaphore
+		ThreadHiveTestContext pendingCtx;
+		pendingCtx.m_countAtomic.set(0);
+		ThreadHiveTask gateTask;
+		gateTask.m_callback = decNumber;
+		gateTask.m_argument = &pendingCtx;
+		gateTask.m_signalSemaphore = hive.newSemaphore(1);
+
+		ThreadHiveTask pendingTask;
+		pendingTask.m_callback = incNumber;
+		pendingTask.m_argument = &pendingCtx;
+		pendingTask.m_waitSemaphore = gateTask.m_signalSemaphore;
+		hive.submitTasks(&pendingTask, 1);
+
+		const U TASK_COUNT = 100;
+		ThreadHiveSemaphore* sem = hive.newSemaphore(TASK_COUNT);
+		ThreadHiveTask tasks[TASK_COUNT];
+		for(U i = 0; i < TASK_COUNT; ++i)
+		{
+			tasks[i].m_callback = checkThreadId;
+			tasks[i].m_argument = &ctx;
+			tasks[i].m_signalSemaphore = sem;
+		}
+
+		hive.submitTasks(&tasks[0], TASK_COUNT);
+
+		hive.waitSemaphore(sem);
+		ANKI_TEST_EXPECT_EQ(ctx.m_countAtomic.get(), TASK_COUNT);
+		ANKI_TEST_EXPECT_EQ(pendingCtx.m_countAtomic.get(), 0);
+
+		// Open the gate
+		hive.submitTasks(&gateTask, 1);
+		hive.waitAllTasks();
+		ANKI_TEST_EXPECT_EQ(pendingCtx.m_countAtomic.get(), 0);
+	}
+
 	// Fuzzy test
 	if(1)
 	{
@@ -169,6 +223,121 @@ ANKI_TEST(Util, ThreadHive)
 	}
 }
 
+/// Records the order the tasks run.
+class PriorityTestContext
+{
+public:
+	Array<ThreadHiveTaskPriority, 64> m_order;
+	Atomic<U32> m_count = {0};
+};
+
+class PriorityTestTask
+{
+public:
+	PriorityTestContext* m_ctx;
+	ThreadHiveTaskPriority m_priority;
+
+	static void callback(void* arg, U32, ThreadHive& hive, ThreadHiveSemaphore*)
+	{
+		PriorityTestTask& self = *static_cast<PriorityTestTask*>(arg);
+		self.m_ctx->m_order[self.m_ctx->m_count.fetchAdd(1)] = self.m_priority;
+	}
+};
+
+ANKI_TEST(Util, ThreadHivePriorities)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	// With no worker threads the waiting thread runs everything so the order is deterministic
+	ThreadHive hive(0, alloc);
+
+	const U TASKS_PER_PRIORITY = 8;
+	Array<PriorityTestTask, TASKS_PER_PRIORITY * 3> tasks;
+	PriorityTestContext ctx;
+
+	// Submit in reverse priority order
+	auto submitAll = [&]() {
+		ctx.m_count.set(0);
+		for(U i = 0; i < tasks.getSize(); ++i)
+		{
+			tasks[i].m_ctx = &ctx;
+			tasks[i].m_priority = ThreadHiveTaskPriority(2 - i / TASKS_PER_PRIORITY);
+			hive.submitTask(PriorityTestTask::callback, &tasks[i], tasks[i].m_priority);
+		}
+	};
+
+	// Priority order
+	if(1)
+	{
+		hive.resetStats();
+		submitAll();
+
+		ThreadHiveStats stats = hive.getStats(ThreadHiveTaskPriority::BACKGROUND);
+		ANKI_TEST_EXPECT_EQ(stats.m_queueDepth, TASKS_PER_PRIORITY);
+
+		hive.waitAllTasks();
+
+		ANKI_TEST_EXPECT_EQ(ctx.m_count.get(), tasks.getSize());
+		for(U i = 0; i < tasks.getSize(); ++i)
+		{
+			ANKI_TEST_EXPECT_EQ(U(ctx.m_order[i]), i / TASKS_PER_PRIORITY);
+		}
+
+		for(ThreadHiveTaskPriority p = ThreadHiveTaskPriority::FIRST; p < ThreadHiveTaskPriority::COUNT; ++p)
+		{
+			stats = hive.getStats(p);
+			ANKI_TEST_EXPECT_EQ(stats.m_queueDepth, 0);
+			ANKI_TEST_EXPECT_EQ(stats.m_maxQueueDepth, TASKS_PER_PRIORITY);
+			ANKI_TEST_EXPECT_EQ(stats.m_startedTaskCount, TASKS_PER_PRIORITY);
+			ANKI_TEST_EXPECT_EQ(stats.m_deferredTaskCount, 0);
+		}
+	}
+
+	// Frame deadline
+	if(1)
+	{
+		hive.resetStats();
+
+		// The deadline has passed so the BACKGROUND tasks shouldn't run
+		hive.setFrameDeadline(HighRezTimer::getCurrentTime() - 1.0);
+		submitAll();
+		hive.waitAllTasks();
+
+		ANKI_TEST_EXPECT_EQ(ctx.m_count.get(), TASKS_PER_PRIORITY * 2);
+		ANKI_TEST_EXPECT_EQ(
+			hive.getStats(ThreadHiveTaskPriority::BACKGROUND).m_deferredTaskCount, TASKS_PER_PRIORITY);
+		ANKI_TEST_EXPECT_EQ(hive.getStats(ThreadHiveTaskPriority::BACKGROUND).m_startedTaskCount, 0);
+
+		// Next frame, the deferred tasks run
+		ctx.m_count.set(0);
+		hive.setFrameDeadline(MAX_SECOND);
+		hive.waitAllTasks();
+
+		ANKI_TEST_EXPECT_EQ(ctx.m_count.get(), TASKS_PER_PRIORITY);
+		for(U i = 0; i < TASKS_PER_PRIORITY; ++i)
+		{
+			ANKI_TEST_EXPECT_EQ(ctx.m_order[i], ThreadHiveTaskPriority::BACKGROUND);
+		}
+	}
+
+	// Mixed priorities with worker threads
+	if(1)
+	{
+		ThreadHive hive(4, alloc);
+		ThreadHiveTestContext tctx;
+		tctx.m_countAtomic.set(0);
+
+		const U TASK_COUNT = 1000;
+		for(U i = 0; i < TASK_COUNT; ++i)
+		{
+			hive.submitTask(incNumber, &tctx, ThreadHiveTaskPriority(i % 3));
+		}
+
+		hive.waitAllTasks();
+		ANKI_TEST_EXPECT_EQ(tctx.m_countAtomic.get(), TASK_COUNT * 2);
+	}
+}
+
 class FibTask
 {
 public:
@@ -245,4 +414,232 @@ ANKI_TEST(Util, ThreadHiveBench)
 	ANKI_TEST_EXPECT_EQ(sum.get(), serialFib);
 }
 
+/// A scheduler with a single locked queue that wakes all threads on every event. It's the design ThreadHive had before
+/// it moved to work-stealing and it's kept here as a reference point for the benchmarks.
+class GlobalQueueHive
+{
+public:
+	using Callback = void (*)(void*, U32 threadId, GlobalQueueHive& hive, ThreadHiveSemaphore* signalSemaphore);
+
+	GlobalQueueHive(U32 threadCount)
+	{
+		for(U32 i = 0; i < threadCount; ++i)
+		{
+			m_threads.push_back(new Thread("anki_globalhive"));
+		}
+
+		for(U32 i = 0; i < threadCount; ++i)
+		{
+			m_threads[i]->start(this, [](ThreadCallbackInfo& info) -> Error {
+				GlobalQueueHive& self = *static_cast<GlobalQueueHive*>(info.m_userData);
+				self.threadRun(self.m_nextThreadId.fetchAdd(1));
+				return Error::NONE;
+			});
+		}
+	}
+
+	~GlobalQueueHive()
+	{
+		{
+			LockGuard<Mutex> lock(m_mtx);
+			m_quit = true;
+			m_cvar.notifyAll();
+		}
+
+		for(Thread* t : m_threads)
+		{
+			ANKI_TEST_EXPECT_NO_ERR(t->join());
+			delete t;
+		}
+	}
+
+	U32 getThreadCount() const
+	{
+		return m_threads.size();
+	}
+
+	void submitTask(Callback cb, void* arg)
+	{
+		{
+			LockGuard<Mutex> lock(m_mtx);
+			m_tasks.push_back({cb, arg});
+			++m_pendingTasks;
+		}
+
+		m_cvar.notifyAll();
+	}
+
+	void waitAllTasks()
+	{
+		LockGuard<Mutex> lock(m_mtx);
+		while(m_pendingTasks > 0)
+		{
+			m_cvar.wait(m_mtx);
+		}
+	}
+
+private:
+	std::vector<Thread*> m_threads;
+	Atomic<U32> m_nextThreadId = {0};
+	std::deque<std::pair<Callback, void*>> m_tasks;
+	U32 m_pendingTasks = 0;
+	Bool m_quit = false;
+	Mutex m_mtx;
+	ConditionVariable m_cvar;
+
+	void threadRun(U32 threadId)
+	{
+		Bool taskDone = false;
+		while(true)
+		{
+			std::pair<Callback, void*> task;
+			{
+				LockGuard<Mutex> lock(m_mtx);
+
+				if(taskDone)
+				{
+					--m_pendingTasks;
+					m_cvar.notifyAll();
+				}
+
+				while(!m_quit && m_tasks.empty())
+				{
+					m_cvar.wait(m_mtx);
+				}
+
+				if(m_quit)
+				{
+					break;
+				}
+
+				task = m_tasks.front();
+				m_tasks.pop_front();
+			}
+
+			task.first(task.second, threadId, *this, nullptr);
+			taskDone = true;
+		}
+	}
+};
+
+/// Context of the scheduling benchmark.
+class SchedulingBenchContext
+{
+public:
+	std::vector<F64> m_latencies; ///< Time between submission and execution of every task.
+	Atomic<U32> m_latencyCount = {0};
+	U32 m_fanOut = 0;
+};
+
+/// A task of the scheduling benchmark. It spawns m_depth levels of children, like the visibility tests do.
+class SchedulingBenchTask
+{
+public:
+	SchedulingBenchContext* m_ctx;
+	Second m_submitTime;
+	U32 m_depth;
+
+	template<typename THive>
+	static void callback(void* arg, U32, THive& hive, ThreadHiveSemaphore*)
+	{
+		SchedulingBenchTask& self = *static_cast<SchedulingBenchTask*>(arg);
+		SchedulingBenchContext& ctx = *self.m_ctx;
+
+		const Second latency = HighRezTimer::getCurrentTime() - self.m_submitTime;
+		ctx.m_latencies[ctx.m_latencyCount.fetchAdd(1)] = latency;
+
+		// Some dummy work
+		volatile U32 sum = 0;
+		for(U32 i = 0; i < 256; ++i)
+		{
+			sum = sum + i;
+		}
+
+		if(self.m_depth > 0)
+		{
+			for(U32 i = 0; i < ctx.m_fanOut; ++i)
+			{
+				SchedulingBenchTask& child = (&self)[1 + i * subtreeSize(self.m_depth - 1, ctx.m_fanOut)];
+				child.m_ctx = &ctx;
+				child.m_depth = self.m_depth - 1;
+				child.m_submitTime = HighRezTimer::getCurrentTime();
+				hive.submitTask(callback<THive>, &child);
+			}
+		}
+	}
+
+	static U32 subtreeSize(U32 depth, U32 fanOut)
+	{
+		return (depth == 0) ? 1 : 1 + fanOut * subtreeSize(depth - 1, fanOut);
+	}
+};
+
+template<typename THive>
+static void benchScheduling(THive& hive, const char* name)
+{
+	const U32 ROOT_COUNT = 64;
+	const U32 DEPTH = 3;
+	const U32 FAN_OUT = 8;
+	const U32 ITERATIONS = 10;
+	const U32 subtreeSize = SchedulingBenchTask::subtreeSize(DEPTH, FAN_OUT);
+	const U32 taskCount = ROOT_COUNT * subtreeSize;
+
+	SchedulingBenchContext ctx;
+	ctx.m_fanOut = FAN_OUT;
+	ctx.m_latencies.resize(taskCount);
+
+	std::vector<SchedulingBenchTask> tasks(taskCount);
+	std::vector<F64> allLatencies;
+
+	Second totalTime = 0.0;
+	for(U32 it = 0; it < ITERATIONS; ++it)
+	{
+		ctx.m_latencyCount.set(0);
+
+		const Second begin = HighRezTimer::getCurrentTime();
+		for(U32 i = 0; i < ROOT_COUNT; ++i)
+		{
+			SchedulingBenchTask& root = tasks[i * subtreeSize];
+			root.m_ctx = &ctx;
+			root.m_depth = DEPTH;
+			root.m_submitTime = HighRezTimer::getCurrentTime();
+			hive.submitTask(SchedulingBenchTask::callback<THive>, &root);
+		}
+
+		hive.waitAllTasks();
+		totalTime += HighRezTimer::getCurrentTime() - begin;
+
+		ANKI_TEST_EXPECT_EQ(ctx.m_latencyCount.get(), taskCount);
+		allLatencies.insert(allLatencies.end(), ctx.m_latencies.begin(), ctx.m_latencies.end());
+	}
+
+	std::sort(allLatencies.begin(), allLatencies.end());
+	auto percentile = [&](F64 p) { return allLatencies[min<PtrSize>(allLatencies.size() * p, allLatencies.size() - 1)]; };
+
+	ANKI_TEST_LOGI("%s (%u threads): %.0f tasks/sec. Latency: p50 %.3fus, p99 %.3fus, p99.9 %.3fus, max %.3fus",
+		name,
+		hive.getThreadCount(),
+		F64(taskCount * ITERATIONS) / totalTime,
+		percentile(0.5) * 1000000.0,
+		percentile(0.99) * 1000000.0,
+		percentile(0.999) * 1000000.0,
+		allLatencies.back() * 1000000.0);
+}
+
+ANKI_TEST(Util, ThreadHiveSchedulingBench)
+{
+	const U32 threadCount = getCpuCoresCount();
+
+	{
+		HeapAllocator<U8> alloc(allocAligned, nullptr);
+		ThreadHive hive(threadCount, alloc);
+		benchScheduling(hive, "ThreadHive");
+	}
+
+	{
+		GlobalQueueHive hive(threadCount);
+		benchScheduling(hive, "Global queue");
+	}
+}
+
 } // end namespace anki
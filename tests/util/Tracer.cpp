@@ -6,6 +6,7 @@
 #include <tests/framework/Framework.h>
 #include <anki/util/Tracer.h>
 #include <anki/util/HighRezTimer.h>
+#include <cstdio>
 
 ANKI_TEST(Util, Tracer)
 {
@@ -50,3 +51,176 @@ ANKI_TEST(Util, Tracer)
 
 	ANKI_TEST_EXPECT_NO_ERR(tracer.flush("./1"));
 }
+
+ANKI_TEST(Util, TracerBoundedMemory)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	Tracer tracer;
+
+	// Drain rarely so the ring buffer fills
+	const U32 RING_SIZE = 16;
+	tracer.init(alloc, RING_SIZE, 64, 10.0);
+
+	tracer.newFrame(0);
+	for(U i = 0; i < 100; ++i)
+	{
+		tracer.increaseCounter("counter", 1);
+	}
+
+	// The frame record takes one slot
+	ANKI_TEST_EXPECT_EQ(tracer.getDroppedRecordCount(), 100 - (RING_SIZE - 1));
+
+	// Capturing drains so there is space again
+	ANKI_TEST_EXPECT_NO_ERR(tracer.captureLastFrames(1, "./bounded"));
+	tracer.increaseCounter("counter", 1);
+	ANKI_TEST_EXPECT_EQ(tracer.getDroppedRecordCount(), 100 - (RING_SIZE - 1));
+
+	// Push more than the history holds. Only the last records should remain
+	for(U frame = 1; frame < 100; ++frame)
+	{
+		tracer.newFrame(frame);
+		tracer.increaseCounter("counter", frame);
+		ANKI_TEST_EXPECT_NO_ERR(tracer.captureLastFrames(1, "./bounded"));
+	}
+
+	StringAuto csv(alloc);
+	File file;
+	ANKI_TEST_EXPECT_NO_ERR(tracer.flush("./bounded"));
+	ANKI_TEST_EXPECT_NO_ERR(file.open("./bounded.counters.csv", FileOpenFlag::READ));
+	ANKI_TEST_EXPECT_NO_ERR(file.readAllText(csv));
+	ANKI_TEST_EXPECT_EQ(csv.find("\n40,"), StringAuto::NPOS);
+	ANKI_TEST_EXPECT_NEQ(csv.find("\n99,99\n"), StringAuto::NPOS);
+}
+
+ANKI_TEST(Util, TracerCaptureLastFrames)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	Tracer tracer;
+	tracer.init(alloc);
+
+	for(U frame = 0; frame < 10; ++frame)
+	{
+		tracer.newFrame(frame);
+		tracer.increaseCounter("counter", frame * 10);
+		tracer.increaseCounter("counter", frame);
+
+		auto handle = tracer.beginEvent();
+		HighRezTimer::sleep(0.001);
+		tracer.endEvent("event", handle);
+	}
+
+	ANKI_TEST_EXPECT_NO_ERR(tracer.captureLastFrames(3, "./last"));
+
+	StringAuto csv(alloc);
+	File file;
+	ANKI_TEST_EXPECT_NO_ERR(file.open("./last.counters.csv", FileOpenFlag::READ));
+	ANKI_TEST_EXPECT_NO_ERR(file.readAllText(csv));
+
+	ANKI_TEST_EXPECT_NEQ(csv.find("Frame,counter,event\n7,77,"), StringAuto::NPOS);
+	ANKI_TEST_EXPECT_NEQ(csv.find("\n8,88,"), StringAuto::NPOS);
+	ANKI_TEST_EXPECT_NEQ(csv.find("\n9,99,"), StringAuto::NPOS);
+	ANKI_TEST_EXPECT_EQ(csv.find("\n6,"), StringAuto::NPOS);
+}
+
+ANKI_TEST(Util, TracerRequestCaptureLastFrames)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	{
+		Tracer tracer;
+		tracer.init(alloc);
+
+		for(U frame = 0; frame < 10; ++frame)
+		{
+			tracer.newFrame(frame);
+			tracer.increaseCounter("counter", frame);
+
+			// The frames after the request are not captured
+			if(frame == 7)
+			{
+				tracer.requestCaptureLastFrames(3, "./requested");
+			}
+		}
+
+		// The destructor writes the captures that are still pending
+	}
+
+	StringAuto csv(alloc);
+	File file;
+	ANKI_TEST_EXPECT_NO_ERR(file.open("./requested.counters.csv", FileOpenFlag::READ));
+	ANKI_TEST_EXPECT_NO_ERR(file.readAllText(csv));
+
+	ANKI_TEST_EXPECT_NEQ(csv.find("Frame,counter\n5,5\n6,6\n7,7\n"), StringAuto::NPOS);
+	ANKI_TEST_EXPECT_EQ(csv.find("\n4,"), StringAuto::NPOS);
+	ANKI_TEST_EXPECT_EQ(csv.find("\n8,"), StringAuto::NPOS);
+}
+
+ANKI_TEST(Util, TracerStreaming)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+
+	{
+		Tracer tracer;
+		tracer.init(alloc, 1024, 1024, 0.001);
+		ANKI_TEST_EXPECT_NO_ERR(tracer.beginStreaming("./stream.ankitrace"));
+
+		// Record from a few threads for longer than the history holds
+		Array<Thread*, 4> threads;
+		for(U i = 0; i < threads.getSize(); ++i)
+		{
+			threads[i] = alloc.newInstance<Thread>("anki_test");
+			threads[i]->start(&tracer, [](ThreadCallbackInfo& info) -> Error {
+				Tracer& tracer = *static_cast<Tracer*>(info.m_userData);
+				for(U j = 0; j < 1000; ++j)
+				{
+					auto handle = tracer.beginEvent();
+					tracer.increaseCounter("thread counter", 1);
+					tracer.endEvent("thread event", handle);
+
+					if(j % 100 == 0)
+					{
+						HighRezTimer::sleep(0.002);
+					}
+				}
+				return Error::NONE;
+			});
+		}
+
+		for(U frame = 0; frame < 10; ++frame)
+		{
+			tracer.newFrame(frame);
+			HighRezTimer::sleep(0.002);
+		}
+
+		for(Thread* thread : threads)
+		{
+			ANKI_TEST_EXPECT_NO_ERR(thread->join());
+			alloc.deleteInstance(thread);
+		}
+
+		ANKI_TEST_EXPECT_NO_ERR(tracer.endStreaming());
+		ANKI_TEST_EXPECT_EQ(tracer.getDroppedRecordCount(), 0);
+	}
+
+	// Convert and check that nothing got lost
+	ANKI_TEST_EXPECT_NO_ERR(Tracer::convertToChromeTrace("./stream.ankitrace", "./stream", alloc));
+
+	StringAuto csv(alloc);
+	File file;
+	ANKI_TEST_EXPECT_NO_ERR(file.open("./stream.counters.csv", FileOpenFlag::READ));
+	ANKI_TEST_EXPECT_NO_ERR(file.readAllText(csv));
+	ANKI_TEST_EXPECT_NEQ(csv.find("Frame,thread counter,thread event\n"), StringAuto::NPOS);
+	ANKI_TEST_EXPECT_NEQ(csv.find("SUM,=SUM(B2:"), StringAuto::NPOS);
+
+	U64 sum = 0;
+	CString line = csv.toCString();
+	const char* it = strchr(line.cstr(), '\n');
+	while(it && it[1] >= '0' && it[1] <= '9')
+	{
+		unsigned long long frame, count;
+		ANKI_TEST_EXPECT_EQ(sscanf(it + 1, "%llu,%llu,", &frame, &count), 2);
+		sum += count;
+		it = strchr(it + 1, '\n');
+	}
+	ANKI_TEST_EXPECT_EQ(sum, 4 * 1000);
+}
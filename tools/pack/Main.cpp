@@ -0,0 +1,169 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/resource/PackArchive.h>
+#include <anki/util/Filesystem.h>
+#include <anki/util/StringList.h>
+#include <anki/util/Logger.h>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace anki;
+
+static const char* USAGE = R"(Create a pack archive (.ankipack) from the files of a directory
+Usage: %s [options] in_directory out_file.ankipack
+Options:
+-b <size>        The uncompressed size of the compressed blocks in KB. Default is 64
+-u <extensions>  Comma separated list of file extensions that will be stored uncompressed so they can be mapped.
+                 Default is "ankitex"
+-n               Don't compress anything
+)";
+
+class Context
+{
+public:
+	HeapAllocator<U8> m_alloc;
+	CString m_inDir;
+	StringListAuto m_filenames;
+	StringListAuto m_uncompressedExtensions;
+	Bool m_compress = true;
+
+	Context(HeapAllocator<U8> alloc)
+		: m_alloc(alloc)
+		, m_filenames(alloc)
+		, m_uncompressedExtensions(alloc)
+	{
+	}
+};
+
+static Error parseCommandLineArgs(int argc, char** argv, Context& ctx, U32& blockSize)
+{
+	if(argc < 3)
+	{
+		return Error::USER_DATA;
+	}
+
+	CString uncompressedExtensions = "ankitex";
+	blockSize = PackArchiveFile::DEFAULT_BLOCK_SIZE;
+	for(I i = 1; i < argc - 2; ++i)
+	{
+		if(CString(argv[i]) == "-b" && i + 1 < argc - 2)
+		{
+			blockSize = U32(atoi(argv[++i])) * 1024;
+			if(blockSize == 0)
+			{
+				return Error::USER_DATA;
+			}
+		}
+		else if(CString(argv[i]) == "-u" && i + 1 < argc - 2)
+		{
+			uncompressedExtensions = argv[++i];
+		}
+		else if(CString(argv[i]) == "-n")
+		{
+			ctx.m_compress = false;
+		}
+		else
+		{
+			return Error::USER_DATA;
+		}
+	}
+
+	ctx.m_inDir = argv[argc - 2];
+	ctx.m_uncompressedExtensions.splitString(uncompressedExtensions, ',');
+	return Error::NONE;
+}
+
+static Error packDirectory(Context& ctx, CString outFilename, U32 blockSize)
+{
+	// Gather the files
+	ANKI_CHECK(walkDirectoryTree(ctx.m_inDir, &ctx, [](const CString& fname, void* ud, Bool isDir) -> Error {
+		if(!isDir)
+		{
+			static_cast<Context*>(ud)->m_filenames.pushBackSprintf("%s", fname.cstr());
+		}
+
+		return Error::NONE;
+	}));
+
+	if(ctx.m_filenames.isEmpty())
+	{
+		ANKI_LOGE("Directory is empty: %s", ctx.m_inDir.cstr());
+		return Error::USER_DATA;
+	}
+
+	// Pack them
+	PackArchiveWriter writer(ctx.m_alloc);
+	ANKI_CHECK(writer.begin(outFilename, blockSize));
+
+	PtrSize totalSize = 0;
+	U32 compressedCount = 0;
+	for(const String& fname : ctx.m_filenames)
+	{
+		StringAuto path(ctx.m_alloc);
+		path.sprintf("%s/%s", ctx.m_inDir.cstr(), fname.cstr());
+
+		File file;
+		ANKI_CHECK(file.open(path.toCString(), FileOpenFlag::READ | FileOpenFlag::BINARY));
+		DynamicArrayAuto<U8> data(ctx.m_alloc);
+		if(file.getSize() > 0)
+		{
+			data.create(file.getSize());
+			ANKI_CHECK(file.read(&data[0], data.getSize()));
+		}
+
+		Bool compress = ctx.m_compress;
+		StringAuto ext(ctx.m_alloc);
+		getFilepathExtension(fname.toCString(), ext);
+		for(const String& uncompressedExt : ctx.m_uncompressedExtensions)
+		{
+			if(!ext.isEmpty() && uncompressedExt == ext)
+			{
+				compress = false;
+			}
+		}
+
+		ANKI_CHECK(writer.addFile(fname.toCString(),
+			ConstWeakArray<U8>(data),
+			(compress) ? PackArchiveFile::Compression::DEFLATE : PackArchiveFile::Compression::NONE));
+
+		totalSize += data.getSize();
+		compressedCount += compress;
+	}
+
+	ANKI_CHECK(writer.end());
+
+	File file;
+	ANKI_CHECK(file.open(outFilename, FileOpenFlag::READ | FileOpenFlag::BINARY));
+	ANKI_LOGI("Packed %u files (%u compressed) of %luKB to %s of %luKB",
+		U32(ctx.m_filenames.getSize()),
+		compressedCount,
+		totalSize / 1024,
+		outFilename.cstr(),
+		file.getSize() / 1024);
+
+	return Error::NONE;
+}
+
+int main(int argc, char** argv)
+{
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	Context ctx(alloc);
+	U32 blockSize;
+
+	if(parseCommandLineArgs(argc, argv, ctx, blockSize))
+	{
+		fprintf(stderr, USAGE, argv[0]);
+		return 1;
+	}
+
+	if(packDirectory(ctx, argv[argc - 1], blockSize))
+	{
+		ANKI_LOGE("Packing failed");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,33 @@
+// Copyright (C) 2009-2018, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <anki/util/Tracer.h>
+#include <anki/util/Logger.h>
+#include <cstdio>
+
+using namespace anki;
+
+static const char* USAGE = R"(Convert a binary trace file to a chrome trace file and a CSV file with the counters
+Usage: %s in_file out_filename
+The output files will be out_filename.trace.json and out_filename.counters.csv
+)";
+
+int main(int argc, char** argv)
+{
+	if(argc != 3)
+	{
+		fprintf(stderr, USAGE, argv[0]);
+		return 1;
+	}
+
+	HeapAllocator<U8> alloc(allocAligned, nullptr);
+	if(Tracer::convertToChromeTrace(argv[1], argv[2], alloc))
+	{
+		ANKI_LOGE("Conversion failed");
+		return 1;
+	}
+
+	return 0;
+}